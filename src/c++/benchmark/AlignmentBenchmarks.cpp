@@ -0,0 +1,407 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file AlignmentBenchmarks.cpp
+ **
+ ** \brief Exact seed matching, Smith-Waterman, ungapped and shadow rescue kernels on synthetic read pairs.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <boost/assign.hpp>
+#include <boost/foreach.hpp>
+
+#include "alignment/BandedSmithWaterman.hh"
+#include "alignment/Cigar.hh"
+#include "alignment/Cluster.hh"
+#include "alignment/FragmentMetadata.hh"
+#include "alignment/MatchArena.hh"
+#include "alignment/MatchDistribution.hh"
+#include "alignment/MatchTally.hh"
+#include "alignment/Seed.hh"
+#include "alignment/ShadowAligner.hh"
+#include "alignment/TemplateLengthStatistics.hh"
+#include "alignment/fragmentBuilder/UngappedAligner.hh"
+#include "alignment/matchFinder/ExactMaskMatcher.hh"
+#include "alignment/matchSelector/FragmentSequencingAdapterClipper.hh"
+#include "flowcell/Layout.hh"
+#include "io/MatchWriter.hh"
+#include "oligo/Nucleotides.hh"
+#include "reference/Contig.hh"
+#include "reference/MaskJumpTable.hh"
+#include "reference/ReferenceKmer.hh"
+
+#include "Benchmark.hh"
+
+namespace isaac
+{
+namespace benchmark
+{
+
+static const int MATCH_SCORE = 2;
+static const int MISMATCH_SCORE = -1;
+static const int GAP_OPEN_SCORE = -15;
+static const int GAP_EXTEND_SCORE = -3;
+static const int MIN_GAP_EXTEND_SCORE = 25;
+
+static const unsigned READ_LENGTH = 100;
+static const unsigned READ_PAIRS = 10000;
+static const unsigned CONTIG_LENGTH = 1000000;
+static const unsigned TEMPLATE_LENGTH = 350;
+
+static std::vector<char> randomBases(const unsigned length)
+{
+    static const char bases[] = {'A', 'C', 'G', 'T'};
+    std::vector<char> ret(length);
+    BOOST_FOREACH(char &base, ret)
+    {
+        base = bases[rand() % 4];
+    }
+    return ret;
+}
+
+/// introduces roughly one mismatch in a hundred bases
+static void mutate(std::vector<char> &bases)
+{
+    static const char bases4[] = {'A', 'C', 'G', 'T'};
+    BOOST_FOREACH(char &base, bases)
+    {
+        if (!(rand() % 100))
+        {
+            base = bases4[(oligo::getValue(base) + 1 + rand() % 3) % 4];
+        }
+    }
+}
+
+static std::vector<char> getBcl(const std::vector<char> &bases)
+{
+    std::vector<char> bcl;
+    bcl.reserve(bases.size());
+    BOOST_FOREACH(const char base, bases)
+    {
+        bcl.push_back((30 << 2) | oligo::getValue(base));
+    }
+    return bcl;
+}
+
+static std::vector<char> reverseComplement(std::vector<char>::const_iterator begin, std::vector<char>::const_iterator end)
+{
+    std::vector<char> ret;
+    ret.reserve(std::distance(begin, end));
+    while (begin != end)
+    {
+        ret.push_back(oligo::getReverseBase(oligo::getValue(*--end)));
+    }
+    return ret;
+}
+
+typedef alignment::Cluster Cluster;
+
+/**
+ * \brief Forward-reverse read pairs sampled from a random contig
+ */
+class ReadPairs
+{
+public:
+    const flowcell::ReadMetadataList readMetadataList_;
+    const flowcell::FlowcellLayoutList flowcells_;
+    std::vector<reference::Contig> contigList_;
+    /// clusters point into their bcl, both are reserved up front and never reallocated
+    std::vector<std::vector<char> > bcl_;
+    std::vector<Cluster> clusters_;
+    std::vector<unsigned long> positions_;
+
+    ReadPairs() :
+        readMetadataList_(boost::assign::list_of
+            (flowcell::ReadMetadata(1, READ_LENGTH, 0, 0))
+            (flowcell::ReadMetadata(READ_LENGTH + 1, READ_LENGTH * 2, 1, READ_LENGTH)).convert_to_container<std::vector<flowcell::ReadMetadata> >()),
+        flowcells_(1, flowcell::Layout("", flowcell::Layout::Fastq, false, 8, std::vector<unsigned>(),
+                                       readMetadataList_, alignment::SeedMetadataList(), "benchmark")),
+        contigList_(1, reference::Contig(0, "benchmark"))
+    {
+        contigList_.front().forward_ = randomBases(CONTIG_LENGTH);
+        // same as the contigs loaded for match selection
+        contigList_.front().packed_.assign(contigList_.front().forward_.begin(), contigList_.front().forward_.end());
+        bcl_.reserve(READ_PAIRS);
+        clusters_.reserve(READ_PAIRS);
+        positions_.reserve(READ_PAIRS);
+        const std::vector<char> &forward = contigList_.front().forward_;
+        while (clusters_.size() < READ_PAIRS)
+        {
+            const unsigned long position = rand() % (CONTIG_LENGTH - TEMPLATE_LENGTH);
+            std::vector<char> bases(forward.begin() + position, forward.begin() + position + READ_LENGTH);
+            const std::vector<char> mate = reverseComplement(forward.begin() + position + TEMPLATE_LENGTH - READ_LENGTH,
+                                                             forward.begin() + position + TEMPLATE_LENGTH);
+            bases.insert(bases.end(), mate.begin(), mate.end());
+            mutate(bases);
+            bcl_.push_back(getBcl(bases));
+            clusters_.push_back(Cluster(READ_LENGTH));
+            clusters_.back().init(readMetadataList_, bcl_.back().begin(), 1101, clusters_.size(), alignment::ClusterXy(0, 0), true, 0);
+            positions_.push_back(position);
+        }
+    }
+};
+
+/**
+ * \brief Seeds of reads sampled from a random contig, one in ten without a match, against the kmers of the
+ *        contig. Both are sorted the way MatchFinder hands them over for a mask. The matches go into a
+ *        MatchArena, so no match files are written.
+ */
+class ExactMaskMatcherBenchmark : public Benchmark
+{
+    typedef oligo::KmerType KmerT;
+    typedef alignment::Seed<KmerT> SeedT;
+    typedef reference::ReferenceKmer<KmerT> ReferenceKmerT;
+    static const unsigned SEEDS = 1000000;
+    static const unsigned REPEAT_THRESHOLD = 16;
+
+    const alignment::SeedMetadataList seedMetadataList_;
+    const std::vector<unsigned> contigKaryotypes_;
+    const flowcell::BarcodeMetadataList barcodeMetadataList_;
+    flowcell::TileMetadataList tileMetadataList_;
+    const boost::filesystem::path tempDirectory_;
+    alignment::matchFinder::TileClusterInfo clusterInfo_;
+    alignment::MatchTally matchTally_;
+    alignment::MatchArena matchArena_;
+    io::TileMatchWriter tileMatchWriter_;
+    io::ThreadMatchWriter matchWriter_;
+    alignment::matchFinder::ExactMaskMatcher<KmerT> matcher_;
+    const reference::MaskJumpTable<KmerT> jumpTable_;
+    std::vector<ReferenceKmerT> referenceKmers_;
+    std::vector<SeedT> seeds_;
+    std::vector<ReferenceKmerT> threadRepeatList_;
+    alignment::MatchDistribution matchDistribution_;
+    std::vector<alignment::Match> matches_;
+
+    static KmerT getKmer(std::vector<char>::const_iterator bases)
+    {
+        KmerT ret = 0;
+        for (unsigned i = 0; oligo::KmerTraits<KmerT>::KMER_BASES > i; ++i, ++bases)
+        {
+            ret = (ret << oligo::BITS_PER_BASE) | oligo::getValue(*bases);
+        }
+        return ret;
+    }
+
+    static flowcell::TileMetadataList makeTileMetadataList()
+    {
+        flowcell::TileMetadataList ret;
+        ret.push_back(flowcell::TileMetadata("benchmark", 0, 1101, 1, SEEDS, 0));
+        return ret;
+    }
+
+public:
+    ExactMaskMatcherBenchmark() :
+        seedMetadataList_(1, alignment::SeedMetadata(0, oligo::KmerTraits<KmerT>::KMER_BASES, 0, 0)),
+        contigKaryotypes_(1, 0),
+        barcodeMetadataList_(1),
+        tileMetadataList_(makeTileMetadataList()),
+        tempDirectory_(boost::filesystem::temp_directory_path()),
+        clusterInfo_(tileMetadataList_, std::vector<size_t>()),
+        matchTally_(1, tempDirectory_, barcodeMetadataList_),
+        tileMatchWriter_(matchTally_, tileMetadataList_.size(), tileMetadataList_.back().getIndex(), &matchArena_),
+        matchWriter_(tileMatchWriter_),
+        matcher_(false, true, REPEAT_THRESHOLD, false, seedMetadataList_, contigKaryotypes_, clusterInfo_)
+    {
+        matchTally_.addTile(tileMetadataList_.front());
+        tileMatchWriter_.reopen(0, tileMetadataList_);
+    }
+
+    std::string getName() const {return "ExactMaskMatcher::matchMask";}
+    std::string getUnit() const {return "seeds";}
+
+    void setUp(const BenchmarkOptions &)
+    {
+        const std::vector<char> contig = randomBases(CONTIG_LENGTH);
+        const unsigned long kmers = CONTIG_LENGTH - oligo::KmerTraits<KmerT>::KMER_BASES + 1;
+        referenceKmers_.reserve(kmers);
+        for (unsigned long position = 0; kmers > position; ++position)
+        {
+            referenceKmers_.push_back(ReferenceKmerT(getKmer(contig.begin() + position), reference::ReferencePosition(0, position)));
+        }
+        std::sort(referenceKmers_.begin(), referenceKmers_.end(), &reference::compareKmerAndPosition<KmerT>);
+
+        seeds_.reserve(SEEDS);
+        while (seeds_.size() < SEEDS)
+        {
+            const alignment::SeedId seedId(0, 0, seeds_.size(), 0, false);
+            if (seeds_.size() % 10)
+            {
+                seeds_.push_back(SeedT(getKmer(contig.begin() + rand() % kmers), seedId));
+            }
+            else
+            {
+                const std::vector<char> bases = randomBases(oligo::KmerTraits<KmerT>::KMER_BASES);
+                seeds_.push_back(SeedT(getKmer(bases.begin()), seedId));
+            }
+        }
+        std::sort(seeds_.begin(), seeds_.end(), &alignment::orderByKmerSeedIndex<KmerT>);
+
+        threadRepeatList_.reserve(REPEAT_THRESHOLD + 1);
+        matchDistribution_.resize(1, std::vector<unsigned>(CONTIG_LENGTH / matchDistribution_.getBinSize() + 1));
+    }
+
+    unsigned long run()
+    {
+        std::fill(clusterInfo_.front().begin(), clusterInfo_.front().end(), alignment::matchFinder::ClusterInfo());
+        matcher_.matchMask(seeds_.begin(), seeds_.end(), 0, matchDistribution_, threadRepeatList_, matchWriter_,
+                           &referenceKmers_.front(), &referenceKmers_.back() + 1, jumpTable_);
+        matchWriter_.flush();
+        matchArena_.extractTileMatches(tileMetadataList_.front().getIndex(), matches_);
+        return seeds_.size();
+    }
+};
+ISAAC_REGISTER_BENCHMARK(ExactMaskMatcherBenchmark);
+
+class BandedSmithWatermanBenchmark : public Benchmark
+{
+    alignment::BandedSmithWaterman bsw_;
+    std::vector<std::vector<char> > queries_;
+    std::vector<std::vector<char> > databases_;
+    alignment::Cigar cigar_;
+public:
+    BandedSmithWatermanBenchmark() : bsw_(MATCH_SCORE, MISMATCH_SCORE, -GAP_OPEN_SCORE, -GAP_EXTEND_SCORE, READ_LENGTH * 3) {}
+    std::string getName() const {return "BandedSmithWaterman::align";}
+    std::string getUnit() const {return "bases";}
+
+    void setUp(const BenchmarkOptions &)
+    {
+        while (queries_.size() < READ_PAIRS)
+        {
+            const std::vector<char> database = randomBases(READ_LENGTH + alignment::BandedSmithWaterman::WIDEST_GAP_SIZE);
+            std::vector<char> query(database.begin() + alignment::BandedSmithWaterman::WIDEST_GAP_SIZE / 2,
+                                    database.begin() + alignment::BandedSmithWaterman::WIDEST_GAP_SIZE / 2 + READ_LENGTH);
+            // short indel in the middle of every other query
+            if (queries_.size() % 2)
+            {
+                query.erase(query.begin() + READ_LENGTH / 2, query.begin() + READ_LENGTH / 2 + 1 + rand() % 4);
+                query.resize(READ_LENGTH, 'A');
+            }
+            mutate(query);
+            queries_.push_back(query);
+            databases_.push_back(database);
+        }
+        cigar_.reserve(1024);
+    }
+
+    unsigned long run()
+    {
+        unsigned long ret = 0;
+        for (std::size_t i = 0; queries_.size() > i; ++i)
+        {
+            cigar_.clear();
+            bsw_.align(queries_[i], databases_[i].begin(), databases_[i].end(), cigar_);
+            ret += queries_[i].size();
+        }
+        return ret;
+    }
+};
+ISAAC_REGISTER_BENCHMARK(BandedSmithWatermanBenchmark);
+
+class UngappedAlignerBenchmark : public Benchmark
+{
+    alignment::fragmentBuilder::UngappedAligner ungappedAligner_;
+    const alignment::matchSelector::SequencingAdapterList adapters_;
+    boost::shared_ptr<ReadPairs> pairs_;
+    std::vector<alignment::FragmentMetadata> fragments_;
+    alignment::Cigar cigarBuffer_;
+public:
+    UngappedAlignerBenchmark() :
+        ungappedAligner_(MATCH_SCORE, MISMATCH_SCORE, GAP_OPEN_SCORE, GAP_EXTEND_SCORE, MIN_GAP_EXTEND_SCORE) {}
+    std::string getName() const {return "UngappedAligner::alignUngapped";}
+    std::string getUnit() const {return "bases";}
+
+    void setUp(const BenchmarkOptions &)
+    {
+        pairs_.reset(new ReadPairs);
+        fragments_.resize(pairs_->clusters_.size() * 2);
+        for (std::size_t i = 0; pairs_->clusters_.size() > i; ++i)
+        {
+            for (unsigned readIndex = 0; 2 > readIndex; ++readIndex)
+            {
+                alignment::FragmentMetadata &fragment = fragments_[i * 2 + readIndex];
+                fragment.cluster = &pairs_->clusters_[i];
+                fragment.readIndex = readIndex;
+                fragment.contigId = 0;
+                fragment.position = pairs_->positions_[i] + (readIndex ? TEMPLATE_LENGTH - READ_LENGTH : 0);
+                fragment.reverse = readIndex;
+            }
+        }
+        cigarBuffer_.reserve(fragments_.size() * 4);
+    }
+
+    unsigned long run()
+    {
+        cigarBuffer_.clear();
+        alignment::matchSelector::FragmentSequencingAdapterClipper adapterClipper(adapters_);
+        const reference::Contig &contig = pairs_->contigList_.front();
+        BOOST_FOREACH(alignment::FragmentMetadata &fragment, fragments_)
+        {
+            // the cigar of the previous run is gone with the cigarBuffer_ contents
+            fragment.setUnaligned();
+            adapterClipper.checkInitStrand(fragment, contig);
+            ungappedAligner_.alignUngapped(fragment, cigarBuffer_, pairs_->readMetadataList_, adapterClipper, contig);
+        }
+        return fragments_.size() * READ_LENGTH;
+    }
+};
+ISAAC_REGISTER_BENCHMARK(UngappedAlignerBenchmark);
+
+class ShadowAlignerBenchmark : public Benchmark
+{
+    const alignment::matchSelector::SequencingAdapterList adapters_;
+    const alignment::TemplateLengthStatistics tls_;
+    boost::shared_ptr<ReadPairs> pairs_;
+    boost::shared_ptr<alignment::ShadowAligner> shadowAligner_;
+    std::vector<alignment::FragmentMetadata> orphans_;
+    std::vector<alignment::FragmentMetadata> shadowList_;
+public:
+    ShadowAlignerBenchmark() :
+        tls_(TEMPLATE_LENGTH - 50, TEMPLATE_LENGTH + 50, TEMPLATE_LENGTH, 20, 20,
+             alignment::TemplateLengthStatistics::FRp, alignment::TemplateLengthStatistics::RFm, -1) {}
+    std::string getName() const {return "ShadowAligner::rescueShadow";}
+    std::string getUnit() const {return "reads";}
+
+    void setUp(const BenchmarkOptions &)
+    {
+        pairs_.reset(new ReadPairs);
+        shadowAligner_.reset(new alignment::ShadowAligner(
+            pairs_->flowcells_, 8, false, MATCH_SCORE, MISMATCH_SCORE, GAP_OPEN_SCORE, GAP_EXTEND_SCORE, MIN_GAP_EXTEND_SCORE));
+        orphans_.resize(pairs_->clusters_.size());
+        for (std::size_t i = 0; pairs_->clusters_.size() > i; ++i)
+        {
+            alignment::FragmentMetadata &orphan = orphans_[i];
+            orphan.cluster = &pairs_->clusters_[i];
+            orphan.readIndex = 0;
+            orphan.contigId = 0;
+            orphan.position = pairs_->positions_[i];
+            orphan.reverse = false;
+        }
+        shadowList_.resize(50);
+    }
+
+    unsigned long run()
+    {
+        BOOST_FOREACH(const alignment::FragmentMetadata &orphan, orphans_)
+        {
+            shadowAligner_->rescueShadow(pairs_->contigList_, orphan, shadowList_, pairs_->readMetadataList_, adapters_, tls_, 0);
+        }
+        return orphans_.size();
+    }
+};
+ISAAC_REGISTER_BENCHMARK(ShadowAlignerBenchmark);
+
+} // namespace benchmark
+} // namespace isaac
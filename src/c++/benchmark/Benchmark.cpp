@@ -0,0 +1,234 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file Benchmark.cpp
+ **
+ ** \brief See Benchmark.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cerrno>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include "common/Exceptions.hh"
+#include "common/SystemCompatibility.hh"
+
+#include "Benchmark.hh"
+
+namespace isaac
+{
+namespace benchmark
+{
+
+namespace bpo = boost::program_options;
+
+BenchmarkOptions::BenchmarkOptions() :
+    filter_(".*"),
+    minSeconds_(1.0),
+    updateBaseline_(false),
+    tolerancePercent_(10.0),
+    seed_(1)
+{
+    namedOptions_.add_options()
+        ("baseline-file,b",     bpo::value<boost::filesystem::path>(&baselineFile_),
+                                "File with the expected throughput of each benchmark. When given, the benchmarks that are "
+                                "slower than the baseline by more than --tolerance make the program fail")
+        ("compress-file",       bpo::value<boost::filesystem::path>(&compressFile_),
+                                "Recorded data to use for the bgzf compression benchmark. Synthetic bam-like data is used "
+                                "if not specified")
+        ("fastq-file",          bpo::value<boost::filesystem::path>(&fastqFile_),
+                                "Recorded fastq to use for the fastq parsing benchmark. Synthetic reads are used if not "
+                                "specified")
+        ("filter,f",            bpo::value<std::string>(&filter_)->default_value(filter_),
+                                "Regular expression to select the benchmarks to run by name")
+        ("min-seconds",         bpo::value<double>(&minSeconds_)->default_value(minSeconds_),
+                                "Minimum time to spend repeating each benchmark")
+        ("seed",                bpo::value<unsigned>(&seed_)->default_value(seed_),
+                                "Random seed for the synthetic inputs")
+        ("tolerance",           bpo::value<double>(&tolerancePercent_)->default_value(tolerancePercent_),
+                                "Slowdown against the baseline, in percent, that is reported as a regression")
+        ("update-baseline",     bpo::value<bool>(&updateBaseline_)->default_value(updateBaseline_),
+                                "Overwrite the --baseline-file with the results of this run instead of comparing")
+        ;
+}
+
+void BenchmarkOptions::postProcess(bpo::variables_map &vm)
+{
+    if(vm.count("help"))
+    {
+        return;
+    }
+    if (updateBaseline_ && baselineFile_.empty())
+    {
+        BOOST_THROW_EXCEPTION(common::InvalidOptionException("\n   *** --update-baseline requires --baseline-file ***\n"));
+    }
+    if (0.0 >= minSeconds_)
+    {
+        BOOST_THROW_EXCEPTION(common::InvalidOptionException("\n   *** --min-seconds must be positive ***\n"));
+    }
+}
+
+std::ostream &operator <<(std::ostream &os, const BenchmarkResult &result)
+{
+    return os << std::left << std::setw(32) << result.name_ << std::right <<
+        std::setw(16) << std::fixed << std::setprecision(0) << result.getUnitsPerSecond() << " " <<
+        std::left << std::setw(8) << (result.unit_ + "/s") << std::right <<
+        std::setw(10) << result.iterations_ << " iterations " <<
+        std::setw(8) << result.allocationsPerIteration_ << " allocations/iteration";
+}
+
+static std::vector<BenchmarkFactory> &benchmarkRegistry()
+{
+    static std::vector<BenchmarkFactory> registry;
+    return registry;
+}
+
+void registerBenchmark(BenchmarkFactory factory)
+{
+    benchmarkRegistry().push_back(factory);
+}
+
+const std::vector<BenchmarkFactory> &getRegisteredBenchmarks()
+{
+    return benchmarkRegistry();
+}
+
+static bool countAllocations(size_t, const void *)
+{
+    return true;
+}
+
+BenchmarkResult measure(Benchmark &benchmark, const BenchmarkOptions &options)
+{
+    BenchmarkResult ret;
+    ret.name_ = benchmark.getName();
+    ret.unit_ = benchmark.getUnit();
+
+    // warm up the caches and let the kernel grow its buffers to their final size
+    benchmark.run();
+
+    // the hook serializes allocations. Count them on a separate iteration so that the timing is not affected
+    common::hookMalloc(&countAllocations);
+    benchmark.run();
+    ret.allocationsPerIteration_ = common::unhookMalloc(&countAllocations);
+
+    const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    do
+    {
+        ret.units_ += benchmark.run();
+        ++ret.iterations_;
+        ret.seconds_ = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1000000.0;
+    }
+    while (options.minSeconds_ > ret.seconds_);
+
+    return ret;
+}
+
+// machine readable comment line telling how many hardware threads the baseline host had
+static const std::string HARDWARE_THREADS_COMMENT = "# hardware threads: ";
+static const std::string MEASURED_ON_COMMENT = "# Measured on ";
+static const std::string COLUMNS_COMMENT = "# benchmark name\tunits per second";
+
+Baseline loadBaseline(const boost::filesystem::path &baselineFile, unsigned &hardwareThreads)
+{
+    Baseline ret;
+    hardwareThreads = 0;
+    std::ifstream is(baselineFile.c_str());
+    if (!is)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open baseline file " + baselineFile.string()));
+    }
+    std::string line;
+    while (std::getline(is, line))
+    {
+        if (0 == line.compare(0, HARDWARE_THREADS_COMMENT.size(), HARDWARE_THREADS_COMMENT))
+        {
+            std::istringstream(line.substr(HARDWARE_THREADS_COMMENT.size())) >> hardwareThreads;
+            continue;
+        }
+        if (line.empty() || '#' == line[0])
+        {
+            continue;
+        }
+        std::istringstream lineStream(line);
+        std::string name;
+        double unitsPerSecond = 0.0;
+        if (!(lineStream >> name >> unitsPerSecond))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(EINVAL, "Invalid line in baseline file " + baselineFile.string() + ": " + line));
+        }
+        ret[name] = unitsPerSecond;
+    }
+    return ret;
+}
+
+/**
+ * \brief Collects the explanatory comments of an existing baseline file. The lines that describe the
+ *        machine and the columns are left out as saveBaseline writes them anew.
+ */
+static std::vector<std::string> loadBaselineComments(const boost::filesystem::path &baselineFile)
+{
+    std::vector<std::string> ret;
+    std::ifstream is(baselineFile.c_str());
+    std::string line;
+    while (std::getline(is, line))
+    {
+        if (!line.empty() && '#' == line[0] &&
+            0 != line.compare(0, HARDWARE_THREADS_COMMENT.size(), HARDWARE_THREADS_COMMENT) &&
+            0 != line.compare(0, MEASURED_ON_COMMENT.size(), MEASURED_ON_COMMENT) &&
+            COLUMNS_COMMENT != line)
+        {
+            ret.push_back(line);
+        }
+    }
+    return ret;
+}
+
+void saveBaseline(const boost::filesystem::path &baselineFile, const std::vector<BenchmarkResult> &results)
+{
+    std::vector<std::string> comments = loadBaselineComments(baselineFile);
+    if (comments.empty())
+    {
+        comments.push_back("# Expected throughput of the isaacBenchmark kernels on the reference build machine.");
+        comments.push_back("# Regenerate with: isaacBenchmark --baseline-file baseline.txt --update-baseline 1");
+    }
+
+    const unsigned hardwareThreads = boost::thread::hardware_concurrency();
+    std::ofstream os(baselineFile.c_str());
+    BOOST_FOREACH(const std::string &comment, comments)
+    {
+        os << comment << "\n";
+    }
+    os << MEASURED_ON_COMMENT << "a host with " << hardwareThreads <<
+        (1 == hardwareThreads ? " hardware thread. The multithreaded kernels ran on one thread\n" : " hardware threads\n");
+    os << HARDWARE_THREADS_COMMENT << hardwareThreads << "\n";
+    os << COLUMNS_COMMENT << "\n";
+    BOOST_FOREACH(const BenchmarkResult &result, results)
+    {
+        os << result.name_ << "\t" << std::fixed << std::setprecision(0) << result.getUnitsPerSecond() << "\n";
+    }
+    if (!os.flush())
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write baseline file " + baselineFile.string()));
+    }
+}
+
+} // namespace benchmark
+} // namespace isaac
@@ -0,0 +1,123 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file Benchmark.hh
+ **
+ ** \brief Minimal harness for timing the hot kernels in isolation.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_BENCHMARK_BENCHMARK_HH
+#define iSAAC_BENCHMARK_BENCHMARK_HH
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "common/Program.hh"
+
+namespace isaac
+{
+namespace benchmark
+{
+
+class BenchmarkOptions : public common::Options
+{
+public:
+    BenchmarkOptions();
+private:
+    std::string usagePrefix() const {return "isaacBenchmark";}
+    void postProcess(boost::program_options::variables_map &vm);
+public:
+    /// only the benchmarks with names matching the regex are run
+    std::string filter_;
+    /// each benchmark is repeated for at least this long
+    double minSeconds_;
+    boost::filesystem::path baselineFile_;
+    bool updateBaseline_;
+    /// slowdown in percent against the baseline that is reported as a regression
+    double tolerancePercent_;
+    /// recorded input. Synthetic reads are used when empty
+    boost::filesystem::path fastqFile_;
+    /// recorded input for bgzf compression. Synthetic bam-like data is used when empty
+    boost::filesystem::path compressFile_;
+    unsigned seed_;
+};
+
+/**
+ * \brief A kernel under test. setUp prepares the inputs outside of the timed region, run is repeated
+ *        until the minimum time is reached.
+ */
+class Benchmark : boost::noncopyable
+{
+public:
+    virtual ~Benchmark() {}
+    virtual std::string getName() const = 0;
+    /// what run counts: bases, bytes, reads...
+    virtual std::string getUnit() const = 0;
+    virtual void setUp(const BenchmarkOptions &options) = 0;
+    /// \return number of units processed
+    virtual unsigned long run() = 0;
+};
+
+struct BenchmarkResult
+{
+    BenchmarkResult() : iterations_(0), units_(0), seconds_(0.0), allocationsPerIteration_(0){}
+    std::string name_;
+    std::string unit_;
+    unsigned long iterations_;
+    unsigned long units_;
+    double seconds_;
+    unsigned allocationsPerIteration_;
+
+    double getUnitsPerSecond() const {return seconds_ ? units_ / seconds_ : 0.0;}
+};
+
+std::ostream &operator <<(std::ostream &os, const BenchmarkResult &result);
+
+typedef boost::shared_ptr<Benchmark> (*BenchmarkFactory)();
+void registerBenchmark(BenchmarkFactory factory);
+const std::vector<BenchmarkFactory> &getRegisteredBenchmarks();
+
+template <typename BenchmarkT> boost::shared_ptr<Benchmark> makeBenchmark()
+{
+    return boost::shared_ptr<Benchmark>(new BenchmarkT);
+}
+
+template <typename BenchmarkT> struct BenchmarkRegistration
+{
+    BenchmarkRegistration() {registerBenchmark(&makeBenchmark<BenchmarkT>);}
+};
+
+#define ISAAC_REGISTER_BENCHMARK(BenchmarkT) \
+    static const isaac::benchmark::BenchmarkRegistration<BenchmarkT> BenchmarkT##Registration
+
+/// times benchmark according to options
+BenchmarkResult measure(Benchmark &benchmark, const BenchmarkOptions &options);
+
+/// unitsPerSecond by benchmark name
+typedef std::map<std::string, double> Baseline;
+/// \param hardwareThreads receives the hardware threads of the host that recorded the baseline, 0 if unknown
+Baseline loadBaseline(const boost::filesystem::path &baselineFile, unsigned &hardwareThreads);
+/// Rewrites baselineFile with the results. The explanatory comments of the existing file are kept.
+void saveBaseline(const boost::filesystem::path &baselineFile, const std::vector<BenchmarkResult> &results);
+
+} // namespace benchmark
+} // namespace isaac
+
+#endif // #ifndef iSAAC_BENCHMARK_BENCHMARK_HH
@@ -0,0 +1,261 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file BuildBenchmarks.cpp
+ **
+ ** \brief Duplicate removal and gap realignment kernels of the bam build on synthetic bins.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include <boost/foreach.hpp>
+
+#include "alignment/BinMetadata.hh"
+#include "alignment/Cigar.hh"
+#include "build/BarcodeBamMapping.hh"
+#include "build/BuildStats.hh"
+#include "build/DuplicateFragmentIndexFiltering.hh"
+#include "build/DuplicatePairEndFilter.hh"
+#include "build/GapRealigner.hh"
+#include "build/PackedFragmentBuffer.hh"
+#include "io/Fragment.hh"
+#include "oligo/Nucleotides.hh"
+#include "reference/Contig.hh"
+
+#include "Benchmark.hh"
+
+namespace isaac
+{
+namespace benchmark
+{
+
+/**
+ * \brief Forward-strand pair ends of a bin, one in ten being a duplicate of the previous one. This is the
+ *        work BinSorter does for each strand of a bin when duplicate removal is on.
+ */
+class DuplicatePairEndFilterBenchmark : public Benchmark
+{
+    static const unsigned PAIR_ENDS = 500000;
+    static const unsigned BIN_LENGTH = 50000000;
+
+    const flowcell::BarcodeMetadataList barcodeMetadataList_;
+    const build::BarcodeBamMapping::BarcodeSampleIndexMap barcodeSampleIndex_;
+    alignment::BinMetadataList binMetadataList_;
+    const alignment::BinMetadataCRefList binMetadataCRefList_;
+    build::BuildStats buildStats_;
+    build::DuplicatePairEndFilter filter_;
+    build::PackedFragmentBuffer fragments_;
+    std::vector<build::FStrandFragmentIndex> pairEnds_;
+    std::vector<build::DuplicateSignature> signatures_;
+    std::vector<build::PackedFragmentBuffer::Index> results_;
+public:
+    DuplicatePairEndFilterBenchmark() :
+        barcodeMetadataList_(1),
+        binMetadataList_(1),
+        binMetadataCRefList_(1, boost::cref(binMetadataList_.front())),
+        buildStats_(binMetadataCRefList_, barcodeMetadataList_),
+        filter_(false)
+    {
+    }
+
+    std::string getName() const {return "DuplicatePairEndFilter::filterSignatures";}
+    std::string getUnit() const {return "fragments";}
+
+    void setUp(const BenchmarkOptions &)
+    {
+        alignment::BinMetadata &bin = binMetadataList_.front();
+        bin = alignment::BinMetadata(barcodeMetadataList_.size(), 0, reference::ReferencePosition(0, 0), BIN_LENGTH, "benchmark", 0);
+        bin.incrementDataSize(reference::ReferencePosition(0, 0), PAIR_ENDS * sizeof(io::FragmentHeader));
+        fragments_.resize(bin);
+
+        const build::DuplicateFilter signatureFilter(false, barcodeSampleIndex_);
+        pairEnds_.reserve(PAIR_ENDS);
+        signatures_.reserve(PAIR_ENDS);
+        while (pairEnds_.size() < PAIR_ENDS)
+        {
+            const bool duplicate = !pairEnds_.empty() && !(pairEnds_.size() % 10);
+            const unsigned long position = duplicate ? pairEnds_.back().fStrandPos_.getPosition() : rand() % BIN_LENGTH;
+            pairEnds_.push_back(build::FStrandFragmentIndex(
+                reference::ReferencePosition(0, position),
+                build::FragmentIndexMate(false, true, 0, io::FragmentIndexAnchor(position + 300)), rand() % 4));
+            pairEnds_.back().dataOffset_ = pairEnds_.size() * sizeof(io::FragmentHeader) - sizeof(io::FragmentHeader);
+            pairEnds_.back().mateDataOffset_ = pairEnds_.back().dataOffset_;
+
+            io::FragmentHeader header;
+            header.fStrandPosition_ = pairEnds_.back().fStrandPos_;
+            header.clusterId_ = pairEnds_.size();
+            static_cast<io::FragmentHeader &>(fragments_.getFragment(pairEnds_.back())) = header;
+
+            signatures_.push_back(signatureFilter.getSignature(pairEnds_.back(), header.barcode_, signatures_.size()));
+        }
+        filter_.reserve(signatures_.size());
+        results_.reserve(pairEnds_.size());
+    }
+
+    unsigned long run()
+    {
+        results_.clear();
+        filter_.filterSignatures(fragments_, pairEnds_.begin(), signatures_.begin(), signatures_.end(), buildStats_, 0,
+                                 std::back_inserter(results_));
+        return signatures_.size();
+    }
+};
+ISAAC_REGISTER_BENCHMARK(DuplicatePairEndFilterBenchmark);
+
+/**
+ * \brief Ungapped 100M alignments of reads sampled from a random contig that has a short deletion every
+ *        GAP_SPACING bases. The reads spanning a deletion have mismatches after it and get realigned.
+ *        The bin is restored from a pristine copy on every run, the way BinSorter loads it from disk.
+ */
+class GapRealignerBenchmark : public Benchmark
+{
+    static const unsigned READS = 100000;
+    static const unsigned READ_LENGTH = 100;
+    static const unsigned CONTIG_LENGTH = 1000000;
+    static const unsigned GAP_SPACING = 200;
+
+    flowcell::BarcodeMetadataList barcodeMetadataList_;
+    const std::vector<alignment::TemplateLengthStatistics> templateLengthStatistics_;
+    std::vector<std::vector<reference::Contig> > contigList_;
+    alignment::BinMetadata bin_;
+    build::RealignerGaps realignerGaps_;
+    build::GapRealigner realigner_;
+    build::PackedFragmentBuffer dataBuffer_;
+    std::vector<char> pristineData_;
+    std::vector<build::PackedFragmentBuffer::Index> pristineIndex_;
+    std::vector<build::PackedFragmentBuffer::Index> index_;
+
+    /// \return the read that starts at position and misses the deleted reference bases
+    std::vector<char> getRead(
+        const std::vector<char> &contig,
+        const std::vector<unsigned long> &deletionLengths,
+        unsigned long position) const
+    {
+        std::vector<char> ret;
+        ret.reserve(READ_LENGTH);
+        while (READ_LENGTH > ret.size())
+        {
+            if (!ret.empty() && !(position % GAP_SPACING) && deletionLengths.size() > position / GAP_SPACING)
+            {
+                position += deletionLengths[position / GAP_SPACING];
+            }
+            ret.push_back(contig.at(position++));
+        }
+        return ret;
+    }
+
+public:
+    GapRealignerBenchmark() :
+        barcodeMetadataList_(1),
+        templateLengthStatistics_(1),
+        contigList_(1, std::vector<reference::Contig>(1, reference::Contig(0, "benchmark"))),
+        realigner_(false, false, 1, 3, 4, 0, true, barcodeMetadataList_, templateLengthStatistics_, contigList_)
+    {
+        barcodeMetadataList_.front().setIndex(0);
+        barcodeMetadataList_.front().setReferenceIndex(0);
+    }
+
+    std::string getName() const {return "GapRealigner::realign";}
+    std::string getUnit() const {return "fragments";}
+
+    void setUp(const BenchmarkOptions &)
+    {
+        static const char bases[] = {'A', 'C', 'G', 'T'};
+        std::vector<char> &contig = contigList_.front().front().forward_;
+        contig.resize(CONTIG_LENGTH);
+        BOOST_FOREACH(char &base, contig)
+        {
+            base = bases[rand() % 4];
+        }
+
+        std::vector<unsigned long> deletionLengths(CONTIG_LENGTH / GAP_SPACING);
+        realignerGaps_.reserve(deletionLengths.size());
+        for (unsigned long gap = 1; deletionLengths.size() > gap; ++gap)
+        {
+            deletionLengths[gap] = 1 + rand() % 4;
+            realignerGaps_.addGap(build::gapRealigner::Gap(reference::ReferencePosition(0, gap * GAP_SPACING), deletionLengths[gap]));
+        }
+        realignerGaps_.finalizeGaps();
+
+        bin_ = alignment::BinMetadata(barcodeMetadataList_.size(), 0, reference::ReferencePosition(0, 0), CONTIG_LENGTH, "benchmark", 0);
+        std::vector<unsigned long> positions;
+        positions.reserve(READS);
+        while (positions.size() < READS)
+        {
+            positions.push_back(rand() % (CONTIG_LENGTH - READ_LENGTH * 2));
+            const reference::ReferencePosition pos(0, positions.back());
+            bin_.incrementDataSize(pos, io::FragmentHeader::getTotalLength(READ_LENGTH, 1));
+            bin_.incrementCigarLength(pos, 1, 0);
+            bin_.incrementSeIdxElements(pos, 1, 0);
+        }
+        dataBuffer_.resize(bin_);
+
+        const unsigned cigar = alignment::Cigar::encode(READ_LENGTH, alignment::Cigar::ALIGN);
+        unsigned long offset = 0;
+        pristineIndex_.reserve(READS);
+        BOOST_FOREACH(const unsigned long position, positions)
+        {
+            const std::vector<char> read = getRead(contig, deletionLengths, position);
+            io::FragmentHeader header;
+            header.fStrandPosition_ = reference::ReferencePosition(0, position);
+            header.mateFStrandPosition_ = header.fStrandPosition_;
+            header.observedLength_ = READ_LENGTH;
+            header.readLength_ = READ_LENGTH;
+            header.cigarLength_ = 1;
+            header.alignmentScore_ = 1;
+            header.clusterId_ = pristineIndex_.size();
+            for (unsigned i = 0; READ_LENGTH > i; ++i)
+            {
+                header.editDistance_ += read[i] != contig[position + i];
+            }
+
+            io::FragmentAccessor &fragment = dataBuffer_.getFragment(offset);
+            static_cast<io::FragmentHeader &>(fragment) = header;
+            unsigned char *base = fragment.basesBegin();
+            BOOST_FOREACH(const char b, read)
+            {
+                *base++ = (30 << 2) | oligo::getValue(b);
+            }
+            std::memcpy(const_cast<unsigned *>(fragment.cigarBegin()), &cigar, sizeof(cigar));
+
+            pristineIndex_.push_back(build::PackedFragmentBuffer::Index(
+                header.fStrandPosition_, offset, offset, fragment.cigarBegin(), fragment.cigarEnd()));
+            offset += fragment.getTotalLength();
+        }
+        pristineData_.assign(dataBuffer_.begin(), dataBuffer_.end());
+        index_.reserve(pristineIndex_.size());
+    }
+
+    unsigned long run()
+    {
+        std::copy(pristineData_.begin(), pristineData_.end(), dataBuffer_.begin());
+        index_.assign(pristineIndex_.begin(), pristineIndex_.end());
+        realigner_.unreserve();
+        realigner_.reserve(bin_);
+
+        const reference::ReferencePosition binStartPos(0, 0);
+        const reference::ReferencePosition binEndPos(0, CONTIG_LENGTH);
+        BOOST_FOREACH(build::PackedFragmentBuffer::Index &index, index_)
+        {
+            realigner_.realign(realignerGaps_, binStartPos, binEndPos, index, dataBuffer_.getFragment(index), dataBuffer_);
+        }
+        return index_.size();
+    }
+};
+ISAAC_REGISTER_BENCHMARK(GapRealignerBenchmark);
+
+} // namespace benchmark
+} // namespace isaac
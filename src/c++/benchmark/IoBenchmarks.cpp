@@ -0,0 +1,199 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file IoBenchmarks.cpp
+ **
+ ** \brief bgzf compression and fastq parsing throughput.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/categories.hpp>
+
+#include "bgzf/BgzfCompressor.hh"
+#include "common/Exceptions.hh"
+#include "flowcell/ReadMetadata.hh"
+#include "io/FastqReader.hh"
+
+#include "Benchmark.hh"
+
+namespace isaac
+{
+namespace benchmark
+{
+
+namespace bios = boost::iostreams;
+
+static const unsigned SYNTHETIC_READ_LENGTH = 150;
+
+static void appendRandomRead(std::string &data, const unsigned length)
+{
+    static const char bases[] = {'A', 'C', 'G', 'T'};
+    for (unsigned i = 0; length > i; ++i)
+    {
+        data.push_back(bases[rand() % 4]);
+    }
+}
+
+static void appendRandomQualities(std::string &data, const unsigned length)
+{
+    // binned qualities as produced by the recent instruments
+    static const char qualities[] = {'#', '-', '7', '<', 'A', 'F', 'J'};
+    for (unsigned i = 0; length > i; ++i)
+    {
+        data.push_back(qualities[4 + rand() % 3 - (rand() % 10 ? 0 : 4)]);
+    }
+}
+
+/**
+ * \brief Discards the data, counts the bytes
+ */
+struct CountingSink
+{
+    typedef char char_type;
+    typedef bios::sink_tag category;
+
+    CountingSink() : bytes_(0) {}
+    std::streamsize write(const char *, std::streamsize n)
+    {
+        bytes_ += n;
+        return n;
+    }
+    unsigned long bytes_;
+};
+
+class BgzfCompressorBenchmark : public Benchmark
+{
+    static const unsigned SYNTHETIC_BYTES = 16 * 1024 * 1024;
+    static const unsigned WRITE_SIZE = 4096;
+    std::string data_;
+    bgzf::BgzfCompressor compressor_;
+public:
+    std::string getName() const {return "BgzfCompressor::write";}
+    std::string getUnit() const {return "bytes";}
+
+    void setUp(const BenchmarkOptions &options)
+    {
+        if (!options.compressFile_.empty())
+        {
+            std::ifstream is(options.compressFile_.c_str());
+            if (!is)
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open " + options.compressFile_.string()));
+            }
+            data_.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+        }
+        else
+        {
+            // roughly what bam records look like to zlib: short binary header followed by bases and qualities
+            data_.reserve(SYNTHETIC_BYTES + SYNTHETIC_READ_LENGTH * 2 + 32);
+            while (SYNTHETIC_BYTES > data_.size())
+            {
+                for (unsigned i = 0; 32 > i; ++i)
+                {
+                    data_.push_back(i < 8 ? 0 : char(rand()));
+                }
+                appendRandomRead(data_, SYNTHETIC_READ_LENGTH);
+                appendRandomQualities(data_, SYNTHETIC_READ_LENGTH);
+            }
+        }
+    }
+
+    unsigned long run()
+    {
+        CountingSink sink;
+        for (std::size_t offset = 0; data_.size() > offset; offset += WRITE_SIZE)
+        {
+            compressor_.write(sink, data_.data() + offset, std::min<std::size_t>(WRITE_SIZE, data_.size() - offset));
+        }
+        compressor_.flush(sink);
+        return data_.size();
+    }
+};
+ISAAC_REGISTER_BENCHMARK(BgzfCompressorBenchmark);
+
+class FastqReaderBenchmark : public Benchmark
+{
+    static const unsigned SYNTHETIC_READS = 200000;
+    static const unsigned MAX_READ_LENGTH = 1000;
+    boost::filesystem::path fastqPath_;
+    bool removeFastq_;
+    const flowcell::ReadMetadata readMetadata_;
+    std::vector<char> bcl_;
+public:
+    FastqReaderBenchmark() :
+        removeFastq_(false), readMetadata_(1, MAX_READ_LENGTH, 0, 0)
+    {
+        bcl_.resize(MAX_READ_LENGTH);
+    }
+
+    ~FastqReaderBenchmark()
+    {
+        if (removeFastq_)
+        {
+            boost::filesystem::remove(fastqPath_);
+        }
+    }
+
+    std::string getName() const {return "FastqReader::extractBcl";}
+    std::string getUnit() const {return "bases";}
+
+    void setUp(const BenchmarkOptions &options)
+    {
+        if (!options.fastqFile_.empty())
+        {
+            fastqPath_ = options.fastqFile_;
+            return;
+        }
+
+        fastqPath_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("isaacBenchmark-%%%%-%%%%.fastq");
+        removeFastq_ = true;
+        std::ofstream os(fastqPath_.c_str());
+        std::string record;
+        for (unsigned read = 0; SYNTHETIC_READS > read && os; ++read)
+        {
+            record = "@benchmark:1:1101:0:0 1:N:0:0\n";
+            appendRandomRead(record, SYNTHETIC_READ_LENGTH);
+            record += "\n+\n";
+            appendRandomQualities(record, SYNTHETIC_READ_LENGTH);
+            record += "\n";
+            os << record;
+        }
+        if (!os.flush())
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write " + fastqPath_.string()));
+        }
+    }
+
+    unsigned long run()
+    {
+        unsigned long ret = 0;
+        // open() keeps reading where it stopped if the path is the same, so each run gets a new reader
+        io::FastqReader reader(true, fastqPath_);
+        while (reader.hasData())
+        {
+            ret += std::distance(bcl_.begin(), reader.extractBcl(readMetadata_, bcl_.begin()));
+            reader.next();
+        }
+        return ret;
+    }
+};
+ISAAC_REGISTER_BENCHMARK(FastqReaderBenchmark);
+
+} // namespace benchmark
+} // namespace isaac
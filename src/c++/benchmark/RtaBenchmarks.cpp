@@ -0,0 +1,176 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file RtaBenchmarks.cpp
+ **
+ ** \brief bcl tile loading and transpose throughput.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <boost/assign.hpp>
+#include <boost/cstdint.hpp>
+
+#include "common/Memory.hh"
+#include "common/Threads.hpp"
+#include "flowcell/Layout.hh"
+#include "flowcell/ReadMetadata.hh"
+#include "flowcell/TileMetadata.hh"
+#include "rta/BclMapper.hh"
+#include "rta/BclTransposeKernel.hh"
+#include "rta/QScoreBinner.hh"
+
+#include "Benchmark.hh"
+
+namespace isaac
+{
+namespace benchmark
+{
+
+/**
+ * \brief A tile laid out the way BclMapper keeps it: page-aligned cycles, each starting with the cluster count.
+ *        The bytes are counted once, so the memory bandwidth is twice the reported throughput.
+ */
+class BclTransposeBenchmark : public Benchmark
+{
+    static const unsigned CYCLES = 150;
+    // a HiSeq X tile
+    static const unsigned CLUSTERS = 4309650;
+    const unsigned long cycleStride_;
+    std::vector<char> tileData_;
+    std::vector<char> clusters_;
+    const rta::BclTransposeKernel kernel_;
+public:
+    BclTransposeBenchmark() :
+        cycleStride_(common::pageRoundUp(sizeof(boost::uint32_t) + CLUSTERS))
+    {
+    }
+
+    std::string getName() const {return "BclTransposeKernel::transpose";}
+    std::string getUnit() const {return "bytes";}
+
+    void setUp(const BenchmarkOptions &)
+    {
+        tileData_.resize(cycleStride_ * CYCLES);
+        for (std::vector<char>::iterator it = tileData_.begin(); tileData_.end() != it; ++it)
+        {
+            *it = rand();
+        }
+        clusters_.resize(static_cast<unsigned long>(CLUSTERS) * CYCLES);
+    }
+
+    unsigned long run()
+    {
+        kernel_.transpose(&tileData_.front() + sizeof(boost::uint32_t), cycleStride_, CYCLES, CLUSTERS, &clusters_.front(), 0);
+        return clusters_.size();
+    }
+};
+ISAAC_REGISTER_BENCHMARK(BclTransposeBenchmark);
+
+/**
+ * \brief Stands in for BclReader. Hands out the same bcl cycle for every cycle the way BclReader does when
+ *        the files are in the page cache, so that the benchmark does not depend on the storage.
+ */
+class CachedCycleReader
+{
+    const std::vector<char> *cycle_;
+public:
+    explicit CachedCycleReader(const std::vector<char> &cycle) : cycle_(&cycle){}
+
+    void reserveBuffers(const std::size_t, const std::size_t) {}
+
+    unsigned readTileCycle(
+        const flowcell::Layout &,
+        const flowcell::TileMetadata &tile,
+        const unsigned,
+        char *cycleBuffer, const std::size_t)
+    {
+        std::copy(cycle_->begin(), cycle_->end(), cycleBuffer);
+        return tile.getClusterCount();
+    }
+};
+
+/**
+ * \brief Loads the cycles of a 2x150 HiSeq X tile into the BclMapper with the default number of loader threads,
+ *        then transposes and bins the clusters the way BclDataSource does for each tile.
+ */
+class BclMapperBenchmark : public Benchmark
+{
+    static const unsigned READ_LENGTH = 150;
+    static const unsigned CLUSTERS = 4309650;
+    static const unsigned INPUT_LOADERS_MAX = 64;
+
+    const flowcell::ReadMetadataList readMetadataList_;
+    const flowcell::Layout flowcell_;
+    const flowcell::TileMetadata tileMetadata_;
+    std::vector<char> cycle_;
+    std::vector<CachedCycleReader> threadReaders_;
+    common::ThreadVector threads_;
+    rta::ParallelBclMapper<CachedCycleReader> bclMapper_;
+    const rta::QScoreBinner qScoreBinner_;
+    std::vector<char> clusters_;
+
+    static rta::QScoreBinner::BclTable makeBinTable()
+    {
+        rta::QScoreBinner::BclTable ret;
+        for (unsigned bcl = 0; ret.size() > bcl; ++bcl)
+        {
+            // everything above quality 30 becomes 30
+            ret[bcl] = (bcl >> 2) > 30 ? ((30 << 2) | (bcl & 3)) : bcl;
+        }
+        return ret;
+    }
+
+public:
+    BclMapperBenchmark() :
+        readMetadataList_(boost::assign::list_of
+            (flowcell::ReadMetadata(1, READ_LENGTH, 0, 0))
+            (flowcell::ReadMetadata(READ_LENGTH + 1, READ_LENGTH * 2, 1, READ_LENGTH)).convert_to_container<std::vector<flowcell::ReadMetadata> >()),
+        flowcell_("", flowcell::Layout::Bcl, flowcell::BclFlowcellData(), 8, std::vector<unsigned>(),
+                  readMetadataList_, alignment::SeedMetadataList(), "benchmark"),
+        tileMetadata_("benchmark", 0, 1101, 1, CLUSTERS, 0),
+        threadReaders_(INPUT_LOADERS_MAX, CachedCycleReader(cycle_)),
+        threads_(INPUT_LOADERS_MAX),
+        bclMapper_(false, READ_LENGTH * 2, threads_, threadReaders_, INPUT_LOADERS_MAX, CLUSTERS, 0),
+        qScoreBinner_(makeBinTable())
+    {
+    }
+
+    std::string getName() const {return "ParallelBclMapper::mapTile";}
+    std::string getUnit() const {return "bytes";}
+
+    void setUp(const BenchmarkOptions &)
+    {
+        cycle_.resize(sizeof(boost::uint32_t) + CLUSTERS);
+        *reinterpret_cast<boost::uint32_t *>(&cycle_.front()) = CLUSTERS;
+        for (std::vector<char>::iterator it = cycle_.begin() + sizeof(boost::uint32_t); cycle_.end() != it; ++it)
+        {
+            *it = rand();
+        }
+        clusters_.resize(static_cast<unsigned long>(CLUSTERS) * READ_LENGTH * 2);
+    }
+
+    unsigned long run()
+    {
+        bclMapper_.mapTile(flowcell_, tileMetadata_);
+        bclMapper_.transpose(clusters_.begin(), &qScoreBinner_);
+        return clusters_.size();
+    }
+};
+ISAAC_REGISTER_BENCHMARK(BclMapperBenchmark);
+
+} // namespace benchmark
+} // namespace isaac
@@ -0,0 +1,97 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file isaacBenchmark.cpp
+ **
+ ** \brief Runs the registered benchmarks and compares them against the baseline.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cstdlib>
+#include <iostream>
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/regex.hpp>
+#include <boost/thread.hpp>
+
+#include "common/Exceptions.hh"
+
+#include "Benchmark.hh"
+
+void runBenchmarks(const isaac::benchmark::BenchmarkOptions &options)
+{
+    using isaac::benchmark::Benchmark;
+    using isaac::benchmark::BenchmarkFactory;
+    using isaac::benchmark::BenchmarkResult;
+
+    srand(options.seed_);
+    const boost::regex filter(options.filter_);
+    std::vector<BenchmarkResult> results;
+    BOOST_FOREACH(const BenchmarkFactory factory, isaac::benchmark::getRegisteredBenchmarks())
+    {
+        const boost::shared_ptr<Benchmark> benchmark = factory();
+        if (boost::regex_search(benchmark->getName(), filter))
+        {
+            benchmark->setUp(options);
+            results.push_back(isaac::benchmark::measure(*benchmark, options));
+            std::cout << results.back() << std::endl;
+        }
+    }
+
+    if (options.updateBaseline_)
+    {
+        isaac::benchmark::saveBaseline(options.baselineFile_, results);
+        ISAAC_THREAD_CERR << "Baseline saved to " << options.baselineFile_ << std::endl;
+    }
+    else if (!options.baselineFile_.empty())
+    {
+        unsigned baselineHardwareThreads = 0;
+        const isaac::benchmark::Baseline baseline =
+            isaac::benchmark::loadBaseline(options.baselineFile_, baselineHardwareThreads);
+        if (baselineHardwareThreads && boost::thread::hardware_concurrency() != baselineHardwareThreads)
+        {
+            ISAAC_THREAD_CERR << "WARNING: " << options.baselineFile_ << " was recorded with " <<
+                baselineHardwareThreads << " hardware threads, this host has " <<
+                boost::thread::hardware_concurrency() << ". Multithreaded benchmarks are not comparable" << std::endl;
+        }
+        unsigned regressions = 0;
+        BOOST_FOREACH(const BenchmarkResult &result, results)
+        {
+            const isaac::benchmark::Baseline::const_iterator expected = baseline.find(result.name_);
+            if (baseline.end() == expected)
+            {
+                std::cout << result.name_ << ": no baseline" << std::endl;
+            }
+            else
+            {
+                const double change = (result.getUnitsPerSecond() / expected->second - 1.0) * 100.0;
+                const bool regressed = -options.tolerancePercent_ > change;
+                regressions += regressed;
+                std::cout << (boost::format("%s: %+.1f%% against the baseline%s") %
+                    result.name_ % change % (regressed ? " REGRESSION" : "")).str() << std::endl;
+            }
+        }
+        if (regressions)
+        {
+            BOOST_THROW_EXCEPTION(isaac::common::PostConditionException(
+                (boost::format("%d benchmarks are slower than the baseline by more than %.1f%%") %
+                    regressions % options.tolerancePercent_).str()));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    isaac::common::run(runBenchmarks, argc, argv);
+}
@@ -0,0 +1,42 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file isaac-align-daemon.cpp
+ **
+ ** \brief User-facing executable for running alignment jobs in a persistent process
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include "common/Debug.hh"
+#include "common/SystemCompatibility.hh"
+#include "options/AlignDaemonOptions.hh"
+#include "package/InstallationPaths.hh"
+#include "workflow/AlignDaemon.hh"
+
+void alignDaemon(const isaac::options::AlignDaemonOptions &options)
+{
+    isaac::package::initialize(isaac::common::getModuleFileName(), "@iSAAC_HOME@");
+
+    isaac::workflow::AlignDaemon daemon(
+        options.spoolDirectory_,
+        options.pollInterval_,
+        options.maxJobs_);
+
+    daemon.run();
+}
+
+int main(int argc, char *argv[])
+{
+    isaac::common::configureMemoryManagement(true, true);
+    isaac::common::run(alignDaemon, argc, argv);
+}
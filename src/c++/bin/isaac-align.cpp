@@ -23,8 +23,7 @@
 #include "options/AlignOptions.hh"
 #include "package/InstallationPaths.hh"
 #include "reference/ReferenceMetadata.hh"
-#include "workflow/AlignWorkflowSerialization.hh"
-#include "workflow/AlignWorkflow.hh"
+#include "workflow/AlignJob.hh"
 
 void align(const isaac::options::AlignOptions &options);
 
@@ -49,107 +48,5 @@ void align(const isaac::options::AlignOptions &options)
         // We're the child process in a fork, just keep running.
     }
 
-    isaac::workflow::AlignWorkflow workflow(
-        options.argv,
-        options.description,
-        options.flowcellLayoutList,
-        options.seedLength,
-        options.barcodeMetadataList,
-        options.allowVariableReadLength,
-        options.cleanupIntermediary,
-        options.ignoreMissingBcls,
-        options.ignoreMissingFilters,
-        options.firstPassSeeds,
-        0, //TODO: have a command-line argument to override the estimation-based value
-        options.referenceMetadataList,
-        options.tempDirectory,
-        options.outputDirectory,
-        options.jobs,
-        options.repeatThreshold,
-        options.mateDriftRange,
-        options.neighborhoodSizeThreshold,
-        availableMemory,
-        options.clustersAtATimeMax,
-        options.ignoreNeighbors,
-        options.ignoreRepeats,
-        options.mapqThreshold,
-        options.perTileTls,
-        options.pfOnly,
-        options.baseQualityCutoff,
-        options.keepUnaligned,
-        options.preSortBins,
-        options.putUnalignedInTheBack,
-        options.realignGapsVigorously,
-        options.realignDodgyFragments,
-        options.realignedGapsPerFragment,
-        options.clipSemialigned,
-        options.clipOverlapping,
-        options.scatterRepeats,
-        options.gappedMismatchesMax,
-        options.avoidSmithWaterman,
-        options.gapMatchScore,
-        options.gapMismatchScore,
-        options.gapOpenScore,
-        options.gapExtendScore,
-        options.minGapExtendScore,
-        options.semialignedGapLimit,
-        options.dodgyAlignmentScore,
-        options.inputLoadersMax,
-        options.tempSaversMax,
-        options.tempLoadersMax,
-        options.outputSaversMax,
-        options.realignGaps,
-        options.bamGzipLevel,
-        options.bamPuFormat,
-        options.bamHeaderTags,
-        options.expectedBgzfCompressionRatio,
-        options.singleLibrarySamples,
-        options.keepDuplicates,
-        options.markDuplicates,
-        options.binRegexString,
-        options.memoryControl,
-        options.clusterIdList,
-        options.userTemplateLengthStatistics,
-        options.statsImageFormat,
-        options.bufferBins,
-        options.qScoreBin,
-        options.fullBclQScoreTable,
-        options.optionalFeatures,
-        options.pessimisticMapQ);
-
-    const boost::filesystem::path stateFilePath = options.tempDirectory / "AlignerState.txt";
-
-    if (isaac::workflow::AlignWorkflow::Start != options.startFrom)
-    {
-        isaac::workflow::load(stateFilePath, workflow);
-    }
-
-    isaac::workflow::AlignWorkflow::State targetState =
-        (options.stopAt == isaac::workflow::AlignWorkflow::Last) ? workflow.getNextState() : options.stopAt;
-
-    ISAAC_ASSERT_MSG(options.startFrom < targetState, "Target state must follow the start state");
-
-    if (options.startFrom != workflow.rewind(options.startFrom))
-    {
-        // store new state as we're about to corrupt all the data required for the subsequent ones
-        isaac::workflow::save(stateFilePath, workflow);
-    }
-
-    while(targetState != workflow.step())
-    {
-        // save new state
-        isaac::workflow::save(stateFilePath, workflow);
-        if (options.cleanupIntermediary)
-        {
-            workflow.cleanupIntermediary();
-        }
-    }
-
-    // save final state
-    isaac::workflow::save(stateFilePath, workflow);
-    if (options.cleanupIntermediary)
-    {
-        workflow.cleanupIntermediary();
-    }
+    isaac::workflow::runAlignJob(options, availableMemory);
 }
-
@@ -45,11 +45,25 @@ namespace alignment
  **
  ** Note: this is non-copyable because of the dynamically-allocated internal
  ** buffer.
+ **
+ ** The matrices are filled by one of the interchangeable kernels chosen at construction
+ ** time depending on what the CPU supports. All kernels produce identical traceback
+ ** matrices, the scalar one is kept as reference for cross-checking the vectorized ones.
  ** 
  **/
 class BandedSmithWaterman: boost::noncopyable
 {
 public:
+    enum Implementation
+    {
+        // pick the fastest one supported by the CPU
+        Auto,
+        Scalar,
+        Sse2,
+        // whole band in a single 256-bit register, gap extension computed by prefix scan
+        Avx2
+    };
+
     /**
      * \brief Initialize the optimizer with specific scores and width
      *
@@ -57,10 +71,12 @@ public:
      * \param mismatchScore - Expected to be negative. The lower the value, the less likely the mismatches are chosen
      * \param gapOpenScore - Expected to be positive. The higher the value, the less likely the gaps are opened
      * \param gapOpenScore - Expected to be positive. The higher the value, the less likely the gaps are extended
+     * \param implementation - kernel to use. Auto picks the fastest one supported by the CPU
      */
     BandedSmithWaterman(
         int matchScore, int mismatchScore, int gapOpenScore,
-        int gapExtendScore, int maxReadLength);
+        int gapExtendScore, int maxReadLength,
+        Implementation implementation = Auto);
     /// \brief delete the pre-allocated re-usable buffer
     ~BandedSmithWaterman();
     /**
@@ -92,6 +108,11 @@ public:
     static const unsigned distanceCutoff = 7;
     // Assumedly no reason to do gapped alignment if total mismatch count is 5 or less
     static const unsigned mismatchesCutoff = 5;
+
+    Implementation getImplementation() const {return implementation_;}
+    /// \return true if the CPU and the build support the implementation
+    static bool isSupported(const Implementation implementation);
+
 private:
     const int matchScore_;
     const int mismatchScore_; 
@@ -101,7 +122,35 @@ private:
     const short initialValue_; // minimal usable value to initialize the matrices
     typedef unsigned short ScoreType;
     static const unsigned int registerLength_ = 16 / sizeof(ScoreType);
+    const Implementation implementation_;
     char *T_;
+
+    // [G, E, F][band position]. Matrix values for the last query base
+    typedef short LastRow[3][WIDEST_GAP_SIZE];
+
+    static Implementation selectImplementation(const Implementation requested);
+
+    /**
+     ** \brief fill the traceback matrices in T_ for each query base. Each query base gets
+     **        3 * WIDEST_GAP_SIZE bytes: G, E and F matrix types for each band position
+     **/
+    void fillScalar(
+        const std::vector<char>::const_iterator queryBegin,
+        const std::vector<char>::const_iterator queryEnd,
+        const std::vector<char>::const_iterator databaseBegin,
+        LastRow &lastRow) const;
+    void fillSse2(
+        const std::vector<char>::const_iterator queryBegin,
+        const std::vector<char>::const_iterator queryEnd,
+        const std::vector<char>::const_iterator databaseBegin,
+        LastRow &lastRow) const;
+    // implemented in BandedSmithWatermanAvx2.cpp which is the only file compiled with AVX2 enabled
+    void fillAvx2(
+        const std::vector<char>::const_iterator queryBegin,
+        const std::vector<char>::const_iterator queryEnd,
+        const std::vector<char>::const_iterator databaseBegin,
+        LastRow &lastRow) const;
+    static bool avx2Supported();
 };  
 
 } // namespace alignment
@@ -287,6 +287,14 @@ public:
         return binFilePath_.string();
     }
 
+    /**
+     * \brief the file with io::FragmentIndexRecord for each fragment of an aligned bin, in the order of the data file
+     */
+    boost::filesystem::path getFragmentIndexPath() const
+    {
+        return boost::filesystem::path(binFilePath_.string() + ".idx");
+    }
+
     unsigned long getDataOffset() const
     {
         return dataOffset_;
@@ -0,0 +1,100 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ **
+ ** \file MatchArena.hh
+ **
+ ** \brief In-memory replacement for the match files produced by MatchFinder.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_ALIGNMENT_MATCH_ARENA_HH
+#define iSAAC_ALIGNMENT_MATCH_ARENA_HH
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include "alignment/Match.hh"
+#include "common/Debug.hh"
+
+namespace isaac
+{
+namespace alignment
+{
+
+/**
+ ** \brief Keeps the matches of each tile in memory so that MatchSelector can take them
+ **        without the temporary files round trip.
+ **
+ ** Matches of all MatchFinder iterations for a tile accumulate in the same slot. Concurrent
+ ** appends to the same tile must be serialized by the caller, appends to different tiles are safe
+ ** once reserveTiles has been called.
+ **/
+class MatchArena : boost::noncopyable
+{
+public:
+    /// ensures slots exist for tiles [0, maxTileIndex]. Not thread-safe
+    void reserveTiles(const unsigned maxTileIndex)
+    {
+        while (tileMatches_.size() <= maxTileIndex)
+        {
+            tileMatches_.push_back(new std::vector<Match>);
+        }
+    }
+
+    void append(const unsigned tileIndex, const Match *matchesBegin, const Match *matchesEnd)
+    {
+        std::vector<Match> &tileMatches = tileMatches_.at(tileIndex);
+        tileMatches.insert(tileMatches.end(), matchesBegin, matchesEnd);
+    }
+
+    unsigned long getTileMatchCount(const unsigned tileIndex) const
+    {
+        return tileIndex < tileMatches_.size() ? tileMatches_[tileIndex].size() : 0;
+    }
+
+    /**
+     * \brief Hands the tile matches over to the caller. The previous content of matches is
+     *        released and the arena slot is left without capacity, so that the memory of the
+     *        tiles that have been taken is not held by the arena.
+     */
+    void extractTileMatches(const unsigned tileIndex, std::vector<Match> &matches)
+    {
+        ISAAC_ASSERT_MSG(tileIndex < tileMatches_.size(), "Tile index is outside of the arena: " << tileIndex);
+        std::vector<Match>().swap(matches);
+        tileMatches_[tileIndex].swap(matches);
+    }
+
+    /// \return memory currently held by the tile slots
+    unsigned long getAllocatedBytes() const
+    {
+        unsigned long ret = 0;
+        for (boost::ptr_vector<std::vector<Match> >::const_iterator it = tileMatches_.begin();
+            tileMatches_.end() != it; ++it)
+        {
+            ret += it->capacity() * sizeof(Match);
+        }
+        return ret;
+    }
+
+private:
+    // ptr_vector keeps the already collected tile matches in place when slots are added
+    boost::ptr_vector<std::vector<Match> > tileMatches_;
+};
+
+} // namespace alignment
+} // namespace isaac
+
+#endif // #ifndef iSAAC_ALIGNMENT_MATCH_ARENA_HH
@@ -27,20 +27,25 @@
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include "alignment/SeedMetadata.hh"
 #include "alignment/SeedId.hh"
 #include "alignment/Seed.hh"
+#include "alignment/MatchArena.hh"
 #include "alignment/MatchTally.hh"
 #include "alignment/MatchDistribution.hh"
 #include "alignment/matchFinder/TileClusterInfo.hh"
 #include "common/Threads.hpp"
+#include "common/WorkStealingScheduler.hpp"
 #include "flowcell/TileMetadata.hh"
 #include "flowcell/ReadMetadata.hh"
 #include "io/FileBufCache.hh"
 #include "io/MatchWriter.hh"
 #include "oligo/Kmer.hh"
+#include "reference/MaskJumpTable.hh"
 #include "reference/ReferenceKmer.hh"
 #include "statistics/MatchFinderTileStats.hh"
 
@@ -74,7 +79,8 @@ public:
         common::ThreadVector &threads,
         const unsigned coresMax,
         const unsigned tempSaversMax,
-        const unsigned unavailableFileHandles);
+        const unsigned unavailableFileHandles,
+        MatchArena *matchArena);
 
     void setTiles(const flowcell::TileMetadataList &tiles);
 
@@ -155,10 +161,24 @@ private:
     ThreadMatchDistributions threadMatchDistributions_;
 
     io::TileMatchWriter matchWriter_;
+    // the writers reserve their buffers on construction and are not copied
+    boost::ptr_vector<io::ThreadMatchWriter> threadMatchWriters_;
     std::vector<io::FileBufCache<io::FileBufWithReopen> > threadReferenceFileBuffers_;
+    // one per kmer source. Mapped and loaded upfront as the matching runs under the malloc block
+    boost::ptr_vector<boost::iostreams::mapped_file_source> maskMappings_;
+    std::vector<reference::MaskJumpTable<KmerT> > maskJumpTables_;
 
-
-    mutable boost::mutex mutex_;
+    /// seeds of one mask. [nSeedsBegin_, nextBegin_) are the N-seeds that follow the mask seeds
+    struct MaskTask
+    {
+        typename KmerSourceMetadataList::const_iterator kmerSource_;
+        typename std::vector<SeedT>::const_iterator begin_;
+        typename std::vector<SeedT>::const_iterator nSeedsBegin_;
+        typename std::vector<SeedT>::const_iterator nextBegin_;
+    };
+    std::vector<MaskTask> maskTasks_;
+    std::vector<unsigned long> maskTaskCosts_;
+    common::WorkStealingScheduler maskScheduler_;
 
     /// top level component to find all the matches for the currently loaded seeds
     const std::vector<MatchDistribution> & match(
@@ -166,13 +186,20 @@ private:
         const std::vector<typename std::vector<SeedT>::iterator> &referenceSeedBounds,
         const bool findNeighbors,
         const bool finalPass);
-    /// management of parallelism between concurrent matchMask operations
-    void matchMaskParallel(
-        typename std::vector<SeedT>::const_iterator &seedsBegin,
-        const std::vector<typename std::vector<SeedT>::iterator> &referenceSeedBounds,
+    /// matches the seeds of one mask
+    void matchMaskTask(
         const bool findNeighbors,
         const bool finalPass,
-        typename KmerSourceMetadataList::const_iterator &kmerSourceIterator,
+        const unsigned taskIndex,
+        const unsigned threadNumber);
+    void flushThreadMatchWriter(const unsigned threadNumber) {threadMatchWriters_[threadNumber].flush();}
+
+    void openMasks();
+    void matchExactMask(
+        const typename std::vector<SeedT>::const_iterator seedsBegin,
+        const typename std::vector<SeedT>::const_iterator seedsEnd,
+        const bool finalPass,
+        const unsigned kmerSourceIndex,
         const unsigned threadNumber);
 
     std::pair<typename std::vector<SeedT>::const_iterator, typename std::vector<SeedT>::const_iterator>
@@ -180,8 +207,7 @@ private:
         const typename std::vector<SeedT>::const_iterator currentBegin,
         const typename std::vector<SeedT>::const_iterator seedsEnd,
         const unsigned currentMask,
-        const unsigned maskWidth,
-        const bool storeNSeedNoMatches);
+        const unsigned maskWidth);
 
     const std::vector<KmerSourceMetadata> getMaskFilesList(
         const reference::SortedReferenceMetadataList &sortedReferenceList) const;
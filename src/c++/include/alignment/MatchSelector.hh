@@ -35,6 +35,7 @@
 #include "alignment/Match.hh"
 #include "alignment/MatchDistribution.hh"
 #include "alignment/MatchTally.hh"
+#include "alignment/RestOfGenomeCorrection.hh"
 #include "alignment/SeedMetadata.hh"
 #include "alignment/TemplateLengthStatistics.hh"
 #include "alignment/matchSelector/BufferingFragmentStorage.hh"
@@ -45,6 +46,7 @@
 #include "common/Threads.hpp"
 #include "flowcell/BarcodeMetadata.hh"
 #include "reference/Contig.hh"
+#include "reference/ContigCache.hh"
 #include "reference/SortedReferenceMetadata.hh"
 #include "io/FiltersMapper.hh"
 
@@ -60,12 +62,30 @@ class MatchSelector: boost::noncopyable
 public:
     typedef flowcell::TileMetadataList TileMetadataList;
     typedef flowcell::ReadMetadataList ReadMetadataList;
+
+    /// Matches and base calls of one of the tiles selected together
+    struct BatchTile
+    {
+        BatchTile(
+            const flowcell::TileMetadata &tileMetadata,
+            const std::vector<Match> &matchList,
+            const BclClusters &bclData) :
+                tileMetadata_(&tileMetadata), matchList_(&matchList), bclData_(&bclData)
+        {
+        }
+        const flowcell::TileMetadata *tileMetadata_;
+        const std::vector<Match> *matchList_;
+        const BclClusters *bclData_;
+    };
+    typedef std::vector<BatchTile> Batch;
+
     /// Construction of an instance for a given reference
     MatchSelector(
         matchSelector::FragmentStorage &fragmentStorage,
         const MatchDistribution &matchDistribution,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
         unsigned int maxThreadCount,
+        const unsigned batchTilesMax,
         const TileMetadataList &tileMetadataList,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const flowcell::FlowcellLayoutList &flowcellLayoutList,
@@ -99,20 +119,54 @@ public:
         threadTemplateBuilders_.clear();
         std::vector<Cluster>().swap(threadCluster_);
         fragmentStorage_.unreserve();
-        std::vector<std::vector<reference::Contig> >().swap(contigList_);
+        contigList_.reset();
     }
 
     void dumpStats(const boost::filesystem::path &statsXmlPath);
 
+    /**
+     * \brief Selects the matches of all the tiles in the batch in one pass of the compute threads.
+     *
+     * Template length statistics are determined for the tiles in the batch order, so the result is the same
+     * as if the tiles were processed one by one. Each tile match list is expected to be sorted.
+     */
     void parallelSelect(
         const MatchTally &matchTally,
         std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics,
-        const flowcell::TileMetadata &tileMetadata,
-        std::vector<Match> &matchList,
-        const BclClusters &bclData);
+        const Batch &batch);
 
 private:
+    /// Matches of one barcode of one tile in the batch along with everything needed to process them
+    struct BatchSegment
+    {
+        BatchSegment(
+            const unsigned batchTileIndex,
+            const BatchTile &tile,
+            const std::vector<reference::Contig> &barcodeContigList,
+            const RestOfGenomeCorrection &restOfGenomeCorrection,
+            const matchSelector::SequencingAdapterList &sequencingAdapters,
+            const std::vector<Match>::const_iterator matchListBegin,
+            const std::vector<Match>::const_iterator matchListEnd,
+            const TemplateLengthStatistics &templateLengthStatistics) :
+                batchTileIndex_(batchTileIndex), tile_(tile), barcodeContigList_(&barcodeContigList),
+                restOfGenomeCorrection_(restOfGenomeCorrection), sequencingAdapters_(&sequencingAdapters),
+                matchListBegin_(matchListBegin), matchListEnd_(matchListEnd),
+                templateLengthStatistics_(templateLengthStatistics)
+        {
+        }
+        unsigned batchTileIndex_;
+        BatchTile tile_;
+        const std::vector<reference::Contig> *barcodeContigList_;
+        RestOfGenomeCorrection restOfGenomeCorrection_;
+        const matchSelector::SequencingAdapterList *sequencingAdapters_;
+        std::vector<Match>::const_iterator matchListBegin_;
+        std::vector<Match>::const_iterator matchListEnd_;
+        // copy, as with perTileTls the tiles of the same batch use different statistics
+        TemplateLengthStatistics templateLengthStatistics_;
+    };
+
     common::ThreadVector computeThreads_;
+    const unsigned batchTilesMax_;
 
     const TileMetadataList tileMetadataList_;
     /**
@@ -137,13 +191,15 @@ private:
     const std::vector<matchSelector::SequencingAdapterList> barcodeSequencingAdapters_;
 
     std::vector<matchSelector::MatchSelectorStats> allStats_;
+    /// Dimensions: [batchTileIndex * computeThreads_.size() + threadNumber]
     std::vector<matchSelector::MatchSelectorStats> threadStats_;
+    std::vector<BatchSegment> batchSegments_;
 
     const MatchDistribution &matchDistribution_;
     /**
      * \brief Dimensions: [referenceIndex][contigId]
      */
-    /*const*/ std::vector<std::vector<reference::Contig> > contigList_; //should be const, but we need the unreserve to be able to free it
+    reference::ContigListsPtr contigList_; //should be const, but we need the unreserve to be able to free it
 
     matchSelector::FragmentStorage &fragmentStorage_;
 
@@ -153,6 +209,8 @@ private:
     std::vector<matchSelector::OverlappingEndsClipper> threadOverlappingEndsClippers_;
     TemplateLengthDistribution templateLengthDistribution_;
 
+    void processBatch(const unsigned threadNumber);
+
     void processMatchList(
         const std::vector<reference::Contig> &barcodeContigList,
         const RestOfGenomeCorrection &restOfGenomeCorrection,
@@ -161,6 +219,7 @@ private:
         const flowcell::TileMetadata & tileMetadata,
         const BclClusters &bclData,
         const TemplateLengthStatistics & templateLengthStatistics,
+        matchSelector::MatchSelectorStats &ourThreadStats,
         const unsigned threadNumber);
 
 
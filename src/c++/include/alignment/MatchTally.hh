@@ -68,6 +68,10 @@ public:
     /// record the match count for each file produced by the matchWriter
     void operator()(const unsigned iteration, const unsigned tileIndex, const unsigned barcodeIndex);
 
+    /// record matchCount matches at once
+    void operator()(const unsigned iteration, const unsigned tileIndex, const unsigned barcodeIndex,
+                    const unsigned long matchCount);
+
     /// return all the tally for all match files for the given tile
     const FileTallyList &getFileTallyList(const flowcell::TileMetadata &tileMetadata) const;
 
@@ -25,6 +25,7 @@
 #include <iostream>
 
 #include "common/Debug.hh"
+#include "oligo/PackedSequence.hh"
 
 namespace isaac
 {
@@ -44,6 +45,8 @@ public:
         reverseSequence_.reserve(maxReadLength);
         forwardQuality_.reserve(maxReadLength);
         reverseQuality_.reserve(maxReadLength);
+        forwardPacked_.reserve(maxReadLength);
+        reversePacked_.reserve(maxReadLength);
     }
 
     /// Copy constructor to preserve the reserverd capacity during container push_back
@@ -53,6 +56,8 @@ public:
         , reverseSequence_(read.reverseSequence_)
         , forwardQuality_(read.forwardQuality_)
         , reverseQuality_(read.reverseQuality_)
+        , forwardPacked_(read.forwardPacked_)
+        , reversePacked_(read.reversePacked_)
         /*, beginCyclesMasked_(read.beginCyclesMasked_)*/
         , endCyclesMasked_(read.endCyclesMasked_)
     {
@@ -65,6 +70,8 @@ public:
     
     const std::vector<char> &getStrandSequence(bool reverse) const {return reverse ? reverseSequence_ : forwardSequence_;}
     const std::vector<char> &getStrandQuality(bool reverse) const {return reverse ? reverseQuality_ : forwardQuality_;}
+    /// 2-bit bases of the strand sequence with Ns flagged separately
+    const oligo::PackedSequence &getStrandPackedSequence(bool reverse) const {return reverse ? reversePacked_ : forwardPacked_;}
 
     const std::vector<char> &getForwardSequence() const {return forwardSequence_;}
     const std::vector<char> &getReverseSequence() const {return reverseSequence_;}
@@ -93,6 +100,8 @@ private:
     std::vector<char> reverseSequence_;
     std::vector<char> forwardQuality_;
     std::vector<char> reverseQuality_;
+    oligo::PackedSequence forwardPacked_;
+    oligo::PackedSequence reversePacked_;
     /// number of cycles masked at the start of the read.
     //unsigned beginCyclesMasked_;
     /// number of cycles masked at the end of the read.
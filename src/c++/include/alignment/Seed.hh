@@ -92,6 +92,31 @@ inline bool orderByKmerSeedIndex(const Seed<KmerT> &lhs, const Seed<KmerT> &rhs)
     return (lhs.getKmer() < rhs.getKmer()) || (lhs.getKmer() == rhs.getKmer() && lhs.getSeedId().getSeed() < rhs.getSeedId().getSeed());
 }
 
+/**
+ ** \brief common::RadixSorter key for the orderByKmerSeedIndex order: the seed index is the least
+ **        significant digit, the kmer bytes follow.
+ **/
+template <typename KmerT>
+struct SeedRadixDigits
+{
+    static const unsigned SEED_INDEX_DIGITS = (SeedId::SEED_WIDTH + 7) / 8;
+    static const unsigned DIGITS = SEED_INDEX_DIGITS + oligo::KmerTraits<KmerT>::KMER_BITS / 8;
+    /// seed sorting is allowed 1/SCRATCH_DIVISOR of the sorted seeds worth of extra memory
+    static const unsigned SCRATCH_DIVISOR = 16;
+
+    unsigned char operator()(const Seed<KmerT> &seed, const unsigned digit) const
+    {
+        return SEED_INDEX_DIGITS > digit ?
+            (seed.getSeedIndex() >> (digit * 8)) & 0xFF :
+            (seed.getKmer() >> ((digit - SEED_INDEX_DIGITS) * 8)) & 0xFF;
+    }
+
+    bool operator()(const Seed<KmerT> &lhs, const Seed<KmerT> &rhs) const
+    {
+        return orderByKmerSeedIndex(lhs, rhs);
+    }
+};
+
 template <typename KmerT>
 inline std::ostream &operator<<(std::ostream &os, const Seed<KmerT> &seed)
 {
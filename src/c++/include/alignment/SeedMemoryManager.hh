@@ -23,6 +23,7 @@
 #include <vector>
 #include <boost/noncopyable.hpp>
 
+#include "alignment/Match.hh"
 #include "alignment/Seed.hh"
 #include "alignment/SeedMetadata.hh"
 #include "common/Threads.hpp"
@@ -49,7 +50,8 @@ public:
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const ReadMetadataList &readMetadataList,
         const SeedMetadataList &seedMetadataList,
-        const flowcell::TileMetadataList &unprocessedTileMetadataList);
+        const flowcell::TileMetadataList &unprocessedTileMetadataList,
+        const bool inMemoryMatches);
 
     bool selectTiles(TileMetadataList &unprocessedPool,
                      const matchFinder::TileClusterInfo &fragmentsToSkip,
@@ -63,6 +65,8 @@ private:
     const flowcell::BarcodeMetadataList &barcodeMetadataList_;
     const ReadMetadataList &readMetadataList_;
     const SeedMetadataList &seedMetadataList_;
+    // matches stay in MatchArena, they need room next to the seeds
+    const bool inMemoryMatches_;
 
     // notFoundMatchesCount_[readIndex][tileIndex] : count of fragmentsToSkip[readIndex][tileIndex][clusterId] != true
     std::vector<std::vector<unsigned > > notFoundMatchesCount_;
@@ -22,7 +22,10 @@
 
 #include "alignment/Cigar.hh"
 #include "alignment/FragmentMetadata.hh"
+#include "alignment/fragmentBuilder/UngappedKernel.hh"
 #include "alignment/matchSelector/FragmentSequencingAdapterClipper.hh"
+#include "oligo/PackedSequence.hh"
+#include "reference/Contig.hh"
 
 namespace isaac
 {
@@ -52,6 +55,7 @@ protected:
     const unsigned normalizedGapOpenScore_;
     const unsigned normalizedGapExtendScore_;
     const unsigned normalizedMaxGapExtendScore_;
+    const UngappedKernel kernel_;
 
     unsigned updateFragmentCigar(
         const flowcell::ReadMetadataList &readMetadataList,
@@ -61,6 +65,17 @@ protected:
         const Cigar &cigarBuffer,
         const unsigned cigarOffset) const;
 
+    /**
+     * \brief Same as above, but compares the aligned bases a word at a time when the contig has been packed
+     */
+    unsigned updateFragmentCigar(
+        const flowcell::ReadMetadataList &readMetadataList,
+        const reference::Contig &contig,
+        FragmentMetadata &fragmentMetadata,
+        const long strandPosition,
+        const Cigar &cigarBuffer,
+        const unsigned cigarOffset) const;
+
     static void clipReference(
         const long referenceSize,
         FragmentMetadata &fragment,
@@ -77,6 +92,27 @@ protected:
         FragmentMetadata &fragment,
         std::vector<char>::const_iterator &sequenceBegin,
         std::vector<char>::const_iterator &sequenceEnd);
+
+private:
+    unsigned updateFragmentCigar(
+        const flowcell::ReadMetadataList &readMetadataList,
+        const std::vector<char> &reference,
+        const oligo::PackedSequence *packedReference,
+        FragmentMetadata &fragmentMetadata,
+        const long strandPosition,
+        const Cigar &cigarBuffer,
+        const unsigned cigarOffset) const;
+
+    unsigned updateAlign(
+        const Read &read,
+        const std::vector<char> &reference,
+        const oligo::PackedSequence *packedReference,
+        const unsigned long referenceOffset,
+        const unsigned sequenceOffset,
+        const unsigned length,
+        const unsigned firstCycle,
+        const unsigned lastCycle,
+        FragmentMetadata &fragmentMetadata) const;
 };
 
 } // namespace fragmentBuilder
@@ -0,0 +1,130 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file UngappedKernel.hh
+ **
+ ** \brief Block-wise comparison and scoring of ungapped stretches of the alignment
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_ALIGNMENT_FRAGMENT_BUILDER_UNGAPPED_KERNEL_HH
+#define iSAAC_ALIGNMENT_FRAGMENT_BUILDER_UNGAPPED_KERNEL_HH
+
+#include <boost/noncopyable.hpp>
+
+namespace isaac
+{
+namespace alignment
+{
+namespace fragmentBuilder
+{
+
+/**
+ ** \brief Compares read bases against the reference in blocks of up to 64 bases producing one bit per
+ **        base and sums the quality-weighted log probabilities of the block.
+ **
+ ** The compare implementation is chosen at construction time depending on what the CPU supports. The log
+ ** probabilities are added one base at a time in the order of the bases, so logProbability is
+ ** bit-identical to the base-by-base scoring regardless of the implementation.
+ **/
+class UngappedKernel: boost::noncopyable
+{
+public:
+    enum Implementation
+    {
+        // pick the fastest one supported by the CPU
+        Auto,
+        Scalar,
+        // 16 bases per compare, hardware popcount
+        Sse42,
+        // 32 bases per compare
+        Avx2,
+        // 64 bases per compare with masked loads
+        Avx512
+    };
+
+    static const unsigned BLOCK_BASES = 64;
+
+    explicit UngappedKernel(const Implementation implementation = Auto);
+
+    /**
+     * \brief Compares up to BLOCK_BASES bases. Bit i of the results corresponds to base i.
+     *
+     * \param mismatches bases for which isMatch(sequence[i], reference[i]) is false
+     * \param edits      bases that count towards the edit distance: sequence[i] != reference[i]
+     */
+    void compare(
+        const char *sequence,
+        const char *reference,
+        const unsigned length,
+        unsigned long &mismatches,
+        unsigned long &edits) const;
+
+    /**
+     * \brief Adds log probabilities of up to BLOCK_BASES bases to logProbability in the order of the bases.
+     *        Floating point addition is not associative, summing in any other order would change the
+     *        alignment scores.
+     *
+     * \param mismatches bit i set if base i is a mismatch
+     * \return logProbability with the bases added
+     */
+    double addLogProbabilities(
+        const char *quality,
+        const unsigned length,
+        const unsigned long mismatches,
+        double logProbability) const;
+
+    static unsigned countBits(const unsigned long bits)
+    {
+        return __builtin_popcountl(bits);
+    }
+
+    Implementation getImplementation() const {return implementation_;}
+    /// \return true if the CPU and the build support the implementation
+    static bool isSupported(const Implementation implementation);
+
+private:
+    // log probabilities of a match for each quality followed by those of a mismatch
+    static const unsigned QUALITY_MAX = 100;
+    double logProbabilityTable_[QUALITY_MAX * 2];
+    const Implementation implementation_;
+
+    static Implementation selectImplementation(const Implementation requested);
+
+    void compareScalar(
+        const char *sequence, const char *reference, const unsigned length,
+        unsigned long &mismatches, unsigned long &edits) const;
+
+    // implemented in UngappedKernelSse42.cpp, UngappedKernelAvx2.cpp and UngappedKernelAvx512.cpp which are
+    // the only files compiled with the corresponding instruction sets enabled
+    void compareSse42(
+        const char *sequence, const char *reference, const unsigned length,
+        unsigned long &mismatches, unsigned long &edits) const;
+    static bool sse42Supported();
+
+    void compareAvx2(
+        const char *sequence, const char *reference, const unsigned length,
+        unsigned long &mismatches, unsigned long &edits) const;
+    static bool avx2Supported();
+
+    void compareAvx512(
+        const char *sequence, const char *reference, const unsigned length,
+        unsigned long &mismatches, unsigned long &edits) const;
+    static bool avx512Supported();
+};
+
+} // namespace fragmentBuilder
+} // namespace alignment
+} // namespace isaac
+
+#endif // #ifndef iSAAC_ALIGNMENT_FRAGMENT_BUILDER_UNGAPPED_KERNEL_HH
@@ -27,6 +27,7 @@
 #include "alignment/Seed.hh"
 #include "io/MatchWriter.hh"
 #include "oligo/Kmer.hh"
+#include "reference/MaskJumpTable.hh"
 #include "reference/ReferenceKmer.hh"
 namespace isaac
 {
@@ -63,24 +64,42 @@ public:
         closeRepeats_(closeRepeats), storeNomatches_(storeNomatches), repeatThreshold_(repeatThreshold),
         ignoreNeighbors_(ignoreNeighbors), contigKaryotypes_(contigKaryotypes), seedMetadataList_(seedMetadataList),
         foundExactMatchesOnly_(foundExactMatchesOnly){}
-    /// walks along the sorted seeds and sorted reference and produces the matches
+    /**
+     ** \brief walks along the sorted seeds and produces the matches. For each distinct seed kmer, skips
+     **        straight to the corresponding range of the memory-mapped sorted reference.
+     **
+     ** \param jumpTable    prefix bucket offsets of the mask file. Empty table causes the search to cover the
+     **                     whole remainder of the reference for each seed kmer.
+     **/
     void matchMask(
         const SeedIterator beginSeeds,
         const SeedIterator endSeeds,
         const unsigned mask,
         MatchDistribution &matchDistribution,
         std::vector<ReferenceKmerT> &threadRepeatList,
-        io::TileMatchWriter &matchWriter,
-        std::istream &reference);
+        io::ThreadMatchWriter &matchWriter,
+        const ReferenceKmerT *referenceBegin,
+        const ReferenceKmerT *referenceEnd,
+        const reference::MaskJumpTable<KmerT> &jumpTable);
 
     void generateTooManyMatches(
         const SeedIterator currentSeed,
         const SeedIterator nextSeed,
-        io::TileMatchWriter &matchWriter);
+        io::ThreadMatchWriter &matchWriter);
     void generateNoMatches(
         const SeedIterator currentSeed,
         const SeedIterator nextSeed,
-        io::TileMatchWriter &matchWriter);
+        io::ThreadMatchWriter &matchWriter);
+
+    /**
+     ** \brief Finds the first reference kmer not less than kmer at or after current.
+     **/
+    static const ReferenceKmerT *skipToKmer(
+        const KmerT kmer,
+        const ReferenceKmerT *current,
+        const ReferenceKmerT *referenceBegin,
+        const ReferenceKmerT *referenceEnd,
+        const reference::MaskJumpTable<KmerT> &jumpTable);
 };
 
 } // namespace matchFinder
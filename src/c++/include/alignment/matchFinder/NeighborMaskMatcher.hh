@@ -61,7 +61,7 @@ public:
         MatchDistribution &matchDistribution,
         std::vector<ReferenceKmerT> &threadRepeatList,
         std::vector<ReferenceKmerT> &threadNeighborsList,
-        io::TileMatchWriter &matchWriter,
+        io::ThreadMatchWriter &matchWriter,
         std::istream &reference);
 
 private:
@@ -76,11 +76,11 @@ private:
     void generateNoMatches(
         const SeedIterator currentSeed,
         const SeedIterator nextSeed,
-        io::TileMatchWriter &matchWriter);
+        io::ThreadMatchWriter &matchWriter);
     void generateTooManyMatches(
         const SeedIterator currentSeed,
         const SeedIterator nextSeed,
-        io::TileMatchWriter &matchWriter);
+        io::ThreadMatchWriter &matchWriter);
 };
 
 } // namespace matchFinder
@@ -67,7 +67,7 @@ public:
     virtual void flush()
     {
     }
-    virtual void resize(const unsigned long clusters)
+    virtual void appendTile(const flowcell::TileMetadata &tileMetadata)
     {
     }
     virtual void unreserve()
@@ -84,6 +84,7 @@ private:
     /// association of a bin index to a path
     alignment::BinMetadataList binPathList_;
     boost::array<boost::mutex, 8> binMutex_;
+    // one open handle per bin. Fragment index files would double that, so BinSorter parses these bins instead
     boost::ptr_vector<std::ofstream > binFiles_;
 
     friend std::ostream& operator << (std::ostream& os, const BinningFragmentStorage &storage);
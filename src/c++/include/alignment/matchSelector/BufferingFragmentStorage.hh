@@ -56,6 +56,7 @@ public:
         const flowcell::FlowcellLayoutList &flowcellLayoutList,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const unsigned long maxTileClusters,
+        const unsigned long maxBatchClusters,
         const unsigned long totalTiles,
         const bool skipEmptyBins);
 
@@ -71,9 +72,9 @@ public:
 
     virtual void prepareFlush();
     virtual void flush();
-    virtual void resize(const unsigned long clusters)
+    virtual void appendTile(const flowcell::TileMetadata &tileMetadata)
     {
-        fragmentCollector_.resize(clusters);
+        fragmentCollector_.appendTile(tileMetadata);
     }
     virtual void unreserve()
     {
@@ -85,7 +86,8 @@ public:
 private:
     const bool keepUnaligned_;
     const unsigned long maxTileReads_;
-    // 0-based number of tile in the order in which they get stored.
+    // 0-based number of tile in the order in which they get stored. Advances by the number of tiles in each
+    // flushed batch so that the unaligned bin positions of a batch do not overlap with the ones of the next batch
     unsigned storedTile_;
     boost::mutex binFlushMutex_;
 
@@ -94,10 +96,13 @@ private:
 
     /// association of a bin index to a path
     alignment::BinMetadataList binPathList_;
+    /// BinMetadata::getFragmentIndexPath for each bin, precomputed to avoid allocations during flushing
+    std::vector<bfs::path> binIndexPaths_;
     FragmentCollector fragmentCollector_;
     matchSelector::FragmentBuffer flushBuffer_;
 
     typedef io::FileBufCache<io::FileBufWithReopen > FileBufCache;
+    // one handle per thread, used for the bin data, then for its fragment index
     std::vector<FileBufCache> threadDataFileBufCaches_;
 
     friend std::ostream& operator << (std::ostream& os, const BufferingFragmentStorage &storage);
@@ -106,6 +111,12 @@ private:
         const unsigned threadNumber,
         const unsigned binNumber, BinMetadata &binMetadata);
 
+    void flushBinIndex(
+        const unsigned threadNumber,
+        const unsigned binNumber,
+        const FragmentBuffer::IndexConstIterator binBegin,
+        const FragmentBuffer::IndexConstIterator binEnd);
+
 
     void flushUnmappedBin(
         const unsigned threadNumber,
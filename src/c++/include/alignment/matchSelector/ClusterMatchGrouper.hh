@@ -0,0 +1,113 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ClusterMatchGrouper.hh
+ **
+ ** Puts the matches of a tile in the order required by MatchSelector without comparison sort.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_ALIGNMENT_MATCH_SELECTOR_CLUSTER_MATCH_GROUPER_HH
+#define iSAAC_ALIGNMENT_MATCH_SELECTOR_CLUSTER_MATCH_GROUPER_HH
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include "alignment/Match.hh"
+#include "common/Threads.hpp"
+
+namespace isaac
+{
+namespace alignment
+{
+namespace matchSelector
+{
+
+/**
+ ** \brief Orders the matches of a tile by barcode, cluster, location and seed.
+ **
+ ** Cluster ids are dense and 0-based within a tile, so the position of every cluster in the result
+ ** is known after the matches are counted. The matches are then moved into their cluster buckets in place
+ ** and only the few matches of each cluster are sorted by location. To use all threads, the
+ ** buckets are first split into contiguous ranges of similar size by in-place partitioning.
+ **
+ ** All buffers are allocated at construction, so group does not allocate memory.
+ **/
+class ClusterMatchGrouper: boost::noncopyable
+{
+public:
+    ClusterMatchGrouper(
+        common::ThreadVector &threads,
+        const unsigned long maxTileClusters,
+        const unsigned barcodesCount);
+
+    /**
+     * \brief Orders matches the same way sorting by seed id tile, barcode and cluster,
+     *        then by location and seed number would do.
+     *
+     * \param tileClusters  number of clusters in the tile. All matches must belong to the same tile and have
+     *                      cluster ids below tileClusters
+     */
+    void group(const unsigned long tileClusters, std::vector<Match> &matches);
+
+    void unreserve();
+
+private:
+    /// a contiguous set of clusters in the order they appear in the result. [begin, end) in clustersByRank_
+    typedef std::pair<unsigned long, unsigned long> RankRange;
+    typedef std::vector<RankRange> RankRanges;
+
+    // don't split ranges further than this, the overhead will not pay off
+    static const unsigned long MIN_RANGE_MATCHES = 0x10000;
+    // ranges per thread that allow to balance the work when clusters have very different numbers of matches
+    static const unsigned RANGES_PER_THREAD = 4;
+
+    common::ThreadVector &threads_;
+    const unsigned barcodesCount_;
+    boost::mutex mutex_;
+
+    // number of matches of each cluster. Reused for counting the matches moved into place
+    std::vector<unsigned> clusterMatchCounts_;
+    std::vector<unsigned short> clusterBarcodes_;
+    // offset of the first match of the cluster in the result
+    std::vector<unsigned long> clusterOffsets_;
+    // cluster ids in the order of their buckets
+    std::vector<unsigned> clustersByRank_;
+    std::vector<unsigned long> barcodeClusters_;
+    std::vector<unsigned long> barcodeMatches_;
+    RankRanges ranges_;
+    RankRanges splitRanges_;
+
+    unsigned long getRankOffset(const unsigned long rank, const unsigned long tileClusters, const unsigned long totalMatches) const
+    {
+        return tileClusters == rank ? totalMatches : clusterOffsets_[clustersByRank_[rank]];
+    }
+
+    bool isBefore(const Match &match, const unsigned long offset) const
+    {
+        return clusterOffsets_[match.getCluster()] < offset;
+    }
+
+    void countMatches(const unsigned threadNumber, const std::vector<Match> &matches);
+    void rankClusters(const unsigned long tileClusters);
+    void splitRanges(const unsigned long tileClusters, std::vector<Match> &matches, std::size_t &nextRange);
+    void groupRanges(const unsigned long tileClusters, std::vector<Match> &matches, std::size_t &nextRange);
+    void groupRange(const RankRange &range, const unsigned long tileClusters, std::vector<Match> &matches);
+};
+
+} // namespace matchSelector
+} // namespace alignment
+} // namespace isaac
+
+#endif // #ifndef iSAAC_ALIGNMENT_MATCH_SELECTOR_CLUSTER_MATCH_GROUPER_HH
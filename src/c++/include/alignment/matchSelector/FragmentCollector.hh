@@ -27,6 +27,7 @@
 #include "alignment/BamTemplate.hh"
 #include "alignment/BinMetadata.hh"
 #include "alignment/matchSelector/BinIndexMap.hh"
+#include "flowcell/TileMetadata.hh"
 #include "io/Fragment.hh"
 
 
@@ -47,12 +48,13 @@ public:
                    const flowcell::FlowcellLayoutList &flowcellLayoutList):
         recordLength_(getRecordLength(flowcellLayoutList)),
         readOffsets_(getReadOffsets(flowcellLayoutList)), // offset of the first read is 0
-        clusters_(reserveClusters)
+        clusters_(0),
+        tiles_(0)
     {
         // data buffer is pre-allocated as the fragments will be put in there by mutiple threads using cluster id
         // as target location
         reserve(reserveClusters);
-        ISAAC_THREAD_CERR << "Constructed FragmentBuffer for " << clusters_ << " clusters. Record length: "
+        ISAAC_THREAD_CERR << "Constructed FragmentBuffer for " << reserveClusters << " clusters. Record length: "
             << recordLength_ << " read offsets : " << readOffsets_[0] << "," <<
             (READS_MAX == readOffsets_.size() ? readOffsets_[1] : 0)  <<  std::endl;
     }
@@ -108,11 +110,18 @@ public:
     typedef std::vector<IndexRecord>::const_iterator IndexConstIterator;
     typedef std::vector<IndexRecord>::iterator IndexIterator;
 
-    void resize(const unsigned long clusters)
+    /**
+     * \brief places the clusters of another tile after the ones already in the buffer
+     * \return index of the first record of the tile clusters
+     */
+    unsigned long appendTile(const unsigned long tileClusters)
     {
-        clusters_ = clusters;
+        const unsigned long ret = clusters_;
+        clusters_ += tileClusters;
+        ++tiles_;
         index_.resize(clusters_ * readOffsets_.size());
         data_.resize(clusters_ * recordLength_);
+        return ret;
     }
 
     void reserve(const unsigned long clusters)
@@ -123,6 +132,8 @@ public:
 
     void clear()
     {
+        clusters_ = 0;
+        tiles_ = 0;
         index_.clear();
         data_.clear();
     }
@@ -147,6 +158,7 @@ public:
         ISAAC_ASSERT_MSG(readOffsets_.size() == 1 || readOffsets_[1] == another.readOffsets_[1], "Read offsets must match");
         using std::swap;
         swap(clusters_, another.clusters_);
+        swap(tiles_, another.tiles_);
         index_.swap(another.index_);
         data_.swap(another.data_);
     }
@@ -179,6 +191,18 @@ public:
         return clusters_;
     }
 
+    /// \return number of tiles appended since the buffer was last cleared
+    unsigned getTiles() const
+    {
+        return tiles_;
+    }
+
+    /// \return bytes the buffer reserves for each cluster: the fragment record and its index entries
+    static unsigned long getClusterBytes(const flowcell::FlowcellLayoutList &flowcellLayoutList)
+    {
+        return getRecordLength(flowcellLayoutList) + getReadOffsets(flowcellLayoutList).size() * sizeof(IndexRecord);
+    }
+
     void sortIndex(const BinIndexMap &binIndexMap)
     {
         std::sort(index_.begin(), index_.end(), boost::bind(orderIndexByBin, _1, _2, boost::ref(binIndexMap)));
@@ -219,6 +243,7 @@ private:
     const unsigned recordLength_;
     const common::FiniteCapacityVector<unsigned, 2> readOffsets_;
     unsigned long clusters_;
+    unsigned tiles_;
     std::vector<IndexRecord> index_;
     std::vector<char> data_;
 
@@ -334,16 +359,18 @@ public:
     FragmentCollector(
         const BinIndexMap &binIndexMap,
         const unsigned long reserveClusters,
-        const flowcell::FlowcellLayoutList &flowcellLayoutList)
+        const flowcell::FlowcellLayoutList &flowcellLayoutList,
+        const unsigned long totalTiles)
     : binIndexMap_(binIndexMap),
-      buffer_(reserveClusters, flowcellLayoutList)
+      buffer_(reserveClusters, flowcellLayoutList),
+      tileClusterOffsets_(totalTiles, 0)
     {
     }
     ~FragmentCollector();
 
-    void resize(const unsigned long clusters)
+    void appendTile(const flowcell::TileMetadata &tileMetadata)
     {
-        buffer_.resize(clusters);
+        tileClusterOffsets_.at(tileMetadata.getIndex()) = buffer_.appendTile(tileMetadata.getClusterCount());
     }
 
     void add(
@@ -358,6 +385,8 @@ public:
 private:
     const BinIndexMap &binIndexMap_;
     FragmentBuffer buffer_;
+    // position of the tile clusters in buffer_, indexed by tile index. Valid for the tiles of the current batch
+    std::vector<unsigned long> tileClusterOffsets_;
     void storeBclAndCigar(const alignment::FragmentMetadata & fragment, FragmentBuffer::IndexRecord & recordStart);
 };
 
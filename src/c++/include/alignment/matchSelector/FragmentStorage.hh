@@ -22,6 +22,7 @@
 
 #include "alignment/BamTemplate.hh"
 #include "alignment/BinMetadata.hh"
+#include "flowcell/TileMetadata.hh"
 
 namespace isaac
 {
@@ -46,7 +47,11 @@ public:
 
     virtual void prepareFlush() = 0;
     virtual void flush() = 0;
-    virtual void resize(const unsigned long clusters) = 0;
+    /**
+     * \brief makes room for the clusters of one more tile of the batch being selected. prepareFlush
+     *        starts a new batch
+     */
+    virtual void appendTile(const flowcell::TileMetadata &tileMetadata) = 0;
     virtual void unreserve() = 0;
 };
 
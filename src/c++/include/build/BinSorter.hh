@@ -20,6 +20,7 @@
 #ifndef iSAAC_BUILD_BIN_SORTER_HH
 #define iSAAC_BUILD_BIN_SORTER_HH
 
+#include <algorithm>
 #include <numeric>
 
 #include <boost/filesystem.hpp>
@@ -28,11 +29,11 @@
 
 #include "alignment/BinMetadata.hh"
 #include "build/BamSerializer.hh"
+#include "build/DuplicateFragmentIndexFiltering.hh"
 #include "build/DuplicatePairEndFilter.hh"
 #include "build/FragmentIndex.hh"
 #include "build/GapRealigner.hh"
 #include "build/NotAFilter.hh"
-#include "build/DuplicateFragmentIndexFiltering.hh"
 #include "build/PackedFragmentBuffer.hh"
 #include "io/FileBufCache.hh"
 #include "flowcell/TileMetadata.hh"
@@ -81,7 +82,7 @@ public:
         const flowcell::FlowcellLayoutList &flowCellLayoutList,
         const IncludeTags includeTags,
         const bool pessimisticMapQ) :
-            singleLibrarySamples_(singleLibrarySamples),
+            duplicateSignatureFilter_(singleLibrarySamples, barcodeBamMapping.getSampleIndexMap()),
             keepDuplicates_(keepDuplicates),
             markDuplicates_(markDuplicates),
             bin_(bin),
@@ -91,12 +92,14 @@ public:
                            contigMap,
                            maxReadLength, forcedDodgyAlignmentScore, flowCellLayoutList, includeTags, pessimisticMapQ),
             fileBuf_(1, std::ios_base::binary|std::ios_base::in),
+            fragmentIndexPath_(bin_.getFragmentIndexPath()),
             realignGaps_(realignGaps),
             realignerGaps_(getGapGroupsCount()),
             gapRealigner_(
                 realignGapsVigorously, realignDodgyFragments, realignedGapsPerFragment, 3, 4, 0, clipSemialigned,
                 barcodeMetadataList, barcodeTemplateLengthStatistics, contigList),
-            dataDistribution_(bin_.getDataDistribution())
+            dataDistribution_(bin_.getDataDistribution()),
+            duplicateFilter_(keepDuplicates_)
     {
         data_.resize(bin_);
 
@@ -104,13 +107,23 @@ public:
         seIdxFileContent_.reserve(bin_.getSeIdxElements());
         rIdxFileContent_.reserve(bin_.getRIdxElements());
         fIdxFileContent_.reserve(bin_.getFIdxElements());
+        if (isFilteringDuplicates())
+        {
+            rSignatures_.reserve(bin_.getRIdxElements());
+            fSignatures_.reserve(bin_.getFIdxElements());
+            duplicateFilter_.reserve(std::max(bin_.getRIdxElements(), bin_.getFIdxElements()));
+        }
         if (REALIGN_NONE != realignGaps_)
         {
             gapRealigner_.reserve(bin_);
             reserveGaps(bin_, barcodeMetadataList);
 
         }
-        fileBuf_.reservePathBuffers(bin_.getPathString().size());
+        fileBuf_.reservePathBuffers(fragmentIndexPath_.string().size());
+        if (!isUnalignedBin())
+        {
+            fragmentIndex_.reserve(bin_.getSeIdxElements() + bin_.getRIdxElements() + bin_.getFIdxElements());
+        }
     }
 
     void reserveGaps(
@@ -123,7 +136,10 @@ public:
             bin.getSeIdxElements() * sizeof(SeFragmentIndex) +
             bin.getRIdxElements() * sizeof(RStrandOrShadowFragmentIndex) +
             bin.getFIdxElements() * sizeof(FStrandFragmentIndex) +
-            bin.getTotalElements() * sizeof(PackedFragmentBuffer::Index);
+            bin.getTotalElements() * sizeof(PackedFragmentBuffer::Index) +
+            (bin.getSeIdxElements() + bin.getRIdxElements() + bin.getFIdxElements()) * sizeof(io::FragmentIndexRecord) +
+            (bin.getRIdxElements() + bin.getFIdxElements()) * sizeof(DuplicateSignature) +
+            DuplicatePairEndFilter::getMemoryRequirements(std::max(bin.getRIdxElements(), bin.getFIdxElements()));
     }
 
     void unreserveIndexes()
@@ -131,6 +147,10 @@ public:
         std::vector<SeFragmentIndex>().swap(seIdxFileContent_);
         std::vector<RStrandOrShadowFragmentIndex>().swap(rIdxFileContent_);
         std::vector<FStrandFragmentIndex>().swap(fIdxFileContent_);
+        std::vector<DuplicateSignature>().swap(rSignatures_);
+        std::vector<DuplicateSignature>().swap(fSignatures_);
+        duplicateFilter_.unreserve();
+        std::vector<io::FragmentIndexRecord>().swap(fragmentIndex_);
     }
 
     void load()
@@ -182,7 +202,7 @@ public:
         return bin_.getIndex();
     }
 private:
-    const bool singleLibrarySamples_;
+    const DuplicateFilter duplicateSignatureFilter_;
     const bool keepDuplicates_;
     const bool markDuplicates_;
     const alignment::BinMetadata &bin_;
@@ -193,17 +213,31 @@ private:
     std::vector<RStrandOrShadowFragmentIndex> rIdxFileContent_;
     std::vector<FStrandFragmentIndex> fIdxFileContent_;
     PackedFragmentBuffer data_;
+    // reads the fragment index, then the bin data
     io::FileBufCache<io::FileBufWithReopen> fileBuf_;
+    const boost::filesystem::path fragmentIndexPath_;
+    std::vector<io::FragmentIndexRecord> fragmentIndex_;
     const GapRealignerMode realignGaps_;
     std::vector<RealignerGaps> realignerGaps_;
     GapRealigner gapRealigner_;
     alignment::BinDataDistribution dataDistribution_;
+    // duplicate signatures of rIdxFileContent_ and fIdxFileContent_ elements
+    std::vector<DuplicateSignature> rSignatures_;
+    std::vector<DuplicateSignature> fSignatures_;
+    DuplicatePairEndFilter duplicateFilter_;
 
     void loadData();
     void loadUnalignedData();
     void loadAlignedData();
+    bool loadFragmentIndex();
+    void placeIndexedData(std::istream &isData);
+    unsigned long placeFragment(std::istream &isData, const io::FragmentIndexRecord &record);
+    void parseAlignedData(std::istream &isData);
+    template <typename FragmentT>
+    void indexFragment(const FragmentT &fragment, const unsigned long offset, const unsigned long mateOffset);
     const io::FragmentAccessor &loadFragment(std::istream &isData, unsigned long &offset);
     bool isUnalignedBin() const {return bin_.isUnalignedBin();}
+    bool isFilteringDuplicates() const {return !keepDuplicates_ || markDuplicates_;}
     unsigned long getUniqueRecordsCount() const {return isUnalignedBin() ? bin_.getTotalElements() : size();}
 
     void resolveDuplicates(BuildStats &buildStats);
@@ -27,6 +27,7 @@
 
 #include "alignment/BinMetadata.hh"
 #include "alignment/TemplateLengthStatistics.hh"
+#include "bam/BamIndexer.hh"
 #include "build/BarcodeBamMapping.hh"
 #include "build/BinSorter.hh"
 #include "build/BuildStats.hh"
@@ -36,6 +37,7 @@
 #include "flowcell/Layout.hh"
 #include "flowcell/TileMetadata.hh"
 #include "io/FileSinkWithMd5.hh"
+#include "reference/ContigCache.hh"
 #include "reference/SortedReferenceMetadata.hh"
 
 
@@ -62,6 +64,7 @@ class Build
     std::vector<unsigned> computeSlotWaitingBins_;
     const unsigned maxSavers_;
     const int bamGzipLevel_;
+    const bam::BamIndexFormat bamIndexFormat_;
     const std::string &bamPuFormat_;
     const std::vector<std::string> &bamHeaderTags_;
     // forcedDodgyAlignmentScore_ gets assigned to reads that have their scores at ushort -1
@@ -85,7 +88,7 @@ class Build
 
     common::ThreadVector threads_;
 
-    const std::vector<std::vector<reference::Contig> > contigList_;
+    const reference::ContigListsPtr contigList_;
     //pair<[barcode], [output file]>, first maps barcode indexes to unique paths in second
     BarcodeBamMapping barcodeBamMapping_;
     //[output file], one stream per bam file path
@@ -98,7 +101,8 @@ class Build
     std::vector<boost::shared_ptr<BinSorter> > threadBinSorters_;
     //[thread][bam file][byte]
     std::vector<std::vector<std::vector<char> > > threadBgzfBuffers_;
-    // Geometry: [thread][bam file]. Streams for compressing bam data into threadBgzfBuffers_
+    // Geometry: [thread][bam file]. Streams for compressing bam data into threadBgzfBuffers_.
+    // Created once per thread, BinSorter::serialize flushes them at the end of each bin
     boost::ptr_vector<boost::ptr_vector<boost::iostreams::filtering_ostream> > threadBgzfStreams_;
     boost::ptr_vector<boost::ptr_vector<bam::BamIndexPart> > threadBamIndexParts_;
 
@@ -117,6 +121,7 @@ public:
           const unsigned maxSavers,
           const build::GapRealignerMode realignGaps,
           const int bamGzipLevel,
+          const bam::BamIndexFormat bamIndexFormat,
           const std::string &bamPuFormat,
           const std::vector<std::string> &bamHeaderTags,
           const double expectedBgzfCompressionRatio,
@@ -142,14 +147,20 @@ public:
         const flowcell::FlowcellLayoutList &flowcellLayoutList,
         const unsigned long availableMemory,
         const double expectedBgzfCompressionRatio,
-        const unsigned computeThreads);
+        const unsigned computeThreads,
+        const unsigned bgzfStreams);
 
     const BarcodeBamMapping &getBarcodeBamMapping() const {return barcodeBamMapping_;}
 private:
+    bam::BamIndexBinning getBamIndexBinning(
+        const reference::SortedReferenceMetadata &sampleReference,
+        const unsigned referenceIndex,
+        const boost::filesystem::path &bamPath) const;
+
     std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> >  createOutputFileStreams(
         const flowcell::TileMetadataList &tileMetadataList,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
-        boost::ptr_vector<bam::BamIndex> &bamIndexes) const;
+        boost::ptr_vector<bam::BamIndex> &bamIndexes);
 
     unsigned long reserveBuffers(
         boost::unique_lock<boost::mutex> &lock,
@@ -206,6 +217,8 @@ private:
         BinSorter &indexedBin,
         const unsigned threadNumber);
 
+    void resolveBamIndexParts(const size_t threadNumber);
+
     void saveAndReleaseBuffers(
         boost::unique_lock<boost::mutex> &lock,
         const boost::filesystem::path &filePath,
@@ -29,184 +29,42 @@ namespace build
 {
 
 /**
- * \brief Order and compares reads to identify duplicates.
+ * \brief Makes duplicate signatures of pair ends.
  *
- * \param oneLibrarySample if true, the sample index is used instead of lane-barcode. This ensures that PCR
+ * \param singleLibrarySamples if true, the sample index is used instead of lane-barcode. This ensures that PCR
  *        duplicates from different lanes are caught.
  */
-template <bool singleLibrarySamples>
-struct FDuplicateFilter
+class DuplicateFilter
 {
-    const BarcodeBamMapping::BarcodeSampleIndexMap &barcodeSampleIndex_;
-    FDuplicateFilter(const BarcodeBamMapping::BarcodeSampleIndexMap &barcodeSampleIndex):
-        barcodeSampleIndex_(barcodeSampleIndex){}
-    bool less(const PackedFragmentBuffer &fragments,
-                     const FStrandFragmentIndex &left,
-                     const FStrandFragmentIndex &right) const
+public:
+    DuplicateFilter(
+        const bool singleLibrarySamples,
+        const BarcodeBamMapping::BarcodeSampleIndexMap &barcodeSampleIndex):
+        singleLibrarySamples_(singleLibrarySamples), barcodeSampleIndex_(barcodeSampleIndex){}
+
+    //same library must be grouped together as we dupe-remove only within the library
+    unsigned getLibrary(const unsigned long barcode) const
     {
-        if (left.fStrandPos_ < right.fStrandPos_)
-            {return true;}
-
-        if (left.fStrandPos_ == right.fStrandPos_)
-        {
-            if (left.mate_.anchor_.value_ < right.mate_.anchor_.value_)
-                {return true;}
-
-            if (left.mate_.anchor_.value_ == right.mate_.anchor_.value_)
-            {
-                if (left.mate_.info_.value_ < right.mate_.info_.value_)
-                    {return true;}
-
-                if (left.mate_.info_.value_ == right.mate_.info_.value_)
-                {
-                    const io::FragmentAccessor &leftFragment = fragments.getFragment(left);
-                    const io::FragmentAccessor &rightFragment = fragments.getFragment(right);
-                    const unsigned long leftLibrary = singleLibrarySamples ?
-                        barcodeSampleIndex_.at(leftFragment.barcode_) : leftFragment.barcode_;
-                    const unsigned long rightLibrary = singleLibrarySamples ?
-                        barcodeSampleIndex_.at(rightFragment.barcode_) : rightFragment.barcode_;
-                    //same library must be grouped together as we dupe-remove only within the library
-                    if (leftLibrary < rightLibrary)
-                        {return true;}
-
-                    if (leftLibrary == rightLibrary)
-                    {
-                        // we want higher alignment score on top
-                        if (left.duplicateClusterRank_ > right.duplicateClusterRank_)
-                            {return true;}
-
-                        if (left.duplicateClusterRank_ == right.duplicateClusterRank_)
-                        {
-                            if (leftFragment.tile_ * INSANELY_HIGH_NUMBER_OF_CLUSTERS_PER_TILE + leftFragment.clusterId_ <
-                                rightFragment.tile_ * INSANELY_HIGH_NUMBER_OF_CLUSTERS_PER_TILE + rightFragment.clusterId_)
-                                {return true;}
-                        }
-                    }
-                }
-            }
-        }
-
-        return false;
+        return singleLibrarySamples_ ? barcodeSampleIndex_.at(barcode) : barcode;
     }
-    bool equal_to(const PackedFragmentBuffer &fragments,
-                         const FStrandFragmentIndex &left,
-                         const FStrandFragmentIndex &right) const
-    {
-        if (left.fStrandPos_ == right.fStrandPos_ &&
-            left.mate_.anchor_.value_ == right.mate_.anchor_.value_ &&
-            left.mate_.info_.value_ == right.mate_.info_.value_)
-        {
-            const io::FragmentAccessor &leftFragment = fragments.getFragment(left);
-            const io::FragmentAccessor &rightFragment = fragments.getFragment(right);
-
-            // In a weird case when both ends of a pair are facing the same way and align at the same position,
-            // this condition prevents one being discarded as duplicated of another
-            if (leftFragment.tile_ != rightFragment.tile_ ||
-                leftFragment.clusterId_ != rightFragment.clusterId_)
-            {
-                const unsigned long leftLibrary = singleLibrarySamples ?
-                    barcodeSampleIndex_.at(leftFragment.barcode_) : leftFragment.barcode_;
-                const unsigned long rightLibrary = singleLibrarySamples ?
-                    barcodeSampleIndex_.at(rightFragment.barcode_) : rightFragment.barcode_;
-
-                return leftLibrary == rightLibrary;
-            }
-        }
-        return false;
-    }
-};
-
-template <bool singleLibrarySamples>
-struct RSDuplicateFilter
-{
-    const BarcodeBamMapping::BarcodeSampleIndexMap &barcodeSampleIndex_;
-    RSDuplicateFilter(const BarcodeBamMapping::BarcodeSampleIndexMap &barcodeSampleIndex):
-        barcodeSampleIndex_(barcodeSampleIndex){}
-    bool less(const PackedFragmentBuffer &fragments,
-                     const RStrandOrShadowFragmentIndex &left,
-                     const RStrandOrShadowFragmentIndex &right) const
-    {
-        if (left.anchor_.value_ < right.anchor_.value_)
-            {return true;}
-
-        if (left.anchor_.value_ == right.anchor_.value_)
-        {
-            if (left.mate_.anchor_.value_ < right.mate_.anchor_.value_)
-                {return true;}
-
-            if (left.mate_.anchor_.value_ == right.mate_.anchor_.value_)
-            {
-                if (left.mate_.info_.value_ < right.mate_.info_.value_)
-                    {return true;}
-
-                if (left.mate_.info_.value_ == right.mate_.info_.value_)
-                {
-                    const io::FragmentAccessor &leftFragment = fragments.getFragment(left);
-                    const io::FragmentAccessor &rightFragment = fragments.getFragment(right);
-                    const unsigned long leftLibrary = singleLibrarySamples ?
-                        barcodeSampleIndex_.at(leftFragment.barcode_) : leftFragment.barcode_;
-                    const unsigned long rightLibrary = singleLibrarySamples ?
-                        barcodeSampleIndex_.at(rightFragment.barcode_) : rightFragment.barcode_;
-                    //same library must be grouped together as we dupe-remove only within the library
-                    if (leftLibrary < rightLibrary)
-                        {return true;}
-
-                    if (leftLibrary == rightLibrary)
-                    {
-                        // we want higher alignment score on top
-                        if (left.duplicateClusterRank_ > right.duplicateClusterRank_)
-                            {return true;}
 
-                        if (left.duplicateClusterRank_ == right.duplicateClusterRank_)
-                        {
-                            if (fragments.getFragment(left).tile_ * INSANELY_HIGH_NUMBER_OF_CLUSTERS_PER_TILE + fragments.getFragment(left).clusterId_ <
-                                fragments.getFragment(right).tile_ * INSANELY_HIGH_NUMBER_OF_CLUSTERS_PER_TILE + fragments.getFragment(right).clusterId_)
-                            {
-                                return true;
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        return false;
-    }
-    bool equal_to(const PackedFragmentBuffer &fragments,
-                         const RStrandOrShadowFragmentIndex &left,
-                         const RStrandOrShadowFragmentIndex &right) const
+    /**
+     * \param index position of idx in the pair end index range passed to DuplicatePairEndFilter::filterSignatures
+     */
+    template <typename IndexT>
+    DuplicateSignature getSignature(
+        const IndexT &idx,
+        const unsigned long barcode,
+        const unsigned index) const
     {
-        if (left.anchor_.value_ == right.anchor_.value_ &&
-            left.mate_.anchor_.value_ == right.mate_.anchor_.value_ &&
-            left.mate_.info_.value_ == right.mate_.info_.value_)
-        {
-            const io::FragmentAccessor &leftFragment = fragments.getFragment(left);
-            const io::FragmentAccessor &rightFragment = fragments.getFragment(right);
-
-            // In a weird case when both ends of a pair are facing the same way and align at the same position,
-            // this condition prevents one being discarded as duplicated of another
-            if (leftFragment.tile_ != rightFragment.tile_ ||
-                leftFragment.clusterId_ != rightFragment.clusterId_)
-            {
-                const unsigned long leftLibrary = singleLibrarySamples ?
-                    barcodeSampleIndex_.at(leftFragment.barcode_) : leftFragment.barcode_;
-                const unsigned long rightLibrary = singleLibrarySamples ?
-                    barcodeSampleIndex_.at(rightFragment.barcode_) : rightFragment.barcode_;
-
-                return leftLibrary == rightLibrary;
-            }
-        }
-        else
-        {
-//            ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(leftFragment.clusterId_, "Not a duplicate " << left << ":" << right);
-//            ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(rightFragment.clusterId_, "Not a duplicate " << left << ":" << right);
-        }
-        return false;
+        return getDuplicateSignature(idx, getLibrary(barcode), index);
     }
 
+private:
+    const bool singleLibrarySamples_;
+    const BarcodeBamMapping::BarcodeSampleIndexMap &barcodeSampleIndex_;
 };
 
-
 } // namespace build
 } // namespace isaac
 
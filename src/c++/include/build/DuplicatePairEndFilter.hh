@@ -20,6 +20,9 @@
 #ifndef iSAAC_BUILD_DUPLICATE_PAIR_END_FILTER_HH
 #define iSAAC_BUILD_DUPLICATE_PAIR_END_FILTER_HH
 
+#include <iterator>
+#include <vector>
+
 #include "build/BuildStats.hh"
 #include "build/FragmentIndex.hh"
 #include "build/PackedFragmentBuffer.hh"
@@ -33,82 +36,155 @@ namespace build
 /**
  *
  * \brief This class implements the generic duplicate filtering flow:
- *  1. sort according to the duplicate ranking
- *  2. skip the ones that are duplicates
- *  3. sort the results according to output storage order requirements
+ *  1. group the pair ends by their DuplicateSignature using an open addressing hash table. Pick the best
+ *     ranking end of each group on the way
+ *  2. keep the best end of each group and the ends coming from the same cluster, skip or mark the rest
+ *
+ *  Fragment payload is accessed only to break ties between equally ranked ends and to produce the results.
+ *  The order of the results is not defined.
  **/
 class DuplicatePairEndFilter
 {
 public:
     DuplicatePairEndFilter(const bool keepDuplicates) : keepDuplicates_(keepDuplicates){}
-    template <typename FilterT, typename InputIteratorT, typename InsertIteratorT>
-    void filterInput(
-        const FilterT& filter,
+
+    static unsigned long getMemoryRequirements(const unsigned long signatures)
+    {
+        return getGroupTableSize(signatures) * sizeof(unsigned);
+    }
+
+    void reserve(const unsigned long signatures)
+    {
+        groups_.reserve(getGroupTableSize(signatures));
+    }
+
+    void unreserve()
+    {
+        std::vector<unsigned>().swap(groups_);
+    }
+
+    /**
+     * \param duplicatesBegin   pair end index records referred to by DuplicateSignature::index_
+     */
+    template <typename InputIteratorT, typename SignatureIteratorT, typename InsertIteratorT>
+    void filterSignatures(
         PackedFragmentBuffer &fragments,
         InputIteratorT duplicatesBegin,
-        InputIteratorT duplicatesEnd,
+        SignatureIteratorT signaturesBegin,
+        SignatureIteratorT signaturesEnd,
         BuildStats &buildStats,
         const unsigned binIndex,
         InsertIteratorT results)
     {
-        if (duplicatesBegin != duplicatesEnd)
+        if (signaturesBegin == signaturesEnd)
         {
-            // reorder them according to duplicate removal rules
-            ISAAC_THREAD_CERR << "Sorting duplicates" << std::endl;
-            const clock_t startSort = clock();
-
-            std::sort(duplicatesBegin, duplicatesEnd,
-                      boost::bind(&FilterT::less, &filter,
-                                  boost::ref(fragments), _1, _2));
+            return;
+        }
 
-            ISAAC_THREAD_CERR << "Sorting duplicates" << " done in " << (clock() - startSort) / 1000 << "ms" << std::endl;
+        ISAAC_THREAD_CERR << "Grouping duplicates" << std::endl;
+        const clock_t startGroup = clock();
 
-            // populate self with the unique fragments
-            ISAAC_THREAD_CERR << "Filtering duplicates" << std::endl;
-            const clock_t startFilter = clock();
+        const unsigned long signaturesCount = std::distance(signaturesBegin, signaturesEnd);
+        ISAAC_ASSERT_MSG(NO_GROUP > signaturesCount, "Too many pair ends for duplicate filtering: " << signaturesCount);
+        const unsigned long tableSize = getGroupTableSize(signaturesCount);
+        const unsigned long tableMask = tableSize - 1;
+        // each slot of the table points at the best ranking signature of the group
+        groups_.assign(tableSize, unsigned(NO_GROUP));
 
+        for (SignatureIteratorT it(signaturesBegin); signaturesEnd != it; ++it)
+        {
+            unsigned long slot = it->hash() & tableMask;
+            while (NO_GROUP != groups_[slot] && !signaturesBegin[groups_[slot]].sameKey(*it))
+            {
+                slot = (slot + 1) & tableMask;
+            }
+            it->group_ = slot;
 
-            // Range is guaranteed to be not empty
-            unsigned long unique = 1;
-            const io::FragmentAccessor &firstBestFragment = fragments.getFragment(*duplicatesBegin);
-            results++ = PackedFragmentBuffer::Index(*duplicatesBegin, firstBestFragment);
-            ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(firstBestFragment.clusterId_, "Selected as the first duplicate best: " << *duplicatesBegin  << ":" << firstBestFragment);
-            for (InputIteratorT it(duplicatesBegin + 1), itLast(duplicatesBegin); duplicatesEnd != it; ++it)
+            const unsigned signature = std::distance(signaturesBegin, it);
+            if (NO_GROUP == groups_[slot] ||
+                isBetter(fragments, duplicatesBegin[it->index_], duplicatesBegin[signaturesBegin[groups_[slot]].index_]))
             {
-                io::FragmentAccessor &fragment = fragments.getFragment(*it);
-                ISAAC_DEV_TRACE_BLOCK(const io::FragmentAccessor &lastFragment = fragments.getFragment(*itLast);)
-
-                if (!filter.equal_to(fragments, *itLast, *it))
-                {
-                    ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Selected as a duplicate best:         " << *it << ":" << fragment);
-                    ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Selected as a duplicate best prev:    " << *itLast << ":" << fragments.getFragment(*itLast));
-                    results++ = PackedFragmentBuffer::Index(*it, fragment);
-                    unique++;
-                    itLast = it;
-                    buildStats.incrementUniqueFragments(binIndex, fragment.barcode_);
-                }
-                else if (keepDuplicates_)
-                {
-                    fragment.flags_.duplicate_ = true;
-                    results++ = PackedFragmentBuffer::Index(*it, fragment);
-                    ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Marked as a duplicate of:             " << lastFragment << ":" << *it << ":" << fragment);
-                    ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(lastFragment.clusterId_, "Marked as a duplicate of:             " << lastFragment << ":" << *it << ":" << fragment);
-                }
-                else
-                {
-                    ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Discarded as a duplicate of:          " << lastFragment << ":" << *it << ":" << fragment);
-                    ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(lastFragment.clusterId_, "Discarded as a duplicate of:          " << lastFragment << ":" << *it << ":" << fragment);
-                }
-                buildStats.incrementTotalFragments(binIndex, fragments.getFragment(*it).barcode_);
+                groups_[slot] = signature;
             }
+        }
+
+        ISAAC_THREAD_CERR << "Grouping duplicates" << " done in " << (clock() - startGroup) / 1000 << "ms" << std::endl;
+
+        ISAAC_THREAD_CERR << "Filtering duplicates" << std::endl;
+        const clock_t startFilter = clock();
+
+        unsigned long unique = 0;
+        for (SignatureIteratorT it(signaturesBegin); signaturesEnd != it; ++it)
+        {
+            const typename std::iterator_traits<InputIteratorT>::value_type &idx = duplicatesBegin[it->index_];
+            const typename std::iterator_traits<InputIteratorT>::value_type &bestIdx =
+                duplicatesBegin[signaturesBegin[groups_[it->group_]].index_];
+            io::FragmentAccessor &fragment = fragments.getFragment(idx);
 
-            ISAAC_THREAD_CERR << "Filtering duplicates"
-                << " done in " << (clock() - startFilter) / 1000 << "ms. found " << unique
-                << " unique out of " << duplicatesEnd - duplicatesBegin << " fragments" << std::endl;
+            // In a weird case when both ends of a pair are facing the same way and align at the same position,
+            // the end that belongs to the cluster of the best one is not a duplicate. Ends of the same cluster
+            // have the same duplicateClusterRank_, so the payload of the best end is needed only when ranks match.
+            if (&idx == &bestIdx ||
+                (idx.duplicateClusterRank_ == bestIdx.duplicateClusterRank_ &&
+                    getGlobalClusterId(fragment) == getGlobalClusterId(fragments.getFragment(bestIdx))))
+            {
+                ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Selected as a duplicate best:         " << idx << ":" << fragment);
+                results++ = PackedFragmentBuffer::Index(idx, fragment);
+                ++unique;
+                buildStats.incrementUniqueFragments(binIndex, fragment.barcode_);
+            }
+            else if (keepDuplicates_)
+            {
+                fragment.flags_.duplicate_ = true;
+                results++ = PackedFragmentBuffer::Index(idx, fragment);
+                ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Marked as a duplicate of:             " << bestIdx << ":" << idx << ":" << fragment);
+            }
+            else
+            {
+                ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.clusterId_, "Discarded as a duplicate of:          " << bestIdx << ":" << idx << ":" << fragment);
+            }
+            buildStats.incrementTotalFragments(binIndex, fragment.barcode_);
         }
+
+        ISAAC_THREAD_CERR << "Filtering duplicates"
+            << " done in " << (clock() - startFilter) / 1000 << "ms. found " << unique
+            << " unique out of " << signaturesCount << " fragments" << std::endl;
     }
+
 private:
+    static const unsigned NO_GROUP = -1U;
     const bool keepDuplicates_;
+    std::vector<unsigned> groups_;
+
+    /**
+     * \return power of two that keeps the table at most half full
+     */
+    static unsigned long getGroupTableSize(const unsigned long signatures)
+    {
+        unsigned long ret = 2;
+        while (ret < signatures * 2)
+        {
+            ret <<= 1;
+        }
+        return ret;
+    }
+
+    static unsigned long getGlobalClusterId(const io::FragmentAccessor &fragment)
+    {
+        return fragment.tile_ * INSANELY_HIGH_NUMBER_OF_CLUSTERS_PER_TILE + fragment.clusterId_;
+    }
+
+    /**
+     * \brief higher alignment score wins, lower cluster id breaks the ties
+     */
+    static bool isBetter(const PackedFragmentBuffer &fragments, const PairEndIndex &left, const PairEndIndex &right)
+    {
+        if (left.duplicateClusterRank_ != right.duplicateClusterRank_)
+        {
+            return left.duplicateClusterRank_ > right.duplicateClusterRank_;
+        }
+        return getGlobalClusterId(fragments.getFragment(left)) < getGlobalClusterId(fragments.getFragment(right));
+    }
 };
 
 
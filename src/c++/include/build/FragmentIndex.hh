@@ -212,6 +212,74 @@ inline std::ostream &operator <<(std::ostream& os, const RStrandOrShadowFragment
         ")" << &idx;
 }
 
+/**
+ * \brief Fixed-width key of a pair end for duplicate detection. Pair ends with equal signatures are duplicates
+ *        unless they come from the same cluster.
+ */
+struct DuplicateSignature
+{
+    DuplicateSignature() : anchor_(0), mateAnchor_(0), mateInfo_(0), library_(0), index_(0), group_(0){}
+    DuplicateSignature(
+        const unsigned long anchor,
+        const unsigned long mateAnchor,
+        const unsigned mateInfo,
+        const unsigned library,
+        const unsigned index) :
+            anchor_(anchor), mateAnchor_(mateAnchor), mateInfo_(mateInfo), library_(library), index_(index), group_(0)
+    {}
+
+    // f-strand position for f-stranded ends, FragmentIndexAnchor value for r-stranded ends and shadows
+    unsigned long anchor_;
+    unsigned long mateAnchor_;
+    // FragmentIndexMate::Info::value_, carries the mate orientation and storage bin
+    unsigned mateInfo_;
+    // barcode or sample index depending on whether samples are single-library
+    unsigned library_;
+    // offset of the pair end index record the signature was made for
+    unsigned index_;
+    // scratch space for the duplicate filter
+    unsigned group_;
+
+    bool sameKey(const DuplicateSignature &that) const
+    {
+        return anchor_ == that.anchor_ && mateAnchor_ == that.mateAnchor_ &&
+            mateInfo_ == that.mateInfo_ && library_ == that.library_;
+    }
+
+    unsigned long hash() const
+    {
+        static const unsigned long MULTIPLIER = 0x9E3779B97F4A7C15UL;
+        unsigned long ret = anchor_ * MULTIPLIER;
+        ret = (ret ^ (ret >> 32) ^ mateAnchor_) * MULTIPLIER;
+        ret = (ret ^ (ret >> 32) ^ ((static_cast<unsigned long>(mateInfo_) << 32) | library_)) * MULTIPLIER;
+        return ret ^ (ret >> 32);
+    }
+};
+BOOST_STATIC_ASSERT(32 == sizeof(DuplicateSignature));
+
+inline DuplicateSignature getDuplicateSignature(
+    const FStrandFragmentIndex &idx, const unsigned library, const unsigned index)
+{
+    return DuplicateSignature(idx.fStrandPos_.getValue(), idx.mate_.anchor_.value_, idx.mate_.info_.value_, library, index);
+}
+
+inline DuplicateSignature getDuplicateSignature(
+    const RStrandOrShadowFragmentIndex &idx, const unsigned library, const unsigned index)
+{
+    return DuplicateSignature(idx.anchor_.value_, idx.mate_.anchor_.value_, idx.mate_.info_.value_, library, index);
+}
+
+inline std::ostream &operator <<(std::ostream& os, const DuplicateSignature& signature)
+{
+    return os << "DuplicateSignature(" <<
+        signature.anchor_ << ", " <<
+        signature.mateAnchor_ << ", " <<
+        signature.mateInfo_ << "mi, " <<
+        signature.library_ << "l, " <<
+        signature.index_ << "i" <<
+        ")";
+}
+
 
 } // namespace build
 } // namespace isaac
@@ -0,0 +1,75 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file Numa.hh
+ **
+ ** \brief Memory and thread placement on numa machines. Everything here is a no-op when the
+ **        binary is compiled without numa support or the machine has a single node.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_NUMA_HH
+#define iSAAC_COMMON_NUMA_HH
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace isaac
+{
+namespace common
+{
+
+/// \return number of numa nodes or 0 if numa is not available
+unsigned getNumaNodeCount();
+
+/**
+ * \brief Pins the calling thread to the node threadNumber % getNumaNodeCount() and makes it allocate
+ *        from that node.
+ *
+ * \param strict if set, the allocations will fail rather than come from another node
+ */
+void bindToNumaNode(const unsigned threadNumber, const bool strict);
+
+/**
+ * \brief While in scope, memory first touched by the calling thread is spread across all nodes.
+ *        Intended for the large read-only data that is accessed by the threads of every node.
+ */
+class ScopedNumaInterleave : boost::noncopyable
+{
+    int savedMode_;
+    unsigned long savedNodemask_;
+public:
+    ScopedNumaInterleave();
+    ~ScopedNumaInterleave();
+};
+
+/**
+ * \brief Accumulates the number of pages each node holds for the memory given to count.
+ *        Only every few pages are checked so that this is cheap enough for gigabytes of data.
+ */
+class NumaPlacement
+{
+    std::vector<unsigned long> nodePages_;
+public:
+    NumaPlacement() : nodePages_(getNumaNodeCount(), 0) {}
+    void count(const void *begin, const std::size_t bytes);
+    friend std::ostream &operator <<(std::ostream &os, const NumaPlacement &placement);
+};
+
+} // namespace common
+} // namespace isaac
+
+#endif // #ifndef iSAAC_COMMON_NUMA_HH
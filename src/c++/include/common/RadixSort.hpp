@@ -0,0 +1,322 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file RadixSort.hpp
+ **
+ ** Parallel radix sort for fixed-width keys with bounded extra memory.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_RADIX_SORT_HPP
+#define iSAAC_COMMON_RADIX_SORT_HPP
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include <boost/array.hpp>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
+
+#include "common/Debug.hh"
+#include "common/Threads.hpp"
+#include "common/WorkStealingScheduler.hpp"
+
+namespace isaac
+{
+namespace common
+{
+
+/**
+ * \brief Sorts by 8-bit digits. DigitsT must provide:
+ *          static const unsigned DIGITS - number of digits in the key
+ *          unsigned char operator()(const value_type &value, unsigned digit) const - digit 0 is the least significant
+ *          bool operator()(const value_type &left, const value_type &right) const - the order the digits produce,
+ *              used for the short ranges
+ *
+ *        The range is split in place (American flag partitioning) on the most significant digit that differs, the
+ *        resulting buckets are distributed across the threads. A bucket that fits into the thread scratch buffer is
+ *        finished with LSD passes, larger ones are split in place on the next digit. With zero scratch the sort
+ *        is entirely in place.
+ */
+template <typename IteratorT, typename DigitsT>
+class RadixSorter : boost::noncopyable
+{
+public:
+    typedef typename std::iterator_traits<IteratorT>::value_type ValueType;
+    static const unsigned RADIX = 256;
+    /// ranges of this size and below are passed to std::sort
+    static const std::size_t SHORT_RANGE_MAX = 64;
+
+    /**
+     * \param scratchMax total number of elements of extra memory the threads are allowed to use
+     */
+    RadixSorter(
+        ThreadVector &threads,
+        const unsigned threadsMax,
+        const std::size_t scratchMax,
+        const DigitsT &digits = DigitsT()) :
+            threads_(threads),
+            threadsMax_(threadsMax),
+            threadScratchMax_(scratchMax / threadsMax),
+            digits_(digits),
+            threadHistograms_(threadsMax),
+            scratch_(threadsMax)
+    {
+        ISAAC_ASSERT_MSG(threadsMax && threads_.size() >= threadsMax, "Incorrect number of threads requested: " << threadsMax);
+    }
+
+    void sort(const IteratorT begin, const IteratorT end)
+    {
+        const std::size_t size = std::distance(begin, end);
+        if (SHORT_RANGE_MAX * threadsMax_ >= size)
+        {
+            std::sort(begin, end, digits_);
+            return;
+        }
+
+        // find the most significant digit that splits the range
+        Histogram histogram;
+        unsigned digit = DigitsT::DIGITS;
+        do
+        {
+            --digit;
+            countParallel(begin, size, digit, histogram);
+        }
+        while (digit && size == *std::max_element(histogram.begin(), histogram.end()));
+
+        partition(begin, digit, histogram);
+        if (!digit)
+        {
+            return;
+        }
+
+        std::vector<std::pair<IteratorT, IteratorT> > buckets;
+        std::vector<unsigned long> bucketCosts;
+        std::size_t bucketMax = 0;
+        IteratorT bucketBegin = begin;
+        BOOST_FOREACH(const std::size_t bucketSize, histogram)
+        {
+            if (bucketSize)
+            {
+                buckets.push_back(std::make_pair(bucketBegin, bucketBegin + bucketSize));
+                bucketCosts.push_back(bucketSize);
+                bucketMax = std::max(bucketMax, bucketSize);
+            }
+            bucketBegin += bucketSize;
+        }
+
+        BOOST_FOREACH(std::vector<ValueType> &scratch, scratch_)
+        {
+            scratch.resize(std::min(bucketMax, threadScratchMax_));
+        }
+
+        WorkStealingScheduler scheduler(threads_, threadsMax_, buckets.size());
+        scheduler.execute(boost::bind(&RadixSorter::sortBucket, this, boost::cref(buckets), digit, _1, _2), bucketCosts);
+
+        BOOST_FOREACH(std::vector<ValueType> &scratch, scratch_)
+        {
+            std::vector<ValueType>().swap(scratch);
+        }
+    }
+
+private:
+    typedef boost::array<std::size_t, RADIX> Histogram;
+    typedef typename std::vector<ValueType>::iterator ScratchIterator;
+
+    ThreadVector &threads_;
+    const unsigned threadsMax_;
+    const std::size_t threadScratchMax_;
+    const DigitsT digits_;
+    std::vector<Histogram> threadHistograms_;
+    std::vector<std::vector<ValueType> > scratch_;
+
+    void sortBucket(
+        const std::vector<std::pair<IteratorT, IteratorT> > &buckets,
+        const unsigned digits,
+        const unsigned bucket,
+        const unsigned threadNumber)
+    {
+        sortRange(buckets[bucket].first, buckets[bucket].second, digits, scratch_[threadNumber]);
+    }
+
+    /**
+     * \brief sorts the range on the digits [0, digits)
+     */
+    void sortRange(const IteratorT begin, const IteratorT end, const unsigned digits, std::vector<ValueType> &scratch)
+    {
+        const std::size_t size = std::distance(begin, end);
+        if (SHORT_RANGE_MAX >= size)
+        {
+            std::sort(begin, end, digits_);
+        }
+        else if (scratch.size() >= size)
+        {
+            sortLsd(begin, end, digits, scratch.begin());
+        }
+        else
+        {
+            Histogram histogram;
+            count(begin, end, digits - 1, histogram);
+            if (size != *std::max_element(histogram.begin(), histogram.end()))
+            {
+                partition(begin, digits - 1, histogram);
+            }
+            if (1 < digits)
+            {
+                IteratorT bucketBegin = begin;
+                BOOST_FOREACH(const std::size_t bucketSize, histogram)
+                {
+                    if (bucketSize)
+                    {
+                        sortRange(bucketBegin, bucketBegin + bucketSize, digits - 1, scratch);
+                        bucketBegin += bucketSize;
+                    }
+                }
+            }
+        }
+    }
+
+    void sortLsd(const IteratorT begin, const IteratorT end, const unsigned digits, const ScratchIterator scratchBegin)
+    {
+        const std::size_t size = std::distance(begin, end);
+        // all histograms in one pass over the data
+        boost::array<Histogram, DigitsT::DIGITS> histograms;
+        for (unsigned digit = 0; digits > digit; ++digit)
+        {
+            std::fill(histograms[digit].begin(), histograms[digit].end(), 0);
+        }
+        for (IteratorT it = begin; end != it; ++it)
+        {
+            for (unsigned digit = 0; digits > digit; ++digit)
+            {
+                ++histograms[digit][digits_(*it, digit)];
+            }
+        }
+
+        bool inScratch = false;
+        for (unsigned digit = 0; digits > digit; ++digit)
+        {
+            const Histogram &histogram = histograms[digit];
+            if (size == *std::max_element(histogram.begin(), histogram.end()))
+            {
+                // all values have the same digit, the pass would not change the order
+                continue;
+            }
+            if (inScratch)
+            {
+                scatter(scratchBegin, scratchBegin + size, begin, digit, histogram);
+            }
+            else
+            {
+                scatter(begin, end, scratchBegin, digit, histogram);
+            }
+            inScratch = !inScratch;
+        }
+        if (inScratch)
+        {
+            std::copy(scratchBegin, scratchBegin + size, begin);
+        }
+    }
+
+    template <typename FromT, typename ToT>
+    void scatter(const FromT begin, const FromT end, const ToT to, const unsigned digit, const Histogram &histogram) const
+    {
+        boost::array<ToT, RADIX> heads;
+        ToT head = to;
+        for (unsigned bucket = 0; RADIX > bucket; ++bucket)
+        {
+            heads[bucket] = head;
+            head += histogram[bucket];
+        }
+        for (FromT it = begin; end != it; ++it)
+        {
+            *heads[digits_(*it, digit)]++ = *it;
+        }
+    }
+
+    void count(const IteratorT begin, const IteratorT end, const unsigned digit, Histogram &histogram) const
+    {
+        std::fill(histogram.begin(), histogram.end(), 0);
+        for (IteratorT it = begin; end != it; ++it)
+        {
+            ++histogram[digits_(*it, digit)];
+        }
+    }
+
+    void countSlice(const IteratorT begin, const std::size_t size, const unsigned digit, const unsigned threadNumber)
+    {
+        count(begin + size * threadNumber / threadsMax_, begin + size * (threadNumber + 1) / threadsMax_,
+              digit, threadHistograms_[threadNumber]);
+    }
+
+    void countParallel(const IteratorT begin, const std::size_t size, const unsigned digit, Histogram &histogram)
+    {
+        threads_.execute(boost::bind(&RadixSorter::countSlice, this, begin, size, digit, _1), threadsMax_);
+        std::fill(histogram.begin(), histogram.end(), 0);
+        BOOST_FOREACH(const Histogram &threadHistogram, threadHistograms_)
+        {
+            std::transform(histogram.begin(), histogram.end(), threadHistogram.begin(), histogram.begin(), std::plus<std::size_t>());
+        }
+    }
+
+    /**
+     * \brief In-place permutation of the range into the buckets described by histogram
+     */
+    void partition(const IteratorT begin, const unsigned digit, const Histogram &histogram) const
+    {
+        boost::array<IteratorT, RADIX> heads;
+        boost::array<IteratorT, RADIX> tails;
+        IteratorT head = begin;
+        for (unsigned bucket = 0; RADIX > bucket; ++bucket)
+        {
+            heads[bucket] = head;
+            head += histogram[bucket];
+            tails[bucket] = head;
+        }
+
+        using std::swap;
+        for (unsigned bucket = 0; RADIX > bucket; ++bucket)
+        {
+            while (heads[bucket] != tails[bucket])
+            {
+                ValueType value = *heads[bucket];
+                unsigned valueBucket = digits_(value, digit);
+                while (bucket != valueBucket)
+                {
+                    swap(value, *heads[valueBucket]++);
+                    valueBucket = digits_(value, digit);
+                }
+                *heads[bucket]++ = value;
+            }
+        }
+    }
+};
+
+/**
+ * \brief Sorts [begin, end) using at most scratchMax elements of extra memory. See RadixSorter.
+ */
+template <typename IteratorT, typename DigitsT>
+void radixSort(
+    const IteratorT begin, const IteratorT end, const DigitsT &digits,
+    ThreadVector &threads, const unsigned threadsMax, const std::size_t scratchMax)
+{
+    RadixSorter<IteratorT, DigitsT> sorter(threads, threadsMax, scratchMax, digits);
+    sorter.sort(begin, end);
+}
+
+} // namespace common
+} // namespace isaac
+
+#endif // #ifndef iSAAC_COMMON_RADIX_SORT_HPP
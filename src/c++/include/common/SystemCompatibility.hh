@@ -30,6 +30,9 @@ namespace common
 /// Maximum number of files that a process can have opened at the same time
 unsigned int getMaxOpenFiles();
 
+/// Bytes of RAM installed
+unsigned long getPhysicalMemory();
+
 /// File size in bytes as returned by stat
 unsigned long getFileSize(const char *filePath);
 
@@ -0,0 +1,165 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file WorkStealingScheduler.hpp
+ **
+ ** Distributes a batch of independent tasks of uneven size across the ThreadVector threads.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_WORK_STEALING_SCHEDULER_HPP
+#define iSAAC_COMMON_WORK_STEALING_SCHEDULER_HPP
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread.hpp>
+
+#include "common/Debug.hh"
+#include "common/Threads.hpp"
+
+namespace isaac
+{
+namespace common
+{
+
+/**
+ * \brief Each thread gets its own queue of tasks. The tasks are dealt to the queues largest first so
+ *        that the estimated costs of the queues are even. A thread takes the tasks from the front of its
+ *        own queue and, once it is empty, steals from the back of the others. This way the tail of the
+ *        batch is made of the smallest tasks and no thread sits idle while another one has work queued.
+ *
+ *        All memory is reserved in the constructor, execute does not allocate.
+ */
+class WorkStealingScheduler : boost::noncopyable
+{
+    struct TaskQueue
+    {
+        TaskQueue(const std::size_t maxTasks) : front_(0), cost_(0) {tasks_.reserve(maxTasks);}
+        boost::mutex mutex_;
+        std::vector<unsigned> tasks_;
+        std::size_t front_;
+        unsigned long cost_;
+    };
+
+    struct OrderByCostDesc
+    {
+        const std::vector<unsigned long> &costs_;
+        OrderByCostDesc(const std::vector<unsigned long> &costs) : costs_(costs){}
+        bool operator()(const unsigned left, const unsigned right) const
+        {
+            return costs_[left] > costs_[right] || (costs_[left] == costs_[right] && left < right);
+        }
+    };
+
+    ThreadVector &threads_;
+    const std::size_t maxTasks_;
+    boost::ptr_vector<TaskQueue> queues_;
+    std::vector<unsigned> order_;
+
+public:
+    /**
+     * \param threadsMax number of threads to use. Must not exceed threads.size()
+     * \param maxTasks   maximum number of tasks execute will be given
+     */
+    WorkStealingScheduler(ThreadVector &threads, const unsigned threadsMax, const std::size_t maxTasks) :
+        threads_(threads), maxTasks_(maxTasks)
+    {
+        ISAAC_ASSERT_MSG(threadsMax && threads_.size() >= threadsMax, "Incorrect number of threads requested: " << threadsMax);
+        while (queues_.size() != threadsMax)
+        {
+            queues_.push_back(new TaskQueue(maxTasks_));
+        }
+        order_.reserve(maxTasks_);
+    }
+
+    /**
+     * \brief Executes func(taskIndex, threadNumber) once for each task in [0, costs.size()). Returns when
+     *        all the tasks are done.
+     *
+     * \param costs estimated relative cost of each task. Only used to order and distribute the tasks.
+     */
+    template <typename F> void execute(F func, const std::vector<unsigned long> &costs)
+    {
+        ISAAC_ASSERT_MSG(maxTasks_ >= costs.size(), "Too many tasks: " << costs.size() << " expected at most " << maxTasks_);
+        order_.clear();
+        for (unsigned task = 0; costs.size() > task; ++task)
+        {
+            order_.push_back(task);
+        }
+        std::sort(order_.begin(), order_.end(), OrderByCostDesc(costs));
+
+        BOOST_FOREACH(TaskQueue &queue, queues_)
+        {
+            queue.tasks_.clear();
+            queue.front_ = 0;
+            queue.cost_ = 0;
+        }
+        BOOST_FOREACH(const unsigned task, order_)
+        {
+            TaskQueue &cheapest = *std::min_element(queues_.begin(), queues_.end(),
+                                                    boost::bind(&TaskQueue::cost_, _1) < boost::bind(&TaskQueue::cost_, _2));
+            cheapest.tasks_.push_back(task);
+            cheapest.cost_ += costs[task];
+        }
+
+        threads_.execute(boost::bind(&WorkStealingScheduler::threadFunc<F>, this, boost::ref(func), _1), queues_.size());
+    }
+
+private:
+    template <typename F> void threadFunc(F &func, const unsigned threadNumber)
+    {
+        unsigned task = 0;
+        while (popOwn(threadNumber, task) || steal(threadNumber, task))
+        {
+            func(task, threadNumber);
+        }
+    }
+
+    bool popOwn(const unsigned threadNumber, unsigned &task)
+    {
+        TaskQueue &queue = queues_[threadNumber];
+        boost::lock_guard<boost::mutex> lock(queue.mutex_);
+        if (queue.tasks_.size() == queue.front_)
+        {
+            return false;
+        }
+        task = queue.tasks_[queue.front_++];
+        return true;
+    }
+
+    bool steal(const unsigned threadNumber, unsigned &task)
+    {
+        for (unsigned victim = (threadNumber + 1) % queues_.size(); threadNumber != victim; victim = (victim + 1) % queues_.size())
+        {
+            TaskQueue &queue = queues_[victim];
+            boost::lock_guard<boost::mutex> lock(queue.mutex_);
+            if (queue.tasks_.size() != queue.front_)
+            {
+                task = queue.tasks_.back();
+                queue.tasks_.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace common
+} // namespace isaac
+
+#endif // #ifndef iSAAC_COMMON_WORK_STEALING_SCHEDULER_HPP
@@ -31,6 +31,11 @@ namespace io
 //#pragma GCC push_options
 //#pragma GCC optimize ("0")
 
+/**
+ * \brief Loads single or paired fastq. When enough threads are given, each read file is parsed on its own
+ *        thread while another thread inflates its next chunk. The threads left over are used to
+ *        inflate the BGZF blocks in parallel.
+ */
 class FastqLoader
 {
     FastqReader read1Reader_;
@@ -45,14 +50,17 @@ public:
      */
     /**
      * \brief Creates uninitialized fastq loader
+     *
+     * \param bgzfInput when false, no threads are set aside for the BGZF block inflation
      */
     FastqLoader(
         const bool allowVariableLength,
         std::size_t maxPathLength,
         common::ThreadVector &threads,
-        const unsigned inputLoadersMax) :
-        read1Reader_(allowVariableLength),
-        read2Reader_(allowVariableLength),
+        const unsigned inputLoadersMax,
+        const bool bgzfInput) :
+        read1Reader_(allowVariableLength, bgzfInput ? getBgzfThreads(inputLoadersMax) : 0),
+        read2Reader_(allowVariableLength, bgzfInput ? getBgzfThreads(inputLoadersMax) : 0),
         paired_(false),
         threads_(threads),
         inputLoadersMax_(inputLoadersMax)
@@ -90,6 +98,18 @@ public:
     {
         if (1 == readMetadataList.size())
         {
+            if (2 <= inputLoadersMax_)
+            {
+                unsigned readClusters[1] = {0};
+                boost::reference_wrapper<InsertIt> insertIterators[] = {boost::ref(it)};
+                FastqReader *readers[] = {&read1Reader_};
+                read1Reader_.startProducing();
+                threads_.execute(boost::bind(&FastqLoader::threadLoadPipelined<InsertIt>, this,
+                                             1, readers, clusterCount, boost::ref(readMetadataList),
+                                             readClusters, insertIterators, _1),
+                                 2);
+                return readClusters[0];
+            }
             return loadSingleRead(read1Reader_, clusterCount, readMetadataList.at(0), 0, it);
         }
         else
@@ -97,7 +117,19 @@ public:
             ISAAC_ASSERT_MSG(2 == readMetadataList.size(), "Only paired and single-ended data is supported");
             unsigned readClusters[2] = {0,0};
             InsertIt it1 = it;
-            if (2 <= inputLoadersMax_)
+            if (4 <= inputLoadersMax_)
+            {
+                it += readMetadataList.at(0).getLength();
+                boost::reference_wrapper<InsertIt> insertIterators[] = {boost::ref(it1), boost::ref(it)};
+                FastqReader *readers[] = {&read1Reader_, &read2Reader_};
+                read1Reader_.startProducing();
+                read2Reader_.startProducing();
+                threads_.execute(boost::bind(&FastqLoader::threadLoadPipelined<InsertIt>, this,
+                                             2, readers, clusterCount, boost::ref(readMetadataList),
+                                             readClusters, insertIterators, _1),
+                                 4);
+            }
+            else if (2 <= inputLoadersMax_)
             {
                 it += readMetadataList.at(0).getLength();
                 boost::reference_wrapper<InsertIt> insertIterators[] = {boost::ref(it1), boost::ref(it)};
@@ -125,6 +157,44 @@ public:
 
     }
 private:
+    /**
+     * \brief Each of the two readers gets half of the input loaders to inflate the BGZF blocks with
+     */
+    static unsigned getBgzfThreads(const unsigned inputLoadersMax)
+    {
+        return std::max(1U, inputLoadersMax / 2);
+    }
+
+    /**
+     * \brief threads [0, readersCount) parse, threads [readersCount, readersCount * 2) produce the chunks for
+     *        the corresponding readers.
+     */
+    template <typename InsertIt>
+    void threadLoadPipelined(
+        const unsigned readersCount,
+        FastqReader *readers[],
+        const unsigned clusterCount,
+        const flowcell::ReadMetadataList &readMetadataList,
+        unsigned readClusters[],
+        boost::reference_wrapper<InsertIt> insertIterators[],
+        const unsigned threadNumber)
+    {
+        if (readersCount <= threadNumber)
+        {
+            readers[threadNumber - readersCount]->produceChunks();
+            return;
+        }
+
+        FastqReader &reader = *readers[threadNumber];
+        ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&FastqReader::stopProducing, &reader))
+        {
+            readClusters[threadNumber] = loadSingleRead(
+                reader, clusterCount, readMetadataList.at(threadNumber),
+                1 == readersCount ? 0 : readMetadataList.at((threadNumber + 1) % readersCount).getLength(),
+                insertIterators[threadNumber].get());
+        }
+    }
+
     template <typename InsertIt>
     static unsigned loadSingleRead(FastqReader &reader, unsigned clusterCount,
                             const flowcell::ReadMetadata &readMetadata,
@@ -27,10 +27,12 @@
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include "common/Debug.hh"
 #include "common/Exceptions.hh"
-#include "common/FiniteCapacityVector.hh"
+#include "bgzf/BgzfReader.hh"
+#include "common/Threads.hpp"
 #include "flowcell/ReadMetadata.hh"
 #include "io/InflateGzipDecompressor.hh"
 #include "io/FileBufCache.hh"
@@ -52,22 +54,39 @@ public:
         common::IsaacException(EINVAL, message){}
 };
 
+/**
+ ** \brief Parses fastq records out of large chunks of uncompressed data.
+ **
+ ** The chunks are produced either on demand by the parsing thread or, when the owner runs produceChunks on
+ ** another thread, ahead of the parser. This way the gzip inflation is pipelined with parsing. BGZF inputs
+ ** are inflated block-parallel on the decompression threads.
+ **/
 class FastqReader: boost::noncopyable
 {
-    static const std::size_t UNCOMPRESSED_BUFFER_SIZE = 4096;
-    // Since we're inflating, it is important that the uncompressed buffer does not
-    // run out of space for each individual chunk of compressed bytes pushed into decompressor.
-    static const std::size_t DECOMPRESSOR_BUFFER_SIZE = UNCOMPRESSED_BUFFER_SIZE;
+    static const std::size_t UNCOMPRESSED_BUFFER_SIZE = 1024 * 1024;
+    // size of the reads from the compressed file
+    static const std::size_t DECOMPRESSOR_BUFFER_SIZE = 64 * 1024;
+    // must fit at least one BGZF block
+    static const std::size_t CHUNK_SIZE = 4 * 1024 * 1024;
     static const unsigned FASTQ_QSCORE_OFFSET = 33;
     const bool allowVariableLength_;
 
+    typedef std::vector<char> BufferType;
+
     FileBufWithReopen fileBuffer_;
-    typedef common::FiniteCapacityVector<char, UNCOMPRESSED_BUFFER_SIZE> BufferType;
     io::InflateGzipDecompressor<BufferType> decompressor_;
+    // only created when the owner expects BGZF inputs
+    boost::scoped_ptr<common::ThreadVector> bgzfThreads_;
+    boost::scoped_ptr<bgzf::ParallelBgzfReader> bgzfReader_;
 
     //boost::filesystem::path forces intermediate string construction during reassignment...
     std::string fastqPath_;
-    bool compressed_;
+    enum
+    {
+        Flat,
+        Gzip,
+        Bgzf
+    } format_;
     bool reachedEof_;
     std::size_t filePos_;
 
@@ -80,12 +99,37 @@ class FastqReader: boost::noncopyable
     BufferType::const_iterator endIt_;
     bool zeroLengthRead_;
 
+    /**
+     * \brief Double-buffered uncompressed data. The producer fills the chunks in turn, the parser drains them
+     *        in the same order.
+     */
+    struct Chunk
+    {
+        BufferType data_;
+        std::size_t consumed_;
+        bool ready_;
+    };
+    Chunk chunks_[2];
+    unsigned produceChunk_;
+    unsigned consumeChunk_;
+    // true when the compressed input is exhausted
+    bool inputEof_;
+    // true while produceChunks is running or about to be run on a separate thread
+    bool producing_;
+    bool producerFailed_;
+    boost::mutex chunkMutex_;
+    boost::condition_variable chunkCondition_;
+
     static const oligo::Translator translator_;
 
 public:
     static const unsigned INCORRECT_FASTQ_BASE = 5;
 
-    FastqReader(const bool allowVariableLength);
+    /**
+     * \param bgzfThreads number of threads to inflate the BGZF-compressed inputs with. When 0, BGZF inputs are
+     *                    inflated sequentially as any other gzip.
+     */
+    FastqReader(const bool allowVariableLength, const unsigned bgzfThreads = 0);
     FastqReader(const bool allowVariableLength, const boost::filesystem::path &fastqPath);
 
     void reservePathBuffers(std::size_t maxPathLength)
@@ -95,6 +139,11 @@ public:
 
     void open(const boost::filesystem::path &fastqPath);
 
+    /**
+     * \return true for .gz files with BGZF block headers
+     */
+    static bool isBgzf(const std::string &path);
+
     void next();
 
     template <typename InsertIt>
@@ -126,9 +175,27 @@ public:
         return std::distance(baseCallsBegin_, baseCallsEnd_);
     }
 
+    /**
+     * \brief Must be called before produceChunks is started on a separate thread.
+     */
+    void startProducing();
+
+    /**
+     * \brief Fills the chunks ahead of the parser until stopProducing is called or the input ends.
+     *        To be run on a thread other than the one calling next.
+     */
+    void produceChunks();
+
+    /**
+     * \brief Makes produceChunks return once the chunk it is filling is complete. Once the producer is stopped
+     *        the parser fills the chunks itself.
+     */
+    void stopProducing();
+
 private:
     typedef boost::error_info<struct tag_errmsg, std::string> errmsg_info;
 
+    void reserveBuffers();
     void resetBuffer();
     std::size_t getOffset(BufferType::const_iterator it) const;
     void findHeader();
@@ -136,9 +203,12 @@ private:
     void findQScores();
     void findQScoresEnd();
     bool fetchMore();
+    std::size_t readChunks(char *buffer, std::size_t amount);
+    /// \return true if the input has ended
+    bool fillChunk(Chunk &chunk);
 
-    std::size_t readCompressedFastq(std::istream &is, char *buffer, std::size_t amount);
-    std::size_t readFlatFastq(std::istream &is, char *buffer, std::size_t amount);
+    std::size_t readCompressedFastq(std::istream &is, char *buffer, std::size_t amount, bool &eof);
+    std::size_t readFlatFastq(std::istream &is, char *buffer, std::size_t amount, bool &eof);
 };
 
 template <typename InsertIt>
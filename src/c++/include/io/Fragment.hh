@@ -30,6 +30,7 @@ namespace io
 {
 
 struct FragmentAccessor;
+struct FragmentIndexRecord;
 /**
  * \brief In terms of duplicate detection, anchor is same for duplicate candidates
  */
@@ -39,6 +40,7 @@ union FragmentIndexAnchor
     explicit FragmentIndexAnchor(unsigned long value) : value_(value){}
     FragmentIndexAnchor(const alignment::FragmentMetadata & fragment);
     FragmentIndexAnchor(const FragmentAccessor & fragment);
+    FragmentIndexAnchor(const FragmentIndexRecord & record);
 
     // Aligned reads are anchored to their lowest cycles. This means that f-stranded reads are
     // anchored to their f-strand position and r-stranded to their r-strand alignment position
@@ -505,6 +507,51 @@ inline FragmentIndexAnchor::FragmentIndexAnchor(const FragmentAccessor & fragmen
     }
 }
 
+/**
+ * \brief Summary of a fragment stored in the bin fragment index file next to the bin data. Contains everything
+ *        needed to index the fragment for duplicate detection and to place it in memory without reading the data.
+ *        Records follow in the order of fragments in the bin data file.
+ */
+struct FragmentIndexRecord
+{
+    FragmentIndexRecord() :
+        fStrandPosition_(), mateFStrandPosition_(), anchor_(), mateAnchor_(), duplicateClusterRank_(0),
+        totalLength_(0), mateStorageBin_(0), barcode_(0),
+        flags_(false, false, false, false, false, false, false, false, false)
+    {
+    }
+
+    explicit FragmentIndexRecord(const FragmentAccessor &fragment) :
+        fStrandPosition_(fragment.fStrandPosition_),
+        mateFStrandPosition_(fragment.mateFStrandPosition_),
+        anchor_(fragment),
+        mateAnchor_(fragment.mateAnchor_),
+        duplicateClusterRank_(fragment.duplicateClusterRank_),
+        totalLength_(fragment.getTotalLength()),
+        mateStorageBin_(fragment.mateStorageBin_),
+        barcode_(fragment.barcode_),
+        flags_(fragment.flags_)
+    {
+    }
+
+    reference::ReferencePosition fStrandPosition_;
+    reference::ReferencePosition mateFStrandPosition_;
+    FragmentIndexAnchor anchor_;
+    FragmentIndexAnchor mateAnchor_;
+    unsigned long duplicateClusterRank_;
+    unsigned totalLength_;
+    unsigned mateStorageBin_;
+    unsigned barcode_;
+    FragmentHeader::Flags flags_;
+
+    unsigned getTotalLength() const {return totalLength_;}
+};
+BOOST_STATIC_ASSERT(56 == sizeof(FragmentIndexRecord));
+
+inline FragmentIndexAnchor::FragmentIndexAnchor(const FragmentIndexRecord & record) : value_(record.anchor_.value_)
+{
+}
+
 } // namespace io
 } // namespace isaac
 
@@ -27,6 +27,8 @@
 #include <boost/filesystem.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 
+#include "alignment/Match.hh"
+#include "alignment/MatchArena.hh"
 #include "alignment/SeedId.hh"
 #include "alignment/MatchTally.hh"
 #include "flowcell/TileMetadata.hh"
@@ -46,6 +48,8 @@ namespace io
  ** per mask and per iteration. This is an implicit coupling to the structure of the MatchFinder
  ** workflow. MatchWriter holds a separate stream for each tile. On each write the referenced
  ** matchTally is updated.
+ **
+ ** If matchArena is supplied, the matches are appended to it instead of the tile files.
  **/
 class TileMatchWriter: boost::noncopyable, boost::ptr_vector<io::FileBufWithReopen>
 {
@@ -57,7 +61,8 @@ public:
     TileMatchWriter(
         alignment::MatchTally &matchTally,
         const unsigned maxTiles,
-        const unsigned maxTileIndex);
+        const unsigned maxTileIndex,
+        alignment::MatchArena *matchArena = 0);
 
     /**
      * \brief Switches to a new set of tile files based on the iteration supplied
@@ -71,12 +76,62 @@ public:
      */
     void write(const SeedId &seedId, const ReferencePosition &referencePosition);
 
+    /**
+     * \brief Writes a block of matches that all belong to the same tile under a single lock
+     *        and updates the match tally once per run of matches with the same barcode
+     */
+    void write(const unsigned tileIndex,
+               const std::vector<alignment::Match>::const_iterator matchesBegin,
+               const std::vector<alignment::Match>::const_iterator matchesEnd);
+
+    unsigned getMaxTileIndex() const {return tileStreams_.size() - 1;}
+
 private:
     alignment::MatchTally &matchTally_;
     io::FileBufCache<io::FileBufWithReopen> tileFileBuffers_;
     std::vector<boost::shared_ptr<std::ostream> > tileStreams_;
     unsigned currentIteration_;
     boost::ptr_vector<boost::mutex> tileMutexes_;
+    alignment::MatchArena *matchArena_;
+
+    void store(const unsigned tileIndex, const alignment::Match *matchesBegin, const alignment::Match *matchesEnd);
+};
+
+/**
+ ** \brief Per-thread front end of TileMatchWriter.
+ **
+ ** Accumulates the matches produced by one thread. When the buffer is full, the matches are
+ ** partitioned by tile with a single counting sort pass and each tile gets written in one
+ ** piece. This way the tile mutexes are taken once per tile per flush instead of once per match.
+ ** The order of matches within a tile is preserved.
+ **/
+class ThreadMatchWriter: boost::noncopyable
+{
+    typedef alignment::SeedId SeedId;
+    typedef isaac::reference::ReferencePosition ReferencePosition;
+public:
+    static const unsigned MAX_BUFFERED_MATCHES = 64 * 1024;
+
+    explicit ThreadMatchWriter(TileMatchWriter &tileMatchWriter);
+
+    void write(const SeedId &seedId, const ReferencePosition &referencePosition)
+    {
+        buffer_.push_back(alignment::Match(seedId, referencePosition));
+        if (MAX_BUFFERED_MATCHES == buffer_.size())
+        {
+            flush();
+        }
+    }
+
+    /// Passes all buffered matches to the TileMatchWriter
+    void flush();
+
+private:
+    TileMatchWriter *tileMatchWriter_;
+    std::vector<alignment::Match> buffer_;
+    std::vector<alignment::Match> partitioned_;
+    // tileOffsets_[tileIndex] is the first position of tile matches in partitioned_
+    std::vector<unsigned> tileOffsets_;
 };
 } //namespace io
 } //namespace isaac
@@ -55,6 +55,20 @@ std::string bases(KmerT kmer)
     return bases<BITS_PER_BASE>(kmer, KmerTraits<KmerT>::KMER_BASES);
 }
 
+template <typename KmerT>
+KmerT reverseComplement(KmerT kmer)
+{
+    KmerT reversed = 0;
+    kmer = ~kmer; // complement all the bases
+    for (unsigned i = 0; KmerTraits<KmerT>::KMER_BASES > i; ++i)
+    {
+        reversed <<= BITS_PER_BASE;
+        reversed |= (kmer & BITS_PER_BASE_MASK);
+        kmer >>= BITS_PER_BASE;
+    }
+    return reversed;
+}
+
 template <typename KmerT>
 inline std::string reverseBases(KmerT kmer)
 {
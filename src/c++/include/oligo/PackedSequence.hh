@@ -0,0 +1,295 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file PackedSequence.hh
+ **
+ ** \brief 2 bits per base sequence storage for word-at-a-time base comparison.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_OLIGO_PACKED_SEQUENCE_HH
+#define iSAAC_OLIGO_PACKED_SEQUENCE_HH
+
+#include <algorithm>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "common/Debug.hh"
+#include "oligo/Nucleotides.hh"
+
+namespace isaac
+{
+namespace oligo
+{
+
+/**
+ ** \brief Bases packed 32 per word, the first base in the least significant bits. Anything that is not
+ **        ACGT is stored as A and flagged in a separate one-bit-per-base mask.
+ **
+ ** Words extracted at any base position line up for xor comparison with words extracted from another
+ ** sequence, which compares 32 bases per instruction.
+ **
+ ** The words are either owned by the sequence or, after wrap(), borrowed from storage such as a mapped
+ ** genome image. Borrowed sequences are read-only.
+ **/
+class PackedSequence
+{
+public:
+    static const unsigned BASES_PER_WORD = 32;
+    // the low bit of every 2-bit lane
+    static const unsigned long LANE_LOW_BITS = 0x5555555555555555UL;
+
+    PackedSequence() : size_(0), externalBases_(0), externalNMask_(0) {}
+
+    /// Copy constructor to preserve the reserved capacity during container push_back
+    PackedSequence(const PackedSequence &that) : bases_(that.bases_), nMask_(that.nMask_), size_(that.size_),
+        externalBases_(that.externalBases_), externalNMask_(that.externalNMask_), externalOwner_(that.externalOwner_)
+    {
+        bases_.reserve(that.bases_.capacity());
+        nMask_.reserve(that.nMask_.capacity());
+    }
+
+    PackedSequence &operator =(const PackedSequence &that)
+    {
+        bases_ = that.bases_;
+        nMask_ = that.nMask_;
+        size_ = that.size_;
+        externalBases_ = that.externalBases_;
+        externalNMask_ = that.externalNMask_;
+        externalOwner_ = that.externalOwner_;
+        return *this;
+    }
+
+    /**
+     * \brief Makes the sequence a view of size bases stored elsewhere in the same layout.
+     *
+     * \param bases   getBaseWords(size) words, the unused bits of the last one zeroed
+     * \param nMask   getMaskWords(size) words, the unused bits of the last one zeroed
+     * \param owner   keeps the storage alive for as long as the sequence or any of its copies exist
+     */
+    void wrap(
+        const unsigned long *bases,
+        const unsigned long *nMask,
+        const unsigned long size,
+        const boost::shared_ptr<const void> &owner)
+    {
+        std::vector<unsigned long>().swap(bases_);
+        std::vector<unsigned long>().swap(nMask_);
+        size_ = size;
+        externalBases_ = bases;
+        externalNMask_ = nMask;
+        externalOwner_ = owner;
+    }
+
+    /// \return true if the words are not owned by the sequence
+    bool isView() const {return externalBases_;}
+
+    void reserve(const unsigned long bases)
+    {
+        bases_.reserve(getBaseWords(bases));
+        nMask_.reserve(getMaskWords(bases));
+    }
+
+    /// number of bases that can be stored without reallocation
+    unsigned long capacity() const
+    {
+        if (isView())
+        {
+            return size_;
+        }
+        return std::min(bases_.capacity() * BASES_PER_WORD, nMask_.capacity() * BASES_PER_WORD * 2);
+    }
+
+    void clear()
+    {
+        bases_.clear();
+        nMask_.clear();
+        size_ = 0;
+        externalBases_ = 0;
+        externalNMask_ = 0;
+        externalOwner_.reset();
+    }
+
+    void swap(PackedSequence &that)
+    {
+        bases_.swap(that.bases_);
+        nMask_.swap(that.nMask_);
+        std::swap(size_, that.size_);
+        std::swap(externalBases_, that.externalBases_);
+        std::swap(externalNMask_, that.externalNMask_);
+        externalOwner_.swap(that.externalOwner_);
+    }
+
+    unsigned long size() const {return size_;}
+    bool empty() const {return !size_;}
+
+    /// \param value 0-3 for ACGT, anything else is treated as N
+    void push_back(const unsigned value)
+    {
+        ISAAC_ASSERT_MSG(!isView(), "Attempt to modify a read-only view");
+        const unsigned baseShift = (size_ % BASES_PER_WORD) * 2;
+        const unsigned maskShift = size_ % (BASES_PER_WORD * 2);
+        if (!baseShift)
+        {
+            bases_.push_back(0);
+        }
+        if (!maskShift)
+        {
+            nMask_.push_back(0);
+        }
+        if (3 < value)
+        {
+            nMask_.back() |= 1UL << maskShift;
+        }
+        else
+        {
+            bases_.back() |= static_cast<unsigned long>(value) << baseShift;
+        }
+        ++size_;
+    }
+
+    /// \brief replaces the contents with characters [begin, end). Non-ACGT characters are stored as N
+    template <typename IteratorT>
+    void assign(IteratorT begin, const IteratorT end)
+    {
+        clear();
+        static const Translator translator = getTranslator();
+        for (; end != begin; ++begin)
+        {
+            push_back(translator[static_cast<unsigned char>(*begin)]);
+        }
+    }
+
+    /**
+     * \return 32 bases starting at position. Bases past the end of the sequence are returned as A
+     */
+    unsigned long getBases(const unsigned long position) const
+    {
+        return getWord(baseWords(), getBaseWords(size_), position / BASES_PER_WORD, (position % BASES_PER_WORD) * 2);
+    }
+
+    /**
+     * \return N flags of 32 bases starting at position, one per 2-bit lane in the lane low bit
+     */
+    unsigned long getNLanes(const unsigned long position) const
+    {
+        return spreadToLanes(getWord(nMaskWords(), getMaskWords(size_), position / (BASES_PER_WORD * 2), position % (BASES_PER_WORD * 2)));
+    }
+
+    /**
+     * \return true if any of the bases [begin, end) is not ACGT
+     */
+    bool hasN(const unsigned long begin, const unsigned long end) const
+    {
+        for (unsigned long position = begin; end > position; position += BASES_PER_WORD * 2)
+        {
+            unsigned long mask = getWord(nMaskWords(), getMaskWords(size_), position / (BASES_PER_WORD * 2), position % (BASES_PER_WORD * 2));
+            if (end - position < BASES_PER_WORD * 2)
+            {
+                mask &= (1UL << (end - position)) - 1;
+            }
+            if (mask)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * \return the low bit of every 2-bit lane set for the bases that differ between the two words
+     */
+    static unsigned long getMismatchLanes(const unsigned long left, const unsigned long right)
+    {
+        const unsigned long diff = left ^ right;
+        return (diff | (diff >> 1)) & LANE_LOW_BITS;
+    }
+
+    /**
+     * \return lane low bits for the first bases of a word
+     */
+    static unsigned long getLanes(const unsigned bases)
+    {
+        return BASES_PER_WORD <= bases ? LANE_LOW_BITS : LANE_LOW_BITS & ((1UL << (bases * 2)) - 1);
+    }
+
+    /**
+     * \return the lane low bits moved into the lower 32 bits, one bit per base
+     */
+    static unsigned long gatherLanes(unsigned long lanes)
+    {
+        lanes &= LANE_LOW_BITS;
+        lanes = (lanes | (lanes >> 1)) & 0x3333333333333333UL;
+        lanes = (lanes | (lanes >> 2)) & 0x0F0F0F0F0F0F0F0FUL;
+        lanes = (lanes | (lanes >> 4)) & 0x00FF00FF00FF00FFUL;
+        lanes = (lanes | (lanes >> 8)) & 0x0000FFFF0000FFFFUL;
+        lanes = (lanes | (lanes >> 16)) & 0x00000000FFFFFFFFUL;
+        return lanes;
+    }
+
+    /**
+     * \return number of lanes set in the value produced by getMismatchLanes or getNLanes
+     */
+    static unsigned countLanes(const unsigned long lanes)
+    {
+        return __builtin_popcountl(lanes);
+    }
+
+    static unsigned long getBaseWords(const unsigned long bases) {return (bases + BASES_PER_WORD - 1) / BASES_PER_WORD;}
+    static unsigned long getMaskWords(const unsigned long bases) {return (bases + BASES_PER_WORD * 2 - 1) / (BASES_PER_WORD * 2);}
+
+private:
+    std::vector<unsigned long> bases_;
+    std::vector<unsigned long> nMask_;
+    unsigned long size_;
+    // not 0 for views
+    const unsigned long *externalBases_;
+    const unsigned long *externalNMask_;
+    boost::shared_ptr<const void> externalOwner_;
+
+    const unsigned long *baseWords() const {return externalBases_ ? externalBases_ : (bases_.empty() ? 0 : &bases_.front());}
+    const unsigned long *nMaskWords() const {return externalBases_ ? externalNMask_ : (nMask_.empty() ? 0 : &nMask_.front());}
+
+    /// 64 bits starting at bit shift of word, zero-filled past the end
+    static unsigned long getWord(const unsigned long *words, const unsigned long wordCount, const unsigned long word, const unsigned shift)
+    {
+        if (wordCount <= word)
+        {
+            return 0;
+        }
+        unsigned long ret = words[word] >> shift;
+        if (shift && wordCount > word + 1)
+        {
+            ret |= words[word + 1] << (64 - shift);
+        }
+        return ret;
+    }
+
+    /// moves bit i of the lower 32 bits to bit 2*i
+    static unsigned long spreadToLanes(unsigned long bits)
+    {
+        bits &= 0xFFFFFFFFUL;
+        bits = (bits | (bits << 16)) & 0x0000FFFF0000FFFFUL;
+        bits = (bits | (bits << 8)) & 0x00FF00FF00FF00FFUL;
+        bits = (bits | (bits << 4)) & 0x0F0F0F0F0F0F0F0FUL;
+        bits = (bits | (bits << 2)) & 0x3333333333333333UL;
+        bits = (bits | (bits << 1)) & LANE_LOW_BITS;
+        return bits;
+    }
+};
+
+} // namespace oligo
+} // namespace isaac
+
+#endif // #ifndef iSAAC_OLIGO_PACKED_SEQUENCE_HH
@@ -0,0 +1,52 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file AlignDaemonOptions.hh
+ **
+ ** \brief Command line options for isaac-align-daemon
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_OPTIONS_ALIGN_DAEMON_OPTIONS_HH
+#define iSAAC_OPTIONS_ALIGN_DAEMON_OPTIONS_HH
+
+#include <boost/filesystem.hpp>
+
+#include "common/Program.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+class AlignDaemonOptions : public common::Options
+{
+public:
+    boost::filesystem::path spoolDirectory_;
+    unsigned pollInterval_;
+    unsigned maxJobs_;
+
+public:
+    AlignDaemonOptions();
+
+    common::Options::Action parse(int argc, char *argv[]);
+
+private:
+    std::string usagePrefix() const {return "isaac-align-daemon";}
+    void postProcess(boost::program_options::variables_map &vm);
+};
+
+} // namespace options
+} // namespace isaac
+
+#endif // #ifndef iSAAC_OPTIONS_ALIGN_DAEMON_OPTIONS_HH
@@ -51,8 +51,11 @@ private:
     void verifyMandatoryPaths(boost::program_options::variables_map &vm);
     void parseParallelization();
     build::GapRealignerMode parseGapRealignment();
+    bam::BamIndexFormat parseBamIndexFormat();
     void parseExecutionTargets();
     void parseMemoryControl();
+    void verifyInMemoryMatches();
+    void verifyPreLoadReference();
     void parseGapScoring();
     workflow::AlignWorkflow::OptionalFeatures parseBamExcludeTags(std::string strBamExcludeTags);
     void parseDodgyAlignmentScore();
@@ -103,6 +106,7 @@ public:
     workflow::AlignWorkflow::State stopAt;
     unsigned int verbosity;
     unsigned clustersAtATimeMax;
+    unsigned selectClustersAtATimeMax;
     bool ignoreNeighbors;
     bool ignoreRepeats;
     unsigned mapqThreshold;
@@ -142,6 +146,8 @@ public:
     std::string realignGapsString;
     build::GapRealignerMode realignGaps;
     int bamGzipLevel;
+    std::string bamIndexFormatString;
+    bam::BamIndexFormat bamIndexFormat;
     std::vector<std::string> bamHeaderTags;
     std::string bamPuFormat;
     double expectedBgzfCompressionRatio;
@@ -156,6 +162,8 @@ public:
     std::string statsImageFormatString;
     reports::AlignmentReportGenerator::ImageFileFormat statsImageFormat;
     bool bufferBins;
+    bool inMemoryMatches;
+    bool preLoadReference;
     bool qScoreBin;
     std::string qScoreBinValueString;
     boost::array<char, 256> fullBclQScoreTable;
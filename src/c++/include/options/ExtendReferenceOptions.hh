@@ -0,0 +1,55 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ExtendReferenceOptions.hh
+ **
+ ** \brief Command line options for 'extendReference'
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_OPTIONS_EXTEND_REFERENCE_OPTIONS_HH
+#define iSAAC_OPTIONS_EXTEND_REFERENCE_OPTIONS_HH
+
+#include <string>
+#include <boost/filesystem.hpp>
+
+#include "common/Program.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+class ExtendReferenceOptions : public isaac::common::Options
+{
+public:
+    ExtendReferenceOptions();
+private:
+    std::string usagePrefix() const {return "extendReference";}
+    void postProcess(boost::program_options::variables_map &vm);
+public:
+    unsigned seedLength;
+    boost::filesystem::path referenceGenome;
+    boost::filesystem::path addedReference;
+    boost::filesystem::path outputDirectory;
+    boost::filesystem::path outputFile;
+    unsigned int repeatThreshold;
+    bool annotate;
+    bool parallelSort;
+    unsigned jobs;
+};
+
+} // namespace options
+} // namespace isaac
+
+#endif // #ifndef iSAAC_OPTIONS_EXTEND_REFERENCE_OPTIONS_HH
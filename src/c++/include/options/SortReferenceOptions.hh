@@ -21,6 +21,7 @@
 #define iSAAC_COMMON_SORT_REFERENCE_OPTIONS_HH
 
 #include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 
 #include "common/Program.hh"
@@ -40,11 +41,15 @@ private:
 public:
     unsigned seedLength;
     unsigned maskWidth;
-    unsigned long mask;
+    // each mask is stored into the output file with the same index
+    std::vector<unsigned long> masks;
     std::string genomeFile;
     boost::filesystem::path genomeNeighborsFile;
-    boost::filesystem::path outFile;
+    std::vector<boost::filesystem::path> outFiles;
     unsigned int repeatThreshold;
+    boost::filesystem::path tempDirectory;
+    unsigned long memoryLimit;
+    unsigned jobs;
 };
 
 } // namespace options
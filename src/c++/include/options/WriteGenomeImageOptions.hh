@@ -0,0 +1,48 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file WriteGenomeImageOptions.hh
+ **
+ ** Command line options for writeGenomeImage
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_OPTIONS_WRITE_GENOME_IMAGE_OPTIONS_HH
+#define iSAAC_OPTIONS_WRITE_GENOME_IMAGE_OPTIONS_HH
+
+#include <string>
+#include <boost/filesystem.hpp>
+
+#include "common/Program.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+class WriteGenomeImageOptions : public common::Options
+{
+public:
+    WriteGenomeImageOptions();
+private:
+    std::string usagePrefix() const {return "writeGenomeImage";}
+    void postProcess(boost::program_options::variables_map &vm);
+public:
+    boost::filesystem::path sortedReferenceMetadata_;
+    boost::filesystem::path outputFilePath_;
+};
+
+} // namespace options
+} // namespace isaac
+
+#endif // #ifndef iSAAC_OPTIONS_WRITE_GENOME_IMAGE_OPTIONS_HH
@@ -23,6 +23,8 @@
 #include <string>
 #include <vector>
 
+#include "oligo/PackedSequence.hh"
+
 namespace isaac
 {
 namespace reference
@@ -33,6 +35,9 @@ struct Contig
     unsigned index_;
     std::string name_;
     std::vector<char> forward_;
+    // 2-bit forward_ for word-at-a-time comparison, mapped from the genome image. Empty unless requested
+    // when loading and the reference has a genome image
+    oligo::PackedSequence packed_;
 
     Contig(const unsigned index, const std::string &name) : index_(index), name_(name){;}
     size_t getLength() const {return forward_.size();}
@@ -0,0 +1,275 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ContigCache.hh
+ **
+ ** Process-wide access to the loaded reference contigs.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_CONTIG_CACHE_HH
+#define iSAAC_REFERENCE_CONTIG_CACHE_HH
+
+#include <ctime>
+
+#include <boost/exception_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "reference/ContigLoader.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+/**
+ * \brief Dimensions: [referenceIndex][contigId]
+ */
+typedef std::vector<std::vector<Contig> > ContigLists;
+typedef boost::shared_ptr<const ContigLists> ContigListsPtr;
+
+/**
+ * \brief Contigs are loaded once per process and shared by the consumers (MatchSelector, Build). Each consumer
+ *        gets the contigs it asks for loaded, the ones already loaded for other consumers are not loaded again.
+ *        The cache holds on to the contigs until release is called. Consumers that still use them keep them
+ *        until they are done.
+ *
+ *        When retention is enabled (aligner daemon), all contigs of the references are loaded and packed by the
+ *        first consumer and kept for the subsequent ones, release does nothing until a request for a different
+ *        set of references comes.
+ *
+ *        The lists a consumer gets never change while it holds them. If another consumer holds the cached lists
+ *        and the new one needs contigs they lack, the new consumer gets a copy of the contigs it wants with the
+ *        missing ones loaded into it. The earlier consumers keep the old lists. This costs memory for the
+ *        duplicated contigs until the earlier consumers are done. A consumer that finds no other consumer
+ *        holding the cache first drops the contigs and packed bases it has not asked for, so that what
+ *        MatchSelector needed does not stay around for Build.
+ */
+class ContigCache
+{
+public:
+    static void setRetain(const bool retain);
+
+    /**
+     * \brief Starts loading all the contigs of the references on a separate thread. get and release
+     *        wait for it to complete. The loading allocates memory, don't prefetch while malloc is blocked.
+     */
+    static void prefetch(const SortedReferenceMetadataList &sortedReferenceMetadataList, const unsigned loadThreads);
+
+    /**
+     * \brief Gives the memory back unless retention is enabled
+     */
+    static void release();
+
+    /**
+     * \return contigs for which loadedContigFilter.isMapped is true. Other contigs might or might not be loaded.
+     *         With retention enabled, all the contigs.
+     */
+    template <typename FilterT> static ContigListsPtr get(
+        const SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const FilterT &loadedContigFilter,
+        common::ThreadVector &loadThreads,
+        const bool packBases = false)
+    {
+        waitForPrefetch();
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        return update(sortedReferenceMetadataList, loadedContigFilter, loadThreads, packBases);
+    }
+
+private:
+    struct AllContigsFilter
+    {
+        bool isMapped(unsigned, unsigned) const {return true;}
+    };
+
+    /// Wanted by the consumer filter but not in the cache yet
+    template <typename FilterT> struct MissingContigsFilter
+    {
+        const FilterT &filter_;
+        const ContigLists &cached_;
+        const SortedReferenceMetadataList &sortedReferenceMetadataList_;
+        const bool packBases_;
+        MissingContigsFilter(
+            const FilterT &filter, const ContigLists &cached,
+            const SortedReferenceMetadataList &sortedReferenceMetadataList, const bool packBases) :
+            filter_(filter), cached_(cached), sortedReferenceMetadataList_(sortedReferenceMetadataList), packBases_(packBases){}
+        bool isMapped(const unsigned referenceIndex, const unsigned contigIndex) const
+        {
+            const Contig &contig = cached_.at(referenceIndex).at(contigIndex);
+            // only the references with genome image get packed
+            return filter_.isMapped(referenceIndex, contigIndex) &&
+                (contig.forward_.empty() ||
+                    (packBases_ && contig.packed_.empty() &&
+                        !sortedReferenceMetadataList_.at(referenceIndex).getGenomeImagePath().empty()));
+        }
+    };
+
+    static bool retain_;
+    static boost::mutex mutex_;
+    static boost::shared_ptr<ContigLists> cached_;
+    static std::vector<SortedReferenceMetadata::Contigs> cachedContigs_;
+    static std::vector<std::time_t> cachedTimestamps_;
+
+    static boost::mutex prefetchMutex_;
+    static boost::scoped_ptr<boost::thread> prefetchThread_;
+    static boost::exception_ptr prefetchException_;
+
+    /// mutex_ must be locked
+    template <typename FilterT> static ContigListsPtr update(
+        const SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const FilterT &loadedContigFilter,
+        common::ThreadVector &loadThreads,
+        const bool packBases)
+    {
+        if (!isCached(sortedReferenceMetadataList))
+        {
+            // free the old ones before loading the new ones
+            cached_.reset();
+            cached_ = retain_ ?
+                load(sortedReferenceMetadataList, AllContigsFilter(), loadThreads, true) :
+                load(sortedReferenceMetadataList, loadedContigFilter, loadThreads, packBases);
+            cachedContigs_ = getContigs(sortedReferenceMetadataList);
+            cachedTimestamps_ = getTimestamps(sortedReferenceMetadataList);
+        }
+        else if (retain_)
+        {
+            loadMissing(sortedReferenceMetadataList, AllContigsFilter(), loadThreads, true);
+        }
+        else
+        {
+            if (cached_.unique())
+            {
+                trim(loadedContigFilter, packBases);
+            }
+            loadMissing(sortedReferenceMetadataList, loadedContigFilter, loadThreads, packBases);
+        }
+        return cached_;
+    }
+
+    /// frees whatever the consumer does not need. Nobody else must be holding cached_
+    template <typename FilterT> static void trim(const FilterT &loadedContigFilter, const bool packBases)
+    {
+        unsigned long trimmed = 0;
+        for (unsigned referenceIndex = 0; cached_->size() > referenceIndex; ++referenceIndex)
+        {
+            std::vector<Contig> &contigs = cached_->at(referenceIndex);
+            for (unsigned contigIndex = 0; contigs.size() > contigIndex; ++contigIndex)
+            {
+                Contig &contig = contigs[contigIndex];
+                const bool wanted = loadedContigFilter.isMapped(referenceIndex, contigIndex);
+                if (!wanted && !contig.forward_.empty())
+                {
+                    std::vector<char>().swap(contig.forward_);
+                    ++trimmed;
+                }
+                if ((!wanted || !packBases) && !contig.packed_.empty())
+                {
+                    oligo::PackedSequence().swap(contig.packed_);
+                }
+            }
+        }
+        if (trimmed)
+        {
+            ISAAC_THREAD_CERR << "Released " << trimmed << " cached contigs the consumer does not need" << std::endl;
+        }
+    }
+
+    template <typename FilterT> static boost::shared_ptr<ContigLists> load(
+        const SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const FilterT &loadedContigFilter,
+        common::ThreadVector &loadThreads,
+        const bool packBases)
+    {
+        ContigLists contigLists = loadContigs(sortedReferenceMetadataList, loadedContigFilter, loadThreads, packBases);
+        boost::shared_ptr<ContigLists> ret(new ContigLists);
+        ret->swap(contigLists);
+        return ret;
+    }
+
+    /// copies the contigs the consumer needs into lists nobody else holds
+    template <typename FilterT> static boost::shared_ptr<ContigLists> copy(
+        const FilterT &loadedContigFilter,
+        const bool packBases)
+    {
+        boost::shared_ptr<ContigLists> ret(new ContigLists(cached_->size()));
+        for (unsigned referenceIndex = 0; cached_->size() > referenceIndex; ++referenceIndex)
+        {
+            const std::vector<Contig> &contigs = cached_->at(referenceIndex);
+            std::vector<Contig> &copies = ret->at(referenceIndex);
+            copies.reserve(contigs.size());
+            for (unsigned contigIndex = 0; contigs.size() > contigIndex; ++contigIndex)
+            {
+                const Contig &contig = contigs[contigIndex];
+                copies.push_back(Contig(contig.index_, contig.name_));
+                if (loadedContigFilter.isMapped(referenceIndex, contigIndex))
+                {
+                    copies.back().forward_ = contig.forward_;
+                    if (packBases)
+                    {
+                        copies.back().packed_ = contig.packed_;
+                    }
+                }
+            }
+        }
+        return ret;
+    }
+
+    template <typename FilterT> static void loadMissing(
+        const SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const FilterT &loadedContigFilter,
+        common::ThreadVector &loadThreads,
+        const bool packBases)
+    {
+        if (!countMissing(MissingContigsFilter<FilterT>(loadedContigFilter, *cached_, sortedReferenceMetadataList, packBases)))
+        {
+            ISAAC_THREAD_CERR << "Reusing cached contigs of " << cached_->size() << " references" << std::endl;
+            return;
+        }
+        if (!cached_.unique())
+        {
+            // the consumers holding cached_ read it without locking. Load into a copy they don't see
+            ISAAC_THREAD_CERR << "Copying cached contigs held by another consumer" << std::endl;
+            cached_ = copy(loadedContigFilter, packBases);
+        }
+        const MissingContigsFilter<FilterT> missingFilter(loadedContigFilter, *cached_, sortedReferenceMetadataList, packBases);
+        ContigLists missing = loadContigs(sortedReferenceMetadataList, missingFilter, loadThreads, packBases);
+        merge(missing);
+    }
+
+    template <typename FilterT> static unsigned long countMissing(const MissingContigsFilter<FilterT> &missingFilter)
+    {
+        unsigned long ret = 0;
+        for (unsigned referenceIndex = 0; cached_->size() > referenceIndex; ++referenceIndex)
+        {
+            for (unsigned contigIndex = 0; cached_->at(referenceIndex).size() > contigIndex; ++contigIndex)
+            {
+                ret += missingFilter.isMapped(referenceIndex, contigIndex);
+            }
+        }
+        return ret;
+    }
+
+    static void prefetchContigs(const SortedReferenceMetadataList sortedReferenceMetadataList, const unsigned loadThreads);
+    static void waitForPrefetch();
+    static void merge(ContigLists &loaded);
+    static bool isCached(const SortedReferenceMetadataList &sortedReferenceMetadataList);
+    static std::vector<SortedReferenceMetadata::Contigs> getContigs(const SortedReferenceMetadataList &sortedReferenceMetadataList);
+    static std::vector<std::time_t> getTimestamps(const SortedReferenceMetadataList &sortedReferenceMetadataList);
+};
+
+} // namespace reference
+} // namespace isaac
+
+#endif // #ifndef iSAAC_REFERENCE_CONTIG_CACHE_HH
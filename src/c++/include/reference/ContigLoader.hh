@@ -22,8 +22,10 @@
 
 #include <boost/format.hpp>
 
+#include "common/Numa.hh"
 #include "common/Threads.hpp"
 #include "reference/Contig.hh"
+#include "reference/GenomeImage.hh"
 #include "reference/SortedReferenceMetadata.hh"
 
 namespace isaac
@@ -39,14 +41,25 @@ void loadContig(
     const reference::SortedReferenceMetadata::Contig &xmlContig,
     std::vector<char> &forward);
 
+/**
+ * \brief maps the genome image of the sorted reference if there is one and it matches the contigs
+ *
+ * \return 0 if there is no usable genome image
+ */
+boost::shared_ptr<const GenomeImage> openGenomeImage(const reference::SortedReferenceMetadata &sortedReferenceMetadata);
+
 template <typename ShouldLoadF> void loadContigsParallel(
     ShouldLoadF &shouldLoad,
     std::vector<reference::SortedReferenceMetadata::Contig>::const_iterator &nextContigToLoad,
     const std::vector<reference::SortedReferenceMetadata::Contig>::const_iterator contigsEnd,
     std::vector<reference::Contig> &contigList,
+    const boost::shared_ptr<const GenomeImage> &genomeImage,
+    const bool packBases,
     boost::mutex &mutex)
 {
     const unsigned traceStep = pow(10, int(log10((contigList.size() + 99) / 100)));
+    // contigs are read by the threads of all nodes. Don't let them all land on the node of the loading thread
+    const common::ScopedNumaInterleave interleave;
     boost::lock_guard<boost::mutex> lock(mutex);
     while (contigsEnd != nextContigToLoad)
     {
@@ -57,7 +70,20 @@ template <typename ShouldLoadF> void loadContigsParallel(
             common::unlock_guard<boost::mutex> unlock(mutex);
             const reference::SortedReferenceMetadata::Contig &xmlContig = *ourContig;
             std::vector<char> &forward = contigList[ourContig->karyotypeIndex_].forward_;
-            loadContig(xmlContig, forward);
+            if (genomeImage)
+            {
+                forward.clear();
+                genomeImage->unpack(xmlContig.index_, 0, xmlContig.totalBases_, forward);
+            }
+            else
+            {
+                loadContig(xmlContig, forward);
+            }
+            if (packBases && genomeImage)
+            {
+                // the packed bases stay in the mapping, shared with other processes through the page cache
+                genomeImage->wrap(xmlContig.index_, genomeImage, contigList[ourContig->karyotypeIndex_].packed_);
+            }
             if (!(xmlContig.index_ % traceStep))
             {
                 ISAAC_THREAD_CERR << (boost::format("Contig %s (%3d:%8d): %s\n") % xmlContig.name_ % xmlContig.index_ % xmlContig.totalBases_ % xmlContig.filePath_).str();
@@ -75,11 +101,17 @@ template <typename ShouldLoadF> void loadContigsParallel(
 
 /**
  * \brief loads the fasta file contigs into memory on multiple threads unless shouldLoad(contig->index_) returns false
+ *
+ * \param genomeImage if not 0, the bases are unpacked from the image instead of parsing the fasta
+ * \param packBases   if true and there is genomeImage, Contig::packed_ is made a view of the mapped image.
+ *                    Contigs are never packed into private memory as that would grow the footprint by a quarter
  */
 template <typename ShouldLoadF> std::vector<reference::Contig> loadContigs(
     const reference::SortedReferenceMetadata::Contigs &xmlContigs,
     ShouldLoadF shouldLoad,
-    common::ThreadVector &loadThreads)
+    common::ThreadVector &loadThreads,
+    const boost::shared_ptr<const GenomeImage> &genomeImage = boost::shared_ptr<const GenomeImage>(),
+    const bool packBases = false)
 {
     std::vector<reference::Contig> ret;
     ret.reserve(xmlContigs.size());
@@ -97,6 +129,8 @@ template <typename ShouldLoadF> std::vector<reference::Contig> loadContigs(
                                     boost::ref(nextContigToLoad),
                                     xmlContigs.end(),
                                     boost::ref(ret),
+                                    boost::cref(genomeImage),
+                                    packBases,
                                     boost::ref(mutex)));
 
     return ret;
@@ -104,11 +138,14 @@ template <typename ShouldLoadF> std::vector<reference::Contig> loadContigs(
 
 /**
  * \brief loads the fasta file contigs into memory on multiple threads
+ *
+ * \param packBases if true, Contig::packed_ is set for the references that have a usable genome image
  */
 template <typename FilterT> std::vector<std::vector<reference::Contig> > loadContigs(
     const reference::SortedReferenceMetadataList &SortedReferenceMetadataList,
     const FilterT &loadedContigFilter,
-    common::ThreadVector &loadThreads)
+    common::ThreadVector &loadThreads,
+    const bool packBases = false)
 {
     ISAAC_TRACE_STAT("loadContigs ");
     std::vector<std::vector<reference::Contig> > ret(SortedReferenceMetadataList.size());
@@ -116,13 +153,30 @@ template <typename FilterT> std::vector<std::vector<reference::Contig> > loadCon
     BOOST_FOREACH(const reference::SortedReferenceMetadata &SortedReferenceMetadata, SortedReferenceMetadataList)
     {
         const unsigned referenceIndex = &SortedReferenceMetadata - &SortedReferenceMetadataList.front();
+        const boost::shared_ptr<const GenomeImage> genomeImage = openGenomeImage(SortedReferenceMetadata);
         std::vector<reference::Contig> contigList =
             loadContigs(SortedReferenceMetadata.getContigs(),
                         boost::bind(&FilterT::isMapped, loadedContigFilter, referenceIndex, _1),
-                        loadThreads);
+                        loadThreads, genomeImage, packBases);
         ret.at(referenceIndex).swap(contigList);
     }
 
+    if (1 < common::getNumaNodeCount())
+    {
+        common::NumaPlacement placement;
+        BOOST_FOREACH(const std::vector<reference::Contig> &contigList, ret)
+        {
+            BOOST_FOREACH(const reference::Contig &contig, contigList)
+            {
+                if (!contig.forward_.empty())
+                {
+                    placement.count(&contig.forward_.front(), contig.forward_.size());
+                }
+            }
+        }
+        ISAAC_THREAD_CERR << "Loaded contigs " << placement << std::endl;
+    }
+
     ISAAC_TRACE_STAT("loadContigs done ");
 
     return ret;
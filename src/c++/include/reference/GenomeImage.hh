@@ -0,0 +1,157 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file GenomeImage.hh
+ **
+ ** \brief Binary image of the reference contigs with 2 bits per base.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_GENOME_IMAGE_HH
+#define iSAAC_REFERENCE_GENOME_IMAGE_HH
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "oligo/PackedSequence.hh"
+#include "reference/Contig.hh"
+#include "reference/SortedReferenceMetadata.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+/**
+ ** \brief Read-only memory-mapped genome image. Concurrent processes mapping the same image share
+ **        the page cache.
+ **
+ ** The contigs are stored in the order of their Contig::index_, four bases per byte in the
+ ** oligo::PackedSequence layout, so that the packed contigs can be used straight from the mapping.
+ ** Anything that is not ACGT in the reference is stored both as an N mask and as a list of N runs
+ ** per contig. Each contig also records the size and modification time of the fasta file it came from
+ ** so that an image left behind by an earlier version of the reference is not used.
+ **/
+class GenomeImage : boost::noncopyable
+{
+public:
+    /// file name of the image stored next to the sorted reference xml
+    static const char *const FILE_NAME;
+
+    explicit GenomeImage(const boost::filesystem::path &imagePath);
+
+    /**
+     * \return true if the image has the same contigs as the sorted reference and none of the fasta files
+     *         has changed since the image was written
+     */
+    bool matches(const SortedReferenceMetadata::Contigs &xmlContigs) const;
+
+    unsigned getContigCount() const {return header().contigCount_;}
+    unsigned long getContigLength(const unsigned contigIndex) const {return contig(contigIndex).totalBases_;}
+
+    /// \return one of ACGTN for the base at the position of the contig
+    char getBase(const unsigned contigIndex, const unsigned long position) const;
+
+    /// \brief appends bases [begin, end) of the contig to forward
+    void unpack(
+        const unsigned contigIndex,
+        const unsigned long begin,
+        const unsigned long end,
+        std::vector<char> &forward) const;
+
+    /**
+     * \brief makes packed a view of the contig bases in the mapped image
+     *
+     * \param image must be this. Keeps the mapping alive while packed or any of its copies exist
+     */
+    void wrap(
+        const unsigned contigIndex,
+        const boost::shared_ptr<const GenomeImage> &image,
+        oligo::PackedSequence &packed) const;
+
+    /**
+     * \param xmlContigs  where the contigs come from. Contigs are matched by index_
+     */
+    static void write(
+        const boost::filesystem::path &imagePath,
+        const SortedReferenceMetadata::Contigs &xmlContigs,
+        const std::vector<Contig> &contigs);
+
+    static boost::filesystem::path getPath(const boost::filesystem::path &sortedReferenceXmlPath)
+    {
+        return sortedReferenceXmlPath.parent_path() / FILE_NAME;
+    }
+
+private:
+    static const unsigned FORMAT_VERSION = 2;
+
+    struct Header
+    {
+        char magic_[8];
+        unsigned version_;
+        unsigned contigCount_;
+    } __attribute__ ((packed));
+
+    struct ContigEntry
+    {
+        unsigned long totalBases_;
+        unsigned long acgtBases_;
+        // where the contig is in the fasta file and the state of the file when the image was written
+        unsigned long fastaOffset_;
+        unsigned long fastaFileSize_;
+        long fastaMtime_;
+        // offsets in bytes from the beginning of the file. All 8-byte aligned
+        unsigned long basesOffset_;
+        unsigned long nMaskOffset_;
+        unsigned long nRunsOffset_;
+        unsigned long nRunsCount_;
+    } __attribute__ ((packed));
+
+    struct NRun
+    {
+        unsigned long begin_;
+        unsigned long length_;
+        bool operator <(const NRun &that) const {return begin_ < that.begin_;}
+    } __attribute__ ((packed));
+
+    boost::filesystem::path imagePath_;
+    boost::iostreams::mapped_file_source file_;
+
+    const Header &header() const {return *reinterpret_cast<const Header *>(file_.data());}
+    const ContigEntry &contig(const unsigned contigIndex) const
+    {
+        return reinterpret_cast<const ContigEntry *>(file_.data() + sizeof(Header))[contigIndex];
+    }
+    const unsigned char *bases(const ContigEntry &entry) const
+    {
+        return reinterpret_cast<const unsigned char *>(file_.data() + entry.basesOffset_);
+    }
+    const unsigned long *nMask(const ContigEntry &entry) const
+    {
+        return reinterpret_cast<const unsigned long *>(file_.data() + entry.nMaskOffset_);
+    }
+    const NRun *nRunsBegin(const ContigEntry &entry) const
+    {
+        return reinterpret_cast<const NRun *>(file_.data() + entry.nRunsOffset_);
+    }
+    const NRun *nRunsEnd(const ContigEntry &entry) const {return nRunsBegin(entry) + entry.nRunsCount_;}
+};
+
+} // namespace reference
+} // namespace isaac
+
+#endif // #ifndef iSAAC_REFERENCE_GENOME_IMAGE_HH
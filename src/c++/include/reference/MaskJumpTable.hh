@@ -0,0 +1,107 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file MaskJumpTable.hh
+ **
+ ** \brief Prefix-bucket offset table for a sorted mask file.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_MASK_JUMP_TABLE_HH
+#define iSAAC_REFERENCE_MASK_JUMP_TABLE_HH
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "common/Debug.hh"
+#include "oligo/Kmer.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+/**
+ ** \brief For each value of the bits immediately following the mask bits of the kmer, stores
+ **        the index of the first ReferenceKmer in the sorted mask file that belongs to the bucket.
+ **
+ ** Allows the match finder to go straight to the part of the mask file that can contain
+ ** the seed kmer instead of scanning all the preceding kmers.
+ **/
+template <typename KmerT>
+class MaskJumpTable
+{
+public:
+    static const unsigned MAX_BUCKET_BITS = 16;
+
+    MaskJumpTable() : maskWidth_(0), bucketBits_(0), kmers_(0), filledBuckets_(0){}
+
+    /// prepares for accumulation of kmers of a mask file with the given maskWidth
+    void reset(const unsigned maskWidth);
+
+    /// must be called for each kmer in the order the kmers are stored in the mask file
+    void add(const KmerT kmer)
+    {
+        const std::size_t bucket = getBucket(kmer);
+        ISAAC_ASSERT_MSG(filledBuckets_ <= bucket + 1, "Kmers must be added in sorted order");
+        while (filledBuckets_ <= bucket)
+        {
+            offsets_[filledBuckets_++] = kmers_;
+        }
+        ++kmers_;
+    }
+
+    void save(const boost::filesystem::path &maskFilePath) const;
+
+    /**
+     ** \param maskWidth    mask width of the reference the mask file belongs to. A table built for a different
+     **                     mask width would send the seeds to the wrong buckets and is an error.
+     **
+     ** \return false if the table file does not exist or does not match the mask file, in which case
+     **         the table is empty.
+     **/
+    bool load(const boost::filesystem::path &maskFilePath, const std::size_t maskFileKmers, const unsigned maskWidth);
+
+    bool empty() const {return offsets_.empty();}
+
+    /// \return range of indexes in the mask file that can contain the kmer
+    std::pair<std::size_t, std::size_t> getBucketRange(const KmerT kmer) const
+    {
+        const std::size_t bucket = getBucket(kmer);
+        return std::make_pair(offsets_[bucket], offsets_[bucket + 1]);
+    }
+
+    static boost::filesystem::path getPath(const boost::filesystem::path &maskFilePath)
+    {
+        return maskFilePath.string() + ".jump";
+    }
+
+private:
+    unsigned maskWidth_;
+    unsigned bucketBits_;
+    std::size_t kmers_;
+    std::size_t filledBuckets_;
+    std::vector<unsigned long> offsets_;
+
+    std::size_t getBucket(const KmerT kmer) const
+    {
+        return std::size_t(kmer >> (oligo::KmerTraits<KmerT>::KMER_BITS - maskWidth_ - bucketBits_)) &
+            ((1UL << bucketBits_) - 1);
+    }
+};
+
+} // namespace reference
+} // namespace isaac
+
+#endif // #ifndef iSAAC_REFERENCE_MASK_JUMP_TABLE_HH
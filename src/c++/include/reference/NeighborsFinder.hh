@@ -56,6 +56,11 @@ public:
         const boost::filesystem::path &tempFile,
         const unsigned jobs);
     void run() const;
+    /**
+     ** \brief Sets hasNeighbors for the kmers that have non-equal neighbors within the list. kmerList must
+     **        contain unique values and is returned sorted.
+     **/
+    static void annotateNeighbors(KmerList &kmerList, const bool parallelSort, const unsigned jobs);
     static void findNeighbors(KmerList &kmerList, unsigned jobs);
     /**
      ** \brief Count the non-equal neighbors within Hamming distance of neighborhoodWidth
@@ -79,6 +84,7 @@ private:
     void updateSortedReference(SortedReferenceMetadata::MaskFiles &maskFileList) const;
     static void findNeighborsParallel(const typename KmerList::iterator kmerListBegin, const typename KmerList::iterator kmerListEnd);
     KmerList getKmerList(const SortedReferenceMetadata &sortedReferenceMetadata) const;
+    std::size_t loadUniqueKmers(const boost::filesystem::path &maskPath, KmerList *kmerList) const;
 };
 
 } // namespace reference
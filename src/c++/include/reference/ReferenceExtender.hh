@@ -0,0 +1,142 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ReferenceExtender.hh
+ **
+ ** Adds the contigs of a separately sorted reference to an existing sorted reference.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_REFERENCE_REFERENCE_EXTENDER_HH
+#define iSAAC_REFERENCE_REFERENCE_EXTENDER_HH
+
+#include <vector>
+#include <boost/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+
+#include "common/Threads.hpp"
+#include "oligo/Kmer.hh"
+#include "oligo/Permutate.hh"
+#include "reference/ReferenceKmer.hh"
+#include "reference/SortedReferenceMetadata.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+/**
+ ** \brief Merges the mask files of the delta reference into the mask files of the existing reference.
+ **
+ ** The delta reference must be sorted with the same seed length and mask width and with no repeat
+ ** threshold, so that every forward occurrence of its kmers is available. The delta contigs are appended
+ ** after the existing ones.
+ **
+ ** Only the kmers that occur in the delta reference (on either strand) change their repeat counts. Their
+ ** existing counts are collected in one pass over the existing mask files. When annotation is requested,
+ ** the same pass collects the existing kmers that share a permuted prefix with a delta kmer. These are
+ ** the only ones that can become neighbors of the new kmers, so the neighbor search runs on them
+ ** and the delta kmers instead of the whole reference. A second pass writes the merged mask files.
+ **/
+template <typename KmerT>
+class ReferenceExtender: boost::noncopyable
+{
+public:
+    /**
+     * \param outputDirectory   where the merged mask files are written. Must differ from the directory
+     *                          of the existing mask files
+     * \param repeatThreshold   must be the one the existing reference was sorted with
+     * \param annotate          find neighbors for the new kmers. Use when the existing reference is annotated
+     */
+    ReferenceExtender(
+        const SortedReferenceMetadata &reference,
+        const SortedReferenceMetadata &delta,
+        const boost::filesystem::path &outputDirectory,
+        const unsigned repeatThreshold,
+        const bool annotate,
+        const bool parallelSort,
+        const unsigned jobs);
+
+    /// \return metadata of the extended reference
+    SortedReferenceMetadata run();
+
+private:
+    typedef ReferenceKmer<KmerT> ReferenceKmerType;
+    typedef std::vector<ReferenceKmerType> ReferenceKmers;
+    typedef std::vector<KmerT> Kmers;
+    static const unsigned KMER_BITS = oligo::KmerTraits<KmerT>::KMER_BASES * oligo::BITS_PER_BASE;
+    // bits of the permuted prefix used to index prefixFilters_
+    static const unsigned PREFIX_FILTER_BITS =
+        oligo::KmerTraits<KmerT>::KMER_BASES < 24 ? oligo::KmerTraits<KmerT>::KMER_BASES : 24;
+
+    /// occurrences of a kmer that is either present in the delta or is a reverse complement of one
+    struct KmerCounts
+    {
+        KmerCounts(const KmerT kmer = 0) : kmer_(kmer), existing_(0), added_(0), tooMany_(false), neighbors_(false){}
+        KmerT kmer_;
+        // forward occurrences in the existing reference
+        unsigned long existing_;
+        // forward occurrences in the delta
+        unsigned long added_;
+        // the existing reference has already stored it as TooManyMatch
+        bool tooMany_;
+        // neighbors flag of the existing reference records or the new neighborhood
+        bool neighbors_;
+
+        bool operator <(const KmerCounts &that) const {return kmer_ < that.kmer_;}
+    };
+    typedef std::vector<KmerCounts> AllKmerCounts;
+
+    const SortedReferenceMetadata &reference_;
+    const SortedReferenceMetadata &delta_;
+    const boost::filesystem::path outputDirectory_;
+    const unsigned repeatThreshold_;
+    const bool annotate_;
+    const bool parallelSort_;
+    const unsigned jobs_;
+    const std::vector<oligo::Permutate> permutateList_;
+
+    common::ThreadVector threads_;
+    // all delta records, sorted, with contig ids past the existing contigs
+    ReferenceKmers deltaKmers_;
+    // sorted by kmer
+    AllKmerCounts counts_;
+    // for each permutation, sorted prefixes of the permuted counts_ kmers
+    std::vector<Kmers> prefixes_;
+    // for each permutation, one bit per PREFIX_FILTER_BITS of the prefixes_ values
+    std::vector<std::vector<bool> > prefixFilters_;
+    // existing kmers that might be neighbors of the counts_ kmers, one list per thread
+    std::vector<Kmers> threadCandidates_;
+    // sorted kmers that have neighbors after the neighbors search
+    Kmers neighborKmers_;
+    std::vector<std::size_t> storedKmers_;
+
+    void validate() const;
+    void loadDelta();
+    void buildPrefixFilters();
+    void scanMasks(const unsigned threadNumber);
+    void scanMask(const SortedReferenceMetadata::MaskFile &maskFile, Kmers &candidates);
+    bool isCandidate(KmerT kmer) const;
+    void findNeighbors();
+    void mergeMasks(const unsigned threadNumber);
+    std::size_t mergeMask(
+        const SortedReferenceMetadata::MaskFile &maskFile,
+        const boost::filesystem::path &outputFile) const;
+    SortedReferenceMetadata makeMetadata() const;
+    unsigned long getMask(const KmerT kmer, const unsigned maskWidth) const {return kmer >> (KMER_BITS - maskWidth);}
+};
+
+} // namespace reference
+} // namespace isaac
+
+#endif // #ifndef iSAAC_REFERENCE_REFERENCE_EXTENDER_HH
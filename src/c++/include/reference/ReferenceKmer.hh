@@ -69,6 +69,13 @@ inline bool compareKmer(const ReferenceKmer<KmerT> &lhs, const ReferenceKmer<Kme
     return lhs.getKmer() < rhs.getKmer();
 }
 
+/// \brief total order for the kmers that have equal values
+template <typename KmerT>
+inline bool compareKmerAndPosition(const ReferenceKmer<KmerT> &lhs, const ReferenceKmer<KmerT> &rhs)
+{
+    return lhs.getKmer() < rhs.getKmer() || (lhs.getKmer() == rhs.getKmer() && lhs.second < rhs.second);
+}
+
 template <typename KmerT>
 inline bool comparePosition(const ReferenceKmer<KmerT> &lhs, const ReferenceKmer<KmerT> &rhs)
 {
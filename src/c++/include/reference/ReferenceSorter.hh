@@ -21,9 +21,11 @@
 #define iSAAC_REFERENCE_REFERENCE_SORTER_HH
 
 #include <string>
+#include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/filesystem.hpp>
 
+#include "common/Threads.hpp"
 #include "oligo/Kmer.hh"
 #include "reference/ReferenceKmer.hh"
 #include "reference/ReferencePosition.hh"
@@ -33,48 +35,79 @@ namespace isaac
 namespace reference
 {
 
+/**
+ ** \brief Produces sorted kmer files for a set of masks in a single pass over the genome.
+ **
+ ** Kmers are generated from blocks of the fasta on all threads and collected into a buffer of at most
+ ** memoryLimit bytes. Whenever the buffer fills up, it is sorted and spilled into tempDirectory as a run.
+ ** The runs and the in-memory remainder are then merged and written into the mask files in order.
+ **/
 template <typename KmerT>
 class ReferenceSorter: boost::noncopyable
 {
 public:
+    /**
+     * \param masks        masks to produce, each is stored in the outputFiles element with the same index
+     * \param memoryLimit  bytes of RAM for the kmer buffer. 0 keeps all kmers in memory
+     */
     ReferenceSorter(
         const unsigned int maskWidth,
-        const unsigned mask,
+        const std::vector<unsigned long> &masks,
         const boost::filesystem::path &genomeFile,
         const boost::filesystem::path &genomeNeighborsFile,
-        const boost::filesystem::path &outputFile,
-        const unsigned repeatThreshold);
+        const std::vector<boost::filesystem::path> &outputFiles,
+        const unsigned repeatThreshold,
+        const boost::filesystem::path &tempDirectory,
+        const unsigned long memoryLimit,
+        const unsigned threads);
+    ~ReferenceSorter();
     void run();
 private:
+    typedef ReferenceKmer<KmerT> ReferenceKmerType;
+    typedef std::vector<ReferenceKmerType> ReferenceKmers;
+    // number of fasta bases converted into kmers at a time
+    static const unsigned BLOCK_BASES = 1 << 22;
+    static const unsigned KMER_BITS = oligo::KmerTraits<KmerT>::KMER_BASES * oligo::BITS_PER_BASE;
+
     const unsigned repeatThreshold_;
     const unsigned int maskWidth_;
-    const unsigned mask_;
-
-    // the mask highlight bits in original kmer (ABCD)
-    const KmerT msbMask_;
-    // the mask value in the original kmer (ABCD) shifted to the topmost position
-    const KmerT maskBits_;
-
-    // the mask highlight bits as if the permutated kmer having them all set was unpermutated back into ABCD
-    const KmerT unpermutatedMsbMask_;
-    // the mask as if the permutated kmer containing it was unpermutated back into ABCD
-    const KmerT unpermutatedMaskBits_;
+    // sorted masks and their output files
+    std::vector<std::pair<unsigned long, boost::filesystem::path> > outputs_;
+    // true for the masks we store
+    std::vector<bool> selectedMasks_;
 
     const boost::filesystem::path genomeFile_;
     const boost::filesystem::path genomeNeighborsFile_;
+    const boost::filesystem::path tempDirectory_;
+    // maximum number of kmers kept in reference_
+    const std::size_t bufferKmersMax_;
 
-    const boost::filesystem::path outputFile_;
-    std::vector<ReferenceKmer<KmerT> > reference_;
-
+    common::ThreadVector threads_;
+    ReferenceKmers reference_;
+    std::vector<ReferenceKmers> threadKmers_;
+    std::vector<boost::filesystem::path> runs_;
 
     unsigned long loadReference(
         std::vector<unsigned long> &contigOffsets);
+    void addBlock(const int contigId, const unsigned long blockPosition, const std::vector<char> &block);
+    void generateKmers(
+        const int contigId, const unsigned long blockPosition, const std::vector<char> &block,
+        const unsigned threadNumber);
     void sortReference();
+    void spillReference();
+    void removeRuns();
     void saveReference(
+        const std::vector<unsigned long> &contigOffsets,
+        const std::vector<bool> &neighbors);
+    template <typename SourceT>
+    std::size_t saveMask(
+        SourceT &source,
+        const unsigned long mask,
+        const boost::filesystem::path &outputFile,
         const std::vector<unsigned long> &contigOffsets,
         const std::vector<bool> &neighbors,
-        const unsigned long genomeLength);
-    void addToReference(const KmerT kmer, const ReferencePosition &referencePosition);
+        ReferenceKmers &sameKmer);
+    unsigned long getMask(const KmerT kmer) const {return kmer >> (KMER_BITS - maskWidth_);}
 };
 
 } // namespace reference
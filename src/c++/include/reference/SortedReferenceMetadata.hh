@@ -94,6 +94,8 @@ private:
     Contigs contigs_;
     unsigned formatVersion_;
     unsigned defaultMaskWidth_;
+    // not serialized. Set when a genome image is found next to the xml file
+    boost::filesystem::path genomeImagePath_;
 
 public:
     SortedReferenceMetadata() :
@@ -120,6 +122,9 @@ public:
         const size_t kmers);
 
     unsigned int getDefaultMaskWidth() const {return defaultMaskWidth_;}
+
+    const boost::filesystem::path &getGenomeImagePath() const {return genomeImagePath_;}
+    void setGenomeImagePath(const boost::filesystem::path &genomeImagePath) {genomeImagePath_ = genomeImagePath;}
     /**
      ** Precondition: the contigs in the current instance are sequentially
      ** indexed from 0 and there are no duplicates.
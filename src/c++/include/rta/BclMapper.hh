@@ -34,6 +34,8 @@
 
 #include "io/InflateGzipDecompressor.hh"
 #include "io/FileBufCache.hh"
+#include "rta/BclTransposeKernel.hh"
+#include "rta/QScoreBinner.hh"
 
 namespace isaac
 {
@@ -66,19 +68,20 @@ public:
         }
     }
 
-    template <typename InsertIteratorT>
-    void transpose(InsertIteratorT insertIterator) const
+    /**
+     * \brief Stores the clusters one after another starting at outputIterator.
+     *
+     * If qScoreBinner is not 0, the clusters are binned while they are still in cache instead of making
+     * another pass over the whole tile. See BclTransposeKernel.
+     */
+    template <typename RandomAccessIteratorT>
+    void transpose(RandomAccessIteratorT outputIterator, const QScoreBinner *qScoreBinner = 0) const
     {
-        const unsigned increment = getTileSize(1);
-        for (unsigned clusterIndex = 0; clusterCount_ > clusterIndex; ++ clusterIndex)
+        if (clusterCount_ && cycleNumbers_)
         {
-            const char *clusterCycleEnd = getBclBufferStart(cycleNumbers_) + getClusterOffset(clusterIndex);
-            const char *clusterCyclePointer = getBclBufferStart(0) + getClusterOffset(clusterIndex);
-            while(clusterCycleEnd != clusterCyclePointer)
-            {
-                *insertIterator++ = *clusterCyclePointer;
-                clusterCyclePointer += increment;
-            }
+            transposeKernel_.transpose(
+                getBclBufferStart(0) + getClusterOffset(0), getTileSize(1), cycleNumbers_, clusterCount_,
+                &*outputIterator, qScoreBinner);
         }
     }
 
@@ -183,6 +186,7 @@ private:
     unsigned clusterCount_;
     unsigned cycleNumbers_;
     std::vector<char> tileData_;
+    BclTransposeKernel transposeKernel_;
 };
 
 /**
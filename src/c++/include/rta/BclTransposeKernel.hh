@@ -0,0 +1,98 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file BclTransposeKernel.hh
+ **
+ ** \brief Turns cycle-major tile bcl data into cluster-major records
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_RTA_BCL_TRANSPOSE_KERNEL_HH
+#define iSAAC_RTA_BCL_TRANSPOSE_KERNEL_HH
+
+#include "rta/QScoreBinner.hh"
+
+namespace isaac
+{
+namespace rta
+{
+
+/**
+ ** \brief Cache-blocked transpose of the tile cycles.
+ **
+ ** The tile is processed in blocks of BLOCK_CLUSTERS clusters. Within a block, 16 cycles are read at a time as
+ ** sequential streams. This matters because the cycles are page-aligned, so the same cluster of all cycles maps
+ ** to the same cache set and per-cluster access thrashes L1. The BLOCK_CLUSTERS complete clusters written
+ ** by a block stay in L2 for the usual read lengths until the block is binned. The SSE2 implementation
+ ** transposes 16 clusters by 16 cycles in registers. The cycles and clusters that don't fill a 16x16 square
+ ** are done by the scalar code.
+ **/
+class BclTransposeKernel
+{
+public:
+    enum Implementation
+    {
+        // pick the fastest one supported by the CPU
+        Auto,
+        Scalar,
+        // 16x16 bytes per 64 unpacks
+        Sse2
+    };
+
+    explicit BclTransposeKernel(const Implementation implementation = Auto);
+
+    /**
+     * \brief Stores clusters one after another, cycles bytes each, starting at output.
+     *
+     * \param firstCycle    bcl byte of the first cluster in the first cycle
+     * \param cycleStride   distance in bytes between the same cluster in two consecutive cycles
+     * \param qScoreBinner  if not 0, each block is binned while it is still in cache
+     */
+    void transpose(
+        const char *firstCycle,
+        const unsigned long cycleStride,
+        const unsigned cycles,
+        const unsigned long clusters,
+        char *output,
+        const QScoreBinner *qScoreBinner) const;
+
+    Implementation getImplementation() const {return implementation_;}
+    /// \return true if the CPU and the build support the implementation
+    static bool isSupported(const Implementation implementation);
+
+private:
+    // 150 cycles of 1024 clusters is 150K of output
+    static const unsigned BLOCK_CLUSTERS = 1024;
+    static const unsigned SQUARE = 16;
+
+    Implementation implementation_;
+
+    static Implementation selectImplementation(const Implementation requested);
+
+    /// transposes [cycleBegin, cycleEnd) of [clusterBegin, clusterEnd)
+    static void transposeScalar(
+        const char *firstCycle, const unsigned long cycleStride, const unsigned cycles,
+        const unsigned cycleBegin, const unsigned cycleEnd,
+        const unsigned long clusterBegin, const unsigned long clusterEnd,
+        char *output);
+
+    static void transposeBlockSse2(
+        const char *firstCycle, const unsigned long cycleStride, const unsigned cycles,
+        const unsigned long blockBegin, const unsigned long blockEnd,
+        char *output);
+};
+
+} // namespace rta
+} // namespace isaac
+
+#endif // #ifndef iSAAC_RTA_BCL_TRANSPOSE_KERNEL_HH
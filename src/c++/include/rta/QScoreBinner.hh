@@ -0,0 +1,85 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file QScoreBinner.hh
+ **
+ ** \brief Replaces the quality scores of bcl bytes with their bins
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_RTA_Q_SCORE_BINNER_HH
+#define iSAAC_RTA_Q_SCORE_BINNER_HH
+
+#include <boost/array.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace isaac
+{
+namespace rta
+{
+
+/**
+ ** \brief Translates bcl bytes (quality score in the upper 6 bits, base in the lower 2) through a 256-entry table.
+ **
+ ** When the table keeps the base bits of every byte and only changes the quality, which is the case for the
+ ** tables produced from --qscore-bin-values, the translation is a 64-entry quality lookup that the SSSE3
+ ** implementation does with four byte shuffles per 16 bytes. Other tables are applied by the scalar
+ ** implementation.
+ **/
+class QScoreBinner: boost::noncopyable
+{
+public:
+    enum Implementation
+    {
+        // pick the fastest one supported by the CPU and the table
+        Auto,
+        Scalar,
+        // 16 bytes per 4 pshufb lookups
+        Ssse3
+    };
+
+    static const unsigned QSCORES = 64;
+    typedef boost::array<char, 256> BclTable;
+
+    explicit QScoreBinner(const BclTable &fullBclQScoreTable, const Implementation implementation = Auto);
+
+    char bin(const char bcl) const {return table_[static_cast<unsigned char>(bcl)];}
+
+    /// \brief bins [begin, end) in place
+    void bin(char *begin, char *end) const;
+
+    Implementation getImplementation() const {return implementation_;}
+    /// \return true if the CPU and the build support the implementation
+    static bool isSupported(const Implementation implementation);
+
+private:
+    const BclTable table_;
+    // binned quality of each quality score, shifted into the bcl quality bits
+    char qScoreTable_[QSCORES];
+    const Implementation implementation_;
+
+    /// \return true if the table never changes the base bits and the result depends on the quality only
+    static bool isQScoreOnly(const BclTable &table);
+    static Implementation selectImplementation(const Implementation requested, const BclTable &table);
+
+    void binScalar(char *begin, char *end) const;
+
+    // implemented in QScoreBinnerSsse3.cpp, the only file compiled with SSSE3 enabled
+    void binSsse3(char *begin, char *end) const;
+    static bool ssse3Supported();
+};
+
+} // namespace rta
+} // namespace isaac
+
+#endif // #ifndef iSAAC_RTA_Q_SCORE_BINNER_HH
@@ -0,0 +1,76 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file AlignDaemon.hh
+ **
+ ** \brief Long-running process that executes alignment jobs submitted through a spool directory.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_WORKFLOW_ALIGN_DAEMON_HH
+#define iSAAC_WORKFLOW_ALIGN_DAEMON_HH
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace isaac
+{
+namespace workflow
+{
+
+namespace bfs = boost::filesystem;
+
+/**
+ ** \brief Picks up <name>.job files from the spool directory in the order of their names. Each job file contains
+ **        isaac-align arguments, one per line. While the job runs, the file is named <name>.running. When
+ **        finished, it is renamed into <name>.done or, if the job failed, <name>.failed containing the error.
+ **
+ ** Jobs run one at a time inside the daemon process, so the reference contigs stay loaded between the jobs
+ ** that use the same reference.
+ **/
+class AlignDaemon: boost::noncopyable
+{
+public:
+    AlignDaemon(
+        const bfs::path &spoolDirectory,
+        const unsigned pollInterval,
+        const unsigned maxJobs);
+
+    void run();
+
+private:
+    static const std::string JOB_EXTENSION;
+    static const std::string RUNNING_EXTENSION;
+    static const std::string DONE_EXTENSION;
+    static const std::string FAILED_EXTENSION;
+    static const std::string STOP_FILE_NAME;
+
+    const bfs::path spoolDirectory_;
+    const unsigned pollInterval_;
+    const unsigned maxJobs_;
+
+    bool isStopRequested() const;
+    bool findNextJob(bfs::path &jobPath) const;
+    /// \return false if another daemon has taken the job
+    bool runJob(const bfs::path &jobPath) const;
+    void align(const std::vector<std::string> &arguments) const;
+    static std::vector<std::string> readArguments(const bfs::path &jobPath);
+};
+
+} // namespace workflow
+} // namespace isaac
+
+#endif // #ifndef iSAAC_WORKFLOW_ALIGN_DAEMON_HH
@@ -0,0 +1,41 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file AlignJob.hh
+ **
+ ** \brief Runs the alignment workflow for one set of parsed isaac-align options.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_WORKFLOW_ALIGN_JOB_HH
+#define iSAAC_WORKFLOW_ALIGN_JOB_HH
+
+#include "options/AlignOptions.hh"
+
+namespace isaac
+{
+namespace workflow
+{
+
+/**
+ * \brief Steps the alignment workflow from options.startFrom to options.stopAt saving the state after each step.
+ *        Shared by isaac-align and isaac-align-daemon.
+ *
+ * \param availableMemory memory budget in bytes. The caller is responsible for enforcing it.
+ */
+void runAlignJob(const options::AlignOptions &options, const unsigned long long availableMemory);
+
+} // namespace workflow
+} // namespace isaac
+
+#endif // #ifndef iSAAC_WORKFLOW_ALIGN_JOB_HH
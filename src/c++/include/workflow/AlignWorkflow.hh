@@ -101,6 +101,7 @@ public:
         const unsigned neighborhoodSizeThreshold,
         const unsigned long availableMemory,
         const unsigned clustersAtATimeMax,
+        const unsigned selectClustersAtATimeMax,
         const bool ignoreNeighbors,
         const bool ignoreRepeats,
         const unsigned mapqThreshold,
@@ -131,6 +132,7 @@ public:
         const unsigned outputSaversMax,
         const build::GapRealignerMode realignGaps,
         const int bamGzipLevel,
+        const bam::BamIndexFormat bamIndexFormat,
         const std::string &bamPuFormat,
         const std::vector<std::string> &bamHeaderTags,
         const double expectedBgzfCompressionRatio,
@@ -143,6 +145,8 @@ public:
         const alignment::TemplateLengthStatistics &userTemplateLengthStatistics,
         const reports::AlignmentReportGenerator::ImageFileFormat statsImageFormat,
         const bool bufferBins,
+        const bool inMemoryMatches,
+        const bool preLoadReference,
         const bool qScoreBin,
         const boost::array<char, 256> &fullBclQScoreTable,
         const OptionalFeatures optionalFeatures,
@@ -175,6 +179,21 @@ public:
      */
     AlignWorkflow::State step();
 
+    /**
+     * \brief Same as step() except that when both the alignment reports and the bam files are
+     *        required to reach targetState, the reports are generated on a second thread while the bam
+     *        files are being built. The reports do not need the bins, so building the bam does not have to
+     *        wait for them. This is only done with --memory-control off as the malloc block Build runs
+     *        under is process-wide and would catch the report allocations.
+     *
+     *        Streaming completed bins into Build while match selection is still running is not
+     *        implemented. Each tile flush appends fragments to every bin it has alignments for, so a bin
+     *        is only complete once the last tile is selected. Build starts after the selection is done.
+     *
+     * \return The new state
+     */
+    AlignWorkflow::State step(const AlignWorkflow::State targetState);
+
     /**
      * \brief Erases all intermediary files that are not required for the stages that have been completed
      */
@@ -217,6 +236,7 @@ private:
     const unsigned long matchesPerBin_;
     const unsigned long availableMemory_;
     const unsigned clustersAtATimeMax_;
+    const unsigned selectClustersAtATimeMax_;
     const unsigned mapqThreshold_;
     const bool perTileTls_;
     const bool pfOnly_;
@@ -245,6 +265,7 @@ private:
     const unsigned outputSaversMax_;
     const build::GapRealignerMode realignGaps_;
     const int bamGzipLevel_;
+    const bam::BamIndexFormat bamIndexFormat_;
     const std::string &bamPuFormat_;
     const std::vector<std::string> &bamHeaderTags_;
     const double expectedBgzfCompressionRatio_;
@@ -252,6 +273,8 @@ private:
     const bool keepDuplicates_;
     const bool markDuplicates_;
     const bool bufferBins_;
+    const bool inMemoryMatches_;
+    const bool preLoadReference_;
     const bool qScoreBin_;
     const boost::array<char, 256> &fullBclQScoreTable_;
     const OptionalFeatures optionalFeatures_;
@@ -278,13 +301,18 @@ private:
     void findMatches(alignWorkflow::FoundMatchesMetadata &foundMatches) const;
     void selectMatches(
         alignment::matchSelector::FragmentStorage &fragmentStorage,
+        const unsigned long batchClustersMax,
         std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const;
     void cleanupMatches() const;
     void cleanupBins() const;
+    /// load, compute and, with buffered bins, flush stages of the match selection overlap
+    unsigned getSelectIoOverlap() const {return bufferBins_ ? 3 : 2;}
+    unsigned long getSelectBatchClustersMax() const;
     void selectMatches(
         SelectedMatchesMetadata &binPaths,
         std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const;
     void generateAlignmentReports() const;
+    void generateAlignmentReportsAndBam(const unsigned threadNumber);
     const build::BarcodeBamMapping generateBam(
         const SelectedMatchesMetadata &binPaths,
         std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const;
@@ -162,9 +162,13 @@ public:
         common::ThreadVector &bclLoadThreads,
         const unsigned inputLoadersMax,
         const bool extractClusterXy);
+    /**
+     * \param qScoreBinner if not 0, the quality scores are binned while the cycles are transposed
+     */
     void loadClusters(
         const flowcell::TileMetadataList &allTiles,
         const flowcell::TileMetadata &tileMetadata,
+        const rta::QScoreBinner *qScoreBinner,
         alignment::BclClusters &bclData);
 
 private:
@@ -178,6 +182,7 @@ private:
 
     void bclToClusters(
         const flowcell::TileMetadata &tileMetadata,
+        const rta::QScoreBinner *qScoreBinner,
         alignment::BclClusters &bclData,
         const bool useLocsPositions) const;
 };
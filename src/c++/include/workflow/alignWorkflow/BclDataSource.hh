@@ -122,13 +122,18 @@ public:
         common::ThreadVector &bclLoadThreads,
         const unsigned inputLoadersMax,
         const bool extractClusterXy);
+    /**
+     * \param qScoreBinner if not 0, the quality scores are binned while the cycles are transposed
+     */
     void loadClusters(
         const flowcell::TileMetadata &tileMetadata,
+        const rta::QScoreBinner *qScoreBinner,
         alignment::BclClusters &bclData);
 
 private:
     void bclToClusters(
         const flowcell::TileMetadata &tileMetadata,
+        const rta::QScoreBinner *qScoreBinner,
         alignment::BclClusters &bclData,
         const bool useLocsPositions) const;
 };
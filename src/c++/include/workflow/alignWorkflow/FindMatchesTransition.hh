@@ -75,7 +75,8 @@ public:
         const unsigned tempSaversMax,
         const common::ScoopedMallocBlock::Mode memoryControl,
         const std::vector<size_t> &clusterIdList,
-        const reference::SortedReferenceMetadataList &sortedReferenceMetadataList);
+        const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+        const bool inMemoryMatches);
 
     template <typename KmerT>
     void perform(FoundMatchesMetadata &foundMatches);
@@ -104,6 +105,8 @@ private:
     const std::vector<size_t> &clusterIdList_;
 
     const reference::SortedReferenceMetadataList &sortedReferenceMetadataList_;
+    // keep matches in FoundMatchesMetadata::matchArena_ instead of the temporary files
+    const bool inMemoryMatches_;
     common::ThreadVector threads_;
 
     static const unsigned maxIterations_ = 2;
@@ -20,6 +20,9 @@
 #ifndef iSAAC_WORKFLOW_ALIGN_WORKFLOW_FOUND_MATCHES_METADATA_HH
 #define iSAAC_WORKFLOW_ALIGN_WORKFLOW_FOUND_MATCHES_METADATA_HH
 
+#include <boost/shared_ptr.hpp>
+
+#include "alignment/MatchArena.hh"
 #include "alignment/MatchTally.hh"
 #include "alignment/MatchDistribution.hh"
 #include "flowcell/BarcodeMetadata.hh"
@@ -48,6 +51,8 @@ struct FoundMatchesMetadata
     flowcell::TileMetadataList tileMetadataList_;
     alignment::MatchTally matchTally_;
     alignment::MatchDistribution matchDistribution_;
+    /// if not 0, the matches are in memory instead of the files listed in matchTally_. Not serialized.
+    boost::shared_ptr<alignment::MatchArena> matchArena_;
 
     void addTile(const flowcell::TileMetadata& tile)
     {
@@ -62,6 +67,7 @@ struct FoundMatchesMetadata
         tileMetadataList_.swap(another.tileMetadataList_);
         matchTally_.swap(another.matchTally_);
         matchDistribution_.swap(another.matchDistribution_);
+        matchArena_.swap(another.matchArena_);
     }
 };
 
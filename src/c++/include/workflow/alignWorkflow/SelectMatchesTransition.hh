@@ -32,11 +32,13 @@
 #include "alignment/FragmentBuilder.hh"
 #include "alignment/TemplateBuilder.hh"
 #include "alignment/Match.hh"
+#include "alignment/MatchArena.hh"
 #include "alignment/MatchDistribution.hh"
 #include "alignment/MatchTally.hh"
 #include "alignment/SeedMetadata.hh"
 #include "alignment/TemplateLengthStatistics.hh"
 #include "alignment/MatchSelector.hh"
+#include "alignment/matchSelector/ClusterMatchGrouper.hh"
 #include "alignment/matchSelector/FragmentStorage.hh"
 #include "alignment/matchSelector/MatchSelectorStats.hh"
 #include "alignment/matchSelector/ParallelMatchLoader.hh"
@@ -47,6 +49,7 @@
 #include "reference/Contig.hh"
 #include "reference/SortedReferenceMetadata.hh"
 #include "rta/BclReader.hh"
+#include "rta/QScoreBinner.hh"
 #include "workflow/alignWorkflow/BamDataSource.hh"
 #include "workflow/alignWorkflow/BclBgzfDataSource.hh"
 #include "workflow/alignWorkflow/BclDataSource.hh"
@@ -67,6 +70,7 @@ public:
     /// Construction of an instance for a given reference
     SelectMatchesTransition(
         const unsigned ioOverlapParallelization,
+        const unsigned long batchClustersMax,
         alignment::matchSelector::FragmentStorage &fragmentStorage,
         const alignment::MatchDistribution &matchDistribution,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
@@ -85,6 +89,7 @@ public:
         const unsigned tempLoadersMax,
         const unsigned tempSaversMax,
         const alignment::MatchTally &matchTally,
+        alignment::MatchArena *matchArena,
         const alignment::TemplateLengthStatistics &defaultTemplateLengthStatistics,
         const unsigned mapqThreshold,
         const bool perTileTls,
@@ -116,6 +121,20 @@ public:
         const boost::filesystem::path &matchSelectorStatsXmlPath,
         std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics);
 
+    /**
+     ** \brief Bytes reserved for each of the biggest tiles a batch can hold: the tile match and base call
+     **        buffers of every io overlap stage and, when fragments are buffered, the fragment collector
+     **        and flush buffer records.
+     **/
+    static unsigned long getBatchTileBytes(
+        const unsigned ioOverlapParallelization,
+        const TileMetadataList &tileMetadataList,
+        const flowcell::FlowcellLayoutList &flowcellLayoutList,
+        const alignment::MatchTally &matchTally,
+        const bool inMemoryMatches,
+        const bool bufferFragments,
+        const bool extractClusterXy);
+
 private:
     common::ThreadVector matchLoadThreads_;
     common::ThreadVector inputLoaderThreads_;
@@ -133,6 +152,10 @@ private:
 
     common::ThreadVector ioOverlapThreads_;
     TileMetadataList::const_iterator nextUnprocessedTile_;
+    // consecutive tiles are selected together as long as their total cluster count does not exceed this
+    const unsigned long batchClustersMax_;
+    // number of the biggest tiles that fit into batchClustersMax_
+    const unsigned batchTilesMax_;
 
 
     mutable bool loadSlotAvailable_;
@@ -144,20 +167,43 @@ private:
     const std::vector<alignment::matchSelector::SequencingAdapterList> barcodeSequencingAdapters_;
 
     const alignment::MatchTally &matchTally_;
-    std::vector<std::vector<alignment::Match> > threadMatches_;
+    // if not 0, matches are taken from the arena instead of the files of matchTally_
+    alignment::MatchArena *matchArena_;
+
+    /// Storage for the data of one tile, big enough for any tile
+    struct TileBuffer
+    {
+        TileBuffer(const unsigned long maxTileMatches, const unsigned clusterLength) :
+            matches_(maxTileMatches), bclData_(clusterLength)
+        {
+        }
+        std::vector<alignment::Match> matches_;
+        alignment::BclClusters bclData_;
+    };
+    // batchTilesMax_ buffers for each io overlap thread. Buffers are taken when the tile is loaded and
+    // returned once its matches are selected, so that the thread waiting for the flush does not hold any.
+    std::vector<TileBuffer> tileBuffers_;
+    // indexes of tileBuffers_ not used by any thread, guarded by slotMutex_
+    std::vector<unsigned> freeTileBuffers_;
+    // tileBuffers_ indexes of the current batch of each thread
+    std::vector<std::vector<unsigned> > threadBatchBuffers_;
+    std::vector<alignment::MatchSelector::Batch> threadBatches_;
+
+    // only used from within the compute slot
+    common::ThreadVector groupThreads_;
+    alignment::matchSelector::ClusterMatchGrouper matchGrouper_;
 
     alignment::matchSelector::FragmentStorage &fragmentStorage_;
 
     alignment::matchSelector::ParallelMatchLoader matchLoader_;
-    std::vector<alignment::BclClusters> threadBclData_;
     boost::scoped_ptr<BclBaseCallsSource> bclBaseCallsSource_;
     boost::scoped_ptr<FastqBaseCallsSource> fastqBaseCallsSource_;
     boost::scoped_ptr<BamBaseCallsSource> bamBaseCallsSource_;
     boost::scoped_ptr<BclBgzfBaseCallsSource> bclBgzfBaseCallsSource_;
 
     alignment::MatchSelector matchSelector_;
-    bool qScoreBin_;
-    const boost::array<char, 256> &fullBclQScoreTable_;
+    // 0 unless qscores are binned
+    const boost::scoped_ptr<const rta::QScoreBinner> qScoreBinner_;
     bool forceTermination_;
 
     void acquireSlot(bool &slotAvailable) const
@@ -192,6 +238,22 @@ private:
     void releaseComputeSlot(const bool exceptionUnwinding) {releaseSlot(computeSlotAvailable_, exceptionUnwinding);}
     void releaseFlushSlot(const bool exceptionUnwinding) {releaseSlot(flushSlotAvailable_, exceptionUnwinding);}
 
+    unsigned acquireTileBuffer()
+    {
+        boost::unique_lock<boost::mutex> lock(slotMutex_);
+        ISAAC_ASSERT_MSG(!freeTileBuffers_.empty(), "Each thread is expected to have enough tile buffers for its batch");
+        const unsigned ret = freeTileBuffers_.back();
+        freeTileBuffers_.pop_back();
+        return ret;
+    }
+
+    void releaseTileBuffers(std::vector<unsigned> &buffers)
+    {
+        boost::unique_lock<boost::mutex> lock(slotMutex_);
+        freeTileBuffers_.insert(freeTileBuffers_.end(), buffers.begin(), buffers.end());
+        buffers.clear();
+    }
+
     void processMatchList(
         const std::vector<reference::Contig> &barcodeContigList,
         const alignment::matchSelector::SequencingAdapterList &sequencingAdapters,
@@ -207,16 +269,17 @@ private:
         std::vector<alignment::Match> &matchList,
         const alignment::BclClusters &bclData);
 
-    void loadClusters(const unsigned threadNumber, const flowcell::TileMetadata &tileMetadata);
+    void loadClusters(const flowcell::TileMetadata &tileMetadata, alignment::BclClusters &bclData);
+
+    void loadBatch(const unsigned threadNumber, const alignment::MatchTally &matchTally);
 
     /**
-     * \brief Processes a single tile
+     * \brief Processes batches of tiles until there are no more tiles left
      **/
     void selectTileMatches(
         const unsigned threadNumber,
         const alignment::MatchTally &matchTally,
-        std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics,
-        common::ScoopedMallocBlock &mallocBlock);
+        std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics);
 
     /**
      ** \brief load all the data from the given tile into the selected destination
@@ -245,10 +308,11 @@ private:
     std::vector<reference::Contig> getContigList(
         const reference::SortedReferenceMetadata &sortedReferenceMetadata) const;
 
-    unsigned long getMaxTileMatches(const alignment::MatchTally &matchTally) const
+    static unsigned long getMaxTileMatches(
+        const TileMetadataList &tileMetadataList, const alignment::MatchTally &matchTally)
     {
         unsigned long ret = 0;
-        BOOST_FOREACH(const flowcell::TileMetadata &tileMetadata, tileMetadataList_)
+        BOOST_FOREACH(const flowcell::TileMetadata &tileMetadata, tileMetadataList)
         {
             const std::vector<alignment::MatchTally::FileTally> &tileFileTally = matchTally.getFileTallyList(tileMetadata);
             ret = std::max(ret,
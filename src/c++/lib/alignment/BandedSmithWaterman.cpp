@@ -35,13 +35,15 @@ namespace alignment
 
 BandedSmithWaterman::BandedSmithWaterman(const int matchScore, const int mismatchScore,
                                          const int gapOpenScore, const int gapExtendScore,
-                                         const int maxReadLength)
+                                         const int maxReadLength,
+                                         const Implementation implementation)
     : matchScore_(matchScore)
     , mismatchScore_(mismatchScore)
     , gapOpenScore_(gapOpenScore)
     , gapExtendScore_(gapExtendScore)
     , maxReadLength_(maxReadLength)
     , initialValue_(static_cast<int>(std::numeric_limits<short>::min()) + gapOpenScore_)
+    , implementation_(selectImplementation(implementation))
     , T_((char *)_mm_malloc (maxReadLength_ * 3 *sizeof(__m128i), 16))
 {
     // check that there won't be any overflows in the matrices
@@ -58,6 +60,34 @@ BandedSmithWaterman::~BandedSmithWaterman()
     _mm_free(T_);
 }
 
+bool BandedSmithWaterman::isSupported(const Implementation implementation)
+{
+    switch (implementation)
+    {
+    case Avx2:
+        return avx2Supported();
+    case Auto:
+    case Scalar:
+    case Sse2:
+        return true;
+    }
+    return false;
+}
+
+BandedSmithWaterman::Implementation BandedSmithWaterman::selectImplementation(const Implementation requested)
+{
+    if (Auto == requested)
+    {
+        return isSupported(Avx2) ? Avx2 : Sse2;
+    }
+    if (!isSupported(requested))
+    {
+        const std::string message = (boost::format("BandedSmithWaterman: implementation %d is not supported by the CPU") % requested).str();
+        BOOST_THROW_EXCEPTION(isaac::common::InvalidParameterException(message));
+    }
+    return requested;
+}
+
 // insert in register 0 only -- workaround for missing sse4 instruction set
 inline __m128i _mm_insert_epi8(__m128i v, char c, int)
 {
@@ -101,6 +131,204 @@ unsigned BandedSmithWaterman::align(
     //allH_.reserve(query.length());
     //const __m128i GapOpenScore = _mm_insert_epi16(_mm_set1_epi16(gapOpenScore_), 0, 0);
     //const __m128i GapExtendScore = _mm_insert_epi16(_mm_set1_epi16(gapExtendScore_), 0, 0);
+    LastRow lastRow;
+    switch (implementation_)
+    {
+    case Scalar:
+        fillScalar(queryBegin, queryEnd, databaseBegin, lastRow);
+        break;
+    case Avx2:
+        fillAvx2(queryBegin, queryEnd, databaseBegin, lastRow);
+        break;
+    default:
+        fillSse2(queryBegin, queryEnd, databaseBegin, lastRow);
+        break;
+    }
+
+    // find the max of E, F and G at the end
+    short max = lastRow[0][WIDEST_GAP_SIZE - 1] - 1;
+    int ii = querySize - 1;
+    int jj = ii;
+    unsigned maxType = 0;
+    for (int j = WIDEST_GAP_SIZE - 1; 0 <= j; --j)
+    {
+        for (unsigned type = 0; 3 > type; ++type)
+        {
+            const short value = lastRow[type][j];
+            if (value > max)
+            {
+                max = value;
+                jj = j;
+                maxType = type;
+            }
+        }
+    }
+    //std::cerr << (boost::format("ii = %d, jj = %d, max = %d, maxType = %d") % (ii + 1) % jj % max % maxType).str() << std::endl;
+    const int jjIncrement[] = {0, 1, -1};
+    const int iiIncrement[] = {-1, 0, -1};
+    const Cigar::OpCode opCodes[] = {Cigar::ALIGN, Cigar::DELETE, Cigar::INSERT};
+    unsigned opLength = 0;
+    //std::string newDatabase;
+    //std::string newQuery;
+    //std::cerr << std::endl << "building CIGAR" << std::endl;
+    if (jj > 0)
+    {
+        cigar.addOperation(jj, Cigar::DELETE);
+    }
+    while(ii >= 0 && jj >= 0 && jj <= 15)
+    {
+#if 0
+        if (0 == maxType)
+        {
+            newDatabase.push_back(database[ii + 15 - jj]);
+            newQuery.push_back(query[ii]);
+        }
+        else if(1 == maxType)
+        {
+            newDatabase.push_back(database[ii + 15 - jj]);
+            newQuery.push_back('-');
+        }
+        else if(2 == maxType)
+        {
+            newDatabase.push_back('-');
+            newQuery.push_back(query[ii]);
+        }
+#endif
+        ++opLength;
+        const unsigned nextMaxType = T_[(ii * 3 + maxType) * sizeof(__m128i) + jj];
+        //std::cerr << (boost::format("ii = %d, jj = %d, maxType = %d, nextMaxType = %d, opLength = %d") %
+        //              ii % jj % maxType %nextMaxType % opLength ).str() << std::endl;
+        if (nextMaxType != maxType)
+        {
+            cigar.addOperation(opLength, opCodes[maxType]);
+            opLength = 0;
+        }
+        ii += iiIncrement[maxType];
+        jj += jjIncrement[maxType];
+        maxType = nextMaxType;
+    }
+    assert(-1 == ii);
+    if (1 != maxType && opLength)
+    {
+        cigar.addOperation(opLength, opCodes[maxType]);
+        opLength = 0;
+    }
+    if (15 > jj)
+    {
+        cigar.addOperation(opLength + 15 - jj, Cigar::DELETE);
+        opLength = 0;
+    }
+    assert(0 == opLength);
+    //descriptor.push_back(d[maxType]);
+    unsigned ret = 0;
+    const std::pair<unsigned, Cigar::OpCode> firstCigar = Cigar::decode(cigar.back());
+    if(Cigar::DELETE == firstCigar.second)
+    {
+        //CASAVA does not like CIGAR beginning with a deletion in the data
+        cigar.pop_back();
+        ISAAC_ASSERT_MSG(Cigar::DELETE != Cigar::decode(cigar.back()).second, "two Cigar::DELETE cannot be next to each other");
+        ret = firstCigar.first;
+    }
+    std::reverse(cigar.begin() + originalCigarSize, cigar.end());
+    if(Cigar::DELETE == Cigar::decode(cigar.back()).second)
+    {
+        //CASAVA does not like CIGAR ending with a deletion in the data
+        cigar.pop_back();
+        ISAAC_ASSERT_MSG(Cigar::DELETE != Cigar::decode(cigar.back()).second, "two Cigar::DELETE cannot be next to each other");
+    }
+    return ret;
+    //std::cerr << std::endl << "CIGAR: " << cigar.toString() << std::endl;
+    //std::reverse(newDatabase.begin(), newDatabase.end());
+    //std::reverse(newQuery.begin(), newQuery.end());
+    //std::cerr << "       " << descriptor << std::endl;
+    //std::cerr << database << std::endl;
+    //std::cerr << "       " << query << std::endl;
+    //std::cerr << "       " << newQuery << std::endl;
+    //std::cerr << "       " << newDatabase << std::endl;
+}
+
+/**
+ * \brief Straightforward implementation of the same recurrences as the vectorized kernels. Band position
+ *        j pairs the query base i with the database base i + WIDEST_GAP_SIZE - 1 - j.
+ */
+void BandedSmithWaterman::fillScalar(
+    const std::vector<char>::const_iterator queryBegin,
+    const std::vector<char>::const_iterator queryEnd,
+    const std::vector<char>::const_iterator databaseBegin,
+    LastRow &lastRow) const
+{
+    short *G = lastRow[0];
+    short *E = lastRow[1];
+    short *F = lastRow[2];
+    std::fill(G, G + WIDEST_GAP_SIZE, initialValue_);
+    std::fill(E, E + WIDEST_GAP_SIZE, initialValue_);
+    std::fill(F, F + WIDEST_GAP_SIZE, 0);
+    G[0] = 0;
+
+    char *t = T_;
+    std::vector<char>::const_iterator queryCurrent = queryBegin;
+    for (unsigned queryOffset = 0; queryEnd != queryCurrent; ++queryOffset, ++queryCurrent)
+    {
+        char *TG = t;
+        char *TE = t + WIDEST_GAP_SIZE;
+        char *TF = t + WIDEST_GAP_SIZE * 2;
+        t += sizeof(__m128i) * 3;
+
+        short newF[WIDEST_GAP_SIZE];
+        short newG[WIDEST_GAP_SIZE];
+        for (unsigned j = 0; WIDEST_GAP_SIZE > j; ++j)
+        {
+            // F[i, j] = max(G[i-1, j-1] - open, E[i-1, j-1] - open, F[i-1, j-1] - extend)
+            const short g = j ? G[j - 1] : 0;
+            const short e = j ? E[j - 1] : 0;
+            const short f = (j ? F[j - 1] : 0) - gapExtendScore_;
+            const short ge = std::max(g, e) - gapOpenScore_;
+            TF[j] = ge < f ? 2 : g < e;
+            newF[j] = std::max(ge, f);
+
+            // G[i, j] = max(G[i-1, j], E[i-1, j], F[i-1, j]) + match/mismatch
+            TG[j] = std::max(G[j], E[j]) < F[j] ? 2 : G[j] < E[j];
+            const bool match = *queryCurrent == *(databaseBegin + queryOffset + WIDEST_GAP_SIZE - 1 - j);
+            newG[j] = std::max(std::max(G[j], E[j]), F[j]) + (match ? matchScore_ : mismatchScore_);
+        }
+        TF[0] = 0;
+        newF[0] = initialValue_;
+
+        // E[i, j] = max(G[i, j+1] - open, E[i, j+1] - extend, F[i, j+1] - open)
+        short g = initialValue_;
+        short e = initialValue_;
+        short f = initialValue_;
+        for (int j = WIDEST_GAP_SIZE - 1; 0 <= j; --j)
+        {
+            short max = g;
+            char tMax = 0;
+            if (e > g && e > f)
+            {
+                max = e;
+                tMax = 1;
+            }
+            else if (f > g)
+            {
+                max = f;
+                tMax = 2;
+            }
+            TE[j] = tMax;
+            E[j] = max;
+            g = newG[j] - gapOpenScore_;
+            e = max - gapExtendScore_;
+            f = newF[j] - gapOpenScore_;
+        }
+        std::copy(newG, newG + WIDEST_GAP_SIZE, G);
+        std::copy(newF, newF + WIDEST_GAP_SIZE, F);
+    }
+}
+
+void BandedSmithWaterman::fillSse2(
+    const std::vector<char>::const_iterator queryBegin,
+    const std::vector<char>::const_iterator queryEnd,
+    const std::vector<char>::const_iterator databaseBegin,
+    LastRow &lastRow) const
+{
     __m128i *t = (__m128i *)T_;
     const __m128i GapOpenScore = _mm_set1_epi16(gapOpenScore_);
     const __m128i GapExtendScore = _mm_set1_epi16(gapExtendScore_);
@@ -194,7 +422,7 @@ unsigned BandedSmithWaterman::align(
         //std::cerr << "   F: " << F[1] <<  F[0] << std::endl;
         //std::cerr << "tmp0: " << tmp0[1] << tmp0[0] << std::endl;
         //std::cerr << "tmp1: " << tmp1[1] << tmp1[0] << std::endl;
-        TG = _mm_max_epi16(_mm_packs_epi16(tmp2[0], tmp2[1]), TG); // 0, 1, or 2 for G, E or F
+        TG = _mm_max_epu8(_mm_packs_epi16(tmp2[0], tmp2[1]), TG); // 0, 1, or 2 for G, E or F
         // add the match/mismatch score
         // load the query base in all 8 values of the register
         __m128i Q = _mm_set1_epi8(*queryCurrent);
@@ -345,120 +573,12 @@ unsigned BandedSmithWaterman::align(
         std::cerr << epi8(TF) << std::endl;
 #endif
     }
-    // find the max of E, F and G at the end
-    short max = _mm_extract_epi16(G[1], 7) - 1;
-    int ii = querySize - 1;
-    int jj = ii;
-    unsigned maxType = 0;
-    __m128i *TT[] = {G, E, F};
-    for (unsigned int k = 0; 2 > k; ++k)
+    for (unsigned int j = 0; 2 > j; ++j)
     {
-        const unsigned int kk = (k + 1) % 2;
-        //std:: cerr << "kk = " << kk << ", max = " << max << std::endl;
-        //std::cerr << "type 0: " << TT[0][kk] << std::endl;
-        //std::cerr << "type 1: " << TT[1][kk] << std::endl;
-        //std::cerr << "type 2: " << TT[2][kk] << std::endl;
-        for (unsigned j = 8; 0 < j; --j)
-        {
-            //std::cerr << "j = " << j;
-            for (unsigned type = 0; 3 > type; ++type)
-            {
-                const short value = _mm_extract_epi16(TT[type][kk], 7);
-                //std::cerr << ", type = " << type << ", value = " << value;
-                TT[type][kk] = _mm_slli_si128(TT[type][kk], 2);
-                if (value > max)
-                {
-                    //std::cerr << std::endl << "max = " << max << ", value = " << value<< ", j = "  << j<< ", kk = "  << kk << std::endl;
-                    max = value;
-                    jj = 8 * kk + j - 1;
-                    maxType = type;
-                }
-            }
-            //std::cerr << std::endl;
-        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lastRow[0] + j * registerLength_), G[j]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lastRow[1] + j * registerLength_), E[j]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lastRow[2] + j * registerLength_), F[j]);
     }
-    //std::cerr << (boost::format("ii = %d, jj = %d, max = %d, maxType = %d") % (ii + 1) % jj % max % maxType).str() << std::endl;
-    const int jjIncrement[] = {0, 1, -1};
-    const int iiIncrement[] = {-1, 0, -1};
-    const Cigar::OpCode opCodes[] = {Cigar::ALIGN, Cigar::DELETE, Cigar::INSERT};
-    unsigned opLength = 0;
-    //std::string newDatabase;
-    //std::string newQuery;
-    //std::cerr << std::endl << "building CIGAR" << std::endl;
-    if (jj > 0)
-    {
-        cigar.addOperation(jj, Cigar::DELETE);
-    }
-    while(ii >= 0 && jj >= 0 && jj <= 15)
-    {
-#if 0
-        if (0 == maxType)
-        {
-            newDatabase.push_back(database[ii + 15 - jj]);
-            newQuery.push_back(query[ii]);
-        }
-        else if(1 == maxType)
-        {
-            newDatabase.push_back(database[ii + 15 - jj]);
-            newQuery.push_back('-');
-        }
-        else if(2 == maxType)
-        {
-            newDatabase.push_back('-');
-            newQuery.push_back(query[ii]);
-        }
-#endif
-        ++opLength;
-        const unsigned nextMaxType = T_[(ii * 3 + maxType) * sizeof(__m128i) + jj];
-        //std::cerr << (boost::format("ii = %d, jj = %d, maxType = %d, nextMaxType = %d, opLength = %d") %
-        //              ii % jj % maxType %nextMaxType % opLength ).str() << std::endl;
-        if (nextMaxType != maxType)
-        {
-            cigar.addOperation(opLength, opCodes[maxType]);
-            opLength = 0;
-        }
-        ii += iiIncrement[maxType];
-        jj += jjIncrement[maxType];
-        maxType = nextMaxType;
-    }
-    assert(-1 == ii);
-    if (1 != maxType && opLength)
-    {
-        cigar.addOperation(opLength, opCodes[maxType]);
-        opLength = 0;
-    }
-    if (15 > jj)
-    {
-        cigar.addOperation(opLength + 15 - jj, Cigar::DELETE);
-        opLength = 0;
-    }
-    assert(0 == opLength);
-    //descriptor.push_back(d[maxType]);
-    unsigned ret = 0;
-    const std::pair<unsigned, Cigar::OpCode> firstCigar = Cigar::decode(cigar.back());
-    if(Cigar::DELETE == firstCigar.second)
-    {
-        //CASAVA does not like CIGAR beginning with a deletion in the data
-        cigar.pop_back();
-        ISAAC_ASSERT_MSG(Cigar::DELETE != Cigar::decode(cigar.back()).second, "two Cigar::DELETE cannot be next to each other");
-        ret = firstCigar.first;
-    }
-    std::reverse(cigar.begin() + originalCigarSize, cigar.end());
-    if(Cigar::DELETE == Cigar::decode(cigar.back()).second)
-    {
-        //CASAVA does not like CIGAR ending with a deletion in the data
-        cigar.pop_back();
-        ISAAC_ASSERT_MSG(Cigar::DELETE != Cigar::decode(cigar.back()).second, "two Cigar::DELETE cannot be next to each other");
-    }
-    return ret;
-    //std::cerr << std::endl << "CIGAR: " << cigar.toString() << std::endl;
-    //std::reverse(newDatabase.begin(), newDatabase.end());
-    //std::reverse(newQuery.begin(), newQuery.end());
-    //std::cerr << "       " << descriptor << std::endl;
-    //std::cerr << database << std::endl;
-    //std::cerr << "       " << query << std::endl;
-    //std::cerr << "       " << newQuery << std::endl;
-    //std::cerr << "       " << newDatabase << std::endl;
 }
 
 std::string epi8(__m128i v)
@@ -0,0 +1,180 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file BandedSmithWatermanAvx2.cpp
+ **
+ ** \brief AVX2 kernel for BandedSmithWaterman. This is the only file compiled with -mavx2,
+ **        the kernel is called only when the CPU supports it.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "alignment/BandedSmithWaterman.hh"
+#include "common/Debug.hh"
+
+namespace isaac
+{
+namespace alignment
+{
+
+#ifdef __AVX2__
+
+/// moves each 16-bit value one band position up, position 0 gets 0
+static inline __m256i shiftUp(const __m256i v)
+{
+    return _mm256_alignr_epi8(v, _mm256_permute2x128_si256(v, v, 0x08), 14);
+}
+
+/// moves each 16-bit value BYTES / 2 band positions down, top positions get 0
+template <int BYTES>
+static inline __m256i shiftDown(const __m256i v)
+{
+    return _mm256_alignr_epi8(_mm256_permute2x128_si256(v, v, 0x81), v, BYTES);
+}
+
+template <>
+inline __m256i shiftDown<16>(const __m256i v)
+{
+    return _mm256_permute2x128_si256(v, v, 0x81);
+}
+
+/// moves values down filling the top with the lowest short value so that they never win the max
+template <int BYTES>
+static inline __m256i shiftDownMin(const __m256i v, const __m256i signBits)
+{
+    return _mm256_xor_si256(shiftDown<BYTES>(_mm256_xor_si256(v, signBits)), signBits);
+}
+
+/// packs 16 values 0, 1 or 2 into the 16 bytes of the traceback matrix
+static inline __m128i packTrace(const __m256i v)
+{
+    return _mm_packs_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+}
+
+bool BandedSmithWaterman::avx2Supported()
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+/**
+ * \brief Same recurrences as fillScalar with the whole band in one register. The sequential
+ *        dependency of E on the neighbouring band position is resolved with a log-step max scan.
+ */
+void BandedSmithWaterman::fillAvx2(
+    const std::vector<char>::const_iterator queryBegin,
+    const std::vector<char>::const_iterator queryEnd,
+    const std::vector<char>::const_iterator databaseBegin,
+    LastRow &lastRow) const
+{
+    BOOST_STATIC_ASSERT(16 == WIDEST_GAP_SIZE);
+    const __m256i GapOpenScore = _mm256_set1_epi16(gapOpenScore_);
+    const __m256i GapExtendScore = _mm256_set1_epi16(gapExtendScore_);
+    const __m256i GapExtendScore2 = _mm256_set1_epi16(gapExtendScore_ * 2);
+    const __m256i GapExtendScore4 = _mm256_set1_epi16(gapExtendScore_ * 4);
+    const __m256i GapExtendScore8 = _mm256_set1_epi16(gapExtendScore_ * 8);
+    const __m256i MatchScore = _mm256_set1_epi16(matchScore_);
+    const __m256i MismatchScore = _mm256_set1_epi16(mismatchScore_);
+    const __m256i SignBits = _mm256_set1_epi16(short(0x8000));
+    const __m256i One = _mm256_set1_epi16(1);
+    const __m256i Two = _mm256_set1_epi16(2);
+    const __m256i Position0 = _mm256_setr_epi16(-1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i Position15 = _mm256_setr_epi16(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, -1);
+    const __m256i InitialValue = _mm256_set1_epi16(initialValue_);
+
+    __m256i E = InitialValue;
+    __m256i F = _mm256_setzero_si256();
+    __m256i G = _mm256_blendv_epi8(InitialValue, _mm256_setzero_si256(), Position0);
+
+    // database bases in reverse order: position j holds the base aligned against the current query base
+    __m128i D = _mm_setzero_si128();
+    for (unsigned int i = 0; WIDEST_GAP_SIZE > i + 1; ++i)
+    {
+        D = _mm_insert_epi8(_mm_slli_si128(D, 1), *(databaseBegin + i), 0);
+    }
+
+    __m128i *t = reinterpret_cast<__m128i *>(T_);
+    std::vector<char>::const_iterator queryCurrent = queryBegin;
+    for (unsigned queryOffset = 0; queryEnd != queryCurrent; ++queryOffset, ++queryCurrent)
+    {
+        // F[i, j] = max(G[i-1, j-1] - open, E[i-1, j-1] - open, F[i-1, j-1] - extend)
+        const __m256i upG = shiftUp(G);
+        const __m256i upE = shiftUp(E);
+        const __m256i upF = _mm256_sub_epi16(shiftUp(F), GapExtendScore);
+        __m256i newF = _mm256_sub_epi16(_mm256_max_epi16(upG, upE), GapOpenScore);
+        __m256i TF = _mm256_and_si256(_mm256_cmpgt_epi16(upE, upG), One);
+        TF = _mm256_blendv_epi8(TF, Two, _mm256_cmpgt_epi16(upF, newF));
+        TF = _mm256_andnot_si256(Position0, TF);
+        newF = _mm256_blendv_epi8(_mm256_max_epi16(newF, upF), InitialValue, Position0);
+
+        // G[i, j] = max(G[i-1, j], E[i-1, j], F[i-1, j]) + match/mismatch
+        __m256i newG = _mm256_max_epi16(G, E);
+        __m256i TG = _mm256_and_si256(_mm256_cmpgt_epi16(E, G), One);
+        TG = _mm256_blendv_epi8(TG, Two, _mm256_cmpgt_epi16(F, newG));
+        newG = _mm256_max_epi16(newG, F);
+
+        D = _mm_insert_epi8(_mm_slli_si128(D, 1), *(databaseBegin + queryOffset + WIDEST_GAP_SIZE - 1), 0);
+        const __m256i B = _mm256_cvtepi8_epi16(_mm_cmpeq_epi8(_mm_set1_epi8(*queryCurrent), D));
+        newG = _mm256_add_epi16(newG, _mm256_blendv_epi8(MismatchScore, MatchScore, B));
+
+        // E[i, j] = max(G[i, j+1] - open, E[i, j+1] - extend, F[i, j+1] - open)
+        const __m256i g = _mm256_sub_epi16(shiftDownMin<2>(newG, SignBits), GapOpenScore);
+        const __m256i f = _mm256_sub_epi16(shiftDownMin<2>(newF, SignBits), GapOpenScore);
+        // the top band position does not have a neighbour and gets the initial value
+        __m256i newE = _mm256_blendv_epi8(_mm256_max_epi16(g, f), InitialValue, Position15);
+        newE = _mm256_max_epi16(newE, _mm256_subs_epi16(shiftDownMin<2>(newE, SignBits), GapExtendScore));
+        newE = _mm256_max_epi16(newE, _mm256_subs_epi16(shiftDownMin<4>(newE, SignBits), GapExtendScore2));
+        newE = _mm256_max_epi16(newE, _mm256_subs_epi16(shiftDownMin<8>(newE, SignBits), GapExtendScore4));
+        newE = _mm256_max_epi16(newE, _mm256_subs_epi16(shiftDownMin<16>(newE, SignBits), GapExtendScore8));
+
+        // recover which of the three provided the max, preferring G, then F, then E same as fillScalar
+        const __m256i e = _mm256_sub_epi16(shiftDownMin<2>(newE, SignBits), GapExtendScore);
+        const __m256i eWins = _mm256_and_si256(_mm256_cmpgt_epi16(e, g), _mm256_cmpgt_epi16(e, f));
+        __m256i TE = _mm256_blendv_epi8(_mm256_and_si256(_mm256_cmpgt_epi16(f, g), Two), One, eWins);
+        TE = _mm256_andnot_si256(Position15, TE);
+
+        G = newG;
+        E = newE;
+        F = newF;
+
+        _mm_store_si128(t++, packTrace(TG));
+        _mm_store_si128(t++, packTrace(TE));
+        _mm_store_si128(t++, packTrace(TF));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lastRow[0]), G);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lastRow[1]), E);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lastRow[2]), F);
+}
+
+#else //__AVX2__
+
+bool BandedSmithWaterman::avx2Supported()
+{
+    return false;
+}
+
+void BandedSmithWaterman::fillAvx2(
+    const std::vector<char>::const_iterator,
+    const std::vector<char>::const_iterator,
+    const std::vector<char>::const_iterator,
+    LastRow &) const
+{
+    ISAAC_ASSERT_MSG(false, "The binary is compiled without AVX2 support");
+}
+
+#endif //__AVX2__
+
+} // namespace alignment
+} // namespace isaac
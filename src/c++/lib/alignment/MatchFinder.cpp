@@ -86,7 +86,8 @@ MatchFinder<KmerT>::MatchFinder(
     common::ThreadVector &threads,
     const unsigned coresMax,
     const unsigned tempSaversMax,
-    const unsigned unavailableFileHandles)
+    const unsigned unavailableFileHandles,
+    MatchArena *matchArena)
     : kmerSourceMetadataList_(getMaskFilesList(sortedReferenceList))
     , referenceContigKaryotypes_(getReferenceContigKaryotypes(sortedReferenceList))
     , seedMetadataList_(seedMetadataList)
@@ -102,19 +103,56 @@ MatchFinder<KmerT>::MatchFinder(
     , threadRepeatLists_(threadsMax_, std::vector<ReferenceKmer>(repeatThreshold_ + 1))
     , threadNeighborsLists_(threadsMax_, std::vector<ReferenceKmer>(neighborhoodSizeThreshold_ + 1))
     , threadMatchDistributions_(threadsMax_, MatchDistribution(sortedReferenceList))
-    , matchWriter_(matchTally, maxTilesAtATime_, tiles.back().getIndex())
+    , matchWriter_(matchTally, maxTilesAtATime_, tiles.back().getIndex(), matchArena)
     , threadReferenceFileBuffers_(
         threadsMax_,
         io::FileBufCache<io::FileBufWithReopen>(1, std::ios_base::binary|std::ios_base::in,
                                                 std::max_element(kmerSourceMetadataList_.begin(), kmerSourceMetadataList_.end(),
                                                                  boost::bind(&KmerSourceMetadata::getPathSize, _1)<
                                                                  boost::bind(&KmerSourceMetadata::getPathSize, _2))->getPathSize()))
+    , maskJumpTables_(kmerSourceMetadataList_.size())
+    , maskScheduler_(threads_, threadsMax_, kmerSourceMetadataList_.size())
 {
+    while (threadMatchWriters_.size() < threadsMax_)
+    {
+        threadMatchWriters_.push_back(new io::ThreadMatchWriter(matchWriter_));
+    }
+    maskTasks_.reserve(kmerSourceMetadataList_.size());
+    maskTaskCosts_.reserve(kmerSourceMetadataList_.size());
     ISAAC_THREAD_CERR << "Constructing the match finder" << std::endl;
-
+    openMasks();
     ISAAC_THREAD_CERR << "Constructing the match finder done" << std::endl;
 }
 
+/**
+ * \brief Memory-maps the mask files and loads their jump tables so that ExactMaskMatcher can jump over the
+ *        reference kmers that are not present among the seeds instead of reading them all.
+ */
+template<typename KmerT>
+void MatchFinder<KmerT>::openMasks()
+{
+    maskMappings_.reserve(kmerSourceMetadataList_.size());
+    BOOST_FOREACH(const KmerSourceMetadata &kmerSource, kmerSourceMetadataList_)
+    {
+        const boost::filesystem::path &sortedReferencePath = kmerSource.maskFilePath_;
+        maskMappings_.push_back(new boost::iostreams::mapped_file_source);
+        // zero-length files can't be mapped
+        if (boost::filesystem::file_size(sortedReferencePath))
+        {
+            try
+            {
+                maskMappings_.back().open(sortedReferencePath.string());
+            }
+            catch (const std::ios_base::failure &e)
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to map reference " + sortedReferencePath.string() + ": " + e.what()));
+            }
+        }
+        maskJumpTables_.at(&kmerSource - &kmerSourceMetadataList_.front()).load(
+            sortedReferencePath, maskMappings_.back().size() / sizeof(ReferenceKmer), kmerSource.maskWidth_);
+    }
+}
+
 /*
  * \brief We have to keep an open output file for each tile in process.
  *        Limit the number of tiles so that we don't go over the ulimit -n
@@ -126,12 +164,14 @@ unsigned MatchFinder<KmerT>::verifyMaxTileCount(
     const unsigned tilesCount) const
 {
     const unsigned requiredInputFilesPerThread(1); // reference kmers
+    const unsigned mappedMaskFiles(kmerSourceMetadataList_.size()); // kept open by the mappings
     const unsigned requiredOutputFilesPerTile(1);  // this implementation stores all matches of a tile in a single file
                                                    // the thread synchronization is used to prevent file corruption
 
     const unsigned maxTileCount =
         (common::getMaxOpenFiles() -
             unavailableFileHandlesCount -
+            mappedMaskFiles -
             requiredInputFilesPerThread * threadsMax_) / requiredOutputFilesPerTile;
 
     if (0 == maxTileCount) {
@@ -194,16 +234,26 @@ const std::vector<MatchDistribution> & MatchFinder<KmerT>::match(
     const bool finalPass)
 {
 
-    // parallelize the matching across all the masks of all the references.
-    typename KmerSourceMetadataList::const_iterator kmerSourceIterator = kmerSourceMetadataList_.begin();
-    threads_.execute(boost::bind(&MatchFinder::matchMaskParallel, this,
-                                 boost::ref(seedsBegin),
-                                 boost::cref(referenceSeedBounds),
-                                 findNeighbors,
-                                 finalPass,
-                                 boost::ref(kmerSourceIterator),
-                                 _1),
-                     threadsMax_);
+    // split the seeds into per-mask tasks and parallelize the matching across all the masks of all the references.
+    maskTasks_.clear();
+    maskTaskCosts_.clear();
+    for (typename KmerSourceMetadataList::const_iterator kmerSourceIterator = kmerSourceMetadataList_.begin();
+         kmerSourceMetadataList_.end() != kmerSourceIterator && referenceSeedBounds.back() != seedsBegin; ++kmerSourceIterator)
+    {
+        const std::pair<typename std::vector<SeedT>::const_iterator, typename std::vector<SeedT>::const_iterator> endNextBegin =
+            skipToTheNextMask(seedsBegin, referenceSeedBounds.at(kmerSourceIterator->referenceIndex_),
+                              kmerSourceIterator->mask_, kmerSourceIterator->maskWidth_);
+        const MaskTask task = {kmerSourceIterator, seedsBegin, endNextBegin.first, endNextBegin.second};
+        maskTasks_.push_back(task);
+        // the cost of matching is roughly proportional to the number of seeds. Empty masks still need their files touched
+        maskTaskCosts_.push_back(std::distance(task.begin_, task.nextBegin_) + 1);
+        seedsBegin = endNextBegin.second;
+    }
+
+    maskScheduler_.execute(boost::bind(&MatchFinder::matchMaskTask, this, findNeighbors, finalPass, _1, _2), maskTaskCosts_);
+
+    // all matches must be in the tile files by the time findMatches returns
+    threads_.execute(boost::bind(&MatchFinder::flushThreadMatchWriter, this, _1), threadsMax_);
 
     return threadMatchDistributions_;
 }
@@ -214,8 +264,7 @@ MatchFinder<KmerT>::skipToTheNextMask(
     const typename std::vector<SeedT>::const_iterator currentBegin,
     const typename std::vector<SeedT>::const_iterator seedsEnd,
     const unsigned currentMask,
-    const unsigned maskWidth,
-    const bool storeNSeedNoMatches)
+    const unsigned maskWidth)
 {
     const KmerT endSeed =
         (KmerT(currentMask) << (oligo::KmerTraits<KmerT>::KMER_BITS - maskWidth)) |
@@ -231,88 +280,86 @@ MatchFinder<KmerT>::skipToTheNextMask(
     if (nextBegin != currentEnd)
     {
         ISAAC_THREAD_CERR << "Skipped " << nextBegin - currentEnd << " N-seeds for mask " << currentMask << std::endl;
-        if (storeNSeedNoMatches)
-        {
-            // generate no-match entries for N-containing seeds or else the match selector statistics will never see those clusters
-            BOOST_FOREACH(const SeedT &seed, std::make_pair(currentEnd, nextBegin))
-            {
-                // N-seeds don't have a valid seed index. seedMetadataList_[seed.getSeedIndex()] is invalid
-//                if (!foundExactMatchesOnly_.isReadComplete(seed.getTile(), seed.getCluster(),
-//                                                           seedMetadataList_[seed.getSeedIndex()].getReadIndex()))
-                {
-                    matchWriter_.write(seed.getSeedId(), reference::ReferencePosition(reference::ReferencePosition::NoMatch));
-                }
-            }
-        }
     }
     return std::make_pair(currentEnd, nextBegin);
 }
 
 template <typename KmerT>
-void MatchFinder<KmerT>::matchMaskParallel(
-    typename std::vector<SeedT>::const_iterator &seedsBegin,
-    const std::vector<typename std::vector<SeedT>::iterator> &referenceSeedBounds,
+void MatchFinder<KmerT>::matchMaskTask(
     const bool findNeighbors,
     const bool finalPass,
-    typename KmerSourceMetadataList::const_iterator &kmerSourceIterator,
+    const unsigned taskIndex,
     const unsigned threadNumber)
 {
-    boost::lock_guard<boost::mutex> lock(mutex_);
-    while (kmerSourceIterator < kmerSourceMetadataList_.end() && referenceSeedBounds.back() != seedsBegin)
-    {
-        typename KmerSourceMetadataList::const_iterator ourKmerSource = kmerSourceIterator++;
-        const unsigned currentMask = ourKmerSource->mask_;
+    const MaskTask &task = maskTasks_.at(taskIndex);
+    const KmerSourceMetadata &kmerSource = *task.kmerSource_;
 
-        const typename std::vector<SeedT>::const_iterator ourBegin(seedsBegin);
-        const typename std::vector<SeedT>::const_iterator seedsEnd(referenceSeedBounds.at(ourKmerSource->referenceIndex_));
-
-        // on the final pass make sure the n-seeds of the open reads get their
-        // nomatches stored. Else Match selector stats will report incorrect total cluster count
-        std::pair<typename std::vector<SeedT>::const_iterator, typename std::vector<SeedT>::const_iterator> ourEndNextBegin =
-            skipToTheNextMask(ourBegin, seedsEnd, currentMask, ourKmerSource->maskWidth_, finalPass);
-        seedsBegin = ourEndNextBegin.second;
+    // on the final pass make sure the n-seeds of the open reads get their
+    // nomatches stored. Else Match selector stats will report incorrect total cluster count
+    if (finalPass)
+    {
+        // generate no-match entries for N-containing seeds or else the match selector statistics will never see those clusters
+        BOOST_FOREACH(const SeedT &seed, std::make_pair(task.nSeedsBegin_, task.nextBegin_))
+        {
+            // N-seeds don't have a valid seed index. seedMetadataList_[seed.getSeedIndex()] is invalid
+            threadMatchWriters_[threadNumber].write(seed.getSeedId(), reference::ReferencePosition(reference::ReferencePosition::NoMatch));
+        }
+    }
 
-        const boost::filesystem::path &sortedReferencePath = ourKmerSource->maskFilePath_;
+    if (findNeighbors)
+    {
+        const boost::filesystem::path &sortedReferencePath = kmerSource.maskFilePath_;
         std::istream threadReferenceFile(threadReferenceFileBuffers_.at(threadNumber).get(sortedReferencePath, io::FileBufWithReopen::SequentialOften));
 
+        matchFinder::NeighborMaskMatcher<KmerT>(
+            ignoreRepeats_,
+            repeatThreshold_,  neighborhoodSizeThreshold_,
+            seedMetadataList_,
+            referenceContigKaryotypes_.at(kmerSource.referenceIndex_),
+            foundExactMatchesOnly_).matchNeighborsMask(
+                task.begin_, task.nSeedsBegin_, kmerSource.mask_,
+                threadMatchDistributions_[threadNumber],
+                threadRepeatLists_[threadNumber],
+                threadNeighborsLists_[threadNumber],
+                threadMatchWriters_[threadNumber],
+                threadReferenceFile);
+        if(!threadReferenceFile && !threadReferenceFile.eof())
         {
-            common::unlock_guard<boost::mutex> unlock(mutex_);
-
-            if (findNeighbors)
-            {
-                matchFinder::NeighborMaskMatcher<KmerT>(
-                    ignoreRepeats_,
-                    repeatThreshold_,  neighborhoodSizeThreshold_,
-                    seedMetadataList_,
-                    referenceContigKaryotypes_.at(ourKmerSource->referenceIndex_),
-                    foundExactMatchesOnly_).matchNeighborsMask(
-                        ourBegin, ourEndNextBegin.first, currentMask,
-                        threadMatchDistributions_[threadNumber],
-                        threadRepeatLists_[threadNumber],
-                        threadNeighborsLists_[threadNumber],
-                        matchWriter_,
-                        threadReferenceFile);
-            }
-            else
-            {
-                matchFinder::ExactMaskMatcher<KmerT>(
-                    1 == iteration_, finalPass,
-                    repeatThreshold_,
-                    ignoreNeighbors_, seedMetadataList_,
-                    referenceContigKaryotypes_.at(ourKmerSource->referenceIndex_),
-                    foundExactMatchesOnly_).matchMask(
-                        ourBegin, ourEndNextBegin.first, currentMask,
-                        threadMatchDistributions_[threadNumber],
-                        threadRepeatLists_[threadNumber],
-                        matchWriter_,
-                        threadReferenceFile);
-            }
-            if(!threadReferenceFile && !threadReferenceFile.eof())
-            {
-                BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to read reference from " + sortedReferencePath.string()));
-            }
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to read reference from " + sortedReferencePath.string()));
         }
     }
+    else
+    {
+        matchExactMask(task.begin_, task.nSeedsBegin_, finalPass,
+                       task.kmerSource_ - kmerSourceMetadataList_.begin(), threadNumber);
+    }
+}
+
+template <typename KmerT>
+void MatchFinder<KmerT>::matchExactMask(
+    const typename std::vector<SeedT>::const_iterator seedsBegin,
+    const typename std::vector<SeedT>::const_iterator seedsEnd,
+    const bool finalPass,
+    const unsigned kmerSourceIndex,
+    const unsigned threadNumber)
+{
+    const KmerSourceMetadata &kmerSource = kmerSourceMetadataList_.at(kmerSourceIndex);
+    const boost::iostreams::mapped_file_source &mappedMask = maskMappings_.at(kmerSourceIndex);
+    const ReferenceKmer *referenceBegin = reinterpret_cast<const ReferenceKmer *>(mappedMask.data());
+    const std::size_t referenceKmers = mappedMask.size() / sizeof(ReferenceKmer);
+
+    matchFinder::ExactMaskMatcher<KmerT>(
+        1 == iteration_, finalPass,
+        repeatThreshold_,
+        ignoreNeighbors_, seedMetadataList_,
+        referenceContigKaryotypes_.at(kmerSource.referenceIndex_),
+        foundExactMatchesOnly_).matchMask(
+            seedsBegin, seedsEnd, kmerSource.mask_,
+            threadMatchDistributions_[threadNumber],
+            threadRepeatLists_[threadNumber],
+            threadMatchWriters_[threadNumber],
+            referenceBegin, referenceBegin + referenceKmers,
+            maskJumpTables_.at(kmerSourceIndex));
 }
 
 template class MatchFinder<oligo::ShortKmerType>;
@@ -32,8 +32,9 @@
 #include "common/Debug.hh"
 #include "common/Exceptions.hh"
 #include "common/FastIo.hh"
+#include "common/Numa.hh"
 #include "reference/Contig.hh"
-#include "reference/ContigLoader.hh"
+#include "reference/ContigCache.hh"
 
 #include "alignment/matchSelector/MatchSelectorStatsXml.hh"
 
@@ -94,6 +95,7 @@ MatchSelector::MatchSelector(
         const MatchDistribution &matchDistribution,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
         const unsigned int maxThreadCount,
+        const unsigned batchTilesMax,
         const TileMetadataList &tileMetadataList,
         const flowcell::BarcodeMetadataList &barcodeMetadataList,
         const flowcell::FlowcellLayoutList &flowcellLayoutList,
@@ -119,6 +121,7 @@ MatchSelector::MatchSelector(
         const TemplateBuilder::DodgyAlignmentScore dodgyAlignmentScore
     )
     : computeThreads_(maxThreadCount),
+      batchTilesMax_(batchTilesMax),
       tileMetadataList_(tileMetadataList),
       barcodeMetadataList_(barcodeMetadataList),
       flowcellLayoutList_(flowcellLayoutList),
@@ -133,9 +136,9 @@ MatchSelector::MatchSelector(
       clipOverlapping_(clipOverlapping),
       barcodeSequencingAdapters_(generateSequencingAdapters(barcodeMetadataList_)),
       allStats_(tileMetadataList_.size(), matchSelector::MatchSelectorStats(barcodeMetadataList_)),
-      threadStats_(computeThreads_.size(), matchSelector::MatchSelectorStats(barcodeMetadataList_)),
+      threadStats_(computeThreads_.size() * batchTilesMax_, matchSelector::MatchSelectorStats(barcodeMetadataList_)),
       matchDistribution_(matchDistribution),
-      contigList_(reference::loadContigs(sortedReferenceMetadataList, MatchDistributionContigFilter(matchDistribution_), computeThreads_)),
+      contigList_(reference::ContigCache::get(sortedReferenceMetadataList, MatchDistributionContigFilter(matchDistribution_), computeThreads_, true)),
       fragmentStorage_(fragmentStorage),
       threadCluster_(computeThreads_.size(),
                      Cluster(flowcell::getMaxReadLength(flowcellLayoutList_) +
@@ -145,6 +148,9 @@ MatchSelector::MatchSelector(
       threadOverlappingEndsClippers_(computeThreads_.size()),
       templateLengthDistribution_(mateDriftRange)
 {
+    // spread the compute threads evenly across the nodes so that the memory they allocate for each tile stays local
+    computeThreads_.execute(boost::bind(&common::bindToNumaNode, _1, false));
+
     while(threadTemplateBuilders_.size() < computeThreads_.size())
     {
         threadTemplateBuilders_.push_back(new TemplateBuilder(flowcellLayoutList_,
@@ -163,6 +169,7 @@ MatchSelector::MatchSelector(
     }
 
     templateLengthDistribution_.reserve(flowcell::getMaxTileClusters(tileMetadataList_));
+    batchSegments_.reserve(batchTilesMax_ * barcodeMetadataList_.size());
 
     ISAAC_THREAD_CERR << "Constructed the match selector" << std::endl;
 }
@@ -263,12 +270,12 @@ void MatchSelector::processMatchList(
     const flowcell::TileMetadata & tileMetadata,
     const BclClusters &bclData,
     const TemplateLengthStatistics & templateLengthStatistics,
+    matchSelector::MatchSelectorStats &ourThreadStats,
     const unsigned threadNumber)
 {
 
     Cluster &ourThreadCluster = threadCluster_[threadNumber];
     TemplateBuilder &ourThreadTemplateBuilder = threadTemplateBuilders_.at(threadNumber);
-    matchSelector::MatchSelectorStats &ourThreadStats = threadStats_.at(threadNumber);
     BamTemplate &ourThreadBamTemplate = ourThreadTemplateBuilder.getBamTemplate();
 
     const flowcell::Layout &flowcell = flowcellLayoutList_.at(tileMetadata.getFlowcellIndex());
@@ -367,78 +374,102 @@ void MatchSelector::processMatchList(
     }
 }
 
+void MatchSelector::processBatch(const unsigned threadNumber)
+{
+    BOOST_FOREACH(const BatchSegment &segment, batchSegments_)
+    {
+        processMatchList(*segment.barcodeContigList_, segment.restOfGenomeCorrection_, *segment.sequencingAdapters_,
+                         std::make_pair(segment.matchListBegin_, segment.matchListEnd_),
+                         *segment.tile_.tileMetadata_, *segment.tile_.bclData_, segment.templateLengthStatistics_,
+                         threadStats_[segment.batchTileIndex_ * computeThreads_.size() + threadNumber],
+                         threadNumber);
+    }
+}
+
 void MatchSelector::parallelSelect(
     const MatchTally &matchTally,
     std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics,
-    const flowcell::TileMetadata &tileMetadata,
-    std::vector<Match> &matchList,
-    const BclClusters &bclData)
+    const Batch &batch)
 {
-    std::for_each(threadStats_.begin(), threadStats_.end(), boost::bind(&matchSelector::MatchSelectorStats::reset, _1));
-
-    ISAAC_THREAD_CERR << "Resizing fragment storage for " <<  tileMetadata.getClusterCount() << " clusters " << std::endl;
-    fragmentStorage_.resize(tileMetadata.getClusterCount());
-    ISAAC_THREAD_CERR << "Resizing fragment storage done for " <<  tileMetadata.getClusterCount() << " clusters " << std::endl;
+    ISAAC_ASSERT_MSG(batch.size() <= batchTilesMax_, "Too many tiles in the batch: " << batch.size() << " allowed: " << batchTilesMax_);
+    std::for_each(threadStats_.begin(), threadStats_.begin() + batch.size() * computeThreads_.size(),
+                  boost::bind(&matchSelector::MatchSelectorStats::reset, _1));
 
-    const MatchTally::FileTallyList &fileTallyList = matchTally.getFileTallyList(tileMetadata);
-    std::vector<Match>::const_iterator barcodeMatchListBegin = matchList.begin();
-    BOOST_FOREACH(const flowcell::BarcodeMetadata &barcode, barcodeMetadataList_)
+    batchSegments_.clear();
+    BOOST_FOREACH(const BatchTile &tile, batch)
     {
-        const unsigned long tileBarcodeMatchCount = std::accumulate(
-            fileTallyList.begin(), fileTallyList.end(), 0UL,
-            bind(std::plus<unsigned long>(),
-                 _1,
-                 boost::bind<unsigned long>(&MatchTally::FileTally::getBarcodeMatchCount, _2, barcode.getIndex())));
+        const unsigned batchTileIndex = &tile - &batch.front();
+        const flowcell::TileMetadata &tileMetadata = *tile.tileMetadata_;
+
+        ISAAC_THREAD_CERR << "Resizing fragment storage for " <<  tileMetadata.getClusterCount() << " clusters " << std::endl;
+        fragmentStorage_.appendTile(tileMetadata);
+        ISAAC_THREAD_CERR << "Resizing fragment storage done for " <<  tileMetadata.getClusterCount() << " clusters " << std::endl;
 
-        if (tileBarcodeMatchCount)
+        const MatchTally::FileTallyList &fileTallyList = matchTally.getFileTallyList(tileMetadata);
+        std::vector<Match>::const_iterator barcodeMatchListBegin = tile.matchList_->begin();
+        BOOST_FOREACH(const flowcell::BarcodeMetadata &barcode, barcodeMetadataList_)
         {
-            // we could do determineTemplateLength on multiple threads. The current assumption is that
-            // doing it just before using gives some memory cache efficiency benefit which compensates for
-            // the absence of parallelization. RP: looks like a wrong assumption though...
-            const std::vector<reference::Contig> &barcodeContigList = contigList_.at(barcode.getReferenceIndex());
-            const flowcell::ReadMetadataList &tileReads = flowcellLayoutList_.at(tileMetadata.getFlowcellIndex()).getReadMetadataList();
-            const RestOfGenomeCorrection restOfGenomeCorrection(barcodeContigList, tileReads);
-            TemplateLengthStatistics &templateLengthStatistics = barcodeTemplateLengthStatistics.at(barcode.getIndex());
-            if (!templateLengthStatistics.isStable() || perTileTls_)
+            const unsigned long tileBarcodeMatchCount = std::accumulate(
+                fileTallyList.begin(), fileTallyList.end(), 0UL,
+                bind(std::plus<unsigned long>(),
+                     _1,
+                     boost::bind<unsigned long>(&MatchTally::FileTally::getBarcodeMatchCount, _2, barcode.getIndex())));
+
+            if (tileBarcodeMatchCount)
             {
-                ISAAC_THREAD_CERR << "Determining template length for " << tileMetadata << ", " << barcode  << " on " << tileBarcodeMatchCount << " matches." << std::endl;
+                // we could do determineTemplateLength on multiple threads. The current assumption is that
+                // doing it just before using gives some memory cache efficiency benefit which compensates for
+                // the absence of parallelization. RP: looks like a wrong assumption though...
+                const std::vector<reference::Contig> &barcodeContigList = contigList_->at(barcode.getReferenceIndex());
+                const flowcell::ReadMetadataList &tileReads = flowcellLayoutList_.at(tileMetadata.getFlowcellIndex()).getReadMetadataList();
+                TemplateLengthStatistics &templateLengthStatistics = barcodeTemplateLengthStatistics.at(barcode.getIndex());
+                if (!templateLengthStatistics.isStable() || perTileTls_)
+                {
+                    ISAAC_THREAD_CERR << "Determining template length for " << tileMetadata << ", " << barcode  << " on " << tileBarcodeMatchCount << " matches." << std::endl;
 
-                templateLengthStatistics =
-                    determineTemplateLength(
-                        tileMetadata, barcodeContigList, barcodeSequencingAdapters_.at(barcode.getIndex()),
-                        barcodeMatchListBegin, barcodeMatchListBegin + tileBarcodeMatchCount,
-                        bclData, 0);
+                    templateLengthStatistics =
+                        determineTemplateLength(
+                            tileMetadata, barcodeContigList, barcodeSequencingAdapters_.at(barcode.getIndex()),
+                            barcodeMatchListBegin, barcodeMatchListBegin + tileBarcodeMatchCount,
+                            *tile.bclData_, 0);
 
-                ISAAC_THREAD_CERR << "Determining template length done for " << tileMetadata << ", " << barcode << ":" << templateLengthStatistics << std::endl;
-            }
-            else
-            {
-                ISAAC_THREAD_CERR << "Using known template length for " << tileMetadata << ", " << barcode  << " on " << tileBarcodeMatchCount << " matches: " << templateLengthStatistics << std::endl;
-            }
+                    ISAAC_THREAD_CERR << "Determining template length done for " << tileMetadata << ", " << barcode << ":" << templateLengthStatistics << std::endl;
+                }
+                else
+                {
+                    ISAAC_THREAD_CERR << "Using known template length for " << tileMetadata << ", " << barcode  << " on " << tileBarcodeMatchCount << " matches: " << templateLengthStatistics << std::endl;
+                }
 
-            threadStats_[0].recordTemplateLengthStatistics(barcode, templateLengthStatistics);
+                threadStats_[batchTileIndex * computeThreads_.size()].recordTemplateLengthStatistics(barcode, templateLengthStatistics);
 
-            ISAAC_THREAD_CERR << "Selecting matches on " <<  computeThreads_.size() << " threads for " <<
-                tileMetadata << "," << barcode << std::endl;
-            computeThreads_.execute(boost::bind(&MatchSelector::processMatchList, this,
-                                                boost::ref(barcodeContigList),
-                                                boost::ref(restOfGenomeCorrection),
-                                                boost::ref(barcodeSequencingAdapters_.at(barcode.getIndex())),
-                                                std::make_pair(barcodeMatchListBegin, barcodeMatchListBegin + tileBarcodeMatchCount),
-                                                boost::ref(tileMetadata), boost::ref(bclData),
-                                                boost::cref(templateLengthStatistics), _1));
+                batchSegments_.push_back(
+                    BatchSegment(batchTileIndex, tile, barcodeContigList,
+                                 RestOfGenomeCorrection(barcodeContigList, tileReads),
+                                 barcodeSequencingAdapters_.at(barcode.getIndex()),
+                                 barcodeMatchListBegin, barcodeMatchListBegin + tileBarcodeMatchCount,
+                                 templateLengthStatistics));
+            }
 
-            ISAAC_THREAD_CERR << "Selecting matches done on " <<  computeThreads_.size() << " threads for " <<
-                tileMetadata  << "," << barcode << std::endl;
+            barcodeMatchListBegin += tileBarcodeMatchCount;
         }
-
-        barcodeMatchListBegin += tileBarcodeMatchCount;
+        ISAAC_ASSERT_MSG(tile.matchList_->end() == barcodeMatchListBegin, "Expected to reach the end of the tile match list");
     }
-    ISAAC_ASSERT_MSG(matchList.end() == barcodeMatchListBegin, "Expected to reach the end of the tile match list");
 
-    BOOST_FOREACH(const matchSelector::MatchSelectorStats &threadStats, threadStats_)
+    // one synchronization point for all tiles and barcodes in the batch. Small tiles would otherwise leave
+    // most of the compute threads idle waiting for the slowest one
+    ISAAC_THREAD_CERR << "Selecting matches on " <<  computeThreads_.size() << " threads for " <<
+        batch.size() << " tiles" << std::endl;
+    computeThreads_.execute(boost::bind(&MatchSelector::processBatch, this, _1));
+    ISAAC_THREAD_CERR << "Selecting matches done on " <<  computeThreads_.size() << " threads for " <<
+        batch.size() << " tiles" << std::endl;
+
+    BOOST_FOREACH(const BatchTile &tile, batch)
     {
-        allStats_.at(tileMetadata.getIndex()) += threadStats;
+        const unsigned batchTileIndex = &tile - &batch.front();
+        for (unsigned threadNumber = 0; computeThreads_.size() > threadNumber; ++threadNumber)
+        {
+            allStats_.at(tile.tileMetadata_->getIndex()) += threadStats_[batchTileIndex * computeThreads_.size() + threadNumber];
+        }
     }
 }
 
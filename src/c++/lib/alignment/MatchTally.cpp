@@ -89,5 +89,14 @@ void MatchTally::operator()(const unsigned iteration, const unsigned tileIndex,
     ++ft.barcodeTally_.at(barcodeIndex);
 }
 
+void MatchTally::operator()(
+    const unsigned iteration, const unsigned tileIndex, const unsigned barcodeIndex, const unsigned long matchCount)
+{
+    FileTally &ft = allTallies_.at(tileIndex).at(iteration);
+    assert(!ft.path_.empty());
+    ft.matchCount_ += matchCount;
+    ft.barcodeTally_.at(barcodeIndex) += matchCount;
+}
+
 } // namespace alignemnt
 } // namespace isaac
@@ -47,6 +47,8 @@ void Read::decodeBcl(
 //    quality_.reserve(readLength);
     forwardQuality_.clear();
     reverseQuality_.clear();
+    forwardPacked_.clear();
+    reversePacked_.clear();
     /*beginCyclesMasked_ = 0L;*/
     endCyclesMasked_ = 0L;
 
@@ -56,6 +58,7 @@ void Read::decodeBcl(
         if (!oligo::isBclN(*bcl))
         {
             forwardSequence_.push_back(oligo::getBase((*bcl) & 3, true));
+            forwardPacked_.push_back((*bcl) & 3);
             reverseSequence_.push_back(oligo::getBase((~(*bcl)) & 3, true));
             forwardQuality_.push_back(((unsigned char)*bcl) >> 2);
             reverseQuality_.push_back(((unsigned char)*bcl) >> 2);
@@ -63,6 +66,7 @@ void Read::decodeBcl(
         else
         {
             forwardSequence_.push_back('n'); // so that it mismatches with 'N' in the reference
+            forwardPacked_.push_back(oligo::invalidOligo);
             reverseSequence_.push_back('n'); // so that it mismatches with 'N' in the reference
             forwardQuality_.push_back(2);
             reverseQuality_.push_back(2);
@@ -70,6 +74,7 @@ void Read::decodeBcl(
     }
     std::reverse(reverseSequence_.begin(), reverseSequence_.end());
     std::reverse(reverseQuality_.begin(), reverseQuality_.end());
+    reversePacked_.assign(reverseSequence_.begin(), reverseSequence_.end());
 }
 
 std::ostream &operator<<(std::ostream &os, const Read &read)
@@ -29,7 +29,7 @@
 
 #include "alignment/SeedGeneratorBase.hh"
 #include "common/Debug.hh"
-#include "common/ParallelSort.hpp"
+#include "common/RadixSort.hpp"
 #include "common/SystemCompatibility.hh"
 
 namespace isaac
@@ -86,7 +86,8 @@ void SeedGeneratorBase<KmerT>::sortSeeds(
         {
             common::ScoopedMallocBlockUnblock unblock(mallocBlock);
             // comparing the full kmer is required to push the N-seeds off to the very end.
-            common::parallelSort(referenceSeedsBegin, referenceSeedsEnd, &alignment::orderByKmerSeedIndex<KmerT>, threads, threadsMax);
+            common::radixSort(referenceSeedsBegin, referenceSeedsEnd, alignment::SeedRadixDigits<KmerT>(), threads, threadsMax,
+                              std::distance(referenceSeedsBegin, referenceSeedsEnd) / alignment::SeedRadixDigits<KmerT>::SCRATCH_DIVISOR);
         }
         ISAAC_THREAD_CERR << "Sorting " << referenceSeedsEnd - referenceSeedsBegin << " seeds done in " << (clock() - startSort) / 1000 << "ms" << std::endl;
         referenceSeedsBegin = referenceSeedsEnd;
@@ -23,6 +23,7 @@
 
 #include "alignment/SeedMemoryManager.hh"
 #include "common/Debug.hh"
+#include "common/Numa.hh"
 
 namespace isaac
 {
@@ -34,11 +35,13 @@ SeedMemoryManager<KmerT>::SeedMemoryManager(
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
     const ReadMetadataList &readMetadataList,
     const SeedMetadataList &seedMetadataList,
-    const flowcell::TileMetadataList &allTiles
+    const flowcell::TileMetadataList &allTiles,
+    const bool inMemoryMatches
     )
     : barcodeMetadataList_(barcodeMetadataList)
     , readMetadataList_(readMetadataList)
     , seedMetadataList_(seedMetadataList)
+    , inMemoryMatches_(inMemoryMatches)
     , notFoundMatchesCount_()
 
 {
@@ -51,8 +54,12 @@ bool SeedMemoryManager<KmerT>::seeIfFits(const TileMetadataList &tiles) const
 {
     try
     {
+        const unsigned long seedCount = getTotalSeedCount(tiles);
         std::vector<SeedT> test;
-        test.reserve(getTotalSeedCount(tiles));
+        test.reserve(seedCount);
+        // Expect a match for one of the two orientations of each seed. The arena vectors grow by doubling.
+        std::vector<Match> testMatches;
+        testMatches.reserve(inMemoryMatches_ ? seedCount : 0);
         return true;
     }
     catch (std::bad_alloc &e)
@@ -180,7 +187,11 @@ void SeedMemoryManager<KmerT>::allocate(const TileMetadataList &tiles, std::vect
                       << seedMetadataList_.size() << " seeds)" << std::endl;
 
     seeds.clear();
-    seeds.resize(totalSeedCount);
+    {
+        // the seeds are sorted and matched by the threads of all nodes
+        const common::ScopedNumaInterleave interleave;
+        seeds.resize(totalSeedCount);
+    }
 
     ISAAC_THREAD_CERR << "Allocating storage done for "
                       << totalSeedCount
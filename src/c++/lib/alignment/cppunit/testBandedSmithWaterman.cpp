@@ -223,3 +223,51 @@ void TestBandedSmithWaterman::testOverflow()
     CPPUNIT_ASSERT_THROW(isaac::alignment::BandedSmithWaterman(2, -1, 17, 3, 3681), isaac::common::InvalidParameterException);
     CPPUNIT_ASSERT_THROW(isaac::alignment::BandedSmithWaterman(2, -1, 11, 3, 13681), isaac::common::InvalidParameterException);
 }
+
+void TestBandedSmithWaterman::testImplementations()
+{
+    using isaac::alignment::BandedSmithWaterman;
+    const BandedSmithWaterman scalar(2, -1, 15, 3, 300, BandedSmithWaterman::Scalar);
+    std::vector<BandedSmithWaterman::Implementation> implementations;
+    implementations.push_back(BandedSmithWaterman::Sse2);
+    if (BandedSmithWaterman::isSupported(BandedSmithWaterman::Avx2))
+    {
+        implementations.push_back(BandedSmithWaterman::Avx2);
+    }
+
+    BOOST_FOREACH(const BandedSmithWaterman::Implementation implementation, implementations)
+    {
+        const BandedSmithWaterman vectorized(2, -1, 15, 3, 300, implementation);
+        for (unsigned test = 0; 1000 > test; ++test)
+        {
+            const unsigned queryLength = 30 + rand() % 120;
+            const std::vector<char> database = subv(genome, rand() % (genome.size() - queryLength - 30), queryLength + 15);
+            // mutate the query with a few mismatches and indels to exercise all three matrices
+            std::vector<char> query;
+            std::size_t position = rand() % 16;
+            while (query.size() < queryLength)
+            {
+                const unsigned dice = rand() % 100;
+                if (2 > dice)
+                {
+                    ++position;
+                }
+                else if (4 > dice)
+                {
+                    query.push_back('T');
+                }
+                else
+                {
+                    query.push_back(database.size() > position && 97 > dice ? database[position] : 'A');
+                    ++position;
+                }
+            }
+            isaac::alignment::Cigar expected;
+            isaac::alignment::Cigar actual;
+            const unsigned expectedOffset = scalar.align(query, database.begin(), database.end(), expected);
+            const unsigned actualOffset = vectorized.align(query, database.begin(), database.end(), actual);
+            CPPUNIT_ASSERT_EQUAL(expected.toString(), actual.toString());
+            CPPUNIT_ASSERT_EQUAL(expectedOffset, actualOffset);
+        }
+    }
+}
@@ -30,6 +30,7 @@ class TestBandedSmithWaterman : public CppUnit::TestFixture
     CPPUNIT_TEST( testSingleDeletion );
     CPPUNIT_TEST( testMultipleIndels );
     CPPUNIT_TEST( testOverflow );
+    CPPUNIT_TEST( testImplementations );
     CPPUNIT_TEST_SUITE_END();
 private:
     const isaac::alignment::BandedSmithWaterman bsw;
@@ -44,6 +45,7 @@ public:
     void testSingleDeletion();
     void testMultipleIndels();
     void testOverflow();
+    void testImplementations();
 };
 
 #endif // #ifndef iSAAC_ALIGNMENT_TEST_BANDED_SMITH_WATERMAN_HH
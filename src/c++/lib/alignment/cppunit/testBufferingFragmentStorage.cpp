@@ -0,0 +1,243 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <string>
+
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testBufferingFragmentStorage.hh"
+#include "BuilderInit.hh"
+#include "alignment/Cigar.hh"
+#include "alignment/matchSelector/BinningFragmentStorage.hh"
+#include "io/Fragment.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestBufferingFragmentStorage, registryName("BufferingFragmentStorage"));
+
+static const unsigned READ_LENGTH = 100;
+static const unsigned TILE_CLUSTERS = 1000;
+// match distribution bins of the single contig. Three of them fit in an output bin
+static const unsigned DISTRIBUTION_BINS = 10;
+static const unsigned DISTRIBUTION_BIN_COUNT = 30;
+static const unsigned long OUTPUT_BIN_SIZE = 100;
+
+static std::vector<char> getBclData(const unsigned length)
+{
+    std::vector<char> ret;
+    ret.reserve(length);
+    while (ret.size() < length)
+    {
+        ret.push_back((30 << 2) | (ret.size() % 4));
+    }
+    return ret;
+}
+
+TestBufferingFragmentStorage::TestBufferingFragmentStorage()
+    : readMetadataList_(getReadMetadataList(READ_LENGTH, READ_LENGTH))
+    , flowcells_(1, isaac::flowcell::Layout("", isaac::flowcell::Layout::Fastq, false, 8, std::vector<unsigned>(),
+                                            readMetadataList_, isaac::alignment::SeedMetadataList(), "blah"))
+    , barcodeMetadataList_(1)
+    , cigarBuffer_(1, isaac::alignment::Cigar::encode(READ_LENGTH, isaac::alignment::Cigar::ALIGN))
+    , bcl_(getBclData(READ_LENGTH * 2))
+    , matchDistribution_()
+{
+    matchDistribution_.push_back(std::vector<unsigned>(DISTRIBUTION_BINS, DISTRIBUTION_BIN_COUNT));
+}
+
+void TestBufferingFragmentStorage::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testBufferingFragmentStorage-%%%%-%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+}
+
+void TestBufferingFragmentStorage::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+/**
+ * \brief Stores alignedPairs proper pairs spread over the contig followed by unalignedPairs no-match pairs
+ *        as one batch of a single tile.
+ */
+void TestBufferingFragmentStorage::storeBatch(
+    isaac::alignment::matchSelector::BufferingFragmentStorage &storage,
+    const unsigned tileIndex,
+    const unsigned alignedPairs,
+    const unsigned unalignedPairs)
+{
+    using isaac::alignment::BamTemplate;
+    using isaac::alignment::Cluster;
+    using isaac::alignment::FragmentMetadata;
+
+    storage.appendTile(isaac::flowcell::TileMetadata("blah", 0, 1101 + tileIndex, 1, TILE_CLUSTERS, tileIndex));
+
+    const unsigned long contigLength = matchDistribution_.getBinSize() * DISTRIBUTION_BINS;
+    Cluster cluster(READ_LENGTH);
+    for (unsigned clusterId = 0; alignedPairs + unalignedPairs > clusterId; ++clusterId)
+    {
+        cluster.init(readMetadataList_, bcl_.begin(), tileIndex, clusterId, isaac::alignment::ClusterXy(0, 0), true, 0);
+        BamTemplate bamTemplate(cigarBuffer_);
+        bamTemplate.initialize(readMetadataList_, cluster);
+        if (alignedPairs > clusterId)
+        {
+            const unsigned long position = (contigLength - READ_LENGTH * 3) * clusterId / alignedPairs;
+            for (unsigned readIndex = 0; 2 > readIndex; ++readIndex)
+            {
+                FragmentMetadata &fragment = bamTemplate.getFragmentMetadata(readIndex);
+                fragment.contigId = 0;
+                fragment.position = position + readIndex * READ_LENGTH * 2;
+                fragment.reverse = readIndex;
+                fragment.cigarOffset = 0;
+                fragment.cigarLength = cigarBuffer_.size();
+                fragment.observedLength = READ_LENGTH;
+                fragment.alignmentScore = 60;
+            }
+            bamTemplate.setAlignmentScore(120);
+            bamTemplate.setProperPair(true);
+        }
+        storage.add(bamTemplate, 0);
+    }
+
+    storage.prepareFlush();
+    storage.flush();
+}
+
+/**
+ * \brief Parses the bin data sequentially and checks that the fragment index holds one matching record
+ *        for each fragment, in the same order.
+ */
+void TestBufferingFragmentStorage::checkFragmentIndex(
+    const isaac::alignment::BinMetadata &bin,
+    const unsigned long expectedFragments)
+{
+    std::ifstream isData(bin.getPath().c_str(), std::ios_base::binary);
+    CPPUNIT_ASSERT(isData);
+    std::ifstream isIndex(bin.getFragmentIndexPath().c_str(), std::ios_base::binary);
+    CPPUNIT_ASSERT(isIndex);
+
+    unsigned long fragments = 0;
+    std::vector<char> fragmentData;
+    isaac::io::FragmentHeader header;
+    while (isData.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        fragmentData.resize(header.getDataLength());
+        CPPUNIT_ASSERT(isData.read(&fragmentData.front(), fragmentData.size()));
+
+        isaac::io::FragmentIndexRecord record;
+        CPPUNIT_ASSERT(isIndex.read(reinterpret_cast<char *>(&record), sizeof(record)));
+        CPPUNIT_ASSERT_EQUAL(header.fStrandPosition_, record.fStrandPosition_);
+        CPPUNIT_ASSERT_EQUAL(header.mateFStrandPosition_, record.mateFStrandPosition_);
+        CPPUNIT_ASSERT_EQUAL(header.getTotalLength(), record.totalLength_);
+        CPPUNIT_ASSERT_EQUAL(header.barcode_, record.barcode_);
+        CPPUNIT_ASSERT_EQUAL(header.flags_.paired_, record.flags_.paired_);
+        CPPUNIT_ASSERT_EQUAL(header.flags_.reverse_, record.flags_.reverse_);
+        CPPUNIT_ASSERT_EQUAL(header.mateStorageBin_, record.mateStorageBin_);
+        ++fragments;
+    }
+    CPPUNIT_ASSERT(isData.eof());
+    CPPUNIT_ASSERT_EQUAL(expectedFragments, fragments);
+
+    isaac::io::FragmentIndexRecord record;
+    CPPUNIT_ASSERT(!isIndex.read(reinterpret_cast<char *>(&record), sizeof(record)));
+}
+
+void TestBufferingFragmentStorage::testFragmentIndex()
+{
+    using isaac::alignment::BinMetadata;
+    isaac::alignment::matchSelector::BufferingFragmentStorage storage(
+        true, false, 1, 1, matchDistribution_, OUTPUT_BIN_SIZE, tempDirectory_, flowcells_, barcodeMetadataList_,
+        TILE_CLUSTERS, TILE_CLUSTERS, 1, false);
+
+    storeBatch(storage, 0, 40, 5);
+    isaac::alignment::BinMetadataList bins;
+    storage.close(bins);
+
+    CPPUNIT_ASSERT_EQUAL(5UL, bins.size());
+    // unaligned bin is never indexed
+    CPPUNIT_ASSERT(bins.front().isUnalignedBin());
+    CPPUNIT_ASSERT_EQUAL(10UL, bins.front().getTotalElements());
+    CPPUNIT_ASSERT(boost::filesystem::exists(bins.front().getPath()));
+    CPPUNIT_ASSERT(!boost::filesystem::exists(bins.front().getFragmentIndexPath()));
+
+    unsigned long alignedFragments = 0;
+    BOOST_FOREACH(const BinMetadata &bin, std::make_pair(bins.begin() + 1, bins.end()))
+    {
+        CPPUNIT_ASSERT(!bin.isEmpty());
+        checkFragmentIndex(bin, bin.getTotalElements());
+        CPPUNIT_ASSERT_EQUAL(bin.getTotalElements() * sizeof(isaac::io::FragmentIndexRecord),
+                             static_cast<unsigned long>(boost::filesystem::file_size(bin.getFragmentIndexPath())));
+        alignedFragments += bin.getTotalElements();
+    }
+    CPPUNIT_ASSERT_EQUAL(80UL, alignedFragments);
+}
+
+void TestBufferingFragmentStorage::testFragmentIndexAppend()
+{
+    using isaac::alignment::BinMetadata;
+    isaac::alignment::matchSelector::BufferingFragmentStorage storage(
+        true, false, 1, 1, matchDistribution_, OUTPUT_BIN_SIZE, tempDirectory_, flowcells_, barcodeMetadataList_,
+        TILE_CLUSTERS, TILE_CLUSTERS, 2, false);
+
+    storeBatch(storage, 0, 40, 0);
+    storeBatch(storage, 1, 20, 3);
+    isaac::alignment::BinMetadataList bins;
+    storage.close(bins);
+
+    CPPUNIT_ASSERT(!boost::filesystem::exists(bins.front().getFragmentIndexPath()));
+    unsigned long alignedFragments = 0;
+    BOOST_FOREACH(const BinMetadata &bin, std::make_pair(bins.begin() + 1, bins.end()))
+    {
+        checkFragmentIndex(bin, bin.getTotalElements());
+        alignedFragments += bin.getTotalElements();
+    }
+    CPPUNIT_ASSERT_EQUAL(120UL, alignedFragments);
+}
+
+static unsigned countFiles(const boost::filesystem::path &directory, const std::string &extension)
+{
+    unsigned ret = 0;
+    for (boost::filesystem::directory_iterator it(directory); boost::filesystem::directory_iterator() != it; ++it)
+    {
+        ret += extension == it->path().extension().string();
+    }
+    return ret;
+}
+
+void TestBufferingFragmentStorage::testStaleIndexRemoved()
+{
+    {
+        isaac::alignment::matchSelector::BinningFragmentStorage storage(
+            true, false, 1, 1, matchDistribution_, OUTPUT_BIN_SIZE, tempDirectory_, flowcells_, barcodeMetadataList_,
+            TILE_CLUSTERS, 1);
+    }
+    const unsigned binFiles = countFiles(tempDirectory_, ".dat");
+    CPPUNIT_ASSERT(binFiles);
+    CPPUNIT_ASSERT_EQUAL(0U, countFiles(tempDirectory_, ".idx"));
+
+    // pretend an earlier run left an index next to each bin
+    for (boost::filesystem::directory_iterator it(tempDirectory_); boost::filesystem::directory_iterator() != it; ++it)
+    {
+        std::ofstream os((it->path().string() + ".idx").c_str(), std::ios_base::binary);
+        os << "stale";
+    }
+    CPPUNIT_ASSERT_EQUAL(binFiles, countFiles(tempDirectory_, ".idx"));
+
+    isaac::alignment::matchSelector::BinningFragmentStorage storage(
+        true, false, 1, 1, matchDistribution_, OUTPUT_BIN_SIZE, tempDirectory_, flowcells_, barcodeMetadataList_,
+        TILE_CLUSTERS, 1);
+    CPPUNIT_ASSERT_EQUAL(binFiles, countFiles(tempDirectory_, ".dat"));
+    CPPUNIT_ASSERT_EQUAL(0U, countFiles(tempDirectory_, ".idx"));
+}
@@ -0,0 +1,59 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_ALIGNMENT_TEST_BUFFERING_FRAGMENT_STORAGE_HH
+#define iSAAC_ALIGNMENT_TEST_BUFFERING_FRAGMENT_STORAGE_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include "alignment/BinMetadata.hh"
+#include "alignment/matchSelector/BufferingFragmentStorage.hh"
+
+class TestBufferingFragmentStorage : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestBufferingFragmentStorage );
+    CPPUNIT_TEST( testFragmentIndex );
+    CPPUNIT_TEST( testFragmentIndexAppend );
+    CPPUNIT_TEST( testStaleIndexRemoved );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    const isaac::flowcell::ReadMetadataList readMetadataList_;
+    const isaac::flowcell::FlowcellLayoutList flowcells_;
+    const isaac::flowcell::BarcodeMetadataList barcodeMetadataList_;
+    const std::vector<unsigned> cigarBuffer_;
+    const std::vector<char> bcl_;
+    isaac::alignment::MatchDistribution matchDistribution_;
+    boost::filesystem::path tempDirectory_;
+
+    void storeBatch(
+        isaac::alignment::matchSelector::BufferingFragmentStorage &storage,
+        const unsigned tileIndex,
+        const unsigned alignedPairs,
+        const unsigned unalignedPairs);
+    void checkFragmentIndex(const isaac::alignment::BinMetadata &bin, const unsigned long expectedFragments);
+
+public:
+    TestBufferingFragmentStorage();
+    void setUp();
+    void tearDown();
+    void testFragmentIndex();
+    void testFragmentIndexAppend();
+    void testStaleIndexRemoved();
+};
+
+#endif // #ifndef iSAAC_ALIGNMENT_TEST_BUFFERING_FRAGMENT_STORAGE_HH
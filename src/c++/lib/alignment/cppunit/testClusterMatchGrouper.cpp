@@ -0,0 +1,93 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testClusterMatchGrouper.hh"
+
+#include "alignment/matchSelector/ClusterMatchGrouper.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestClusterMatchGrouper, registryName("ClusterMatchGrouper"));
+
+void TestClusterMatchGrouper::setUp()
+{
+    srand(0);
+}
+
+void TestClusterMatchGrouper::tearDown()
+{
+}
+
+static bool orderByBarcodeClusterLocation(const isaac::alignment::Match &lhs, const isaac::alignment::Match &rhs)
+{
+    return
+        lhs.seedId.getTileBarcodeCluster() < rhs.seedId.getTileBarcodeCluster() ||
+        (lhs.seedId.getTileBarcodeCluster() == rhs.seedId.getTileBarcodeCluster() &&
+            (lhs.location < rhs.location ||
+                (lhs.location == rhs.location && lhs.seedId.getSeed() < rhs.seedId.getSeed())));
+}
+
+void TestClusterMatchGrouper::checkGrouping(
+    const unsigned threads, const unsigned long tileClusters,
+    const unsigned barcodes, const unsigned maxClusterMatches)
+{
+    using isaac::alignment::Match;
+    using isaac::alignment::SeedId;
+    std::vector<Match> matches;
+    for (unsigned long cluster = 0; tileClusters > cluster; ++cluster)
+    {
+        const unsigned barcode = rand() % barcodes;
+        // some clusters get no matches at all
+        const unsigned clusterMatches = rand() % (maxClusterMatches + 1);
+        for (unsigned i = 0; clusterMatches > i; ++i)
+        {
+            matches.push_back(Match(SeedId(7, barcode, cluster, rand() % 4, rand() % 2),
+                                    isaac::reference::ReferencePosition(rand() % 3, rand() % 1000)));
+        }
+    }
+    std::random_shuffle(matches.begin(), matches.end());
+
+    std::vector<Match> expected = matches;
+    std::sort(expected.begin(), expected.end(), orderByBarcodeClusterLocation);
+
+    isaac::common::ThreadVector threadVector(threads);
+    isaac::alignment::matchSelector::ClusterMatchGrouper grouper(threadVector, tileClusters, barcodes);
+    grouper.group(tileClusters, matches);
+
+    CPPUNIT_ASSERT_EQUAL(expected.size(), matches.size());
+    for (std::size_t i = 0; expected.size() > i; ++i)
+    {
+        CPPUNIT_ASSERT_EQUAL(expected[i].seedId.getBarcode(), matches[i].seedId.getBarcode());
+        CPPUNIT_ASSERT_EQUAL(expected[i].seedId.getCluster(), matches[i].seedId.getCluster());
+        CPPUNIT_ASSERT_EQUAL(expected[i].seedId.getSeed(), matches[i].seedId.getSeed());
+        CPPUNIT_ASSERT_EQUAL(expected[i].location.getValue(), matches[i].location.getValue());
+    }
+}
+
+void TestClusterMatchGrouper::testFewMatches()
+{
+    checkGrouping(1, 100, 1, 5);
+    checkGrouping(4, 100, 3, 5);
+    checkGrouping(4, 1, 1, 0);
+}
+
+void TestClusterMatchGrouper::testManyMatches()
+{
+    // enough matches for the ranges to be split between threads
+    checkGrouping(4, 100000, 5, 10);
+    checkGrouping(3, 1000, 2, 2000);
+}
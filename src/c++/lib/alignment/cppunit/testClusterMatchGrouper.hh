@@ -0,0 +1,41 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_ALIGNMENT_TEST_CLUSTER_MATCH_GROUPER_HH
+#define iSAAC_ALIGNMENT_TEST_CLUSTER_MATCH_GROUPER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+
+#include "alignment/Match.hh"
+
+class TestClusterMatchGrouper : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestClusterMatchGrouper );
+    CPPUNIT_TEST( testFewMatches );
+    CPPUNIT_TEST( testManyMatches );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    void checkGrouping(
+        const unsigned threads, const unsigned long tileClusters,
+        const unsigned barcodes, const unsigned maxClusterMatches);
+public:
+    void setUp();
+    void tearDown();
+    void testFewMatches();
+    void testManyMatches();
+};
+
+#endif // #ifndef iSAAC_ALIGNMENT_TEST_CLUSTER_MATCH_GROUPER_HH
+
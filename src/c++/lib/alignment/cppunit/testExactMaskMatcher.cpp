@@ -0,0 +1,160 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testExactMaskMatcher.hh"
+
+#include "alignment/matchFinder/ExactMaskMatcher.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestExactMaskMatcher, registryName("ExactMaskMatcher"));
+
+typedef isaac::oligo::KmerType KmerType;
+typedef isaac::reference::ReferenceKmer<KmerType> ReferenceKmer;
+typedef isaac::reference::MaskJumpTable<KmerType> MaskJumpTable;
+typedef isaac::alignment::matchFinder::ExactMaskMatcher<KmerType> ExactMaskMatcher;
+static const unsigned MASK_WIDTH = 6;
+static const unsigned UNMASKED_BITS = isaac::oligo::KmerTraits<KmerType>::KMER_BITS - MASK_WIDTH;
+static const KmerType MASK = KmerType(0x11) << UNMASKED_BITS;
+static const KmerType LAST_KMER = MASK | ((KmerType(1) << UNMASKED_BITS) - 1);
+
+void TestExactMaskMatcher::setUp()
+{
+    srand(0);
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testExactMaskMatcher-%%%%-%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+}
+
+void TestExactMaskMatcher::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+static KmerType randomKmer()
+{
+    const KmerType unmasked = (KmerType(rand()) << 40) ^ (KmerType(rand()) << 20) ^ KmerType(rand());
+    return MASK | (unmasked & ((KmerType(1) << UNMASKED_BITS) - 1));
+}
+
+static bool orderByKmer(const ReferenceKmer &lhs, const ReferenceKmer &rhs)
+{
+    return lhs.getKmer() < rhs.getKmer();
+}
+
+/**
+ * \brief builds the jump table the way the reference sorter does and loads it back
+ */
+static void loadTable(
+    const boost::filesystem::path &maskFilePath, const std::vector<ReferenceKmer> &reference, MaskJumpTable &table)
+{
+    MaskJumpTable builder;
+    builder.reset(MASK_WIDTH);
+    for (std::vector<ReferenceKmer>::const_iterator it = reference.begin(); reference.end() != it; ++it)
+    {
+        builder.add(it->getKmer());
+    }
+    builder.save(maskFilePath);
+    CPPUNIT_ASSERT(table.load(maskFilePath, reference.size(), MASK_WIDTH));
+}
+
+/**
+ * \brief skipToKmer must give the same result as the binary search of the remainder of the reference,
+ *        with and without the jump table
+ */
+static void checkSkip(
+    const std::vector<ReferenceKmer> &reference, const MaskJumpTable &table, const KmerType kmer,
+    const ReferenceKmer *current)
+{
+    const ReferenceKmer *begin = reference.empty() ? 0 : &reference.front();
+    const ReferenceKmer *end = begin + reference.size();
+    const ReferenceKmer *expected = std::lower_bound(current, end, ReferenceKmer(kmer), &orderByKmer);
+    CPPUNIT_ASSERT(expected == ExactMaskMatcher::skipToKmer(kmer, current, begin, end, table));
+    CPPUNIT_ASSERT(expected == ExactMaskMatcher::skipToKmer(kmer, current, begin, end, MaskJumpTable()));
+}
+
+void TestExactMaskMatcher::testSkipToKmer()
+{
+    std::vector<ReferenceKmer> reference;
+    for (unsigned i = 0; 50000 > i; ++i)
+    {
+        reference.push_back(ReferenceKmer(randomKmer(), isaac::reference::ReferencePosition(0, i)));
+    }
+    // repeats
+    reference.insert(reference.end(), reference.begin(), reference.begin() + 500);
+    std::stable_sort(reference.begin(), reference.end(), &orderByKmer);
+    MaskJumpTable table;
+    loadTable(tempDirectory_ / "mask.dat", reference, table);
+
+    // the way matchMask walks the sorted seeds: each search starts where the previous one stopped
+    std::vector<KmerType> seeds;
+    for (unsigned i = 0; 20000 > i; ++i)
+    {
+        seeds.push_back(0 == i % 2 ? reference[rand() % reference.size()].getKmer() : randomKmer());
+    }
+    std::sort(seeds.begin(), seeds.end());
+    const ReferenceKmer *current = &reference.front();
+    for (std::vector<KmerType>::const_iterator seed = seeds.begin(); seeds.end() != seed; ++seed)
+    {
+        checkSkip(reference, table, *seed, current);
+        current = ExactMaskMatcher::skipToKmer(*seed, current, &reference.front(), &reference.back() + 1, table);
+    }
+
+    // from the start of the reference
+    checkSkip(reference, table, MASK, &reference.front());
+    checkSkip(reference, table, reference.front().getKmer(), &reference.front());
+    checkSkip(reference, table, reference.back().getKmer(), &reference.front());
+    checkSkip(reference, table, LAST_KMER, &reference.front());
+}
+
+void TestExactMaskMatcher::testSkipToLastKmer()
+{
+    std::vector<ReferenceKmer> reference;
+    reference.push_back(ReferenceKmer(MASK | 3));
+    reference.push_back(ReferenceKmer(MASK | 100));
+    reference.push_back(ReferenceKmer(LAST_KMER - 1));
+    reference.push_back(ReferenceKmer(LAST_KMER));
+    reference.push_back(ReferenceKmer(LAST_KMER));
+    MaskJumpTable table;
+    loadTable(tempDirectory_ / "mask.dat", reference, table);
+
+    const ReferenceKmer *begin = &reference.front();
+    CPPUNIT_ASSERT(begin + 3 == ExactMaskMatcher::skipToKmer(LAST_KMER, begin, begin, begin + reference.size(), table));
+    CPPUNIT_ASSERT(begin + 2 == ExactMaskMatcher::skipToKmer(LAST_KMER - 1, begin + 1, begin, begin + reference.size(), table));
+    checkSkip(reference, table, LAST_KMER, begin + 2);
+    checkSkip(reference, table, LAST_KMER - 2, begin);
+    checkSkip(reference, table, MASK | 101, begin + 1);
+
+    // nothing past the last kmer of the reference
+    reference.pop_back();
+    reference.pop_back();
+    loadTable(tempDirectory_ / "mask.dat", reference, table);
+    begin = &reference.front();
+    CPPUNIT_ASSERT(begin + reference.size() == ExactMaskMatcher::skipToKmer(LAST_KMER, begin, begin, begin + reference.size(), table));
+    checkSkip(reference, table, LAST_KMER, begin + 1);
+}
+
+void TestExactMaskMatcher::testSkipEmptyMask()
+{
+    const std::vector<ReferenceKmer> reference;
+    MaskJumpTable table;
+    loadTable(tempDirectory_ / "mask.dat", reference, table);
+    CPPUNIT_ASSERT(!table.empty());
+
+    checkSkip(reference, table, MASK, 0);
+    checkSkip(reference, table, LAST_KMER, 0);
+}
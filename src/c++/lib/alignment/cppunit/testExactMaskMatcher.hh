@@ -0,0 +1,38 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_ALIGNMENT_TEST_EXACT_MASK_MATCHER_HH
+#define iSAAC_ALIGNMENT_TEST_EXACT_MASK_MATCHER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+class TestExactMaskMatcher : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestExactMaskMatcher );
+    CPPUNIT_TEST( testSkipToKmer );
+    CPPUNIT_TEST( testSkipToLastKmer );
+    CPPUNIT_TEST( testSkipEmptyMask );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+public:
+    void setUp();
+    void tearDown();
+    void testSkipToKmer();
+    void testSkipToLastKmer();
+    void testSkipEmptyMask();
+};
+
+#endif // #ifndef iSAAC_ALIGNMENT_TEST_EXACT_MASK_MATCHER_HH
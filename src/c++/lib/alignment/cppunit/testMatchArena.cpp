@@ -0,0 +1,127 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <vector>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testMatchArena.hh"
+
+#include "alignment/MatchArena.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestMatchArena, registryName("MatchArena"));
+
+using isaac::alignment::Match;
+using isaac::alignment::MatchArena;
+using isaac::alignment::SeedId;
+using isaac::reference::ReferencePosition;
+
+void TestMatchArena::setUp()
+{
+}
+
+void TestMatchArena::tearDown()
+{
+}
+
+static std::vector<Match> makeMatches(const unsigned tile, const unsigned count)
+{
+    std::vector<Match> ret;
+    for (unsigned cluster = 0; count > cluster; ++cluster)
+    {
+        ret.push_back(Match(SeedId(tile, 0, cluster, 0, 0), ReferencePosition(0, cluster * 100)));
+    }
+    return ret;
+}
+
+static void checkMatches(const std::vector<Match> &expected, const std::vector<Match> &actual)
+{
+    CPPUNIT_ASSERT_EQUAL(expected.size(), actual.size());
+    for (unsigned i = 0; expected.size() > i; ++i)
+    {
+        CPPUNIT_ASSERT_EQUAL(expected[i].seedId, actual[i].seedId);
+        CPPUNIT_ASSERT_EQUAL(expected[i].location, actual[i].location);
+    }
+}
+
+void TestMatchArena::testAppend()
+{
+    MatchArena arena;
+    arena.reserveTiles(2);
+    CPPUNIT_ASSERT_EQUAL(0UL, arena.getTileMatchCount(0));
+    // tiles past the reserved ones have no matches
+    CPPUNIT_ASSERT_EQUAL(0UL, arena.getTileMatchCount(3));
+
+    const std::vector<Match> tile1 = makeMatches(1, 10);
+    arena.append(1, &tile1.front(), &tile1.front() + 4);
+    arena.append(1, &tile1.front() + 4, &tile1.back() + 1);
+    CPPUNIT_ASSERT_EQUAL(0UL, arena.getTileMatchCount(0));
+    CPPUNIT_ASSERT_EQUAL(10UL, arena.getTileMatchCount(1));
+    CPPUNIT_ASSERT_EQUAL(0UL, arena.getTileMatchCount(2));
+
+    // reserving more tiles keeps the collected matches
+    arena.reserveTiles(5);
+    CPPUNIT_ASSERT_EQUAL(10UL, arena.getTileMatchCount(1));
+    const std::vector<Match> tile5 = makeMatches(5, 3);
+    arena.append(5, &tile5.front(), &tile5.back() + 1);
+    CPPUNIT_ASSERT_EQUAL(3UL, arena.getTileMatchCount(5));
+}
+
+void TestMatchArena::testExtract()
+{
+    MatchArena arena;
+    arena.reserveTiles(1);
+    const std::vector<Match> tile0 = makeMatches(0, 7);
+    const std::vector<Match> tile1 = makeMatches(1, 5);
+    arena.append(0, &tile0.front(), &tile0.back() + 1);
+    arena.append(1, &tile1.front(), &tile1.back() + 1);
+
+    std::vector<Match> matches = makeMatches(2, 3);
+    arena.extractTileMatches(1, matches);
+    // the append order is preserved
+    checkMatches(tile1, matches);
+    CPPUNIT_ASSERT_EQUAL(0UL, arena.getTileMatchCount(1));
+    CPPUNIT_ASSERT_EQUAL(7UL, arena.getTileMatchCount(0));
+
+    arena.extractTileMatches(0, matches);
+    checkMatches(tile0, matches);
+
+    // nothing left for the tile once taken
+    arena.extractTileMatches(0, matches);
+    CPPUNIT_ASSERT(matches.empty());
+}
+
+void TestMatchArena::testRelease()
+{
+    MatchArena arena;
+    arena.reserveTiles(1);
+    CPPUNIT_ASSERT_EQUAL(0UL, arena.getAllocatedBytes());
+
+    const std::vector<Match> tile0 = makeMatches(0, 1000);
+    const std::vector<Match> tile1 = makeMatches(1, 100);
+    arena.append(0, &tile0.front(), &tile0.back() + 1);
+    arena.append(1, &tile1.front(), &tile1.back() + 1);
+    CPPUNIT_ASSERT(1100 * sizeof(Match) <= arena.getAllocatedBytes());
+
+    // the buffer capacity does not travel back into the arena
+    std::vector<Match> matches(10000);
+    arena.extractTileMatches(0, matches);
+    CPPUNIT_ASSERT(1000 <= matches.capacity() && 10000 > matches.capacity());
+    CPPUNIT_ASSERT_EQUAL(arena.getTileMatchCount(1) * sizeof(Match), arena.getAllocatedBytes());
+
+    arena.extractTileMatches(1, matches);
+    CPPUNIT_ASSERT_EQUAL(100UL, matches.size());
+    CPPUNIT_ASSERT(1000 > matches.capacity());
+    CPPUNIT_ASSERT_EQUAL(0UL, arena.getAllocatedBytes());
+}
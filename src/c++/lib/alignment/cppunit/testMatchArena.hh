@@ -0,0 +1,34 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_ALIGNMENT_TEST_MATCH_ARENA_HH
+#define iSAAC_ALIGNMENT_TEST_MATCH_ARENA_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TestMatchArena : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestMatchArena );
+    CPPUNIT_TEST( testAppend );
+    CPPUNIT_TEST( testExtract );
+    CPPUNIT_TEST( testRelease );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testAppend();
+    void testExtract();
+    void testRelease();
+};
+
+#endif // #ifndef iSAAC_ALIGNMENT_TEST_MATCH_ARENA_HH
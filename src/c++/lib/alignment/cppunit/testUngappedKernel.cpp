@@ -0,0 +1,137 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testUngappedKernel.hh"
+#include "alignment/Quality.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestUngappedKernel, registryName("UngappedKernel"));
+
+using isaac::alignment::fragmentBuilder::UngappedKernel;
+
+void TestUngappedKernel::setUp()
+{
+}
+
+void TestUngappedKernel::tearDown()
+{
+}
+
+void TestUngappedKernel::testCompare()
+{
+    const UngappedKernel kernel(UngappedKernel::Scalar);
+    //                           read n matches anything, reference N matches nothing but read n
+    const std::string sequence  = "ACGTnnAC";
+    const std::string reference = "ACGANTNC";
+    unsigned long mismatches = 0;
+    unsigned long edits = 0;
+    kernel.compare(sequence.data(), reference.data(), sequence.size(), mismatches, edits);
+    CPPUNIT_ASSERT_EQUAL(0x48UL, mismatches);
+    CPPUNIT_ASSERT_EQUAL(0x78UL, edits);
+}
+
+/**
+ * \brief logProbability must be bit-identical to adding the bases one at a time
+ */
+void TestUngappedKernel::testLogProbabilities()
+{
+    using isaac::alignment::Quality;
+    const UngappedKernel kernel(UngappedKernel::Scalar);
+    const std::string quality(10, 30);
+    double expected = -1.0;
+    for (unsigned i = 0; quality.size() > i; ++i)
+    {
+        expected += (0 == i || 9 == i) ? Quality::getLogMismatchFast(30) : Quality::getLogMatch(30);
+    }
+    CPPUNIT_ASSERT_EQUAL(expected, kernel.addLogProbabilities(quality.data(), quality.size(), 0x201UL, -1.0));
+
+    for (unsigned test = 0; 1000 > test; ++test)
+    {
+        const unsigned length = 1 + rand() % UngappedKernel::BLOCK_BASES;
+        std::string stretchQuality;
+        for (unsigned i = 0; UngappedKernel::BLOCK_BASES + length > i; ++i)
+        {
+            stretchQuality.push_back(rand() % 64);
+        }
+        const unsigned long fullBlockMismatches = rand() * static_cast<unsigned long>(rand());
+        const unsigned long mismatches = rand() * static_cast<unsigned long>(rand());
+
+        double stretchExpected = 0.0;
+        for (unsigned i = 0; stretchQuality.size() > i; ++i)
+        {
+            const bool mismatch = UngappedKernel::BLOCK_BASES > i ?
+                (fullBlockMismatches >> i) & 1 : (mismatches >> (i - UngappedKernel::BLOCK_BASES)) & 1;
+            stretchExpected += mismatch ? Quality::getLogMismatchFast(stretchQuality[i]) : Quality::getLogMatch(stretchQuality[i]);
+        }
+        // a full block followed by a shorter one as they come in a long stretch
+        double logProbability = kernel.addLogProbabilities(
+            stretchQuality.data(), UngappedKernel::BLOCK_BASES, fullBlockMismatches, 0.0);
+        logProbability = kernel.addLogProbabilities(
+            stretchQuality.data() + UngappedKernel::BLOCK_BASES, length, mismatches, logProbability);
+        CPPUNIT_ASSERT_EQUAL(stretchExpected, logProbability);
+    }
+}
+
+/**
+ * \brief All implementations must produce the same bits
+ */
+void TestUngappedKernel::testImplementations()
+{
+    static const char bases[] = {'A', 'C', 'G', 'T', 'N', 'n'};
+    const UngappedKernel scalar(UngappedKernel::Scalar);
+    std::vector<UngappedKernel::Implementation> implementations;
+    if (UngappedKernel::isSupported(UngappedKernel::Sse42))
+    {
+        implementations.push_back(UngappedKernel::Sse42);
+    }
+    if (UngappedKernel::isSupported(UngappedKernel::Avx2))
+    {
+        implementations.push_back(UngappedKernel::Avx2);
+    }
+    if (UngappedKernel::isSupported(UngappedKernel::Avx512))
+    {
+        implementations.push_back(UngappedKernel::Avx512);
+    }
+
+    BOOST_FOREACH(const UngappedKernel::Implementation implementation, implementations)
+    {
+        const UngappedKernel vectorized(implementation);
+        for (unsigned test = 0; 1000 > test; ++test)
+        {
+            const unsigned length = 1 + rand() % UngappedKernel::BLOCK_BASES;
+            std::string sequence;
+            std::string reference;
+            for (unsigned i = 0; length > i; ++i)
+            {
+                reference.push_back(bases[rand() % 5]);
+                sequence.push_back(rand() % 4 ? reference[i] : bases[rand() % 6]);
+            }
+
+            unsigned long expectedMismatches = 0;
+            unsigned long expectedEdits = 0;
+            scalar.compare(sequence.data(), reference.data(), length, expectedMismatches, expectedEdits);
+            unsigned long mismatches = 0;
+            unsigned long edits = 0;
+            vectorized.compare(sequence.data(), reference.data(), length, mismatches, edits);
+            CPPUNIT_ASSERT_EQUAL(expectedMismatches, mismatches);
+            CPPUNIT_ASSERT_EQUAL(expectedEdits, edits);
+        }
+    }
+}
@@ -0,0 +1,36 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_ALIGNMENT_TEST_UNGAPPED_KERNEL_HH
+#define iSAAC_ALIGNMENT_TEST_UNGAPPED_KERNEL_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "alignment/fragmentBuilder/UngappedKernel.hh"
+
+class TestUngappedKernel : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestUngappedKernel );
+    CPPUNIT_TEST( testCompare );
+    CPPUNIT_TEST( testLogProbabilities );
+    CPPUNIT_TEST( testImplementations );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testCompare();
+    void testLogProbabilities();
+    void testImplementations();
+};
+
+#endif // #ifndef iSAAC_ALIGNMENT_TEST_UNGAPPED_KERNEL_HH
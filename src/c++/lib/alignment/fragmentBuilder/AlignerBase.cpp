@@ -125,6 +125,118 @@ unsigned AlignerBase::updateFragmentCigar(
     const long strandPosition,
     const Cigar &cigarBuffer,
     const unsigned cigarOffset) const
+{
+    return updateFragmentCigar(readMetadataList, reference, 0, fragmentMetadata, strandPosition, cigarBuffer, cigarOffset);
+}
+
+unsigned AlignerBase::updateFragmentCigar(
+    const flowcell::ReadMetadataList &readMetadataList,
+    const reference::Contig &contig,
+    FragmentMetadata &fragmentMetadata,
+    const long strandPosition,
+    const Cigar &cigarBuffer,
+    const unsigned cigarOffset) const
+{
+    // packing is optional at contig load time
+    const oligo::PackedSequence *packedReference =
+        contig.packed_.size() == contig.forward_.size() ? &contig.packed_ : 0;
+    return updateFragmentCigar(readMetadataList, contig.forward_, packedReference,
+                               fragmentMetadata, strandPosition, cigarBuffer, cigarOffset);
+}
+
+/**
+ * \brief Same as UngappedKernel::compare, but uses the 2-bit packed sequences comparing 32 bases per word
+ */
+static void comparePacked(
+    const oligo::PackedSequence &packedSequence,
+    const oligo::PackedSequence &packedReference,
+    const unsigned sequenceOffset,
+    const unsigned long referenceOffset,
+    const unsigned length,
+    unsigned long &mismatches,
+    unsigned long &edits)
+{
+    mismatches = 0;
+    edits = 0;
+    for (unsigned done = 0; length > done; done += oligo::PackedSequence::BASES_PER_WORD)
+    {
+        const unsigned long lanes = oligo::PackedSequence::getLanes(length - done);
+        const unsigned long readN = packedSequence.getNLanes(sequenceOffset + done);
+        const unsigned long referenceN = packedReference.getNLanes(referenceOffset + done);
+        const unsigned long diff = oligo::PackedSequence::getMismatchLanes(
+            packedSequence.getBases(sequenceOffset + done), packedReference.getBases(referenceOffset + done));
+
+        // N in the read matches anything, N in the reference matches only N in the read
+        mismatches |= oligo::PackedSequence::gatherLanes((diff | referenceN) & ~readN & lanes) << done;
+        edits |= oligo::PackedSequence::gatherLanes((diff | referenceN | readN) & lanes) << done;
+    }
+}
+
+/**
+ * \brief Scores an ALIGN operation UngappedKernel::BLOCK_BASES bases at a time.
+ *
+ * \return number of matching bases
+ */
+unsigned AlignerBase::updateAlign(
+    const Read &read,
+    const std::vector<char> &reference,
+    const oligo::PackedSequence *packedReference,
+    const unsigned long referenceOffset,
+    const unsigned sequenceOffset,
+    const unsigned length,
+    const unsigned firstCycle,
+    const unsigned lastCycle,
+    FragmentMetadata &fragmentMetadata) const
+{
+    const bool reverse = fragmentMetadata.reverse;
+    const std::vector<char> &sequence = read.getStrandSequence(reverse);
+    const std::vector<char> &quality = read.getStrandQuality(reverse);
+    unsigned matchCount = 0;
+    // offset of the base following the last mismatch
+    unsigned matchesBegin = 0;
+    for (unsigned done = 0; length > done; done += UngappedKernel::BLOCK_BASES)
+    {
+        const unsigned bases = std::min(length - done, UngappedKernel::BLOCK_BASES);
+        unsigned long mismatches = 0;
+        unsigned long edits = 0;
+        if (packedReference)
+        {
+            comparePacked(read.getStrandPackedSequence(reverse), *packedReference,
+                          sequenceOffset + done, referenceOffset + done, bases, mismatches, edits);
+        }
+        else
+        {
+            kernel_.compare(&sequence[sequenceOffset + done], &reference[referenceOffset + done], bases, mismatches, edits);
+        }
+        fragmentMetadata.logProbability = kernel_.addLogProbabilities(
+            &quality[sequenceOffset + done], bases, mismatches, fragmentMetadata.logProbability);
+
+        // the edit distance includes all mismatches and ambiguous bases (Ns)
+        fragmentMetadata.editDistance += UngappedKernel::countBits(edits);
+        const unsigned mismatchCount = UngappedKernel::countBits(mismatches);
+        matchCount += bases - mismatchCount;
+        fragmentMetadata.smithWatermanScore += mismatchCount * normalizedMismatchScore_;
+        for (; mismatches; mismatches &= mismatches - 1)
+        {
+            const unsigned mismatch = done + __builtin_ctzl(mismatches);
+            fragmentMetadata.matchesInARow = std::max(fragmentMetadata.matchesInARow, mismatch - matchesBegin);
+            matchesBegin = mismatch + 1;
+            const unsigned currentBase = sequenceOffset + mismatch;
+            fragmentMetadata.addMismatchCycle(reverse ? lastCycle - currentBase : firstCycle + currentBase);
+        }
+    }
+    fragmentMetadata.matchesInARow = std::max(fragmentMetadata.matchesInARow, length - matchesBegin);
+    return matchCount;
+}
+
+unsigned AlignerBase::updateFragmentCigar(
+    const flowcell::ReadMetadataList &readMetadataList,
+    const std::vector<char> &reference,
+    const oligo::PackedSequence *packedReference,
+    FragmentMetadata &fragmentMetadata,
+    const long strandPosition,
+    const Cigar &cigarBuffer,
+    const unsigned cigarOffset) const
 {
     const Read &read = fragmentMetadata.getRead();
     const bool reverse = fragmentMetadata.reverse;
@@ -155,32 +267,10 @@ unsigned AlignerBase::updateFragmentCigar(
         const Cigar::OpCode opCode = cigar.second;
         if (opCode == Cigar::ALIGN)
         {
-            unsigned matchesInARow = 0;
-            for (unsigned j = 0; length > j; ++j)
-            {
-                if (isMatch(sequence[currentBase], *currentReference))
-                {
-                    ++matchCount;
-                    ++matchesInARow;
-                    fragmentMetadata.logProbability += Quality::getLogMatch(quality[currentBase]);
-                }
-                else
-                {
-                    fragmentMetadata.matchesInARow = std::max(fragmentMetadata.matchesInARow, matchesInARow);
-                    matchesInARow = 0;
-                    fragmentMetadata.addMismatchCycle(reverse ? lastCycle - currentBase : firstCycle + currentBase);
-                    fragmentMetadata.logProbability += Quality::getLogMismatchFast(quality[currentBase]);
-                    fragmentMetadata.smithWatermanScore += normalizedMismatchScore_;
-                }
-                // the edit distance includes all mismatches and ambiguous bases (Ns)
-                if (sequence[currentBase] != *currentReference)
-                {
-                    ++fragmentMetadata.editDistance;
-                }
-                ++currentReference;
-                ++currentBase;
-            }
-            fragmentMetadata.matchesInARow = std::max(fragmentMetadata.matchesInARow, matchesInARow);
+            matchCount += updateAlign(read, reference, packedReference, currentReference - reference.begin(),
+                                      currentBase, length, firstCycle, lastCycle, fragmentMetadata);
+            currentReference += length;
+            currentBase += length;
         }
         else if (opCode == Cigar::INSERT)
         {
@@ -80,7 +80,7 @@ unsigned UngappedAligner::alignUngapped(
         cigarBuffer.addOperation(clipEndBases, Cigar::SOFT_CLIP);
     }
 
-    const unsigned ret = updateFragmentCigar(readMetadataList, reference, fragmentMetadata,
+    const unsigned ret = updateFragmentCigar(readMetadataList, contig, fragmentMetadata,
                                              fragmentMetadata.position, cigarBuffer, cigarOffset);
 
     if (!ret)
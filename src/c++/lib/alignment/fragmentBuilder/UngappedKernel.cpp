@@ -0,0 +1,148 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file UngappedKernel.cpp
+ **
+ ** \brief See UngappedKernel.hh. Dispatch and the scalar implementation.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <boost/format.hpp>
+
+#include "alignment/Alignment.hh"
+#include "alignment/Quality.hh"
+#include "alignment/fragmentBuilder/UngappedKernel.hh"
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+
+namespace isaac
+{
+namespace alignment
+{
+namespace fragmentBuilder
+{
+
+const unsigned UngappedKernel::BLOCK_BASES;
+
+UngappedKernel::UngappedKernel(const Implementation implementation)
+    : implementation_(selectImplementation(implementation))
+{
+    for (unsigned quality = 0; QUALITY_MAX > quality; ++quality)
+    {
+        logProbabilityTable_[quality] = Quality::getLogMatch(quality);
+        logProbabilityTable_[QUALITY_MAX + quality] = Quality::getLogMismatchFast(quality);
+    }
+}
+
+bool UngappedKernel::isSupported(const Implementation implementation)
+{
+    switch (implementation)
+    {
+    case Sse42:
+        return sse42Supported();
+    case Avx2:
+        return avx2Supported();
+    case Avx512:
+        return avx512Supported();
+    case Auto:
+    case Scalar:
+        return true;
+    }
+    return false;
+}
+
+UngappedKernel::Implementation UngappedKernel::selectImplementation(const Implementation requested)
+{
+    if (Auto == requested)
+    {
+        return isSupported(Avx512) ? Avx512 : isSupported(Avx2) ? Avx2 : isSupported(Sse42) ? Sse42 : Scalar;
+    }
+    if (!isSupported(requested))
+    {
+        const std::string message = (boost::format("UngappedKernel: implementation %d is not supported by the CPU") % requested).str();
+        BOOST_THROW_EXCEPTION(isaac::common::InvalidParameterException(message));
+    }
+    return requested;
+}
+
+void UngappedKernel::compare(
+    const char *sequence,
+    const char *reference,
+    const unsigned length,
+    unsigned long &mismatches,
+    unsigned long &edits) const
+{
+    ISAAC_ASSERT_MSG(BLOCK_BASES >= length, "Block is too long: " << length);
+    switch (implementation_)
+    {
+    case Avx512:
+        compareAvx512(sequence, reference, length, mismatches, edits);
+        break;
+    case Avx2:
+        compareAvx2(sequence, reference, length, mismatches, edits);
+        break;
+    case Sse42:
+        compareSse42(sequence, reference, length, mismatches, edits);
+        break;
+    default:
+        compareScalar(sequence, reference, length, mismatches, edits);
+        break;
+    }
+}
+
+/**
+ * \brief Reference implementation. Vectorized ones use it for the bases that don't fill a register.
+ */
+void UngappedKernel::compareScalar(
+    const char *sequence,
+    const char *reference,
+    const unsigned length,
+    unsigned long &mismatches,
+    unsigned long &edits) const
+{
+    mismatches = 0;
+    edits = 0;
+    for (unsigned i = 0; length > i; ++i)
+    {
+        if (!isMatch(sequence[i], reference[i]))
+        {
+            mismatches |= 1UL << i;
+        }
+        if (sequence[i] != reference[i])
+        {
+            edits |= 1UL << i;
+        }
+    }
+}
+
+/**
+ * \brief The additions depend on each other, there is nothing to gain from vectorizing the table lookups
+ */
+double UngappedKernel::addLogProbabilities(
+    const char *quality,
+    const unsigned length,
+    const unsigned long mismatches,
+    double logProbability) const
+{
+    ISAAC_ASSERT_MSG(BLOCK_BASES >= length, "Block is too long: " << length);
+    for (unsigned i = 0; length > i; ++i)
+    {
+        const unsigned index = static_cast<unsigned char>(quality[i]) + ((mismatches >> i) & 1) * QUALITY_MAX;
+        logProbability += logProbabilityTable_[index];
+    }
+    return logProbability;
+}
+
+} // namespace fragmentBuilder
+} // namespace alignment
+} // namespace isaac
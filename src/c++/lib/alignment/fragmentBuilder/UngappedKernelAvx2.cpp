@@ -0,0 +1,104 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file UngappedKernelAvx2.cpp
+ **
+ ** \brief AVX2 implementation of the UngappedKernel. The only file compiled with AVX2 enabled.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "alignment/fragmentBuilder/UngappedKernel.hh"
+#include "common/Debug.hh"
+
+namespace isaac
+{
+namespace alignment
+{
+namespace fragmentBuilder
+{
+
+#ifdef __AVX2__
+
+bool UngappedKernel::avx2Supported()
+{
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+}
+
+void UngappedKernel::compareAvx2(
+    const char *sequence,
+    const char *reference,
+    const unsigned length,
+    unsigned long &mismatches,
+    unsigned long &edits) const
+{
+    unsigned long blockMismatches = 0;
+    unsigned long blockEdits = 0;
+    unsigned done = 0;
+    {
+        const __m256i readN = _mm256_set1_epi8('n');
+        const __m256i referenceN = _mm256_set1_epi8('N');
+        for (; length >= done + 32; done += 32)
+        {
+            const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(sequence + done));
+            const __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(reference + done));
+            const __m256i equal = _mm256_cmpeq_epi8(s, r);
+            // isMatch: n in the read matches anything, N in the reference matches nothing else
+            const __m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(s, readN),
+                                                  _mm256_andnot_si256(_mm256_cmpeq_epi8(r, referenceN), equal));
+            blockMismatches |= static_cast<unsigned long>(~static_cast<unsigned>(_mm256_movemask_epi8(match))) << done;
+            blockEdits |= static_cast<unsigned long>(~static_cast<unsigned>(_mm256_movemask_epi8(equal))) << done;
+        }
+    }
+    if (length >= done + 16)
+    {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sequence + done));
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(reference + done));
+        const __m128i equal = _mm_cmpeq_epi8(s, r);
+        const __m128i match = _mm_or_si128(_mm_cmpeq_epi8(s, _mm_set1_epi8('n')),
+                                           _mm_andnot_si128(_mm_cmpeq_epi8(r, _mm_set1_epi8('N')), equal));
+        blockMismatches |= static_cast<unsigned long>(~_mm_movemask_epi8(match) & 0xFFFF) << done;
+        blockEdits |= static_cast<unsigned long>(~_mm_movemask_epi8(equal) & 0xFFFF) << done;
+        done += 16;
+    }
+    if (length != done)
+    {
+        compareScalar(sequence + done, reference + done, length - done, mismatches, edits);
+        blockMismatches |= mismatches << done;
+        blockEdits |= edits << done;
+    }
+    mismatches = blockMismatches;
+    edits = blockEdits;
+}
+
+#else //__AVX2__
+
+bool UngappedKernel::avx2Supported()
+{
+    return false;
+}
+
+void UngappedKernel::compareAvx2(
+    const char *, const char *, const unsigned, unsigned long &, unsigned long &) const
+{
+    ISAAC_ASSERT_MSG(false, "The binary is compiled without AVX2 support");
+}
+
+#endif //__AVX2__
+
+} // namespace fragmentBuilder
+} // namespace alignment
+} // namespace isaac
@@ -0,0 +1,79 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file UngappedKernelAvx512.cpp
+ **
+ ** \brief AVX-512 implementation of the UngappedKernel. The only file compiled with AVX-512 enabled.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+#include <immintrin.h>
+#endif
+
+#include "alignment/fragmentBuilder/UngappedKernel.hh"
+#include "common/Debug.hh"
+
+namespace isaac
+{
+namespace alignment
+{
+namespace fragmentBuilder
+{
+
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+
+bool UngappedKernel::avx512Supported()
+{
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("popcnt");
+}
+
+/**
+ * \brief The whole block in one register. Masked loads don't touch the memory past the end of the block.
+ */
+void UngappedKernel::compareAvx512(
+    const char *sequence,
+    const char *reference,
+    const unsigned length,
+    unsigned long &mismatches,
+    unsigned long &edits) const
+{
+    const __mmask64 valid = BLOCK_BASES == length ? ~0UL : (1UL << length) - 1;
+    const __m512i s = _mm512_maskz_loadu_epi8(valid, sequence);
+    const __m512i r = _mm512_maskz_loadu_epi8(valid, reference);
+    const __mmask64 equal = _mm512_cmpeq_epi8_mask(s, r);
+    // isMatch: n in the read matches anything, N in the reference matches nothing else
+    const __mmask64 match = _mm512_cmpeq_epi8_mask(s, _mm512_set1_epi8('n')) |
+        (equal & ~_mm512_cmpeq_epi8_mask(r, _mm512_set1_epi8('N')));
+    mismatches = ~match & valid;
+    edits = ~equal & valid;
+}
+
+#else //defined(__AVX512F__) && defined(__AVX512BW__)
+
+bool UngappedKernel::avx512Supported()
+{
+    return false;
+}
+
+void UngappedKernel::compareAvx512(
+    const char *, const char *, const unsigned, unsigned long &, unsigned long &) const
+{
+    ISAAC_ASSERT_MSG(false, "The binary is compiled without AVX-512 support");
+}
+
+#endif //defined(__AVX512F__) && defined(__AVX512BW__)
+
+} // namespace fragmentBuilder
+} // namespace alignment
+} // namespace isaac
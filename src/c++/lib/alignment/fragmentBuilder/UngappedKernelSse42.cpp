@@ -0,0 +1,90 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file UngappedKernelSse42.cpp
+ **
+ ** \brief SSE4.2 implementation of the UngappedKernel. The only file compiled with SSE4.2 enabled.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+#include "alignment/fragmentBuilder/UngappedKernel.hh"
+#include "common/Debug.hh"
+
+namespace isaac
+{
+namespace alignment
+{
+namespace fragmentBuilder
+{
+
+#ifdef __SSE4_2__
+
+bool UngappedKernel::sse42Supported()
+{
+    return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+}
+
+void UngappedKernel::compareSse42(
+    const char *sequence,
+    const char *reference,
+    const unsigned length,
+    unsigned long &mismatches,
+    unsigned long &edits) const
+{
+    const __m128i readN = _mm_set1_epi8('n');
+    const __m128i referenceN = _mm_set1_epi8('N');
+    unsigned long blockMismatches = 0;
+    unsigned long blockEdits = 0;
+    unsigned done = 0;
+    for (; length >= done + 16; done += 16)
+    {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sequence + done));
+        const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i *>(reference + done));
+        const __m128i equal = _mm_cmpeq_epi8(s, r);
+        // isMatch: n in the read matches anything, N in the reference matches nothing else
+        const __m128i match = _mm_or_si128(_mm_cmpeq_epi8(s, readN), _mm_andnot_si128(_mm_cmpeq_epi8(r, referenceN), equal));
+        blockMismatches |= static_cast<unsigned long>(~_mm_movemask_epi8(match) & 0xFFFF) << done;
+        blockEdits |= static_cast<unsigned long>(~_mm_movemask_epi8(equal) & 0xFFFF) << done;
+    }
+    if (length != done)
+    {
+        compareScalar(sequence + done, reference + done, length - done, mismatches, edits);
+        blockMismatches |= mismatches << done;
+        blockEdits |= edits << done;
+    }
+    mismatches = blockMismatches;
+    edits = blockEdits;
+}
+
+#else //__SSE4_2__
+
+bool UngappedKernel::sse42Supported()
+{
+    return false;
+}
+
+void UngappedKernel::compareSse42(
+    const char *, const char *, const unsigned, unsigned long &, unsigned long &) const
+{
+    ISAAC_ASSERT_MSG(false, "The binary is compiled without SSE4.2 support");
+}
+
+#endif //__SSE4_2__
+
+} // namespace fragmentBuilder
+} // namespace alignment
+} // namespace isaac
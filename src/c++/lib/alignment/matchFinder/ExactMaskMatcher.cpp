@@ -30,7 +30,7 @@ namespace matchFinder
 {
 
 template <typename KmerT>
-inline void writeMatch(io::TileMatchWriter &matchWriter, const alignment::Seed<KmerT> &seed, const reference::ReferencePosition &referencePosition)
+inline void writeMatch(io::ThreadMatchWriter &matchWriter, const alignment::Seed<KmerT> &seed, const reference::ReferencePosition &referencePosition)
 {
     ISAAC_THREAD_CERR_DEV_TRACE("writeMatch: " << seed << " " << referencePosition);
     matchWriter.write(seed.getSeedId(), referencePosition);
@@ -44,7 +44,7 @@ template <typename KmerT>
 void ExactMaskMatcher<KmerT>::generateNoMatches(
     const SeedIterator currentSeed,
     const SeedIterator nextSeed,
-    io::TileMatchWriter &matchWriter)
+    io::ThreadMatchWriter &matchWriter)
 {
     for (SeedIterator seed = currentSeed; nextSeed > seed; ++seed)
     {
@@ -64,7 +64,7 @@ template <typename KmerT>
 void ExactMaskMatcher<KmerT>::generateTooManyMatches(
     const SeedIterator currentSeed,
     const SeedIterator nextSeed,
-    io::TileMatchWriter &matchWriter)
+    io::ThreadMatchWriter &matchWriter)
 {
     for (SeedIterator seed = currentSeed; nextSeed > seed; ++seed)
     {
@@ -78,6 +78,42 @@ void ExactMaskMatcher<KmerT>::generateTooManyMatches(
     }
 }
 
+template <typename KmerT>
+inline bool compareReferenceKmer(const reference::ReferenceKmer<KmerT> &referenceKmer, const KmerT kmer)
+{
+    return referenceKmer.getKmer() < kmer;
+}
+
+/**
+ * \brief Finds the first reference kmer not less than kmer. Uses jump table to narrow down the range
+ *        then gallops from the current position so that the cost is proportional to the log of
+ *        the distance skipped rather than to the number of reference kmers skipped.
+ */
+template <typename KmerT>
+const typename ExactMaskMatcher<KmerT>::ReferenceKmerT *ExactMaskMatcher<KmerT>::skipToKmer(
+    const KmerT kmer,
+    const ReferenceKmerT *current,
+    const ReferenceKmerT *referenceBegin,
+    const ReferenceKmerT *referenceEnd,
+    const reference::MaskJumpTable<KmerT> &jumpTable)
+{
+    const ReferenceKmerT *end = referenceEnd;
+    if (!jumpTable.empty())
+    {
+        const std::pair<std::size_t, std::size_t> bucket = jumpTable.getBucketRange(kmer);
+        current = std::max(current, referenceBegin + bucket.first);
+        end = std::max(current, referenceBegin + bucket.second);
+    }
+
+    const std::size_t size = end - current;
+    std::size_t bound = 1;
+    while (size >= bound && current[bound - 1].getKmer() < kmer)
+    {
+        bound <<= 1;
+    }
+    return std::lower_bound(current + bound / 2, current + std::min(bound, size), kmer, &compareReferenceKmer<KmerT>);
+}
+
 // Initial implementation that works only for exact matches
 template <typename KmerT>
 void ExactMaskMatcher<KmerT>::matchMask(
@@ -86,8 +122,10 @@ void ExactMaskMatcher<KmerT>::matchMask(
     const unsigned mask,
     MatchDistribution &matchDistribution,
     std::vector<ReferenceKmerT> &threadRepeatList,
-    io::TileMatchWriter &matchWriter,
-    std::istream &reference)
+    io::ThreadMatchWriter &matchWriter,
+    const ReferenceKmerT *referenceBegin,
+    const ReferenceKmerT *referenceEnd,
+    const reference::MaskJumpTable<KmerT> &jumpTable)
 {
     const clock_t start = clock();
     ISAAC_THREAD_CERR << "Finding exact matches for mask " << mask << std::endl;
@@ -97,9 +135,7 @@ void ExactMaskMatcher<KmerT>::matchMask(
     // all memory reservation must have been done outside the threaded code
     assert(threadRepeatList.capacity() >= repeatThreshold_ + 1);
     SeedIterator nextSeed = beginSeeds;
-    ReferenceKmerT nextReference;
-    char *readBuffer = reinterpret_cast<char *>(&nextReference);
-    reference.read(readBuffer, sizeof(nextReference));
+    const ReferenceKmerT *nextReference = referenceBegin;
     while(endSeeds != nextSeed)
     {
         // identify all the seeds with the same k-mer
@@ -109,20 +145,17 @@ void ExactMaskMatcher<KmerT>::matchMask(
             ++nextSeed;
         }
         // discard reference positions with smaller k-mer
-        while (reference && currentSeed->getKmer() > nextReference.getKmer())
-        {
-            reference.read(readBuffer, sizeof(nextReference));
-        }
+        nextReference = skipToKmer(currentSeed->getKmer(), nextReference, referenceBegin, referenceEnd, jumpTable);
         // Generate the list of reference positions matching the currentSeed
         threadRepeatList.clear();
-        while (reference && (currentSeed->getKmer() == nextReference.getKmer()))
+        while (referenceEnd != nextReference && (currentSeed->getKmer() == nextReference->getKmer()))
         {
             if (threadRepeatList.size() < repeatThreshold_)
             {
                 threadRepeatList.push_back(reference::ReferenceKmer<KmerT>(
-                    nextReference.getKmer(), nextReference.getTranslatedPosition(contigKaryotypes_)));
+                    nextReference->getKmer(), nextReference->getTranslatedPosition(contigKaryotypes_)));
             }
-            reference.read(readBuffer, sizeof(nextReference));
+            ++nextReference;
         }
         // generate the matches for each seed
         if (threadRepeatList.empty())
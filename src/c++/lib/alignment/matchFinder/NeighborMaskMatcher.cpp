@@ -30,7 +30,7 @@ namespace matchFinder
 {
 
 template <typename KmerT>
-inline void writeMatch(io::TileMatchWriter &matchWriter, const alignment::Seed<KmerT> &seed, const reference::ReferencePosition &referencePosition)
+inline void writeMatch(io::ThreadMatchWriter &matchWriter, const alignment::Seed<KmerT> &seed, const reference::ReferencePosition &referencePosition)
 {
     ISAAC_THREAD_CERR_DEV_TRACE("writeNeigbhorMatch: " << seed << " " << referencePosition);
     matchWriter.write(seed.getSeedId(), referencePosition);
@@ -68,7 +68,7 @@ template <typename KmerT>
 void NeighborMaskMatcher<KmerT>::generateNoMatches(
     const SeedIterator currentSeed,
     const SeedIterator nextSeed,
-    io::TileMatchWriter &matchWriter)
+    io::ThreadMatchWriter &matchWriter)
 {
     for (SeedIterator seed = currentSeed; nextSeed > seed; ++seed)
     {
@@ -90,7 +90,7 @@ template <typename KmerT>
 void NeighborMaskMatcher<KmerT>::generateTooManyMatches(
     const SeedIterator currentSeed,
     const SeedIterator nextSeed,
-    io::TileMatchWriter &matchWriter)
+    io::ThreadMatchWriter &matchWriter)
 {
     if (ignoreRepeats_)
     {
@@ -115,7 +115,7 @@ void NeighborMaskMatcher<KmerT>::matchNeighborsMask(
     MatchDistribution &matchDistribution,
     std::vector<ReferenceKmerT> &threadRepeatList,
     std::vector<ReferenceKmerT> &threadNeighborsList,
-    io::TileMatchWriter &matchWriter,
+    io::ThreadMatchWriter &matchWriter,
     std::istream &reference)
 {
     const clock_t start = clock();
@@ -63,6 +63,8 @@ BinningFragmentStorage::BinningFragmentStorage(
         {
             BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open bin file " + binMetadata.getPathString()));
         }
+        // an index left by an earlier --buffer-bins run would otherwise be trusted by BinSorter
+        bfs::remove(binMetadata.getFragmentIndexPath());
     }
 
     ISAAC_THREAD_CERR << "Resetting output files done for " << binPathList_.size() << " bins" << std::endl;
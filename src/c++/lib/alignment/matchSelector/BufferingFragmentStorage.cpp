@@ -44,6 +44,7 @@ BufferingFragmentStorage::BufferingFragmentStorage(
     const flowcell::FlowcellLayoutList &flowcellLayoutList,
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
     const unsigned long maxTileClusters,
+    const unsigned long maxBatchClusters,
     const unsigned long totalTiles,
     const bool skipEmptyBins)
     : keepUnaligned_(keepUnaligned)
@@ -53,18 +54,23 @@ BufferingFragmentStorage::BufferingFragmentStorage(
     , flushThreads_(maxSavers)
     , binPathList_(buildBinPathList(binIndexMap_, matchDistribution, binDirectory,
                                     barcodeMetadataList, maxTileReads_, totalTiles, preSortBins, skipEmptyBins))
-    , fragmentCollector_(binIndexMap_, maxTileClusters, flowcellLayoutList)
-    , flushBuffer_(maxTileClusters, flowcellLayoutList)
+    , fragmentCollector_(binIndexMap_, maxBatchClusters, flowcellLayoutList, totalTiles)
+    , flushBuffer_(maxBatchClusters, flowcellLayoutList)
     , threadDataFileBufCaches_(flushThreads_.size(),
                            FileBufCache(1, std::ios_base::out | std::ios_base::app | std::ios_base::binary))
 
 {
     ISAAC_THREAD_CERR << "Resetting output files for " << binPathList_.size() << " bins" << std::endl;
 
+    binIndexPaths_.reserve(binPathList_.size());
+    BOOST_FOREACH(const BinMetadata &binMetadata, binPathList_)
+    {
+        binIndexPaths_.push_back(binMetadata.getFragmentIndexPath());
+    }
     // assuming the last entry in the list contains the longest paths
     std::for_each(threadDataFileBufCaches_.begin(), threadDataFileBufCaches_.end(),
                   boost::bind(&FileBufCache::reservePathBuffers, _1,
-                              binPathList_.back().getPathString().size()));
+                              binIndexPaths_.back().string().size()));
 
 //    threadFragmentCollectors_.reserve(reserveClusters);
 
@@ -78,6 +84,7 @@ void BufferingFragmentStorage::flushBin(
 //    ISAAC_THREAD_CERR_DEV_TRACE((boost::format("BufferingFragmentStorage::flushBin: %d %s") % binNumber % binMetadata).str());
 
     ISAAC_ASSERT_MSG(binNumber == binMetadata.getIndex(), "Bin index mismatch");
+    ISAAC_ASSERT_MSG(!binMetadata.isUnalignedBin(), "Unaligned bin is flushed by flushUnmappedBin");
 
 //    ISAAC_THREAD_CERR_DEV_TRACE((boost::format("flushBuffer_.indexEnd() - currentBinIterator: %d") %
 //        (flushBuffer_.indexEnd() - currentBinIterator)).str());
@@ -92,11 +99,13 @@ void BufferingFragmentStorage::flushBin(
             // make sure file is empty first time we decide to put data in it.
             // boost::filesystem::remove for some stupid reason needs to allocate strings for this...
             unlink(binMetadata.getPath().c_str());
+            unlink(binIndexPaths_[binNumber].c_str());
         }
         std::ostream osData(threadDataFileBufCaches_[threadNumber].get(binMetadata.getPath()));
 
         // store data sequentially in the bin file
-        for(FragmentBuffer::IndexConstIterator currentBinIterator = binBegin;
+        FragmentBuffer::IndexConstIterator currentBinIterator = binBegin;
+        for(;
             binEnd != currentBinIterator && currentBinIterator->initialized();
             ++currentBinIterator)
         {
@@ -105,7 +114,7 @@ void BufferingFragmentStorage::flushBin(
     //        ISAAC_THREAD_CERR << recordStart << std::endl;
     //        ISAAC_THREAD_CERR_DEV_TRACE((boost::format("%s") % recordStart).str());
 
-            const io::FragmentHeader& header = recordStart.fragmentHeader();
+            const io::FragmentAccessor& header = recordStart.fragment();
 
             binMetadata.incrementDataSize(header.fStrandPosition_, header.getTotalLength());
     //        ISAAC_ASSERT_MSG(io::FragmentHeader::magicValue_ == header.magic_, "corrupt binary data in memory");
@@ -134,11 +143,35 @@ void BufferingFragmentStorage::flushBin(
         // itself, most likely the same file will be reopen on a different thread. this means, another FileBufWithReopen
         // will be already writing to it.
         osData.flush();
+
+        flushBinIndex(threadNumber, binNumber, binBegin, currentBinIterator);
     }
 
 //    ISAAC_THREAD_CERR << "Flushing bin done: " << binMetadata << std::endl;
 }
 
+/**
+ * \brief Appends io::FragmentIndexRecord of [binBegin, binEnd) to the fragment index of the bin. Records
+ *        follow the order in which flushBin stored the fragments.
+ */
+void BufferingFragmentStorage::flushBinIndex(
+    const unsigned threadNumber,
+    const unsigned binNumber,
+    const FragmentBuffer::IndexConstIterator binBegin,
+    const FragmentBuffer::IndexConstIterator binEnd)
+{
+    // reopens the thread file handle, the bin data is flushed by now
+    std::ostream osIndex(threadDataFileBufCaches_[threadNumber].get(binIndexPaths_[binNumber]));
+    for(FragmentBuffer::IndexConstIterator currentBinIterator = binBegin; binEnd != currentBinIterator; ++currentBinIterator)
+    {
+        const io::FragmentIndexRecord indexRecord(currentBinIterator->fragment());
+        if (!osIndex.write(reinterpret_cast<const char *>(&indexRecord), sizeof(indexRecord))) {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write into " + binIndexPaths_[binNumber].string()));
+        }
+    }
+    osIndex.flush();
+}
+
 
 void BufferingFragmentStorage::flushUnmappedBin(
     const unsigned threadNumber,
@@ -242,8 +275,8 @@ void BufferingFragmentStorage::flush()
 
     ISAAC_ASSERT_MSG(binPathList_.size() == nextUnflushedBin, "Discrepancy between total bins and flushed bins count");
 
+    storedTile_ += flushBuffer_.getTiles();
     flushBuffer_.clear();
-    ++storedTile_;
 
     ISAAC_THREAD_CERR << "Flushing buffer done for " << nextUnflushedBin << " bins" << std::endl;
 }
@@ -0,0 +1,276 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ClusterMatchGrouper.cpp
+ **
+ ** \brief See ClusterMatchGrouper.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include "alignment/matchSelector/ClusterMatchGrouper.hh"
+#include "common/Debug.hh"
+
+namespace isaac
+{
+namespace alignment
+{
+namespace matchSelector
+{
+
+static bool orderByLocationSeed(const Match &left, const Match &right)
+{
+    // same location for different seed numbers designates different locations for the fragment
+    // ensure consistency of results by ordering by the seed as well
+    return left.location < right.location ||
+        (left.location == right.location && left.seedId.getSeed() < right.seedId.getSeed());
+}
+
+ClusterMatchGrouper::ClusterMatchGrouper(
+    common::ThreadVector &threads,
+    const unsigned long maxTileClusters,
+    const unsigned barcodesCount):
+        threads_(threads),
+        barcodesCount_(barcodesCount)
+{
+    ISAAC_ASSERT_MSG(barcodesCount_ <= 0x10000, "Too many barcodes: " << barcodesCount_);
+    clusterMatchCounts_.reserve(maxTileClusters);
+    clusterBarcodes_.reserve(maxTileClusters);
+    clusterOffsets_.reserve(maxTileClusters);
+    clustersByRank_.reserve(maxTileClusters);
+    barcodeClusters_.reserve(barcodesCount_);
+    barcodeMatches_.reserve(barcodesCount_);
+    ranges_.reserve(threads_.size() * RANGES_PER_THREAD * 2);
+    splitRanges_.reserve(ranges_.capacity());
+}
+
+void ClusterMatchGrouper::unreserve()
+{
+    std::vector<unsigned>().swap(clusterMatchCounts_);
+    std::vector<unsigned short>().swap(clusterBarcodes_);
+    std::vector<unsigned long>().swap(clusterOffsets_);
+    std::vector<unsigned>().swap(clustersByRank_);
+    std::vector<unsigned long>().swap(barcodeClusters_);
+    std::vector<unsigned long>().swap(barcodeMatches_);
+    RankRanges().swap(ranges_);
+    RankRanges().swap(splitRanges_);
+}
+
+void ClusterMatchGrouper::countMatches(const unsigned threadNumber, const std::vector<Match> &matches)
+{
+    const std::vector<Match>::const_iterator begin = matches.begin() + matches.size() * threadNumber / threads_.size();
+    const std::vector<Match>::const_iterator end = matches.begin() + matches.size() * (threadNumber + 1) / threads_.size();
+    for (std::vector<Match>::const_iterator it = begin; end != it; ++it)
+    {
+        const unsigned long cluster = it->getCluster();
+        ISAAC_ASSERT_MSG(clusterMatchCounts_.size() > cluster, "Cluster id is outside of the tile: " << *it);
+        // all matches of a cluster have the same barcode. Whichever thread counts the first one stores it.
+        if (!__sync_fetch_and_add(&clusterMatchCounts_[cluster], 1))
+        {
+            clusterBarcodes_[cluster] = it->getBarcode();
+        }
+    }
+}
+
+void ClusterMatchGrouper::rankClusters(const unsigned long tileClusters)
+{
+    barcodeClusters_.assign(barcodesCount_, 0);
+    barcodeMatches_.assign(barcodesCount_, 0);
+    for (unsigned long cluster = 0; tileClusters > cluster; ++cluster)
+    {
+        const unsigned barcode = clusterBarcodes_[cluster];
+        ISAAC_ASSERT_MSG(barcodesCount_ > barcode, "Unexpected barcode index " << barcode << " for cluster " << cluster);
+        ++barcodeClusters_[barcode];
+        barcodeMatches_[barcode] += clusterMatchCounts_[cluster];
+    }
+
+    // turn the counts into the rank and offset of the first cluster of each barcode
+    unsigned long rank = 0;
+    unsigned long offset = 0;
+    for (unsigned barcode = 0; barcodesCount_ > barcode; ++barcode)
+    {
+        std::swap(rank, barcodeClusters_[barcode]);
+        rank += barcodeClusters_[barcode];
+        std::swap(offset, barcodeMatches_[barcode]);
+        offset += barcodeMatches_[barcode];
+    }
+
+    for (unsigned long cluster = 0; tileClusters > cluster; ++cluster)
+    {
+        const unsigned barcode = clusterBarcodes_[cluster];
+        clustersByRank_[barcodeClusters_[barcode]++] = cluster;
+        clusterOffsets_[cluster] = barcodeMatches_[barcode];
+        barcodeMatches_[barcode] += clusterMatchCounts_[cluster];
+    }
+}
+
+void ClusterMatchGrouper::splitRanges(
+    const unsigned long tileClusters,
+    std::vector<Match> &matches,
+    std::size_t &nextRange)
+{
+    while (true)
+    {
+        std::size_t ourRange = 0;
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            if (ranges_.size() == nextRange)
+            {
+                break;
+            }
+            ourRange = nextRange++;
+        }
+
+        const RankRange &range = ranges_[ourRange];
+        const unsigned long beginOffset = getRankOffset(range.first, tileClusters, matches.size());
+        const unsigned long endOffset = getRankOffset(range.second, tileClusters, matches.size());
+        unsigned long middle = range.second;
+        if (MIN_RANGE_MATCHES < endOffset - beginOffset)
+        {
+            // find the first cluster that starts in the second half of the range matches.
+            const unsigned long middleOffset = beginOffset + (endOffset - beginOffset) / 2;
+            unsigned long low = range.first + 1;
+            unsigned long high = range.second;
+            while (low < high)
+            {
+                const unsigned long rank = low + (high - low) / 2;
+                if (getRankOffset(rank, tileClusters, matches.size()) < middleOffset)
+                {
+                    low = rank + 1;
+                }
+                else
+                {
+                    high = rank;
+                }
+            }
+            middle = low;
+        }
+
+        if (range.second != middle)
+        {
+            const unsigned long middleOffset = getRankOffset(middle, tileClusters, matches.size());
+            const std::vector<Match>::iterator partitionPoint = std::partition(
+                matches.begin() + beginOffset, matches.begin() + endOffset,
+                boost::bind(&ClusterMatchGrouper::isBefore, this, _1, middleOffset));
+            ISAAC_ASSERT_MSG(matches.begin() + middleOffset == partitionPoint, "Partitioning must stop at the cluster bucket boundary");
+        }
+        splitRanges_[ourRange * 2] = RankRange(range.first, middle);
+        splitRanges_[ourRange * 2 + 1] = RankRange(middle, range.second);
+    }
+}
+
+void ClusterMatchGrouper::groupRange(
+    const RankRange &range,
+    const unsigned long tileClusters,
+    std::vector<Match> &matches)
+{
+    // from now on, the count is the number of matches already moved into the cluster bucket
+    for (unsigned long rank = range.first; range.second != rank; ++rank)
+    {
+        clusterMatchCounts_[clustersByRank_[rank]] = 0;
+    }
+
+    for (unsigned long rank = range.first; range.second != rank; ++rank)
+    {
+        const unsigned cluster = clustersByRank_[rank];
+        const unsigned long clusterBegin = clusterOffsets_[cluster];
+        const unsigned long clusterEnd = getRankOffset(rank + 1, tileClusters, matches.size());
+        unsigned &placed = clusterMatchCounts_[cluster];
+        while (clusterBegin + placed < clusterEnd)
+        {
+            Match &match = matches[clusterBegin + placed];
+            const unsigned long matchCluster = match.getCluster();
+            if (cluster == matchCluster)
+            {
+                ++placed;
+            }
+            else
+            {
+                // the match goes to the next free position of its own bucket. Whatever was there gets checked next.
+                std::swap(match, matches[clusterOffsets_[matchCluster] + clusterMatchCounts_[matchCluster]++]);
+            }
+        }
+        // the bucket is complete and nothing will be swapped into it anymore
+        std::sort(matches.begin() + clusterBegin, matches.begin() + clusterEnd, orderByLocationSeed);
+    }
+}
+
+void ClusterMatchGrouper::groupRanges(
+    const unsigned long tileClusters,
+    std::vector<Match> &matches,
+    std::size_t &nextRange)
+{
+    while (true)
+    {
+        std::size_t ourRange = 0;
+        {
+            boost::lock_guard<boost::mutex> lock(mutex_);
+            if (ranges_.size() == nextRange)
+            {
+                break;
+            }
+            ourRange = nextRange++;
+        }
+        groupRange(ranges_[ourRange], tileClusters, matches);
+    }
+}
+
+void ClusterMatchGrouper::group(const unsigned long tileClusters, std::vector<Match> &matches)
+{
+    ISAAC_ASSERT_MSG(clusterMatchCounts_.capacity() >= tileClusters,
+                     "Tile cluster count " << tileClusters << " exceeds the reserved " << clusterMatchCounts_.capacity());
+
+    clusterMatchCounts_.assign(tileClusters, 0);
+    clusterBarcodes_.assign(tileClusters, 0);
+    clusterOffsets_.resize(tileClusters);
+    clustersByRank_.resize(tileClusters);
+
+    threads_.execute(boost::bind(&ClusterMatchGrouper::countMatches, this, _1, boost::cref(matches)));
+    rankClusters(tileClusters);
+
+    ranges_.clear();
+    ranges_.push_back(RankRange(0, tileClusters));
+    while (threads_.size() * RANGES_PER_THREAD > ranges_.size())
+    {
+        splitRanges_.resize(ranges_.size() * 2);
+        std::size_t nextRange = 0;
+        threads_.execute(boost::bind(&ClusterMatchGrouper::splitRanges, this,
+                                     tileClusters, boost::ref(matches), boost::ref(nextRange)));
+
+        const std::size_t rangesBefore = ranges_.size();
+        ranges_.clear();
+        BOOST_FOREACH(const RankRange &range, splitRanges_)
+        {
+            if (range.first != range.second)
+            {
+                ranges_.push_back(range);
+            }
+        }
+        if (rangesBefore == ranges_.size())
+        {
+            // none of the ranges could be split further
+            break;
+        }
+    }
+
+    std::size_t nextRange = 0;
+    threads_.execute(boost::bind(&ClusterMatchGrouper::groupRanges, this,
+                                 tileClusters, boost::ref(matches), boost::ref(nextRange)));
+}
+
+} // namespace matchSelector
+} // namespace alignment
+} // namespace isaac
@@ -50,7 +50,8 @@ void FragmentCollector::add(
     const alignment::FragmentMetadata &fragment = bamTemplate.getFragmentMetadata(fragmentIndex);
     ISAAC_THREAD_CERR_DEV_TRACE_CLUSTER_ID(fragment.getCluster().getId(), "FragmentCollector::add: " << fragment);
     FragmentBuffer::IndexRecord &recordStart =
-        buffer_.initialize(fragment.getCluster().getId(), fragment.getReadIndex());
+        buffer_.initialize(tileClusterOffsets_[fragment.getCluster().getTile()] + fragment.getCluster().getId(),
+                           fragment.getReadIndex());
     recordStart.fStrandPos_ = fragment.getFStrandReferencePosition();
     storeBclAndCigar(fragment, recordStart);
 
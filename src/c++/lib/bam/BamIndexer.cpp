@@ -17,8 +17,14 @@
  ** \author Lilian Janin
  **/
 
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+
+#include "bam/Bam.hh"
 #include "bam/BamIndexer.hh"
 #include "alignment/Cigar.hh"
+#include "bgzf/BgzfCompressor.hh"
 
 
 namespace isaac
@@ -26,11 +32,86 @@ namespace isaac
 namespace bam
 {
 
+namespace
+{
+
+/**
+ * \brief Walks the bgzf block headers of a compressed buffer to map uncompressed offsets onto virtual offsets.
+ *        Offsets are expected to be mostly increasing. The chunk reduction can make them step back by less
+ *        than a block, so the previous block is remembered to avoid rescanning the buffer from the start.
+ */
+class BgzfBlockCursor
+{
+    struct Block
+    {
+        Block() : compressedPosition_(0), uncompressedPosition_(0), compressedSize_(0), uncompressedSize_(0) {}
+        uint64_t compressedPosition_;
+        uint64_t uncompressedPosition_;
+        uint32_t compressedSize_;
+        uint32_t uncompressedSize_;
+    };
+
+    const std::vector<char> &bgzfBuffer_;
+    Block previous_;
+    Block current_;
+
+public:
+    BgzfBlockCursor(const std::vector<char> &bgzfBuffer) : bgzfBuffer_(bgzfBuffer) {}
+
+    VirtualOffset resolve(const UnresolvedOffset unresolvedPos)
+    {
+        if (unresolvedPos < current_.uncompressedPosition_)
+        {
+            current_ = unresolvedPos < previous_.uncompressedPosition_ ? Block() : previous_;
+            previous_ = Block();
+        }
+        while (unresolvedPos >= current_.uncompressedPosition_ + current_.uncompressedSize_)
+        {
+            previous_ = current_;
+            current_.compressedPosition_ += current_.compressedSize_;
+            current_.uncompressedPosition_ += current_.uncompressedSize_;
+            if (current_.compressedPosition_ == bgzfBuffer_.size())
+            {
+                current_.compressedSize_ = 0;
+                current_.uncompressedSize_ = 0;
+                break;
+            }
+            const uint64_t pos = current_.compressedPosition_;
+            ISAAC_ASSERT_MSG( pos+17 < bgzfBuffer_.size(), "Error while parsing BGZF block during indexing: trying to read past end of buffer" );
+            ISAAC_ASSERT_MSG( bgzfBuffer_[pos+0] == '\x1f' && bgzfBuffer_[pos+1] == '\x8b' &&
+                              bgzfBuffer_[pos+2] == '\x08' && bgzfBuffer_[pos+3] == '\x04' &&
+                              bgzfBuffer_[pos+12] == '\x42' && bgzfBuffer_[pos+13] == '\x43',
+                              "Error while parsing BGZF block during indexing: invalid block header at " << pos );
+            const uint16_t compressedBlockSize   = *((uint16_t*)(&bgzfBuffer_[pos+16]));
+            const uint32_t uncompressedBlockSize = *((uint32_t*)(&bgzfBuffer_[pos+compressedBlockSize-3]));
+            current_.compressedSize_ = compressedBlockSize + 1;
+            current_.uncompressedSize_ = uncompressedBlockSize;
+        }
+
+        VirtualOffset result;
+        result.set(current_.compressedPosition_, unresolvedPos - current_.uncompressedPosition_);
+        return result;
+    }
+};
 
-BamIndexPart::BamIndexPart()
-    : localUncompressedOffset_( 0 )
+template <typename T>
+void writeIndexValue(std::ostream &os, const T &value)
+{
+    if (!os.write(reinterpret_cast<const char*>(&value), sizeof(value)))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing bam index"));
+    }
+}
+
+} // namespace
+
+
+BamIndexPart::BamIndexPart(const BamIndexBinning &binning)
+    : binning_( binning )
+    , localUncompressedOffset_( 0 )
     , bamStatsMapped_( 0 )
     , bamStatsNmapped_( 0 )
+    , resolved_( false )
 {
     initStructures();
 }
@@ -38,7 +119,7 @@ BamIndexPart::BamIndexPart()
 void BamIndexPart::initStructures()
 {
     chunks_.reserve( BAM_INDEXER_MAX_CHUNKS );
-    linearIndex_.reserve( BAM_MAX_CONTIG_LENGTH / 16384 );
+    linearIndex_.reserve( binning_.getLinearIndexSize() );
 }
 
 void BamIndexPart::processFragment( const build::FragmentAccessorBamAdapter& alignment, uint32_t serializedLength )
@@ -48,7 +129,7 @@ void BamIndexPart::processFragment( const build::FragmentAccessorBamAdapter& ali
     if (alignment.pos() >= 0)
     {
         uint32_t observedLength = alignment.observedLength();
-        const uint32_t bin(bam_reg2bin(alignment.pos(), alignment.pos() + alignment.seqLen())); // it would be more correct to use observedLength instead of alignment.seqLen(), but samtools is doing it this way.
+        const uint32_t bin(binning_.reg2bin(alignment.pos(), alignment.pos() + alignment.seqLen())); // it would be more correct to use observedLength instead of alignment.seqLen(), but samtools is doing it this way.
 
         addToBinIndexChunks( localUncompressedOffset_, localUncompressedOffset_ + serializedLength, bin, alignment.refId() );
         addToLinearIndex( alignment.pos(), localUncompressedOffset_ );
@@ -73,7 +154,7 @@ void BamIndexPart::processFragment( const build::FragmentAccessorBamAdapter& ali
 
 void BamIndexPart::addToBinIndexChunks( const UnresolvedOffset virtualOffset, const UnresolvedOffset virtualEndOffset, const uint32_t bin, const uint32_t refId )
 {
-    ISAAC_ASSERT_MSG( bin < BAM_MAX_BIN, "Invalid bin number in uncompressed BAM" );
+    ISAAC_ASSERT_MSG( bin < binning_.getBinCount(), "Invalid bin number in uncompressed BAM" );
 
     if (!chunks_.empty() &&
         bin == chunks_.back().bin &&
@@ -95,13 +176,10 @@ void BamIndexPart::addToBinIndexChunks( const UnresolvedOffset virtualOffset, co
     }
 }
 
-void BamIndexPart::addToLinearIndex( const uint32_t pos, const UnresolvedOffset virtualOffset )
+void BamIndexPart::addToLinearIndex( const uint64_t pos, const UnresolvedOffset virtualOffset )
 {
-    if (pos >= BAM_MAX_CONTIG_LENGTH)
-    {
-        ISAAC_ASSERT_MSG( pos < BAM_MAX_CONTIG_LENGTH, "Alignment position greater than the maximum allowed by BAM index: " << pos);
-    }
-    const uint32_t linearBin = pos>>14;
+    ISAAC_ASSERT_MSG( pos < binning_.getMaxPosition(), "Alignment position greater than the maximum allowed by BAM index: " << pos);
+    const uint64_t linearBin = pos >> BamIndexBinning::MIN_SHIFT;
     if ( linearIndex_.size() <= linearBin )
     {
         const UnresolvedOffset lastValue = linearIndex_.empty()?0xFFFFFFFFFFFFFFFF:linearIndex_.back();
@@ -113,56 +191,86 @@ void BamIndexPart::addToLinearIndex( const uint32_t pos, const UnresolvedOffset
     }
 }
 
+void BamIndexPart::resolve(const std::vector<char> &bgzfBuffer)
+{
+    ISAAC_ASSERT_MSG(!resolved_, "Bam index part offsets are already resolved");
+    // chunk start and end offsets interleave almost in order
+    BgzfBlockCursor chunkCursor(bgzfBuffer);
+    BOOST_FOREACH(UnresolvedBinIndexChunk &chunk, chunks_)
+    {
+        chunk.startPos = chunkCursor.resolve(chunk.startPos).get();
+        chunk.endPos = chunkCursor.resolve(chunk.endPos).get();
+    }
+
+    // linear index offsets are in order
+    BgzfBlockCursor linearIndexCursor(bgzfBuffer);
+    BOOST_FOREACH(UnresolvedOffset &offset, linearIndex_)
+    {
+        if (offset != 0xFFFFFFFFFFFFFFFF)
+        {
+            offset = linearIndexCursor.resolve(offset).get();
+        }
+    }
+    resolved_ = true;
+}
+
 
 BamIndex::BamIndex()
-    : bamRefCount_( 0 )
+    : binning_()
+    , bamRefCount_( 0 )
     , lastProcessedRefId_( 0xFFFFFFFF )
-    , baiStream_()
-    , binIndex_( BAM_MAX_BIN )
+    , indexFile_()
+    , binIndex_( binning_.getBinCount() )
     , binIndexEmpty_(true)
     , bamStatsMapped_( 0 )
     , bamStatsNmapped_( 0 )
+    , bamStatsGlobalNoCoordinates_( 0 )
     , positionInBam_( 0 )
-    , currentBgzfBlockCompressedPosition_( 0 )
-    , currentBgzfBlockUncompressedPosition_( 0 )
-    , currentBgzfBlockCompressedSize_( 0 )
-    , currentBgzfBlockUncompressedSize_( 0 )
 {
 }
 
 
-BamIndex::BamIndex(const boost::filesystem::path &bamPath, const uint32_t bamRefCount, const uint32_t bamHeaderCompressedLength)
-    : bamRefCount_( bamRefCount )
+BamIndex::BamIndex(const boost::filesystem::path &bamPath, const uint32_t bamRefCount, const uint32_t bamHeaderCompressedLength,
+                   const BamIndexBinning &binning)
+    : binning_( binning )
+    , bamRefCount_( bamRefCount )
     , lastProcessedRefId_( 0xFFFFFFFF )
-    , baiStream_( (bamPath.string() + ".bai").c_str() )
-    , binIndex_( BAM_MAX_BIN )
+    , indexFile_( (bamPath.string() + (binning_.isCsi() ? ".csi" : ".bai")).c_str(), std::ios_base::binary )
+    , binIndex_( binning_.getBinCount() )
     , binIndexEmpty_(true)
     , bamStatsMapped_( 0 )
     , bamStatsNmapped_( 0 )
     , bamStatsGlobalNoCoordinates_( 0 )
     , positionInBam_( bamHeaderCompressedLength )
-    , currentBgzfBlockCompressedPosition_( 0 )
-    , currentBgzfBlockUncompressedPosition_( 0 )
-    , currentBgzfBlockCompressedSize_( 0 )
-    , currentBgzfBlockUncompressedSize_( 0 )
 {
-    if( !baiStream_)
+    if( !indexFile_)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Error opening bam index file for writing: " + bamPath.string()));
+    }
+    // index of the other kind left over from a previous run would not match the new bam
+    boost::filesystem::remove(bamPath.string() + (binning_.isCsi() ? ".bai" : ".csi"));
+    if (binning_.isCsi())
     {
-        BOOST_THROW_EXCEPTION(common::IoException(errno, "Error opening bam index file for writing"));
+        csiStream_.push(bgzf::BgzfCompressor());
+        csiStream_.push(indexFile_);
     }
     initStructures();
-    outputBaiHeader();
+    outputHeader();
 }
 
 void BamIndex::initStructures()
 {
-    ISAAC_ASSERT_MSG( binIndex_.size() == BAM_MAX_BIN, "Unexpected number of bins in Bam index" );
-    for (uint32_t i=0; i<BAM_MAX_BIN; ++i)
+    ISAAC_ASSERT_MSG( binIndex_.size() == binning_.getBinCount(), "Unexpected number of bins in Bam index" );
+    for (uint32_t i=0; i<binIndex_.size(); ++i)
     {
-        binIndex_[i].reserve( MAX_CLUSTER_PER_INDEX_BIN );
+        // upper level bins past the end of the longest contig never get any chunks either
+        if (binning_.getBinStart(i) < binning_.getMaxContigLength())
+        {
+            binIndex_[i].reserve( MAX_CLUSTER_PER_INDEX_BIN );
+        }
     }
     binIndexEmpty_ = true;
-    linearIndex_.reserve( BAM_MAX_CONTIG_LENGTH / 16384 );
+    linearIndex_.reserve( binning_.getLinearIndexSize() );
 }
 
 void BamIndex::outputIndexFile()
@@ -176,31 +284,53 @@ void BamIndex::outputIndexFile()
     {
         ISAAC_ASSERT_MSG (lastProcessedRefId_ < bamRefCount_,
                           "Bam indexer processed more chromosomes than was declared in Bam header" );
-        outputBaiChromosomeIndex();
+        outputChromosomeIndex();
         lastProcessedRefId_++;
     }
-    outputBaiFooter();
+    outputFooter();
 }
 
-void BamIndex::outputBaiHeader()
+void BamIndex::outputHeader()
 {
-    if (!baiStream_.write("BAI\1", 4) ||
-        !baiStream_.write(reinterpret_cast<const char*>(&bamRefCount_), 4))
+    std::ostream &os = getIndexStream();
+    if (binning_.isCsi())
+    {
+        const int32_t minShift = BamIndexBinning::MIN_SHIFT;
+        const int32_t depth = binning_.getDepth();
+        const int32_t auxLength = 0;
+        if (!os.write("CSI\1", 4) ||
+            !os.write(reinterpret_cast<const char*>(&minShift), 4) ||
+            !os.write(reinterpret_cast<const char*>(&depth), 4) ||
+            !os.write(reinterpret_cast<const char*>(&auxLength), 4) ||
+            !os.write(reinterpret_cast<const char*>(&bamRefCount_), 4))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing bam index header"));
+        }
+    }
+    else if (!os.write("BAI\1", 4) ||
+             !os.write(reinterpret_cast<const char*>(&bamRefCount_), 4))
     {
         BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing bam index header"));
     }
 }
 
-void BamIndex::outputBaiChromosomeIndex()
+/**
+ * \brief CSI has no linear index. Each bin carries the offset of the first record overlapping it instead.
+ */
+VirtualOffset BamIndex::getBinLinearOffset(const uint32_t bin, const std::vector< VirtualOffsetPair > &binIndexEntry) const
 {
-    struct {
-        uint32_t binNum;
-        uint32_t nClusters;
-        uint64_t offBeg, offEnd;
-        uint64_t mapped, nmapped;
-    } __attribute__ ((packed))
-          specialBin = { BAM_MAX_BIN, 2, 0, 0, bamStatsMapped_, bamStatsNmapped_ };
+    const uint64_t window = binning_.getBinStart(bin) >> BamIndexBinning::MIN_SHIFT;
+    VirtualOffset ret = binIndexEntry.front().first;
+    if (window < linearIndex_.size() && linearIndex_[window].get() && linearIndex_[window].get() < ret.get())
+    {
+        ret = linearIndex_[window];
+    }
+    return ret;
+}
 
+void BamIndex::outputChromosomeIndex()
+{
+    std::ostream &os = getIndexStream();
     uint32_t nBin = binIndexEmpty_ ? 0 : std::count_if( binIndex_.begin(),
                                                         binIndex_.end(),
                                                         boost::bind(&std::vector< VirtualOffsetPair >::empty, _1) == false );
@@ -208,73 +338,97 @@ void BamIndex::outputBaiChromosomeIndex()
     if (nBin > 0 || bamStatsMapped_ > 0 || bamStatsNmapped_ > 0)
     {
         ++nBin; // Add samtools' special bin to the count
-        if (!baiStream_.write(reinterpret_cast<const char*>(&nBin), 4))
-        {
-            BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing bam chromosome index"));
-        }
+        writeIndexValue(os, nBin);
 
-        unsigned int i=0;
+        uint64_t offBeg = 0, offEnd = 0;
+        uint32_t i=0;
         BOOST_FOREACH( const std::vector< VirtualOffsetPair >& binIndexEntry, binIndex_ )
         {
             if ( !binIndexEntry.empty() )
             {
                 const uint32_t nChunk = binIndexEntry.size();
-                if (!baiStream_.write(reinterpret_cast<const char*>(&i), 4) ||
-                    !baiStream_.write(reinterpret_cast<const char*>(&nChunk), 4) ||
-                    !baiStream_.write(reinterpret_cast<const char*>(&binIndexEntry[0]), nChunk*16))
+                writeIndexValue(os, i);
+                if (binning_.isCsi())
+                {
+                    writeIndexValue(os, getBinLinearOffset(i, binIndexEntry).get());
+                }
+                writeIndexValue(os, nChunk);
+                if (!os.write(reinterpret_cast<const char*>(&binIndexEntry[0]), nChunk*16))
                 {
                     BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing bam chromosome index"));
                 }
 
                 // Fill in samtools' "specialBin" bamStats
-                if (specialBin.offBeg > binIndexEntry[0].first.get() || specialBin.offBeg == 0)
+                if (offBeg > binIndexEntry[0].first.get() || offBeg == 0)
                 {
-                    specialBin.offBeg = binIndexEntry[0].first.get();
+                    offBeg = binIndexEntry[0].first.get();
                 }
-                if (specialBin.offEnd < binIndexEntry[nChunk-1].second.get() || specialBin.offEnd == 0)
+                if (offEnd < binIndexEntry[nChunk-1].second.get() || offEnd == 0)
                 {
-                    specialBin.offEnd = binIndexEntry[nChunk-1].second.get();
+                    offEnd = binIndexEntry[nChunk-1].second.get();
                 }
             }
             ++i;
         }
 
         // Write special samtools bin
-        baiStream_.write(reinterpret_cast<const char*>(&specialBin), sizeof(specialBin));
+        writeIndexValue(os, binning_.getPseudoBin());
+        if (binning_.isCsi())
+        {
+            writeIndexValue(os, uint64_t(0));
+        }
+        writeIndexValue(os, uint32_t(2));
+        writeIndexValue(os, offBeg);
+        writeIndexValue(os, offEnd);
+        writeIndexValue(os, bamStatsMapped_);
+        writeIndexValue(os, bamStatsNmapped_);
     }
     else
     {
-        baiStream_.write(reinterpret_cast<const char*>(&nBin), 4); // nBin==0
+        writeIndexValue(os, nBin); // nBin==0
     }
 
-    // Write linear index
-    const uint32_t nIntv = linearIndex_.size();
-
-    if (!baiStream_.write(reinterpret_cast<const char*>(&nIntv), 4) ||
-        (!linearIndex_.empty() && !baiStream_.write(reinterpret_cast<const char*>(&linearIndex_.front()), nIntv*8)))
+    if (!binning_.isCsi())
     {
-        BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing bam linear index"));
+        // Write linear index
+        const uint32_t nIntv = linearIndex_.size();
+
+        if (!os.write(reinterpret_cast<const char*>(&nIntv), 4) ||
+            (!linearIndex_.empty() && !os.write(reinterpret_cast<const char*>(&linearIndex_.front()), nIntv*8)))
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing bam linear index"));
+        }
     }
     // reset variables to make them ready to process the next chromosome
     clearStructures();
 }
 
-void BamIndex::outputBaiFooter()
+void BamIndex::outputFooter()
 {
     // output number of coor-less reads (special samtools field)
-    if (!baiStream_.write(reinterpret_cast<const char*>(&bamStatsGlobalNoCoordinates_), 8))
+    writeIndexValue(getIndexStream(), bamStatsGlobalNoCoordinates_);
+    if (binning_.isCsi())
+    {
+        if (!csiStream_.strict_sync())
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Error compressing bam index"));
+        }
+        serializeBgzfFooter(indexFile_);
+    }
+    if (!indexFile_.flush())
     {
         BOOST_THROW_EXCEPTION(common::IoException(errno, "Error writing bam index footer"));
     }
 }
 
 void BamIndex::processIndexPart(const bam::BamIndexPart &bamIndexPart,
-                                const std::vector<char> &bgzfBuffer)
+                                const uint64_t bgzfBufferSize)
 {
-    if (bgzfBuffer.empty())
+    if (!bgzfBufferSize)
     {
         return;
     }
+    ISAAC_ASSERT_MSG(bamIndexPart.resolved_, "Bam index part offsets must be resolved before merging");
 
     if (!bamIndexPart.chunks_.empty())
     {
@@ -291,14 +445,15 @@ void BamIndex::processIndexPart(const bam::BamIndexPart &bamIndexPart,
             {
                 ISAAC_ASSERT_MSG (lastProcessedRefId_ < refId,
                                   "Bam indexer tries to process more chromosomes than was declared in Bam header" );
-                outputBaiChromosomeIndex();
+                outputChromosomeIndex();
                 lastProcessedRefId_++;
             }
         }
 
-        resetBgzfParsing();
-        mergeBinIndex( bamIndexPart.chunks_, bgzfBuffer );
-        mergeLinearIndex( bamIndexPart.linearIndex_, bgzfBuffer );
+        // part offsets are relative to the start of its bgzf data
+        const uint64_t shift = positionInBam_ << 16;
+        mergeBinIndex( bamIndexPart.chunks_, shift );
+        mergeLinearIndex( bamIndexPart.linearIndex_, shift );
 
         bamStatsMapped_ += bamIndexPart.bamStatsMapped_;
         bamStatsNmapped_ += bamIndexPart.bamStatsNmapped_;
@@ -310,65 +465,18 @@ void BamIndex::processIndexPart(const bam::BamIndexPart &bamIndexPart,
     }
 
     // Add offset for next index part
-    positionInBam_ += bgzfBuffer.size();
+    positionInBam_ += bgzfBufferSize;
 }
-// debug stuff
-//void BamIndex::printBgzfInfo( const std::vector<char> bgzfBuffer )
-//{
-//    uint64_t compressedSize = bgzfBuffer.size();
-//    uint64_t uncompressedSize = 0;
-//    baiStream_ << "total compressedSize:   " << compressedSize << std::endl;
-//    baiStream_ << "uncompressedSize: " << uncompressedSize << std::endl;
-//
-//    uint64_t posInBgzf = 0;
-//    while (posInBgzf < bgzfBuffer.size())
-//    {
-//        baiStream_ << "** posInBgzf:   " << posInBgzf << std::endl;
-//        ISAAC_ASSERT_MSG( bgzfBuffer[posInBgzf+0] == '\x1f', "Error while parsing BGZF block during indexing: invalid byte 0" );
-//        ISAAC_ASSERT_MSG( bgzfBuffer[posInBgzf+1] == '\x8b', "Error while parsing BGZF block during indexing: invalid byte 1" );
-//        ISAAC_ASSERT_MSG( bgzfBuffer[posInBgzf+2] == '\x08', "Error while parsing BGZF block during indexing: invalid byte 2" );
-//        ISAAC_ASSERT_MSG( bgzfBuffer[posInBgzf+3] == '\x04', "Error while parsing BGZF block during indexing: invalid byte 3" );
-//        ISAAC_ASSERT_MSG( bgzfBuffer[posInBgzf+12] == '\x42', "Error while parsing BGZF block during indexing: invalid byte 12" );
-//        ISAAC_ASSERT_MSG( bgzfBuffer[posInBgzf+13] == '\x43', "Error while parsing BGZF block during indexing: invalid byte 13" );
-//        uint16_t compressedBlockSize   = *((uint16_t*)(&bgzfBuffer[posInBgzf+16]));
-//        uint32_t uncompressedBlockSize = *((uint32_t*)(&bgzfBuffer[posInBgzf+compressedBlockSize-3]));
-//        baiStream_ << "compressedBlockSize: "   << compressedBlockSize   << std::endl;
-//        baiStream_ << "uncompressedBlockSize: " << uncompressedBlockSize << std::endl;
-//        posInBgzf += compressedBlockSize + 1;
-//    }
-//    ISAAC_ASSERT_MSG( posInBgzf == bgzfBuffer.size(), "Error while parsing BGZF block during indexing: end of last block doesn't match end of buffer" );
-//}
-//
-//void BamIndex::printBamIndexPartInfo( const bam::BamIndexPart &bamIndexPart )
-//{
-//    baiStream_ << "bamIndexPart.localUncompressedOffset_: " << bamIndexPart.localUncompressedOffset_ << std::endl;
-//    baiStream_ << "bamIndexPart.bamStatsMapped_: " << bamIndexPart.bamStatsMapped_ << std::endl;
-//    baiStream_ << "bamIndexPart.bamStatsNmapped_: " << bamIndexPart.bamStatsNmapped_ << std::endl;
-//    uint32_t binNum = 0;
-//    BOOST_FOREACH( const UnresolvedBinIndexChunk& chunk, bamIndexPart.chunks_ )
-//    {
-//        baiStream_ << "chunk[]: " << chunk.startPos << ", " << chunk.endPos << ", " << chunk.bin << ", " << chunk.refId << std::endl;
-//    }
-//    binNum = 0;
-//    BOOST_FOREACH( const UnresolvedOffset val, bamIndexPart.linearIndex_)
-//    {
-//        if (val)
-//        {
-//            baiStream_ << "linearIndex_[" << binNum << "]: " << val << std::endl;
-//        }
-//        ++binNum;
-//    }
-//}
-
-void BamIndex::mergeBinIndex( const std::vector<UnresolvedBinIndexChunk>& binIndexChunks, const std::vector<char> &bgzfBuffer )
+
+void BamIndex::mergeBinIndex( const std::vector<UnresolvedBinIndexChunk>& binIndexChunks, const uint64_t shift )
 {
     BOOST_FOREACH( const UnresolvedBinIndexChunk& chunk, binIndexChunks )
     {
-        addToBinIndex( chunk, bgzfBuffer );
+        addToBinIndex( chunk, shift );
     }
 }
 
-void BamIndex::mergeLinearIndex( const std::vector<UnresolvedOffset>& linearIndexToMerge, const std::vector<char> &bgzfBuffer )
+void BamIndex::mergeLinearIndex( const std::vector<UnresolvedOffset>& linearIndexToMerge, const uint64_t shift )
 {
     if (linearIndex_.size() < linearIndexToMerge.size())
     {
@@ -378,7 +486,8 @@ void BamIndex::mergeLinearIndex( const std::vector<UnresolvedOffset>& linearInde
     {
         if (linearIndexToMerge[i] != 0xFFFFFFFFFFFFFFFF)
         {
-            VirtualOffset off = resolveOffset( linearIndexToMerge[i], bgzfBuffer );
+            VirtualOffset off;
+            off.set(linearIndexToMerge[i] + shift);
             if (off.get() < linearIndex_[i].get() || linearIndex_[i].get() == 0)
             {
                 linearIndex_[i] = off;
@@ -387,13 +496,15 @@ void BamIndex::mergeLinearIndex( const std::vector<UnresolvedOffset>& linearInde
     }
 }
 
-void BamIndex::addToBinIndex( const UnresolvedBinIndexChunk& chunk, const std::vector<char> &bgzfBuffer )
+void BamIndex::addToBinIndex( const UnresolvedBinIndexChunk& chunk, const uint64_t shift )
 {
-    ISAAC_ASSERT_MSG( binIndex_.size() == BAM_MAX_BIN, "Unexpected number of bins in Bam index" );
-    ISAAC_ASSERT_MSG( chunk.bin < BAM_MAX_BIN, "Invalid bin number in uncompressed BAM" );
+    ISAAC_ASSERT_MSG( binIndex_.size() == binning_.getBinCount(), "Unexpected number of bins in Bam index" );
+    ISAAC_ASSERT_MSG( chunk.bin < binIndex_.size(), "Invalid bin number in uncompressed BAM" );
 
-    VirtualOffset start = resolveOffset(chunk.startPos, bgzfBuffer);
-    VirtualOffset end   = resolveOffset(chunk.endPos, bgzfBuffer);
+    VirtualOffset start;
+    start.set(chunk.startPos + shift);
+    VirtualOffset end;
+    end.set(chunk.endPos + shift);
 
     if (!binIndex_[chunk.bin].empty() && binIndex_[chunk.bin].back().second.compressedOffset() == start.compressedOffset())
     {
@@ -410,7 +521,7 @@ void BamIndex::addToBinIndex( const UnresolvedBinIndexChunk& chunk, const std::v
 void BamIndex::clearStructures()
 {
     bamStatsMapped_ = bamStatsNmapped_ = 0;
-    ISAAC_ASSERT_MSG( binIndex_.size() == BAM_MAX_BIN, "Unexpected number of bins in Bam index" );
+    ISAAC_ASSERT_MSG( binIndex_.size() == binning_.getBinCount(), "Unexpected number of bins in Bam index" );
     if (!binIndexEmpty_)
     {
         BOOST_FOREACH( std::vector< VirtualOffsetPair >& binIndexEntry, binIndex_)
@@ -420,51 +531,6 @@ void BamIndex::clearStructures()
     }
     binIndexEmpty_ = true;
     linearIndex_.clear();
-
-    resetBgzfParsing();
-}
-
-void BamIndex::resetBgzfParsing()
-{
-    currentBgzfBlockCompressedPosition_ = 0;
-    currentBgzfBlockUncompressedPosition_ = 0;
-    currentBgzfBlockCompressedSize_ = 0;
-    currentBgzfBlockUncompressedSize_ = 0;
-}
-
-VirtualOffset BamIndex::resolveOffset(UnresolvedOffset unresolvedPos, const std::vector<char> &bgzfBuffer)
-{
-    VirtualOffset result;
-    if ( unresolvedPos < currentBgzfBlockUncompressedPosition_ )
-    {
-        // This could be made more efficient
-        resetBgzfParsing();
-    }
-    while (unresolvedPos >= currentBgzfBlockUncompressedPosition_ + currentBgzfBlockUncompressedSize_)
-    {
-        currentBgzfBlockCompressedPosition_ += currentBgzfBlockCompressedSize_;
-        currentBgzfBlockUncompressedPosition_ += currentBgzfBlockUncompressedSize_;
-        if (currentBgzfBlockCompressedPosition_ == bgzfBuffer.size())
-        {
-            currentBgzfBlockCompressedSize_ = 0;
-            currentBgzfBlockUncompressedSize_ = 0;
-            break;
-        }
-        ISAAC_ASSERT_MSG( currentBgzfBlockCompressedPosition_+13 < bgzfBuffer.size(), "Error while parsing BGZF block during indexing: trying to read past end of buffer" );
-        ISAAC_ASSERT_MSG( bgzfBuffer[currentBgzfBlockCompressedPosition_+0] == '\x1f', "Error while parsing BGZF block during indexing: invalid byte 0" );
-        ISAAC_ASSERT_MSG( bgzfBuffer[currentBgzfBlockCompressedPosition_+1] == '\x8b', "Error while parsing BGZF block during indexing: invalid byte 1" );
-        ISAAC_ASSERT_MSG( bgzfBuffer[currentBgzfBlockCompressedPosition_+2] == '\x08', "Error while parsing BGZF block during indexing: invalid byte 2" );
-        ISAAC_ASSERT_MSG( bgzfBuffer[currentBgzfBlockCompressedPosition_+3] == '\x04', "Error while parsing BGZF block during indexing: invalid byte 3" );
-        ISAAC_ASSERT_MSG( bgzfBuffer[currentBgzfBlockCompressedPosition_+12] == '\x42', "Error while parsing BGZF block during indexing: invalid byte 12" );
-        ISAAC_ASSERT_MSG( bgzfBuffer[currentBgzfBlockCompressedPosition_+13] == '\x43', "Error while parsing BGZF block during indexing: invalid byte 13" );
-        uint16_t compressedBlockSize   = *((uint16_t*)(&bgzfBuffer[currentBgzfBlockCompressedPosition_+16]));
-        uint32_t uncompressedBlockSize = *((uint32_t*)(&bgzfBuffer[currentBgzfBlockCompressedPosition_+compressedBlockSize-3]));
-        currentBgzfBlockCompressedSize_ = compressedBlockSize + 1;
-        currentBgzfBlockUncompressedSize_ = uncompressedBlockSize;
-    }
-
-    result.set(currentBgzfBlockCompressedPosition_ + positionInBam_, unresolvedPos - currentBgzfBlockUncompressedPosition_);
-    return result;
 }
 
 
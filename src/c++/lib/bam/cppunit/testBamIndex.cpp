@@ -0,0 +1,284 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testBamIndex.hh"
+
+#include "bam/BamIndexer.hh"
+#include "bgzf/BgzfReader.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestBamIndex, registryName("BamIndex"));
+
+using isaac::bam::BamIndexBinning;
+
+void TestBamIndex::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testBamIndex-%%%%-%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+}
+
+void TestBamIndex::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+/**
+ * \brief Values of bam_reg2bin from the SAM specification, section 5.3
+ */
+void TestBamIndex::testBaiReg2bin()
+{
+    const BamIndexBinning bai;
+    CPPUNIT_ASSERT(!bai.isCsi());
+    CPPUNIT_ASSERT_EQUAL(5U, bai.getDepth());
+    CPPUNIT_ASSERT_EQUAL(37450U, bai.getPseudoBin());
+    CPPUNIT_ASSERT_EQUAL(1UL << 29, bai.getMaxPosition());
+
+    // 16kbp leaves start at 4681
+    CPPUNIT_ASSERT_EQUAL(4681U, bai.reg2bin(0, 1));
+    CPPUNIT_ASSERT_EQUAL(4681U, bai.reg2bin(0, 16384));
+    CPPUNIT_ASSERT_EQUAL(4681U, bai.reg2bin(16383, 16384));
+    CPPUNIT_ASSERT_EQUAL(4682U, bai.reg2bin(16384, 16385));
+    CPPUNIT_ASSERT_EQUAL(4681U + 4096U, bai.reg2bin(1 << 26, (1 << 26) + 100));
+    CPPUNIT_ASSERT_EQUAL(37448U, bai.reg2bin((1 << 29) - 1, 1 << 29));
+    // crossing a leaf boundary goes one level up for each boundary crossed
+    CPPUNIT_ASSERT_EQUAL(585U, bai.reg2bin(16383, 16385));
+    CPPUNIT_ASSERT_EQUAL(586U, bai.reg2bin(1 << 17, (1 << 17) + 16385));
+    CPPUNIT_ASSERT_EQUAL(73U, bai.reg2bin((1 << 17) - 1, (1 << 17) + 1));
+    CPPUNIT_ASSERT_EQUAL(9U, bai.reg2bin((1 << 20) - 1, (1 << 20) + 1));
+    CPPUNIT_ASSERT_EQUAL(1U, bai.reg2bin((1 << 23) - 1, (1 << 23) + 1));
+    CPPUNIT_ASSERT_EQUAL(2U, bai.reg2bin(1 << 26, 1 << 27));
+    CPPUNIT_ASSERT_EQUAL(8U, bai.reg2bin(7 << 26, 1 << 29));
+    CPPUNIT_ASSERT_EQUAL(0U, bai.reg2bin((1 << 26) - 1, (1 << 26) + 1));
+    CPPUNIT_ASSERT_EQUAL(0U, bai.reg2bin(0, 1 << 29));
+}
+
+/**
+ * \brief Values of reg2bin from the CSI specification with min_shift 14
+ */
+void TestBamIndex::testCsiReg2bin()
+{
+    // the shallowest CSI that reaches past the BAI limit
+    const BamIndexBinning csi(true, (1UL << 29) + 1);
+    CPPUNIT_ASSERT(csi.isCsi());
+    CPPUNIT_ASSERT_EQUAL(6U, csi.getDepth());
+    CPPUNIT_ASSERT_EQUAL(299594U, csi.getPseudoBin());
+    CPPUNIT_ASSERT_EQUAL(1UL << 32, csi.getMaxPosition());
+
+    // leaves start at ((1 << 18) - 1) / 7
+    CPPUNIT_ASSERT_EQUAL(37449U, csi.reg2bin(0, 1));
+    CPPUNIT_ASSERT_EQUAL(37450U, csi.reg2bin(16384, 16385));
+    CPPUNIT_ASSERT_EQUAL(37449U + 32768U, csi.reg2bin(1UL << 29, (1UL << 29) + 1));
+    CPPUNIT_ASSERT_EQUAL(299592U, csi.reg2bin((1UL << 32) - 1, 1UL << 32));
+    CPPUNIT_ASSERT_EQUAL(4681U, csi.reg2bin(16383, 16385));
+    CPPUNIT_ASSERT_EQUAL(1U, csi.reg2bin((1UL << 26) - 1, (1UL << 26) + 1));
+    CPPUNIT_ASSERT_EQUAL(2U, csi.reg2bin(1UL << 29, 1UL << 30));
+    CPPUNIT_ASSERT_EQUAL(0U, csi.reg2bin((1UL << 29) - 1, (1UL << 29) + 1));
+
+    // depth 5 CSI bins the same way BAI does
+    const BamIndexBinning csi5(true, 1UL << 29);
+    const BamIndexBinning bai;
+    CPPUNIT_ASSERT_EQUAL(5U, csi5.getDepth());
+    CPPUNIT_ASSERT_EQUAL(bai.getPseudoBin(), csi5.getPseudoBin());
+    for (unsigned long beg = 0; (1UL << 29) > beg; beg += 7777777)
+    {
+        for (unsigned long length = 1; (1UL << 29) - beg >= length; length *= 9)
+        {
+            CPPUNIT_ASSERT_EQUAL(bai.reg2bin(beg, beg + length), csi5.reg2bin(beg, beg + length));
+        }
+    }
+
+    // depth 0 has a single bin
+    const BamIndexBinning csi0(true, 16384);
+    CPPUNIT_ASSERT_EQUAL(0U, csi0.getDepth());
+    CPPUNIT_ASSERT_EQUAL(2U, csi0.getPseudoBin());
+    CPPUNIT_ASSERT_EQUAL(0U, csi0.reg2bin(0, 16384));
+    CPPUNIT_ASSERT_EQUAL(0U, csi0.reg2bin(16383, 16384));
+}
+
+void TestBamIndex::testBinStart()
+{
+    const BamIndexBinning bai;
+    CPPUNIT_ASSERT_EQUAL(0UL, bai.getBinStart(0));
+    CPPUNIT_ASSERT_EQUAL(0UL, bai.getBinStart(1));
+    CPPUNIT_ASSERT_EQUAL(1UL << 26, bai.getBinStart(2));
+    CPPUNIT_ASSERT_EQUAL(7UL << 26, bai.getBinStart(8));
+    CPPUNIT_ASSERT_EQUAL(0UL, bai.getBinStart(9));
+    CPPUNIT_ASSERT_EQUAL(1UL << 23, bai.getBinStart(10));
+    CPPUNIT_ASSERT_EQUAL(0UL, bai.getBinStart(4681));
+    CPPUNIT_ASSERT_EQUAL(16384UL, bai.getBinStart(4682));
+    CPPUNIT_ASSERT_EQUAL((1UL << 29) - 16384, bai.getBinStart(37448));
+
+    const BamIndexBinning csi(true, 1UL << 32);
+    CPPUNIT_ASSERT_EQUAL(6U, csi.getDepth());
+    CPPUNIT_ASSERT_EQUAL(1UL << 29, csi.getBinStart(2));
+    CPPUNIT_ASSERT_EQUAL(0UL, csi.getBinStart(37449));
+    CPPUNIT_ASSERT_EQUAL((1UL << 32) - 16384, csi.getBinStart(299592));
+
+    // the bin of a region starts at or before the region, within the bin span
+    for (unsigned long beg = 0; (1UL << 32) > beg; beg += 33333333)
+    {
+        for (unsigned long length = 1; (1UL << 32) - beg >= length; length *= 5)
+        {
+            const unsigned bin = csi.reg2bin(beg, beg + length);
+            CPPUNIT_ASSERT(beg >= csi.getBinStart(bin));
+            CPPUNIT_ASSERT_EQUAL(bin, csi.reg2bin(csi.getBinStart(bin), beg + length));
+        }
+    }
+}
+
+/**
+ * \brief CSI gets the smallest depth that can index the longest contig
+ */
+void TestBamIndex::testDepth()
+{
+    CPPUNIT_ASSERT_EQUAL(0U, BamIndexBinning(true, 1).getDepth());
+    CPPUNIT_ASSERT_EQUAL(0U, BamIndexBinning(true, 1UL << 14).getDepth());
+    CPPUNIT_ASSERT_EQUAL(1U, BamIndexBinning(true, (1UL << 14) + 1).getDepth());
+    CPPUNIT_ASSERT_EQUAL(5U, BamIndexBinning(true, 1UL << 29).getDepth());
+    CPPUNIT_ASSERT_EQUAL(6U, BamIndexBinning(true, (1UL << 29) + 1).getDepth());
+    CPPUNIT_ASSERT_EQUAL(6U, BamIndexBinning(true, 1UL << 32).getDepth());
+    CPPUNIT_ASSERT_EQUAL(7U, BamIndexBinning(true, (1UL << 32) + 1).getDepth());
+
+    // BAI depth does not depend on the contig length
+    CPPUNIT_ASSERT_EQUAL(5U, BamIndexBinning(false, 1000).getDepth());
+
+    for (unsigned long length = 1; (1UL << 40) > length; length = length * 3 + 1)
+    {
+        const BamIndexBinning csi(true, length);
+        CPPUNIT_ASSERT(csi.getMaxPosition() >= length);
+        CPPUNIT_ASSERT(!csi.getDepth() || csi.getMaxPosition() / 8 < length);
+    }
+}
+
+void TestBamIndex::testBinCount()
+{
+    CPPUNIT_ASSERT_EQUAL(37449U, BamIndexBinning().getBinCount());
+    // last leaf of a 1Mbp contig is 4681 + 999999 / 16384
+    CPPUNIT_ASSERT_EQUAL(4743U, BamIndexBinning(false, 1000000).getBinCount());
+    CPPUNIT_ASSERT_EQUAL(37449U + 65536U, BamIndexBinning(true, 1UL << 30).getBinCount());
+    CPPUNIT_ASSERT_EQUAL(1U, BamIndexBinning(true, 16384).getBinCount());
+    CPPUNIT_ASSERT_EQUAL(3U, BamIndexBinning(true, 16385).getBinCount());
+
+    const BamIndexBinning csi(true, 1500000000);
+    for (unsigned long beg = 0; csi.getMaxContigLength() > beg; beg += 1234567)
+    {
+        CPPUNIT_ASSERT(csi.getBinCount() > csi.reg2bin(beg, beg + 1));
+    }
+}
+
+static std::vector<char> inflateBgzf(const boost::filesystem::path &path)
+{
+    std::ifstream is(path.c_str(), std::ios_base::binary);
+    CPPUNIT_ASSERT(is);
+    isaac::bgzf::BgzfReader reader;
+    std::vector<char> ret;
+    for (unsigned size = reader.readNextBlock(is); !is.eof(); size = reader.readNextBlock(is))
+    {
+        if (size)
+        {
+            ret.resize(ret.size() + size);
+            reader.uncompressCurrentBlock(&ret.front() + ret.size() - size, size);
+        }
+    }
+    return ret;
+}
+
+template <typename T>
+static T readValue(const std::vector<char> &data, std::size_t &offset)
+{
+    CPPUNIT_ASSERT(data.size() >= offset + sizeof(T));
+    T ret;
+    memcpy(&ret, &data[offset], sizeof(T));
+    offset += sizeof(T);
+    return ret;
+}
+
+static boost::uint64_t virtualOffset(const boost::uint64_t compressedOffset, const boost::uint32_t uncompressedOffset)
+{
+    isaac::bam::VirtualOffset ret;
+    ret.set(compressedOffset, uncompressedOffset);
+    return ret.get();
+}
+
+/**
+ * \brief Two leaves of a contig too long for BAI. Checks the layout of the CSI specification, section 4
+ */
+void TestBamIndex::testCsiOutput()
+{
+    const BamIndexBinning csi(true, 1UL << 30);
+    const boost::filesystem::path bamPath = tempDirectory_ / "test.bam";
+    const boost::uint32_t headerLength = 100;
+    isaac::bam::BamIndex index(bamPath, 1, headerLength, csi);
+
+    // offsets within the only bgzf block of the part
+    const unsigned long position = (1UL << 29) + 5;
+    isaac::bam::BamIndexPart part(csi);
+    part.addToBinIndexChunks(0, 300, csi.reg2bin(position, position + 100), 0);
+    part.addToLinearIndex(position, 0);
+    part.addToLinearIndex(position + 99, 0);
+    part.addToBinIndexChunks(300, 600, csi.reg2bin(position + 20000, position + 20100), 0);
+    part.addToLinearIndex(position + 20000, 300);
+    part.bamStatsMapped_ = 2;
+    part.resolved_ = true;
+
+    index.processIndexPart(part, 1000);
+    index.flush();
+    CPPUNIT_ASSERT(!boost::filesystem::exists(bamPath.string() + ".bai"));
+
+    const std::vector<char> data = inflateBgzf(bamPath.string() + ".csi");
+    std::size_t offset = 0;
+    CPPUNIT_ASSERT(!memcmp("CSI\1", &data.front(), 4));
+    offset += 4;
+    CPPUNIT_ASSERT_EQUAL(14, readValue<boost::int32_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(6, readValue<boost::int32_t>(data, offset));
+    // l_aux
+    CPPUNIT_ASSERT_EQUAL(0, readValue<boost::int32_t>(data, offset));
+    // n_ref
+    CPPUNIT_ASSERT_EQUAL(1, readValue<boost::int32_t>(data, offset));
+    // two leaves and the pseudo-bin
+    CPPUNIT_ASSERT_EQUAL(3, readValue<boost::int32_t>(data, offset));
+
+    CPPUNIT_ASSERT_EQUAL(37449U + 32768U, readValue<boost::uint32_t>(data, offset));
+    // loffset
+    CPPUNIT_ASSERT_EQUAL(virtualOffset(headerLength, 0), readValue<boost::uint64_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(1, readValue<boost::int32_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(virtualOffset(headerLength, 0), readValue<boost::uint64_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(virtualOffset(headerLength, 300), readValue<boost::uint64_t>(data, offset));
+
+    CPPUNIT_ASSERT_EQUAL(37449U + 32769U, readValue<boost::uint32_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(virtualOffset(headerLength, 300), readValue<boost::uint64_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(1, readValue<boost::int32_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(virtualOffset(headerLength, 300), readValue<boost::uint64_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(virtualOffset(headerLength, 600), readValue<boost::uint64_t>(data, offset));
+
+    CPPUNIT_ASSERT_EQUAL(csi.getPseudoBin(), readValue<boost::uint32_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(boost::uint64_t(0), readValue<boost::uint64_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(2, readValue<boost::int32_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(virtualOffset(headerLength, 0), readValue<boost::uint64_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(virtualOffset(headerLength, 600), readValue<boost::uint64_t>(data, offset));
+    // mapped and unmapped read counts
+    CPPUNIT_ASSERT_EQUAL(boost::uint64_t(2), readValue<boost::uint64_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(boost::uint64_t(0), readValue<boost::uint64_t>(data, offset));
+
+    // no linear index in CSI. n_no_coor ends the file
+    CPPUNIT_ASSERT_EQUAL(boost::uint64_t(0), readValue<boost::uint64_t>(data, offset));
+    CPPUNIT_ASSERT_EQUAL(data.size(), offset);
+}
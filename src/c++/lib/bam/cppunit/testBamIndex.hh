@@ -0,0 +1,44 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_BAM_TEST_BAM_INDEX_HH
+#define iSAAC_BAM_TEST_BAM_INDEX_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+class TestBamIndex : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestBamIndex );
+    CPPUNIT_TEST( testBaiReg2bin );
+    CPPUNIT_TEST( testCsiReg2bin );
+    CPPUNIT_TEST( testBinStart );
+    CPPUNIT_TEST( testDepth );
+    CPPUNIT_TEST( testBinCount );
+    CPPUNIT_TEST( testCsiOutput );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+public:
+    void setUp();
+    void tearDown();
+    void testBaiReg2bin();
+    void testCsiReg2bin();
+    void testBinStart();
+    void testDepth();
+    void testBinCount();
+    void testCsiOutput();
+};
+
+#endif // #ifndef iSAAC_BAM_TEST_BAM_INDEX_HH
@@ -0,0 +1,158 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file BgzfCompressor.cpp
+ **
+ ** \brief see BgzfCompressor.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cstring>
+#include <new>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+
+#include "bgzf/BgzfCompressor.hh"
+#include "common/Debug.hh"
+
+namespace isaac
+{
+namespace bgzf
+{
+
+BgzfCompressor::BgzfCompressor(const int level, common::ThreadVector *threads):
+    level_(level),
+    threads_(threads),
+    slabBlocks_(threads_ ? threads_->size() : 1),
+    uncompressedIn_(0)
+{
+    init();
+}
+
+BgzfCompressor::BgzfCompressor(const BgzfCompressor& that):
+    level_(that.level_),
+    threads_(that.threads_),
+    slabBlocks_(that.slabBlocks_),
+    uncompressedIn_(0)
+{
+    init();
+}
+
+BgzfCompressor::~BgzfCompressor()
+{
+    BOOST_FOREACH(z_stream &strm, streams_)
+    {
+        deflateEnd(&strm);
+    }
+}
+
+unsigned long BgzfCompressor::getMemoryRequirements(const unsigned slabBlocks)
+{
+    // deflateInit2 with windowBits 15 and memLevel 8 allocates (1 << (15 + 2)) + (1 << (8 + 9)) bytes
+    static const unsigned long deflateStateBytes = (1UL << (MAX_WBITS + 2)) + (1UL << (8 + 9));
+    return slabBlocks * (max_uncompressed_per_block_ + bgzf_buffer_size_ + sizeof(std::size_t) +
+        sizeof(z_stream) + deflateStateBytes);
+}
+
+void BgzfCompressor::init()
+{
+    uncompressed_.resize(slabBlocks_ * max_uncompressed_per_block_);
+    compressed_.resize(slabBlocks_ * bgzf_buffer_size_);
+    compressedSizes_.reserve(slabBlocks_);
+
+    z_stream zero;
+    memset(&zero, 0, sizeof(zero));
+    streams_.resize(slabBlocks_, zero);
+    BOOST_FOREACH(z_stream &strm, streams_)
+    {
+        // negative window bits produce raw deflate data without zlib or gzip wrapping
+        const int ret = deflateInit2(&strm, level_, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+        if (Z_MEM_ERROR == ret)
+        {
+            throw std::bad_alloc();
+        }
+        ISAAC_ASSERT_MSG(Z_OK == ret, "deflateInit2 failed with " << ret << " for compression level " << level_);
+    }
+}
+
+void BgzfCompressor::compressSlab()
+{
+    const std::size_t blocks = (uncompressedIn_ + max_uncompressed_per_block_ - 1) / max_uncompressed_per_block_;
+    compressedSizes_.resize(blocks);
+    if (1 == blocks)
+    {
+        compressBlocks(0, 1);
+    }
+    else
+    {
+        threads_->execute(boost::bind(&BgzfCompressor::compressBlocks, this, _1, blocks), blocks);
+    }
+}
+
+void BgzfCompressor::compressBlocks(const std::size_t threadNumber, const std::size_t threads)
+{
+    for (std::size_t block = threadNumber; compressedSizes_.size() > block; block += threads)
+    {
+        const std::size_t offset = block * max_uncompressed_per_block_;
+        compressedSizes_[block] = compressBlock(
+            streams_.at(threadNumber), &uncompressed_[offset],
+            std::min<std::size_t>(max_uncompressed_per_block_, uncompressedIn_ - offset),
+            &compressed_[block * bgzf_buffer_size_]);
+    }
+}
+
+/**
+ * \brief Deflates data straight after the space reserved for the bgzf header, then fills in
+ *        the header and the footer.
+ *
+ * \return total size of the bgzf block
+ */
+std::size_t BgzfCompressor::compressBlock(z_stream &strm, const char *data, const std::size_t size, char *block)
+{
+    strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    strm.avail_in = size;
+    strm.next_out = reinterpret_cast<Bytef*>(block + sizeof(Header));
+    strm.avail_out = bgzf_buffer_size_ - sizeof(Header) - sizeof(Footer);
+    const int ret = deflate(&strm, Z_FINISH);
+    ISAAC_ASSERT_MSG(Z_STREAM_END == ret, "deflate failed with " << ret << " for " << size << " bytes");
+    const std::size_t cdataSize = bgzf_buffer_size_ - sizeof(Header) - sizeof(Footer) - strm.avail_out;
+    deflateReset(&strm);
+
+    const std::size_t blockSize = sizeof(Header) + cdataSize + sizeof(Footer);
+    ISAAC_ASSERT_MSG(bgzf_buffer_size_ > blockSize, "Bgzf block is too big: " << blockSize);
+    const unsigned short bsize(blockSize - 1);
+    const Header header =
+    {
+        31, 139, 8, 0x04, {0, 0, 0, 0}, 0, 255,
+        {
+         {(sizeof(BAM_XFIELD) - sizeof(short)), (sizeof(BAM_XFIELD) - sizeof(short)) / 256},
+         66, 67, {2,0}, {(unsigned char)(bsize), (unsigned char)(bsize / 256)}
+        }
+    };
+    memcpy(block, &header, sizeof(header));
+
+    const unsigned long crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(data), size);
+    Footer footer;
+    for (unsigned i = 0; sizeof(footer.CRC32) > i; ++i)
+    {
+        footer.CRC32[i] = (unsigned char)(crc >> (i * 8));
+        footer.ISIZE[i] = (unsigned char)(size >> (i * 8));
+    }
+    memcpy(block + sizeof(Header) + cdataSize, &footer, sizeof(footer));
+
+    return blockSize;
+}
+
+} // namespace bgzf
+} // namespace isaac
@@ -0,0 +1,163 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <zlib.h>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testBgzfCompressor.hh"
+
+#include "bgzf/BgzfCompressor.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestBgzfCompressor, registryName("BgzfCompressor"));
+
+// uncompressed bytes that go into a single bgzf block
+static const unsigned BLOCK_DATA = 0xFF00;
+static const unsigned THREADS = 4;
+
+TestBgzfCompressor::TestBgzfCompressor() : threads_(THREADS)
+{
+}
+
+void TestBgzfCompressor::setUp()
+{
+}
+
+void TestBgzfCompressor::tearDown()
+{
+}
+
+/**
+ * \brief Compresses data writing it in pieces of chunk bytes. Deflates on threads when given.
+ */
+static std::string compress(const std::string &data, isaac::common::ThreadVector *threads, const std::size_t chunk)
+{
+    std::string ret;
+    boost::iostreams::filtering_ostream bgzf;
+    bgzf.push(isaac::bgzf::BgzfCompressor(Z_DEFAULT_COMPRESSION, threads));
+    bgzf.push(boost::iostreams::back_inserter(ret));
+    for (std::size_t offset = 0; data.size() > offset; offset += chunk)
+    {
+        CPPUNIT_ASSERT(bgzf.write(data.data() + offset, std::min(chunk, data.size() - offset)));
+    }
+    CPPUNIT_ASSERT(bgzf.strict_sync());
+    return ret;
+}
+
+/**
+ * \brief Walks the bgzf blocks using their BSIZE and inflates each of them.
+ *
+ * \return number of blocks found
+ */
+static unsigned decompress(const std::string &bgzf, std::string &data)
+{
+    unsigned blocks = 0;
+    std::vector<char> buffer(0x10000);
+    for (std::size_t offset = 0; bgzf.size() > offset; ++blocks)
+    {
+        CPPUNIT_ASSERT(bgzf.size() >= offset + 18);
+        CPPUNIT_ASSERT_EQUAL(31, int((unsigned char)bgzf[offset]));
+        CPPUNIT_ASSERT_EQUAL(139, int((unsigned char)bgzf[offset + 1]));
+        CPPUNIT_ASSERT_EQUAL('B', bgzf[offset + 12]);
+        CPPUNIT_ASSERT_EQUAL('C', bgzf[offset + 13]);
+        const std::size_t blockSize = (unsigned char)bgzf[offset + 16] + (unsigned char)bgzf[offset + 17] * 256 + 1;
+        CPPUNIT_ASSERT(bgzf.size() >= offset + blockSize);
+
+        z_stream strm;
+        memset(&strm, 0, sizeof(strm));
+        CPPUNIT_ASSERT_EQUAL(Z_OK, inflateInit2(&strm, 16 + MAX_WBITS));
+        strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(bgzf.data() + offset));
+        strm.avail_in = blockSize;
+        strm.next_out = reinterpret_cast<Bytef*>(&buffer.front());
+        strm.avail_out = buffer.size();
+        CPPUNIT_ASSERT_EQUAL(Z_STREAM_END, inflate(&strm, Z_FINISH));
+        CPPUNIT_ASSERT_EQUAL(0U, strm.avail_in);
+        data.append(&buffer.front(), buffer.size() - strm.avail_out);
+        inflateEnd(&strm);
+        CPPUNIT_ASSERT(BLOCK_DATA >= buffer.size() - strm.avail_out);
+
+        offset += blockSize;
+    }
+    return blocks;
+}
+
+static std::string getCompressibleData(const std::size_t size)
+{
+    std::string ret;
+    ret.reserve(size);
+    unsigned random = 1;
+    while (ret.size() < size)
+    {
+        random = random * 1103515245 + 12345;
+        ret.push_back("ACGT"[(random >> 16) % 4]);
+    }
+    return ret;
+}
+
+void TestBgzfCompressor::checkParallelMatchesSerial(const std::string &data, const unsigned expectedBlocks)
+{
+    const std::string serial = compress(data, 0, data.size() + 1);
+    std::string decompressed;
+    CPPUNIT_ASSERT_EQUAL(expectedBlocks, decompress(serial, decompressed));
+    CPPUNIT_ASSERT(data == decompressed);
+
+    CPPUNIT_ASSERT(serial == compress(data, &threads_, data.size() + 1));
+    // small writes must not change the block boundaries
+    CPPUNIT_ASSERT(serial == compress(data, 0, 1000));
+    CPPUNIT_ASSERT(serial == compress(data, &threads_, 1000));
+}
+
+void TestBgzfCompressor::testEmpty()
+{
+    CPPUNIT_ASSERT(compress(std::string(), 0, 1).empty());
+    CPPUNIT_ASSERT(compress(std::string(), &threads_, 1).empty());
+}
+
+void TestBgzfCompressor::testSingleBlock()
+{
+    checkParallelMatchesSerial(getCompressibleData(1), 1);
+    checkParallelMatchesSerial(getCompressibleData(BLOCK_DATA), 1);
+}
+
+void TestBgzfCompressor::testMultiBlock()
+{
+    checkParallelMatchesSerial(getCompressibleData(BLOCK_DATA + 1), 2);
+    // more blocks than threads, last slab partially filled
+    checkParallelMatchesSerial(getCompressibleData(BLOCK_DATA * (THREADS * 2 + 1) + 123), THREADS * 2 + 2);
+}
+
+void TestBgzfCompressor::testFullSlab()
+{
+    checkParallelMatchesSerial(getCompressibleData(BLOCK_DATA * THREADS), THREADS);
+    checkParallelMatchesSerial(getCompressibleData(BLOCK_DATA * THREADS * 3), THREADS * 3);
+}
+
+void TestBgzfCompressor::testIncompressible()
+{
+    std::string data;
+    unsigned random = 1;
+    while (data.size() < BLOCK_DATA * THREADS + 1)
+    {
+        random = random * 1103515245 + 12345;
+        data.push_back(char(random >> 16));
+    }
+    checkParallelMatchesSerial(data, THREADS + 1);
+}
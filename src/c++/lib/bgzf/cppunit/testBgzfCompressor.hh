@@ -0,0 +1,47 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_BGZF_TEST_BGZF_COMPRESSOR_HH
+#define iSAAC_BGZF_TEST_BGZF_COMPRESSOR_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+#include "common/Threads.hpp"
+
+class TestBgzfCompressor : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestBgzfCompressor );
+    CPPUNIT_TEST( testEmpty );
+    CPPUNIT_TEST( testSingleBlock );
+    CPPUNIT_TEST( testMultiBlock );
+    CPPUNIT_TEST( testFullSlab );
+    CPPUNIT_TEST( testIncompressible );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    isaac::common::ThreadVector threads_;
+
+    void checkParallelMatchesSerial(const std::string &data, const unsigned expectedBlocks);
+public:
+    TestBgzfCompressor();
+    void setUp();
+    void tearDown();
+    void testEmpty();
+    void testSingleBlock();
+    void testMultiBlock();
+    void testFullSlab();
+    void testIncompressible();
+};
+
+#endif // #ifndef iSAAC_BGZF_TEST_BGZF_COMPRESSOR_HH
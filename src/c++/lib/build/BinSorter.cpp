@@ -169,14 +169,74 @@ const io::FragmentAccessor &BinSorter::loadFragment(std::istream &isData, unsign
     return fragment;
 }
 
+template <typename FragmentT>
+void BinSorter::indexFragment(
+    const FragmentT &fragment,
+    const unsigned long offset,
+    const unsigned long mateOffset)
+{
+    if (!fragment.flags_.paired_)
+    {
+        SeFragmentIndex seIdx(fragment.fStrandPosition_);
+        seIdx.dataOffset_ = offset;
+        seIdxFileContent_.push_back(seIdx);
+    }
+    else if (fragment.flags_.reverse_ || fragment.flags_.unmapped_)
+    {
+        RStrandOrShadowFragmentIndex rsIdx(
+            fragment.fStrandPosition_, // shadows are stored at the position of their singletons,
+            io::FragmentIndexAnchor(fragment),
+            FragmentIndexMate(
+                fragment.flags_.mateUnmapped_, fragment.flags_.mateReverse_, fragment.mateStorageBin_,
+                fragment.mateAnchor_),
+            fragment.duplicateClusterRank_);
+
+        rsIdx.dataOffset_ = offset;
+        rsIdx.mateDataOffset_ = mateOffset;
+        if (isFilteringDuplicates())
+        {
+            rSignatures_.push_back(duplicateSignatureFilter_.getSignature(
+                rsIdx, fragment.barcode_, rIdxFileContent_.size()));
+        }
+        rIdxFileContent_.push_back(rsIdx);
+    }
+    else
+    {
+        FStrandFragmentIndex fIdx(
+            fragment.fStrandPosition_,
+            FragmentIndexMate(
+                fragment.flags_.mateUnmapped_, fragment.flags_.mateReverse_, fragment.mateStorageBin_,
+                fragment.mateAnchor_),
+            fragment.duplicateClusterRank_);
+
+        fIdx.dataOffset_ = offset;
+        fIdx.mateDataOffset_ = mateOffset;
+        if (isFilteringDuplicates())
+        {
+            fSignatures_.push_back(duplicateSignatureFilter_.getSignature(
+                fIdx, fragment.barcode_, fIdxFileContent_.size()));
+        }
+        fIdxFileContent_.push_back(fIdx);
+    }
+}
+
 void BinSorter::loadAlignedData()
 {
     if(bin_.getDataSize())
     {
         ISAAC_THREAD_CERR << "Reading alignment records from " << bin_ << std::endl;
-        unsigned long dataSize = 0;
         // summarize chunk sizes to get offsets
         dataDistribution_.tallyOffsets();
+
+        rIdxFileContent_.clear();
+        fIdxFileContent_.clear();
+        seIdxFileContent_.clear();
+        rSignatures_.clear();
+        fSignatures_.clear();
+
+        // the index goes first as fileBuf_ holds one file at a time
+        const bool indexed = loadFragmentIndex();
+
         std::istream isData(fileBuf_.get(bin_.getPath()));
         if (!isData) {
             BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open " + bin_.getPathString()));
@@ -187,142 +247,159 @@ void BinSorter::loadAlignedData()
                 errno, (boost::format("Failed to seek to position %d in %s") % bin_.getDataOffset() % bin_.getPathString()).str()));
         }
 
-        rIdxFileContent_.clear();
-        fIdxFileContent_.clear();
-        seIdxFileContent_.clear();
-        unsigned long binOffset = 0;
-
-        while(isData && dataSize != bin_.getDataSize())
+        if (indexed)
+        {
+            placeIndexedData(isData);
+        }
+        else
         {
-            unsigned long offset = 0;
-            const io::FragmentAccessor &fragment = loadFragment(isData, offset);
-            const unsigned fragmentLength = fragment.getTotalLength();
-            dataSize += fragmentLength;
-
-            verifyFragmentIntegrity(fragment);
-
-            if (!fragment.flags_.paired_)
-            {
-                SeFragmentIndex seIdx(fragment.fStrandPosition_);
-                seIdx.dataOffset_ = offset;
-                seIdxFileContent_.push_back(seIdx);
-                binOffset += fragmentLength;
-            }
-            else
-            {
-                binOffset += fragmentLength;
-                unsigned long mateOffset = offset;
-                if (bin_.coversPosition(fragment.mateFStrandPosition_))
-                {
-                    const io::FragmentAccessor &mateFragment = loadFragment(isData, mateOffset);
-                    ISAAC_ASSERT_MSG(mateFragment.clusterId_ == fragment.clusterId_, "mateFragment.clusterId_ != fragment.clusterId_");
-                    ISAAC_ASSERT_MSG(mateFragment.flags_.unmapped_ == fragment.flags_.mateUnmapped_, "mateFragment.flags_.unmapped_ != fragment.flags_.mateUnmapped_");
-                    ISAAC_ASSERT_MSG(mateFragment.flags_.reverse_ == fragment.flags_.mateReverse_,
-                                     "mateFragment.flags_.reverse_ != fragment.flags_.mateReverse_" << fragment << " " << mateFragment);
-
-                    const unsigned mateFragmentLength = mateFragment.getTotalLength();
-                    dataSize += mateFragmentLength;
-
-                    verifyFragmentIntegrity(mateFragment);
-
-                    if (mateFragment.flags_.reverse_ || mateFragment.flags_.unmapped_)
-                    {
-                        RStrandOrShadowFragmentIndex rsMateIdx(
-                            mateFragment.fStrandPosition_, // shadows are stored at the position of their singletons,
-                            io::FragmentIndexAnchor(mateFragment),
-                            FragmentIndexMate(
-                                mateFragment.flags_.mateUnmapped_, mateFragment.flags_.mateReverse_, mateFragment.mateStorageBin_,
-                                mateFragment.mateAnchor_),
-                                mateFragment.duplicateClusterRank_);
-
-                        rsMateIdx.dataOffset_ = mateOffset;
-                        rsMateIdx.mateDataOffset_ = offset;
-                        rIdxFileContent_.push_back(rsMateIdx);
-                    }
-                    else
-                    {
-                        FStrandFragmentIndex fMateIdx(
-                            mateFragment.fStrandPosition_,
-                            FragmentIndexMate(
-                                mateFragment.flags_.mateUnmapped_, mateFragment.flags_.mateReverse_, mateFragment.mateStorageBin_,
-                                mateFragment.mateAnchor_),
-                                mateFragment.duplicateClusterRank_);
-
-                        fMateIdx.dataOffset_ = mateOffset;
-                        fMateIdx.mateDataOffset_ = offset;
-                        fIdxFileContent_.push_back(fMateIdx);
-                    }
-
-                    binOffset += mateFragmentLength;
-                }
-
-                if (fragment.flags_.reverse_ || fragment.flags_.unmapped_)
-                {
-                    RStrandOrShadowFragmentIndex rsIdx(
-                        fragment.fStrandPosition_, // shadows are stored at the position of their singletons,
-                        io::FragmentIndexAnchor(fragment),
-                        FragmentIndexMate(
-                            fragment.flags_.mateUnmapped_, fragment.flags_.mateReverse_, fragment.mateStorageBin_,
-                            fragment.mateAnchor_),
-                        fragment.duplicateClusterRank_);
-
-                    rsIdx.dataOffset_ = offset;
-                    rsIdx.mateDataOffset_ = mateOffset;
-                    rIdxFileContent_.push_back(rsIdx);
-                }
-                else
-                {
-                    FStrandFragmentIndex fIdx(
-                        fragment.fStrandPosition_,
-                        FragmentIndexMate(
-                            fragment.flags_.mateUnmapped_, fragment.flags_.mateReverse_, fragment.mateStorageBin_,
-                            fragment.mateAnchor_),
-                        fragment.duplicateClusterRank_);
-
-                    fIdx.dataOffset_ = offset;
-                    fIdx.mateDataOffset_ = mateOffset;
-                    fIdxFileContent_.push_back(fIdx);
-                }
-            }
+            parseAlignedData(isData);
         }
         ISAAC_THREAD_CERR << "Reading alignment records done from " << bin_ << std::endl;
     }
 }
 
+/**
+ * \brief Reads the fragment index file produced by the match selector.
+ *
+ * \return false if the file is missing or does not describe the bin data. The data then has to be parsed.
+ */
+bool BinSorter::loadFragmentIndex()
+{
+    const unsigned long records = bin_.getSeIdxElements() + bin_.getRIdxElements() + bin_.getFIdxElements();
+    boost::system::error_code error;
+    const boost::uintmax_t fileSize = boost::filesystem::file_size(fragmentIndexPath_, error);
+    if (error)
+    {
+        // BinningFragmentStorage and older versions don't produce the index
+        ISAAC_THREAD_CERR << "No fragment index " << fragmentIndexPath_ << ". Parsing bin data" << std::endl;
+        return false;
+    }
+    if (records * sizeof(io::FragmentIndexRecord) != fileSize || bin_.getDataOffset())
+    {
+        ISAAC_THREAD_CERR << "WARNING: fragment index " << fragmentIndexPath_ << " does not match " << bin_ <<
+            ". Parsing bin data" << std::endl;
+        return false;
+    }
+
+    std::istream isIndex(fileBuf_.get(fragmentIndexPath_));
+    fragmentIndex_.resize(records);
+    if (!isIndex.read(reinterpret_cast<char *>(&fragmentIndex_.front()), fileSize)) {
+        BOOST_THROW_EXCEPTION(common::IoException(
+            errno, (boost::format("Failed to read %d bytes from %s") % fileSize % fragmentIndexPath_.string()).str()));
+    }
+
+    unsigned long dataSize = 0;
+    BOOST_FOREACH(const io::FragmentIndexRecord &record, fragmentIndex_)
+    {
+        dataSize += record.getTotalLength();
+    }
+    if (bin_.getDataSize() != dataSize)
+    {
+        ISAAC_THREAD_CERR << "WARNING: fragment index " << fragmentIndexPath_ << " describes " << dataSize <<
+            " bytes instead of " << bin_.getDataSize() << ". Parsing bin data" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * \brief Reads the fragment described by record from isData straight into its place in data_
+ *
+ * \return offset of the fragment in data_
+ */
+unsigned long BinSorter::placeFragment(std::istream &isData, const io::FragmentIndexRecord &record)
+{
+    const unsigned fragmentLength = record.getTotalLength();
+    const unsigned long offset = dataDistribution_.addBytes(record.fStrandPosition_ - bin_.getBinStart(), fragmentLength);
+    io::FragmentAccessor &fragment = data_.getFragment(offset);
+    if (!isData.read(reinterpret_cast<char *>(&fragment), fragmentLength)) {
+        BOOST_THROW_EXCEPTION(common::IoException(
+            errno, (boost::format("Failed to read %d bytes from %s") % fragmentLength % bin_.getPathString()).str()));
+    }
+    ISAAC_ASSERT_MSG(fragment.getTotalLength() == fragmentLength, "Fragment index does not match the data in " << bin_ << " " << fragment);
+    verifyFragmentIntegrity(fragment);
+    return offset;
+}
+
+/**
+ * \brief Reads each fragment of the bin data into its place in data_ with one read.
+ *        The indexes are built from fragmentIndex_ without looking at the fragment data.
+ */
+void BinSorter::placeIndexedData(std::istream &isData)
+{
+    for (std::vector<io::FragmentIndexRecord>::const_iterator it = fragmentIndex_.begin(); fragmentIndex_.end() != it; ++it)
+    {
+        const io::FragmentIndexRecord &record = *it;
+        const unsigned long offset = placeFragment(isData, record);
+        unsigned long mateOffset = offset;
+        // mates that are stored in the same bin follow each other
+        if (record.flags_.paired_ && bin_.coversPosition(record.mateFStrandPosition_))
+        {
+            ++it;
+            ISAAC_ASSERT_MSG(fragmentIndex_.end() != it, "Missing mate index record in " << fragmentIndexPath_);
+            mateOffset = placeFragment(isData, *it);
+            const io::FragmentAccessor &fragment = data_.getFragment(offset);
+            const io::FragmentAccessor &mateFragment = data_.getFragment(mateOffset);
+            ISAAC_ASSERT_MSG(mateFragment.clusterId_ == fragment.clusterId_, "mateFragment.clusterId_ != fragment.clusterId_");
+            ISAAC_ASSERT_MSG(mateFragment.flags_.unmapped_ == fragment.flags_.mateUnmapped_, "mateFragment.flags_.unmapped_ != fragment.flags_.mateUnmapped_");
+            ISAAC_ASSERT_MSG(mateFragment.flags_.reverse_ == fragment.flags_.mateReverse_,
+                             "mateFragment.flags_.reverse_ != fragment.flags_.mateReverse_" << fragment << " " << mateFragment);
+            indexFragment(*it, mateOffset, offset);
+        }
+        indexFragment(record, offset, mateOffset);
+    }
+}
+
+/**
+ * \brief Reads the bin data fragment by fragment and indexes it
+ */
+void BinSorter::parseAlignedData(std::istream &isData)
+{
+    unsigned long dataSize = 0;
+    while(isData && dataSize != bin_.getDataSize())
+    {
+        unsigned long offset = 0;
+        const io::FragmentAccessor &fragment = loadFragment(isData, offset);
+        dataSize += fragment.getTotalLength();
+
+        verifyFragmentIntegrity(fragment);
+
+        unsigned long mateOffset = offset;
+        if (fragment.flags_.paired_ && bin_.coversPosition(fragment.mateFStrandPosition_))
+        {
+            const io::FragmentAccessor &mateFragment = loadFragment(isData, mateOffset);
+            ISAAC_ASSERT_MSG(mateFragment.clusterId_ == fragment.clusterId_, "mateFragment.clusterId_ != fragment.clusterId_");
+            ISAAC_ASSERT_MSG(mateFragment.flags_.unmapped_ == fragment.flags_.mateUnmapped_, "mateFragment.flags_.unmapped_ != fragment.flags_.mateUnmapped_");
+            ISAAC_ASSERT_MSG(mateFragment.flags_.reverse_ == fragment.flags_.mateReverse_,
+                             "mateFragment.flags_.reverse_ != fragment.flags_.mateReverse_" << fragment << " " << mateFragment);
+
+            dataSize += mateFragment.getTotalLength();
+
+            verifyFragmentIntegrity(mateFragment);
+            indexFragment(mateFragment, mateOffset, offset);
+        }
+        indexFragment(fragment, offset, mateOffset);
+    }
+}
 
 void BinSorter::resolveDuplicates(
     BuildStats &buildStats)
 {
     NotAFilter().filterInput(data_, seIdxFileContent_.begin(), seIdxFileContent_.end(), buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
-    if (keepDuplicates_ && !markDuplicates_)
+    if (!isFilteringDuplicates())
     {
         NotAFilter().filterInput(data_, rIdxFileContent_.begin(), rIdxFileContent_.end(), buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
         NotAFilter().filterInput(data_, fIdxFileContent_.begin(), fIdxFileContent_.end(), buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
     }
     else
     {
-        if (singleLibrarySamples_)
-        {
-            DuplicatePairEndFilter(keepDuplicates_).filterInput(
-                RSDuplicateFilter<true>(barcodeBamMapping_.getSampleIndexMap()),
-                data_, rIdxFileContent_.begin(), rIdxFileContent_.end(),
-                buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
-            DuplicatePairEndFilter(keepDuplicates_).filterInput(
-                FDuplicateFilter<true>(barcodeBamMapping_.getSampleIndexMap()),
-                data_, fIdxFileContent_.begin(), fIdxFileContent_.end(),
-                buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
-        }
-        else
-        {
-            DuplicatePairEndFilter(keepDuplicates_).filterInput(
-                RSDuplicateFilter<false>(barcodeBamMapping_.getSampleIndexMap()),
-                data_, rIdxFileContent_.begin(), rIdxFileContent_.end(),
-                buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
-            DuplicatePairEndFilter(keepDuplicates_).filterInput(
-                FDuplicateFilter<false>(barcodeBamMapping_.getSampleIndexMap()),
-                data_, fIdxFileContent_.begin(), fIdxFileContent_.end(),
-                buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
-        }
+        duplicateFilter_.filterSignatures(
+            data_, rIdxFileContent_.begin(), rSignatures_.begin(), rSignatures_.end(),
+            buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
+        duplicateFilter_.filterSignatures(
+            data_, fIdxFileContent_.begin(), fSignatures_.begin(), fSignatures_.end(),
+            buildStats, binStatsIndex_, std::back_inserter<BaseType>(*this));
     }
 }
 
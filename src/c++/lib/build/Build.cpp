@@ -17,13 +17,6 @@
  ** \author Roman Petrovski
  **/
 
-#include "common/config.h"
-
-#ifdef HAVE_NUMA
-#include <numa.h>
-#include <numaif.h>
-#endif //HAVE_NUMA
- 
 #include <boost/foreach.hpp>
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
@@ -35,9 +28,10 @@
 #include "build/Build.hh"
 #include "common/Debug.hh"
 #include "common/FileSystem.hh"
+#include "common/Numa.hh"
 #include "common/Threads.hpp"
 #include "io/Fragment.hh"
-#include "reference/ContigLoader.hh"
+#include "reference/ContigCache.hh"
 
 #include "BuildStatsXml.hh"
 #include "SortedReferenceXmlBamHeaderAdapter.hh"
@@ -175,10 +169,36 @@ inline bool orderBySampleIndex(
     return barcodeBamMapping.getSampleIndex(left.getIndex()) < barcodeBamMapping.getSampleIndex(right.getIndex());
 }
 
+/**
+ * \brief BAI can't index contigs longer than 512Mbp. Such references get CSI regardless of what was requested
+ */
+bam::BamIndexBinning Build::getBamIndexBinning(
+    const reference::SortedReferenceMetadata &sampleReference,
+    const unsigned referenceIndex,
+    const boost::filesystem::path &bamPath) const
+{
+    unsigned long maxContigLength = 0;
+    BOOST_FOREACH(const reference::SortedReferenceMetadata::Contig &contig, sampleReference.getContigs())
+    {
+        if (contigMap_.isMapped(referenceIndex, contig.index_))
+        {
+            maxContigLength = std::max(maxContigLength, contig.totalBases_);
+        }
+    }
+
+    const bool longContigs = bam::BAM_MAX_CONTIG_LENGTH < maxContigLength;
+    if (bam::BAM_INDEX_BAI == bamIndexFormat_ && longContigs)
+    {
+        ISAAC_THREAD_CERR << "WARNING: " << bamPath << " has a contig of " << maxContigLength <<
+            " bases which is too long for BAI. Generating CSI index instead" << std::endl;
+    }
+    return bam::BamIndexBinning(bam::BAM_INDEX_CSI == bamIndexFormat_ || longContigs, maxContigLength);
+}
+
 std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > Build::createOutputFileStreams(
     const flowcell::TileMetadataList &tileMetadataList,
     const flowcell::BarcodeMetadataList &barcodeMetadataList,
-    boost::ptr_vector<bam::BamIndex> &bamIndexes) const
+    boost::ptr_vector<bam::BamIndex> &bamIndexes)
 {
     unsigned sinkIndexToCreate = 0;
     std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > ret;
@@ -212,7 +232,8 @@ std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > Build::crea
                 {
                     std::ostringstream oss(compressedHeader);
                     boost::iostreams::filtering_ostream bgzfStream;
-                    bgzfStream.push(bgzf::BgzfCompressor(bamGzipLevel_));
+                    // threads_ are idle during construction. Let them deflate header blocks in parallel
+                    bgzfStream.push(bgzf::BgzfCompressor(bamGzipLevel_, &threads_));
                     bgzfStream.push(oss);
                     bam::serializeHeader(bgzfStream,
                                          argv_,
@@ -246,7 +267,8 @@ std::vector<boost::shared_ptr<boost::iostreams::filtering_ostream> > Build::crea
                 unsigned headerCompressedLength = compressedHeader.size();
                 unsigned contigCount = sampleReference.getContigsCount(
                     boost::bind(&BuildContigMap::isMapped, &contigMap_, barcode.getReferenceIndex(), _1));
-                bamIndexes.push_back(new bam::BamIndex(bamPath, contigCount, headerCompressedLength));
+                bamIndexes.push_back(new bam::BamIndex(bamPath, contigCount, headerCompressedLength,
+                                                       getBamIndexBinning(sampleReference, barcode.getReferenceIndex(), bamPath)));
             }
             else
             {
@@ -373,6 +395,7 @@ Build::Build(const std::vector<std::string> &argv,
              const unsigned maxSavers,
              const build::GapRealignerMode realignGaps,
              const int bamGzipLevel,
+             const bam::BamIndexFormat bamIndexFormat,
              const std::string &bamPuFormat,
              const std::vector<std::string> &bamHeaderTags,
              const double expectedBgzfCompressionRatio,
@@ -405,6 +428,7 @@ Build::Build(const std::vector<std::string> &argv,
      maxComputers_(maxComputers),
      maxSavers_(maxSavers),
      bamGzipLevel_(bamGzipLevel),
+     bamIndexFormat_(bamIndexFormat),
      bamPuFormat_(bamPuFormat),
      bamHeaderTags_(bamHeaderTags),
      forcedDodgyAlignmentScore_(forcedDodgyAlignmentScore),
@@ -422,7 +446,7 @@ Build::Build(const std::vector<std::string> &argv,
      pessimisticMapQ_(pessimisticMapQ),
      forceTermination_(false),
      threads_(maxComputers_ + maxLoaders_ + maxSavers_),
-     contigList_(reference::loadContigs(sortedReferenceMetadataList, contigMap_, threads_)),
+     contigList_(reference::ContigCache::get(sortedReferenceMetadataList, contigMap_, threads_)),
      barcodeBamMapping_(mapBarcodesToFiles(outputDirectory_, barcodeMetadataList_)),
      bamIndexes_(),
      bamFileStreams_(createOutputFileStreams(tileMetadataList_, barcodeMetadataList_, bamIndexes_)),
@@ -474,7 +498,6 @@ void Build::testBinsFitInRam()
                 std::vector<char>().swap(bgzfBuffer);
             }
             threadBinSorters_.at(0).reset();
-            threadBgzfStreams_.at(0).clear();
             threadBamIndexParts_.at(0).clear();
         }
     }
@@ -483,27 +506,19 @@ void Build::testBinsFitInRam()
 
 void Build::allocateThreadData(const size_t threadNumber)
 {
-#ifdef HAVE_NUMA
-    if (-1 == numa_available())
-    {
-        ISAAC_THREAD_CERR << "WARNING: numa library is unavailable while the binary is compiled to use numa" << std::endl;
-    }
-    else if (-1 == numa_max_node())
-    {
-        ISAAC_THREAD_CERR << "WARNING: numa_max_node returned -1 while the binary is compiled to use numa" << std::endl;
-    }
-    else
+    common::bindToNumaNode(threadNumber, true);
+
+    // The streams are kept for the whole build. They deflate serially: bins already get compressed concurrently
+    // on the compute threads and threads_ is busy with sortBinParallel while they do.
+    boost::ptr_vector<boost::iostreams::filtering_ostream> &bgzfStreams = threadBgzfStreams_.at(threadNumber);
+    while(bgzfStreams.size() < bamFileStreams_.size())
     {
-        int runOnNode = threadNumber % (numa_max_node() + 1);
-        ISAAC_ASSERT_MSG(8 * sizeof(unsigned long) >= unsigned(runOnNode), "numa node is too high: " << runOnNode);
-        ISAAC_ASSERT_MSG(-1 != numa_run_on_node(runOnNode), "numa_run_on_node " << runOnNode <<
-            " failed, errno: " << errno  << ":" << strerror(errno));
-        unsigned long nodemask = 1UL << runOnNode;
-        ISAAC_ASSERT_MSG(-1 != set_mempolicy(MPOL_BIND/*|MPOL_F_STATIC_NODES*/, &nodemask, sizeof(nodemask) * 8),
-                         "set_mempolicy for nodemask: " << nodemask <<
-                         " failed, errno: " << errno << ":" << strerror(errno));
+        bgzfStreams.push_back(new boost::iostreams::filtering_ostream);
+        bgzfStreams.back().push(bgzf::BgzfCompressor(bamGzipLevel_));
+        bgzfStreams.back().push(
+            boost::iostreams::back_insert_device<std::vector<char> >(
+                threadBgzfBuffers_.at(threadNumber).at(bgzfStreams.size()-1)));
     }
-#endif //HAVE_NUMA
 }
 
 void Build::run(common::ScoopedMallocBlock &mallocBlock)
@@ -555,7 +570,8 @@ unsigned long Build::estimateOptimumFragmentsPerBin(
     const flowcell::FlowcellLayoutList &flowcellLayoutList,
     const unsigned long availableMemory,
     const double expectedBgzfCompressionRatio,
-    const unsigned computeThreads)
+    const unsigned computeThreads,
+    const unsigned bgzfStreams)
 {
 //    const size_t maxFragmentIndexBytes = std::max(sizeof(io::RStrandOrShadowFragmentIndex),
 //                                                         sizeof(io::FStrandFragmentIndex));
@@ -577,7 +593,10 @@ unsigned long Build::estimateOptimumFragmentsPerBin(
 //    const unsigned minOverlap = 3;;
     // try to increase granularity so that the CPU gets efficiently utilized.
     const unsigned minOverlap = computeThreads;
-    return availableMemory / fragmentMemoryRequirements / minOverlap;
+    // slabs and deflate state of the bgzf streams stay allocated for the whole build
+    const unsigned long bgzfStreamsMemory = bgzfStreams * bgzf::BgzfCompressor::getMemoryRequirements();
+    const unsigned long binMemory = availableMemory - std::min(availableMemory, bgzfStreamsMemory);
+    return binMemory / fragmentMemoryRequirements / minOverlap;
 }
 
 /**
@@ -593,7 +612,6 @@ unsigned long Build::reserveBuffers(
     const size_t threadNumber)
 {
     common::unlock_guard<boost::unique_lock<boost::mutex> > unlock(lock);
-    boost::ptr_vector<boost::iostreams::filtering_ostream> &bgzfStreams = threadBgzfStreams_.at(threadNumber);
     boost::ptr_vector<bam::BamIndexPart> &bamIndexParts = threadBamIndexParts_.at(threadNumber);
     const alignment::BinMetadata &bin = *thisThreadBinIt;
     // bin stats have an entry per filtered bin reference.
@@ -608,7 +626,7 @@ unsigned long Build::reserveBuffers(
                           clipSemialigned_, barcodeBamMapping_, tileMetadataList_, barcodeMetadataList_,
                           barcodeTemplateLengthStatistics_,
                           contigMap_,
-                          maxReadLength_, realignGaps_, contigList_, forcedDodgyAlignmentScore_,
+                          maxReadLength_, realignGaps_, *contigList_, forcedDodgyAlignmentScore_,
                           bin, binStatsIndex, flowcellLayoutList_, includeTags_, pessimisticMapQ_));
 
         unsigned outputFileIndex = 0;
@@ -617,26 +635,15 @@ unsigned long Build::reserveBuffers(
             bgzfBuffer.reserve(estimateBinCompressedDataRequirements(bin, outputFileIndex++));
         }
 
-        ISAAC_ASSERT_MSG(!bgzfStreams.size(), "Expecting empty pool of streams");
-        while(bgzfStreams.size() < bamFileStreams_.size())
-        {
-            bgzfStreams.push_back(new boost::iostreams::filtering_ostream);
-            bgzfStreams.back().push(bgzf::BgzfCompressor(bamGzipLevel_));
-            bgzfStreams.back().push(
-                boost::iostreams::back_insert_device<std::vector<char> >(
-                    threadBgzfBuffers_.at(threadNumber).at(bgzfStreams.size()-1)));
-        }
-
         ISAAC_ASSERT_MSG(!bamIndexParts.size(), "Expecting empty pool of bam index parts");
         while(bamIndexParts.size() < bamFileStreams_.size())
         {
-            bamIndexParts.push_back(new bam::BamIndexPart);
+            bamIndexParts.push_back(new bam::BamIndexPart(bamIndexes_.at(bamIndexParts.size()).getBinning()));
         }
     }
     catch(std::bad_alloc &e)
     {
         errno = 0;
-        bgzfStreams.clear();
         bamIndexParts.clear();
         // give a chance other threads to allocate what they need... TODO: this is not required anymore as allocation happens orderly
         threadBinSorters_.at(threadNumber).reset();
@@ -820,7 +827,7 @@ void Build::sortBinParallel(alignment::BinMetadataCRefList::const_iterator &next
             {
                 common::unlock_guard<boost::unique_lock<boost::mutex> > unlock(lock);
                 processBin(*threadBinSorters_.at(threadNumber), threadNumber);
-                threadBgzfStreams_.at(threadNumber).clear();
+                resolveBamIndexParts(threadNumber);
             }
             // give back some memory to allow other threads to load
             // data while we're waiting for our turn to save
@@ -850,6 +857,19 @@ unsigned long Build::processBin(
     return unique;
 }
 
+/**
+ * \brief Turn the bam index offsets of the freshly compressed bin into virtual offsets within its bgzf buffers.
+ *        Done here, in parallel with the other bins, so that saving only has to shift them.
+ */
+void Build::resolveBamIndexParts(const size_t threadNumber)
+{
+    unsigned index = 0;
+    BOOST_FOREACH(bam::BamIndexPart &bamIndexPart, threadBamIndexParts_.at(threadNumber))
+    {
+        bamIndexPart.resolve(threadBgzfBuffers_.at(threadNumber).at(index++));
+    }
+}
+
 /**
  * \brief Save bgzf compressed buffers into corresponding sample files and and release associated memory
  */
@@ -894,7 +914,7 @@ void Build::saveBuffer(
         BOOST_THROW_EXCEPTION(common::IoException(
             errno, (boost::format("Failed to write bgzf block of %d bytes into bam stream") % bgzfBuffer.size()).str()));
     }
-    bamIndex.processIndexPart( bamIndexPart, bgzfBuffer );
+    bamIndex.processIndexPart( bamIndexPart, bgzfBuffer.size() );
 
     ISAAC_THREAD_CERR << "Saving " << bgzfBuffer.size() << " bytes of sorted data for bin " << filePath << " done in " << (clock() - start) / 1000 << "ms\n";
 }
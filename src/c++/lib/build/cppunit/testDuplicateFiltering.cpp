@@ -48,25 +48,7 @@ public:
     }
 };
 
-template<typename IndexT> class TestDuplicateFilter
-{
-
-};
-
 isaac::build::BarcodeBamMapping::BarcodeSampleIndexMap emptyMap;
-template<>
-class TestDuplicateFilter<isaac::build::RStrandOrShadowFragmentIndex> : public RSDuplicateFilter<false>
-{
-public:
-    TestDuplicateFilter() : RSDuplicateFilter<false>(emptyMap){}
-};
-
-template<>
-class TestDuplicateFilter<isaac::build::FStrandFragmentIndex> : public FDuplicateFilter<false>
-{
-public:
-    TestDuplicateFilter() : FDuplicateFilter<false>(emptyMap){}
-};
 
 template <typename IndexT>
 void testNoDifferences(std::vector<IndexT> bin, std::vector<IndexT>  expectedUnique)
@@ -85,9 +67,18 @@ void testNoDifferences(std::vector<IndexT> bin, std::vector<IndexT>  expectedUni
 
     isaac::flowcell::BarcodeMetadataList barcodeMetadataList(1);
     BuildStats fakeBuildStats(binMetadataCRefList, barcodeMetadataList);
+    const DuplicateFilter signatureFilter(false, emptyMap);
+    std::vector<DuplicateSignature> signatures;
+    BOOST_FOREACH(const IndexType &idx, bin)
+    {
+        signatures.push_back(signatureFilter.getSignature(
+            idx, fakeEmptyFragmentBuffer.getFragment(idx).barcode_, signatures.size()));
+    }
+
     std::vector<PackedFragmentBuffer::Index> filteredIndex;
-    filter.filterInput(
-        TestDuplicateFilter<IndexT>(), fakeEmptyFragmentBuffer, bin.begin(), bin.end(), fakeBuildStats, 0, std::back_inserter(filteredIndex));
+    filter.filterSignatures(
+        fakeEmptyFragmentBuffer, bin.begin(), signatures.begin(), signatures.end(), fakeBuildStats, 0,
+        std::back_inserter(filteredIndex));
 
     std::vector<unsigned long> uniqueFragments;
     std::transform(filteredIndex.begin(), filteredIndex.end(), std::back_inserter(uniqueFragments),
@@ -0,0 +1,160 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file Numa.cpp
+ **
+ ** \brief See Numa.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include "common/config.h"
+
+#ifdef HAVE_NUMA
+#include <numa.h>
+#include <numaif.h>
+#endif //HAVE_NUMA
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#include "common/Debug.hh"
+#include "common/Numa.hh"
+
+namespace isaac
+{
+namespace common
+{
+
+static unsigned probeNumaNodeCount()
+{
+#ifdef HAVE_NUMA
+    if (-1 == numa_available())
+    {
+        ISAAC_THREAD_CERR << "WARNING: numa library is unavailable while the binary is compiled to use numa" << std::endl;
+        return 0;
+    }
+    else if (-1 == numa_max_node())
+    {
+        ISAAC_THREAD_CERR << "WARNING: numa_max_node returned -1 while the binary is compiled to use numa" << std::endl;
+        return 0;
+    }
+    const unsigned ret = numa_max_node() + 1;
+    ISAAC_ASSERT_MSG(8 * sizeof(unsigned long) >= ret, "Too many numa nodes: " << ret);
+    return ret;
+#else //HAVE_NUMA
+    return 0;
+#endif //HAVE_NUMA
+}
+
+unsigned getNumaNodeCount()
+{
+    static const unsigned nodeCount = probeNumaNodeCount();
+    return nodeCount;
+}
+
+void bindToNumaNode(const unsigned threadNumber, const bool strict)
+{
+#ifdef HAVE_NUMA
+    const unsigned nodeCount = getNumaNodeCount();
+    if (nodeCount)
+    {
+        int runOnNode = threadNumber % nodeCount;
+        ISAAC_ASSERT_MSG(-1 != numa_run_on_node(runOnNode), "numa_run_on_node " << runOnNode <<
+            " failed, errno: " << errno  << ":" << strerror(errno));
+        unsigned long nodemask = 1UL << runOnNode;
+        const int mode = strict ? MPOL_BIND/*|MPOL_F_STATIC_NODES*/ : MPOL_PREFERRED;
+        ISAAC_ASSERT_MSG(-1 != set_mempolicy(mode, &nodemask, sizeof(nodemask) * 8),
+                         "set_mempolicy " << mode << " for nodemask: " << nodemask <<
+                         " failed, errno: " << errno << ":" << strerror(errno));
+    }
+#endif //HAVE_NUMA
+}
+
+ScopedNumaInterleave::ScopedNumaInterleave() : savedMode_(-1), savedNodemask_(0)
+{
+#ifdef HAVE_NUMA
+    const unsigned nodeCount = getNumaNodeCount();
+    if (1 < nodeCount)
+    {
+        ISAAC_ASSERT_MSG(-1 != get_mempolicy(&savedMode_, &savedNodemask_, sizeof(savedNodemask_) * 8, 0, 0),
+                         "get_mempolicy failed, errno: " << errno << ":" << strerror(errno));
+        unsigned long nodemask = ~0UL >> (sizeof(nodemask) * 8 - nodeCount);
+        ISAAC_ASSERT_MSG(-1 != set_mempolicy(MPOL_INTERLEAVE, &nodemask, sizeof(nodemask) * 8),
+                         "set_mempolicy MPOL_INTERLEAVE for nodemask: " << nodemask <<
+                         " failed, errno: " << errno << ":" << strerror(errno));
+    }
+#endif //HAVE_NUMA
+}
+
+ScopedNumaInterleave::~ScopedNumaInterleave()
+{
+#ifdef HAVE_NUMA
+    if (-1 != savedMode_)
+    {
+        // MPOL_DEFAULT does not take a nodemask
+        set_mempolicy(savedMode_, MPOL_DEFAULT == savedMode_ ? 0 : &savedNodemask_, sizeof(savedNodemask_) * 8);
+    }
+#endif //HAVE_NUMA
+}
+
+void NumaPlacement::count(const void *begin, const std::size_t bytes)
+{
+#ifdef HAVE_NUMA
+    if (1 < nodePages_.size() && bytes)
+    {
+        static const unsigned long PAGES_STEP = 16;
+        static const unsigned PAGES_PER_CALL = 1024;
+        const unsigned long pageSize = sysconf(_SC_PAGESIZE);
+        const char *page = static_cast<const char*>(begin) - reinterpret_cast<unsigned long>(begin) % pageSize;
+        const char *end = static_cast<const char*>(begin) + bytes;
+        void *pages[PAGES_PER_CALL];
+        int status[PAGES_PER_CALL];
+        while (end > page)
+        {
+            unsigned long count = 0;
+            for (; PAGES_PER_CALL > count && end > page; ++count, page += pageSize * PAGES_STEP)
+            {
+                pages[count] = const_cast<char*>(page);
+            }
+            // with nodes set to 0, move_pages only reports where the pages are
+            if (-1 == move_pages(0, count, pages, 0, status, 0))
+            {
+                ISAAC_THREAD_CERR << "WARNING: move_pages failed, errno: " << errno << ":" << strerror(errno) << std::endl;
+                return;
+            }
+            for (unsigned long i = 0; count > i; ++i)
+            {
+                // negative status is for pages that are not present
+                if (0 <= status[i] && nodePages_.size() > unsigned(status[i]))
+                {
+                    nodePages_[status[i]] += PAGES_STEP;
+                }
+            }
+        }
+    }
+#endif //HAVE_NUMA
+}
+
+std::ostream &operator <<(std::ostream &os, const NumaPlacement &placement)
+{
+    os << "NumaPlacement(";
+    for (std::size_t node = 0; placement.nodePages_.size() > node; ++node)
+    {
+        os << (node ? ", " : "") << "node " << node << ": ~" << placement.nodePages_[node] << " pages";
+    }
+    return os << ")";
+}
+
+} // namespace common
+} // namespace isaac
@@ -82,6 +82,16 @@ unsigned int getMaxOpenFiles()
 #endif
 }
 
+unsigned long getPhysicalMemory()
+{
+#ifdef HAVE_SYSCONF
+    assert(0 < sysconf(_SC_PHYS_PAGES));
+    return static_cast<unsigned long>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGESIZE);
+#else
+#error 'sysconf' is required
+#endif
+}
+
 long clock()
 {
 #ifdef HAVE_CLOCK
@@ -0,0 +1,144 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testNuma.cpp
+ **
+ ** Unit tests for Numa.hh on hosts without numa or with a single node
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include "common/config.h"
+
+#ifdef HAVE_NUMA
+#include <numaif.h>
+#endif //HAVE_NUMA
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testNuma.hh"
+
+#include "common/Numa.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestNuma, registryName("Numa"));
+
+// a few megabytes so that the vector gets its own mapping rather than heap pages touched before
+static const unsigned long SEED_COUNT = 1024 * 1024;
+
+void TestNuma::setUp()
+{
+}
+
+void TestNuma::tearDown()
+{
+}
+
+void TestNuma::testNodeCount()
+{
+    const unsigned nodeCount = isaac::common::getNumaNodeCount();
+    // probed once
+    CPPUNIT_ASSERT_EQUAL(nodeCount, isaac::common::getNumaNodeCount());
+#ifndef HAVE_NUMA
+    CPPUNIT_ASSERT_EQUAL(0U, nodeCount);
+#endif //HAVE_NUMA
+}
+
+void TestNuma::testInterleaveKeepsPolicy()
+{
+    if (1 < isaac::common::getNumaNodeCount())
+    {
+        // the fallback path is what is tested here
+        return;
+    }
+#ifdef HAVE_NUMA
+    int mode = -1;
+    unsigned long nodemask = 0;
+    CPPUNIT_ASSERT_EQUAL(0, get_mempolicy(&mode, &nodemask, sizeof(nodemask) * 8, 0, 0));
+    {
+        const isaac::common::ScopedNumaInterleave interleave;
+        int scopedMode = -1;
+        unsigned long scopedNodemask = 0;
+        CPPUNIT_ASSERT_EQUAL(0, get_mempolicy(&scopedMode, &scopedNodemask, sizeof(scopedNodemask) * 8, 0, 0));
+        CPPUNIT_ASSERT_EQUAL(mode, scopedMode);
+        CPPUNIT_ASSERT_EQUAL(nodemask, scopedNodemask);
+    }
+    int restoredMode = -1;
+    unsigned long restoredNodemask = 0;
+    CPPUNIT_ASSERT_EQUAL(0, get_mempolicy(&restoredMode, &restoredNodemask, sizeof(restoredNodemask) * 8, 0, 0));
+    CPPUNIT_ASSERT_EQUAL(mode, restoredMode);
+    CPPUNIT_ASSERT_EQUAL(nodemask, restoredNodemask);
+#else //HAVE_NUMA
+    // nothing to observe, construction and destruction must simply not fail
+    const isaac::common::ScopedNumaInterleave interleave;
+#endif //HAVE_NUMA
+}
+
+static unsigned long seedValue(const unsigned long i)
+{
+    return i * 2654435761UL;
+}
+
+void TestNuma::testInterleavedAllocation()
+{
+    // same as SeedMemoryManager::allocate
+    std::vector<unsigned long> seeds(SEED_COUNT / 2);
+    for (unsigned long i = 0; seeds.size() > i; ++i)
+    {
+        seeds[i] = seedValue(i);
+    }
+    {
+        const isaac::common::ScopedNumaInterleave interleave;
+        // nested guards must not break the outer one
+        {
+            const isaac::common::ScopedNumaInterleave nested;
+        }
+        seeds.resize(SEED_COUNT);
+    }
+
+    for (unsigned long i = 0; SEED_COUNT / 2 > i; ++i)
+    {
+        CPPUNIT_ASSERT_EQUAL(seedValue(i), seeds[i]);
+    }
+    for (unsigned long i = SEED_COUNT / 2; SEED_COUNT > i; ++i)
+    {
+        CPPUNIT_ASSERT_EQUAL(0UL, seeds[i]);
+        seeds[i] = seedValue(i);
+    }
+    for (unsigned long i = 0; SEED_COUNT > i; ++i)
+    {
+        CPPUNIT_ASSERT_EQUAL(seedValue(i), seeds[i]);
+    }
+}
+
+void TestNuma::testPlacement()
+{
+    if (1 < isaac::common::getNumaNodeCount())
+    {
+        return;
+    }
+    const std::vector<char> data(SEED_COUNT, 'A');
+    isaac::common::NumaPlacement placement;
+    placement.count(&data.front(), data.size());
+    placement.count(&data.front(), 0);
+
+    std::ostringstream os;
+    os << placement;
+    // with a single node there is nothing to count
+    CPPUNIT_ASSERT_EQUAL(std::string(isaac::common::getNumaNodeCount() ?
+        "NumaPlacement(node 0: ~0 pages)" : "NumaPlacement()"), os.str());
+    CPPUNIT_ASSERT(std::vector<char>(SEED_COUNT, 'A') == data);
+}
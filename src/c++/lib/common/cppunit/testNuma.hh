@@ -0,0 +1,42 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testNuma.hh
+ **
+ ** Unit tests for Numa.hh on hosts without numa or with a single node
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_CPPUNIT_TEST_NUMA_HH
+#define iSAAC_COMMON_CPPUNIT_TEST_NUMA_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TestNuma : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestNuma );
+    CPPUNIT_TEST( testNodeCount );
+    CPPUNIT_TEST( testInterleaveKeepsPolicy );
+    CPPUNIT_TEST( testInterleavedAllocation );
+    CPPUNIT_TEST( testPlacement );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testNodeCount();
+    void testInterleaveKeepsPolicy();
+    void testInterleavedAllocation();
+    void testPlacement();
+};
+
+#endif // #ifndef iSAAC_COMMON_CPPUNIT_TEST_NUMA_HH
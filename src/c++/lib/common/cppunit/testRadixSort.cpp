@@ -0,0 +1,120 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testRadixSort.cpp
+ **
+ ** Unit tests for RadixSort.hpp
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "RegistryName.hh"
+#include "testRadixSort.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestRadixSort, registryName("RadixSort"));
+
+void TestRadixSort::setUp()
+{
+}
+
+void TestRadixSort::tearDown()
+{
+}
+
+/// 64-bit key with a payload that must travel with it
+struct Record
+{
+    unsigned long key_;
+    unsigned payload_;
+};
+
+struct RecordDigits
+{
+    static const unsigned DIGITS = 8;
+    unsigned char operator()(const Record &record, const unsigned digit) const
+    {
+        return (record.key_ >> (digit * 8)) & 0xFF;
+    }
+    bool operator()(const Record &left, const Record &right) const
+    {
+        return left.key_ < right.key_;
+    }
+};
+
+static std::vector<Record> makeRecords(const unsigned count, const unsigned long keyMask)
+{
+    std::vector<Record> ret(count);
+    for (unsigned i = 0; count > i; ++i)
+    {
+        ret[i].key_ = ((static_cast<unsigned long>(rand()) << 32) ^ rand()) & keyMask;
+        ret[i].payload_ = i;
+    }
+    return ret;
+}
+
+static void checkSorted(const std::vector<Record> &original, const std::vector<Record> &sorted)
+{
+    CPPUNIT_ASSERT_EQUAL(original.size(), sorted.size());
+    std::vector<bool> seen(original.size(), false);
+    for (std::size_t i = 0; sorted.size() > i; ++i)
+    {
+        CPPUNIT_ASSERT(!i || sorted[i - 1].key_ <= sorted[i].key_);
+        CPPUNIT_ASSERT_EQUAL(original.at(sorted[i].payload_).key_, sorted[i].key_);
+        CPPUNIT_ASSERT(!seen.at(sorted[i].payload_));
+        seen[sorted[i].payload_] = true;
+    }
+}
+
+void TestRadixSort::testInPlace()
+{
+    isaac::common::ThreadVector threads(4);
+    const std::vector<Record> original = makeRecords(100000, ~0UL);
+    std::vector<Record> records(original);
+    isaac::common::radixSort(records.begin(), records.end(), RecordDigits(), threads, threads.size(), 0);
+    checkSorted(original, records);
+}
+
+void TestRadixSort::testScratch()
+{
+    isaac::common::ThreadVector threads(4);
+    const std::vector<Record> original = makeRecords(100000, ~0UL);
+    // enough scratch for some of the buckets to be sorted with lsd and some in place
+    for (std::size_t scratch = 0; original.size() >= scratch; scratch += original.size() / 4)
+    {
+        std::vector<Record> records(original);
+        isaac::common::radixSort(records.begin(), records.end(), RecordDigits(), threads, 3, scratch);
+        checkSorted(original, records);
+    }
+}
+
+void TestRadixSort::testSkewed()
+{
+    isaac::common::ThreadVector threads(4);
+    // identical top digits and a few distinct values in the low ones
+    std::vector<Record> original = makeRecords(50000, 0x0F0FUL);
+    std::vector<Record> records(original);
+    isaac::common::radixSort(records.begin(), records.end(), RecordDigits(), threads, threads.size(), records.size());
+    checkSorted(original, records);
+
+    // all equal
+    for (std::size_t i = 0; original.size() > i; ++i)
+    {
+        original[i].key_ = 42;
+    }
+    records = original;
+    isaac::common::radixSort(records.begin(), records.end(), RecordDigits(), threads, threads.size(), 0);
+    checkSorted(original, records);
+}
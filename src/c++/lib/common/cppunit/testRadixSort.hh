@@ -0,0 +1,42 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testRadixSort.hh
+ **
+ ** Unit tests for RadixSort.hpp
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_CPPUNIT_TEST_RADIX_SORT
+#define iSAAC_COMMON_CPPUNIT_TEST_RADIX_SORT
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "common/RadixSort.hpp"
+
+class TestRadixSort : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestRadixSort );
+    CPPUNIT_TEST( testInPlace );
+    CPPUNIT_TEST( testScratch );
+    CPPUNIT_TEST( testSkewed );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testInPlace();
+    void testScratch();
+    void testSkewed();
+};
+
+#endif // #ifndef iSAAC_COMMON_CPPUNIT_TEST_RADIX_SORT
@@ -0,0 +1,103 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testWorkStealingScheduler.cpp
+ **
+ ** Unit tests for WorkStealingScheduler.hpp
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "RegistryName.hh"
+#include "testWorkStealingScheduler.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestWorkStealingScheduler, registryName("WorkStealingScheduler"));
+
+void TestWorkStealingScheduler::setUp()
+{
+}
+
+void TestWorkStealingScheduler::tearDown()
+{
+}
+
+struct CountTask
+{
+    std::vector<unsigned> &executed_;
+    std::vector<unsigned> &threadTasks_;
+    boost::mutex &mutex_;
+    CountTask(std::vector<unsigned> &executed, std::vector<unsigned> &threadTasks, boost::mutex &mutex) :
+        executed_(executed), threadTasks_(threadTasks), mutex_(mutex){}
+    void operator()(const unsigned task, const unsigned threadNumber) const
+    {
+        // make the large tasks take noticeably longer so that the others have to steal
+        boost::this_thread::sleep(boost::posix_time::milliseconds(task % 7));
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        ++executed_.at(task);
+        ++threadTasks_.at(threadNumber);
+    }
+};
+
+void TestWorkStealingScheduler::testEachTaskOnce()
+{
+    isaac::common::ThreadVector threads(4);
+    isaac::common::WorkStealingScheduler scheduler(threads, 3, 100);
+    boost::mutex mutex;
+    for (unsigned tasks = 0; 100 >= tasks; tasks += 25)
+    {
+        std::vector<unsigned long> costs;
+        for (unsigned task = 0; tasks > task; ++task)
+        {
+            costs.push_back(task % 7);
+        }
+        std::vector<unsigned> executed(tasks, 0);
+        std::vector<unsigned> threadTasks(threads.size(), 0);
+        scheduler.execute(CountTask(executed, threadTasks, mutex), costs);
+        CPPUNIT_ASSERT_EQUAL(std::size_t(tasks), std::size_t(std::count(executed.begin(), executed.end(), 1U)));
+        // only the requested number of threads is allowed to participate
+        CPPUNIT_ASSERT_EQUAL(0U, threadTasks.back());
+        CPPUNIT_ASSERT_EQUAL(tasks, std::accumulate(threadTasks.begin(), threadTasks.end(), 0U));
+    }
+}
+
+void TestWorkStealingScheduler::testSingleThread()
+{
+    isaac::common::ThreadVector threads(2);
+    isaac::common::WorkStealingScheduler scheduler(threads, 1, 10);
+    boost::mutex mutex;
+    const std::vector<unsigned long> costs(10, 1);
+    std::vector<unsigned> executed(costs.size(), 0);
+    std::vector<unsigned> threadTasks(threads.size(), 0);
+    scheduler.execute(CountTask(executed, threadTasks, mutex), costs);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(costs.size()), std::size_t(std::count(executed.begin(), executed.end(), 1U)));
+    CPPUNIT_ASSERT_EQUAL(10U, threadTasks.front());
+}
+
+static void throwOnTaskFive(const unsigned task, const unsigned)
+{
+    if (5 == task)
+    {
+        BOOST_THROW_EXCEPTION(isaac::common::IoException(EIO, "task 5 failed"));
+    }
+}
+
+void TestWorkStealingScheduler::testException()
+{
+    isaac::common::ThreadVector threads(2);
+    isaac::common::WorkStealingScheduler scheduler(threads, 2, 10);
+    const std::vector<unsigned long> costs(10, 1);
+    CPPUNIT_ASSERT_THROW(scheduler.execute(&throwOnTaskFive, costs), isaac::common::IoException);
+}
@@ -0,0 +1,42 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file testWorkStealingScheduler.hh
+ **
+ ** Unit tests for WorkStealingScheduler.hpp
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifndef iSAAC_COMMON_CPPUNIT_TEST_WORK_STEALING_SCHEDULER
+#define iSAAC_COMMON_CPPUNIT_TEST_WORK_STEALING_SCHEDULER
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "common/WorkStealingScheduler.hpp"
+
+class TestWorkStealingScheduler : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestWorkStealingScheduler );
+    CPPUNIT_TEST( testEachTaskOnce );
+    CPPUNIT_TEST( testSingleThread );
+    CPPUNIT_TEST( testException );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testEachTaskOnce();
+    void testSingleThread();
+    void testException();
+};
+
+#endif // #ifndef iSAAC_COMMON_CPPUNIT_TEST_WORK_STEALING_SCHEDULER
@@ -16,8 +16,10 @@
  **
  ** \author Roman Petrovski
  **/
-//#include <xmmintrin.h>
+#include <emmintrin.h>
+
 #include <boost/bind.hpp>
+#include <boost/foreach.hpp>
 
 #include "common/Debug.hh"
 #include "common/FileSystem.hh"
@@ -35,27 +37,50 @@ FastqReader::FastqReader(const bool allowVariableLength, const boost::filesystem
     fileBuffer_(std::ios_base::in),
     decompressor_(DECOMPRESSOR_BUFFER_SIZE),
     fastqPath_(),
-    compressed_(false),
+    format_(Flat),
     reachedEof_(false),
     filePos_(0),
-    zeroLengthRead_(false)
+    zeroLengthRead_(false),
+    produceChunk_(0),
+    consumeChunk_(0),
+    inputEof_(false),
+    producing_(false),
+    producerFailed_(false)
 {
+    reserveBuffers();
     open(fastqPath);
 }
 
-FastqReader::FastqReader(const bool allowVariableLength) :
+FastqReader::FastqReader(const bool allowVariableLength, const unsigned bgzfThreads) :
         allowVariableLength_(allowVariableLength),
         fileBuffer_(std::ios_base::in),
         decompressor_(DECOMPRESSOR_BUFFER_SIZE),
+        bgzfThreads_(bgzfThreads ? new common::ThreadVector(bgzfThreads) : 0),
+        bgzfReader_(bgzfThreads ? new bgzf::ParallelBgzfReader(*bgzfThreads_, bgzfThreads) : 0),
         fastqPath_(),
-        compressed_(false),
+        format_(Flat),
         reachedEof_(false),
         filePos_(0),
-        zeroLengthRead_(false)
+        zeroLengthRead_(false),
+        produceChunk_(0),
+        consumeChunk_(0),
+        inputEof_(false),
+        producing_(false),
+        producerFailed_(false)
 {
+    reserveBuffers();
     resetBuffer();
 }
 
+void FastqReader::reserveBuffers()
+{
+    buffer_.reserve(UNCOMPRESSED_BUFFER_SIZE);
+    BOOST_FOREACH(Chunk &chunk, chunks_)
+    {
+        chunk.data_.reserve(CHUNK_SIZE);
+    }
+}
+
 void FastqReader::resetBuffer()
 {
     buffer_.resize(UNCOMPRESSED_BUFFER_SIZE);
@@ -65,22 +90,60 @@ void FastqReader::resetBuffer()
     baseCallsEnd_ = buffer_.end();
     qScoresBegin_ = buffer_.end();
     endIt_ = buffer_.end();
+
+    BOOST_FOREACH(Chunk &chunk, chunks_)
+    {
+        chunk.data_.clear();
+        chunk.consumed_ = 0;
+        chunk.ready_ = false;
+    }
+    produceChunk_ = 0;
+    consumeChunk_ = 0;
+    inputEof_ = false;
+    producerFailed_ = false;
+}
+
+/**
+ * \brief BGZF is gzip with the 'BC' extra subfield carrying the block size.
+ */
+bool FastqReader::isBgzf(const std::string &path)
+{
+    if (!common::isDotGzPath(path))
+    {
+        return false;
+    }
+    std::ifstream is(path.c_str(), std::ios_base::binary);
+    bgzf::Header header;
+    return is.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+        31U == header.ID1 && 139U == header.ID2 && 8U == header.CM && (header.FLG & 4) &&
+        6U == header.xfield.XLEN[0] && 0U == header.xfield.XLEN[1] &&
+        66U == header.xfield.SI1 && 67U == header.xfield.SI2;
 }
 
 void FastqReader::open(const boost::filesystem::path &fastqPath)
 {
     if (fastqPath != fastqPath_)
     {
+        ISAAC_ASSERT_MSG(!producing_, "Attempt to open " << fastqPath << " while the chunks are being produced for " << fastqPath_);
         resetBuffer();
         // ensure actual copying, prevent path buffer sharing
         fastqPath_ = fastqPath.c_str();
-        compressed_ = common::isDotGzPath(fastqPath_);
-        fileBuffer_.reopen(fastqPath_.c_str(), FileBufWithReopen::SequentialOnce);
+        format_ = !common::isDotGzPath(fastqPath_) ? Flat : (bgzfReader_ && isBgzf(fastqPath_)) ? Bgzf : Gzip;
+        if (Bgzf == format_)
+        {
+            bgzfReader_->open(fastqPath_);
+            // the parallel reader keeps its own file handle
+            fileBuffer_.close();
+        }
+        else
+        {
+            fileBuffer_.reopen(fastqPath_.c_str(), FileBufWithReopen::SequentialOnce);
+        }
         buffer_.resize(UNCOMPRESSED_BUFFER_SIZE);
         decompressor_.reset();
         filePos_ = 0;
 
-        if (fileBuffer_.is_open())
+        if (Bgzf == format_ || fileBuffer_.is_open())
         {
             reachedEof_ = false;
             next();
@@ -90,7 +153,8 @@ void FastqReader::open(const boost::filesystem::path &fastqPath)
             BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Failed to open fastq file: %s") %
                 fastqPath_).str()));
         }
-        ISAAC_THREAD_CERR << "Opened fastq stream on " << fastqPath_ << std::endl;
+        ISAAC_THREAD_CERR << "Opened " << (Flat == format_ ? "" : Gzip == format_ ? "gzip " : "bgzf ") <<
+            "fastq stream on " << fastqPath_ << std::endl;
     }
     else
     {
@@ -113,11 +177,39 @@ IteratorT findNotNewLine(IteratorT itBegin, IteratorT itEnd)
          boost::bind(std::not_equal_to<char>(), '\n', _1));
 }
 
+/**
+ * \brief Finds the first '\n' or '\r' 16 bytes at a time
+ */
+inline const char *findNewLine(const char *begin, const char *end)
+{
+    const __m128i newLine = _mm_set1_epi8('\n');
+    const __m128i carriageReturn = _mm_set1_epi8('\r');
+    for (; std::size_t(end - begin) >= sizeof(__m128i); begin += sizeof(__m128i))
+    {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        const int mask = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, newLine), _mm_cmpeq_epi8(bytes, carriageReturn)));
+        if (mask)
+        {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+    while (end != begin && '\n' != *begin && '\r' != *begin)
+    {
+        ++begin;
+    }
+    return begin;
+}
+
 template <typename IteratorT>
 IteratorT findNewLine(IteratorT itBegin, IteratorT itEnd)
 {
-    static const char *rn = "\n\r";
-    return std::find_first_of(itBegin, itEnd, rn, rn+2);
+    if (itBegin == itEnd)
+    {
+        return itEnd;
+    }
+    const char *begin = &*itBegin;
+    return itBegin + (findNewLine(begin, begin + std::distance(itBegin, itEnd)) - begin);
 }
 
 void FastqReader::findHeader()
@@ -278,7 +370,7 @@ void FastqReader::findQScoresEnd()
     }
 }
 
-std::size_t FastqReader::readCompressedFastq(std::istream &is, char *buffer, std::size_t amount)
+std::size_t FastqReader::readCompressedFastq(std::istream &is, char *buffer, std::size_t amount, bool &eof)
 {
     const std::size_t amountOri = amount;
     while (amount)
@@ -297,7 +389,7 @@ std::size_t FastqReader::readCompressedFastq(std::istream &is, char *buffer, std
                     getPath() % getOffset(headerBegin_)).str()));
             }
 */
-            reachedEof_ = true;
+            eof = true;
             return amountOri - amount;
         }
         amount -= decompressedBytes;
@@ -309,20 +401,141 @@ std::size_t FastqReader::readCompressedFastq(std::istream &is, char *buffer, std
     return amountOri;
 }
 
-std::size_t FastqReader::readFlatFastq(std::istream &is, char *buffer, std::size_t amount)
+std::size_t FastqReader::readFlatFastq(std::istream &is, char *buffer, std::size_t amount, bool &eof)
 {
     is.read(buffer, amount);
     if (!is.good() && !is.eof())
     {
         BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format(
-            "readFlatFastq failed: %s, offset %u") %
-            getPath() % getOffset(headerBegin_)).str()));
+            "readFlatFastq failed: %s") % getPath()).str()));
     }
-    reachedEof_ = is.eof();
+    eof = is.eof();
     return is.gcount();
 
 }
 
+bool FastqReader::fillChunk(Chunk &chunk)
+{
+    chunk.data_.clear();
+    chunk.consumed_ = 0;
+    if (Bgzf == format_)
+    {
+        return !bgzfReader_->readMoreData(chunk.data_);
+    }
+
+    std::istream is(&fileBuffer_);
+    bool eof = false;
+    chunk.data_.resize(CHUNK_SIZE);
+    const std::size_t readBytes = Gzip == format_ ?
+        readCompressedFastq(is, &chunk.data_.front(), chunk.data_.size(), eof) :
+        readFlatFastq(is, &chunk.data_.front(), chunk.data_.size(), eof);
+    chunk.data_.resize(readBytes);
+    return eof;
+}
+
+void FastqReader::startProducing()
+{
+    boost::unique_lock<boost::mutex> lock(chunkMutex_);
+    ISAAC_ASSERT_MSG(!producing_, "Chunks are already being produced for " << fastqPath_);
+    producing_ = true;
+    producerFailed_ = false;
+}
+
+void FastqReader::stopProducing()
+{
+    boost::unique_lock<boost::mutex> lock(chunkMutex_);
+    producing_ = false;
+    chunkCondition_.notify_all();
+}
+
+void FastqReader::produceChunks()
+{
+    boost::unique_lock<boost::mutex> lock(chunkMutex_);
+    try
+    {
+        while (producing_ && !inputEof_)
+        {
+            Chunk &chunk = chunks_[produceChunk_];
+            if (chunk.ready_)
+            {
+                // parser has not drained it yet
+                chunkCondition_.wait(lock);
+                continue;
+            }
+            bool eof = false;
+            {
+                common::unlock_guard<boost::unique_lock<boost::mutex> > unlock(lock);
+                eof = fillChunk(chunk);
+            }
+            chunk.ready_ = true;
+            inputEof_ = eof;
+            produceChunk_ = (produceChunk_ + 1) % 2;
+            chunkCondition_.notify_all();
+        }
+    }
+    catch (...)
+    {
+        producerFailed_ = true;
+        chunkCondition_.notify_all();
+        throw;
+    }
+}
+
+std::size_t FastqReader::readChunks(char *buffer, std::size_t amount)
+{
+    const std::size_t amountOri = amount;
+    boost::unique_lock<boost::mutex> lock(chunkMutex_);
+    while (amount)
+    {
+        Chunk &chunk = chunks_[consumeChunk_];
+        if (!chunk.ready_)
+        {
+            if (producerFailed_)
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(EIO, "Failed to decompress " + getPath()));
+            }
+            if (inputEof_)
+            {
+                break;
+            }
+            if (producing_)
+            {
+                chunkCondition_.wait(lock);
+                continue;
+            }
+            // nobody is producing the chunks for us. Do it on this thread
+            ISAAC_ASSERT_MSG(produceChunk_ == consumeChunk_, "Producer position is expected to match the parser one");
+            bool eof = false;
+            {
+                common::unlock_guard<boost::unique_lock<boost::mutex> > unlock(lock);
+                eof = fillChunk(chunk);
+            }
+            chunk.ready_ = true;
+            inputEof_ = eof;
+            produceChunk_ = (produceChunk_ + 1) % 2;
+        }
+
+        const std::size_t available = chunk.data_.size() - chunk.consumed_;
+        const std::size_t copy = std::min(amount, available);
+        std::copy(chunk.data_.begin() + chunk.consumed_, chunk.data_.begin() + chunk.consumed_ + copy, buffer);
+        chunk.consumed_ += copy;
+        buffer += copy;
+        amount -= copy;
+        if (chunk.data_.size() == chunk.consumed_)
+        {
+            chunk.ready_ = false;
+            consumeChunk_ = (consumeChunk_ + 1) % 2;
+            chunkCondition_.notify_all();
+        }
+    }
+
+    if (inputEof_ && !chunks_[consumeChunk_].ready_)
+    {
+        reachedEof_ = true;
+    }
+    return amountOri - amount;
+}
+
 bool FastqReader::fetchMore()
 {
     if (reachedEof_)
@@ -341,6 +554,8 @@ bool FastqReader::fetchMore()
             getPath() % getOffset(headerBegin_)).str()));
     }
 
+    // resize within the reserved capacity does not invalidate the iterators
+    buffer_.resize(UNCOMPRESSED_BUFFER_SIZE);
     headerBegin_ -= distance;
     headerEnd_ -= distance;
     baseCallsBegin_ -= distance;
@@ -348,16 +563,9 @@ bool FastqReader::fetchMore()
     qScoresBegin_ -= distance;
     endIt_ -= distance;
 
-    BufferType::iterator firstUnreadByte = buffer_.end() - distance;
-
-
     try
     {
-        std::istream is(&fileBuffer_);
-        buffer_.resize(UNCOMPRESSED_BUFFER_SIZE);
-        const std::size_t readBytes = compressed_ ?
-            readCompressedFastq(is, &*firstUnreadByte, distance) : readFlatFastq(is, &*firstUnreadByte, buffer_.size() - moved);
-
+        const std::size_t readBytes = readChunks(&buffer_.front() + moved, buffer_.size() - moved);
         filePos_ += readBytes;
         buffer_.resize(moved + readBytes);
     }
@@ -18,6 +18,7 @@
  **/
 
 #include <fstream>
+#include <numeric>
 #include <boost/format.hpp>
 #include <boost/foreach.hpp>
 #include <boost/system/error_code.hpp>
@@ -35,13 +36,15 @@ namespace io
 TileMatchWriter::TileMatchWriter(
     alignment::MatchTally &matchTally,
     const unsigned maxTiles,
-    const unsigned maxTileIndex)
+    const unsigned maxTileIndex,
+    alignment::MatchArena *matchArena)
     : matchTally_(matchTally),
       tileFileBuffers_(
           maxTiles, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary,
           matchTally_.getMaxFilePathLength()),
       currentIteration_(-1U),
-      tileMutexes_(maxTiles)
+      tileMutexes_(maxTiles),
+      matchArena_(matchArena)
 {
     ISAAC_THREAD_CERR << "Resizing tileStreams to " << maxTileIndex + 1 << std::endl;
     tileStreams_.resize(maxTileIndex + 1);
@@ -53,6 +56,11 @@ TileMatchWriter::TileMatchWriter(
         tileStreams_.at(i) = boost::shared_ptr<std::ostream>(new std::ostream(0));
         tileMutexes_.push_back(new boost::mutex);
     }
+
+    if (matchArena_)
+    {
+        matchArena_->reserveTiles(maxTileIndex);
+    }
 }
 
 void TileMatchWriter::reopen(const unsigned iteration, const TileMetadataList &tileMetadataList)
@@ -66,6 +74,12 @@ void TileMatchWriter::reopen(const unsigned iteration, const TileMetadataList &t
         tileStreams_.at(i)->rdbuf(0);
     }
 
+    currentIteration_ = iteration;
+    if (matchArena_)
+    {
+        return;
+    }
+
     BOOST_FOREACH(const flowcell::TileMetadata &tile, tileMetadataList)
     {
         const boost::filesystem::path &filePath = matchTally_.getTilePath(iteration, tile.getIndex());
@@ -73,24 +87,101 @@ void TileMatchWriter::reopen(const unsigned iteration, const TileMetadataList &t
         // this reopens the file handle with new filePath and associates the needed ostream at the tile index position
         tileStreams_.at(tile.getIndex())->rdbuf(tileFileBuffers_.get(filePath, io::FileBufWithReopen::SequentialOnce));
     }
-    currentIteration_ = iteration;
+}
+
+/**
+ * \brief Puts matches either into the tile file or into the arena. The tile mutex must be held.
+ */
+void TileMatchWriter::store(
+    const unsigned tileIndex, const alignment::Match *matchesBegin, const alignment::Match *matchesEnd)
+{
+    if (matchArena_)
+    {
+        matchArena_->append(tileIndex, matchesBegin, matchesEnd);
+        return;
+    }
+
+    ISAAC_ASSERT_MSG(0 != tileStreams_.at(tileIndex), "Reopen was supposed to create an ostream at this position");
+    std::ostream &os = *tileStreams_.at(tileIndex);
+    if (!os.write(reinterpret_cast<const char *>(matchesBegin), sizeof(alignment::Match) * (matchesEnd - matchesBegin)))
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Failed to write matches into %s") %
+            matchTally_.getTilePath(currentIteration_, tileIndex)).str()));
+    }
 }
 
 void TileMatchWriter::write(const SeedId &seedId, const ReferencePosition &referencePosition)
 {
     const size_t index = seedId.getTile();
-
-    ISAAC_ASSERT_MSG(0 != tileStreams_.at(index), "Reopen was supposed to create an ostream at this position");
-    std::ostream &os = *tileStreams_.at(index);
     const alignment::Match match(seedId, referencePosition);
 
     boost::lock_guard<boost::mutex> lock(tileMutexes_[index]);
-    if (!os.write(reinterpret_cast<const char *>(&match), sizeof(match)))
+    store(index, &match, &match + 1);
+    matchTally_(currentIteration_, index, seedId.getBarcode());
+}
+
+void TileMatchWriter::write(
+    const unsigned tileIndex,
+    const std::vector<alignment::Match>::const_iterator matchesBegin,
+    const std::vector<alignment::Match>::const_iterator matchesEnd)
+{
+    boost::lock_guard<boost::mutex> lock(tileMutexes_[tileIndex]);
+    store(tileIndex, &*matchesBegin, &*matchesBegin + (matchesEnd - matchesBegin));
+
+    std::vector<alignment::Match>::const_iterator runBegin = matchesBegin;
+    while (matchesEnd != runBegin)
     {
-        BOOST_THROW_EXCEPTION(common::IoException(errno, (boost::format("Failed to write match into %s") %
-            matchTally_.getTilePath(currentIteration_, index)).str()));
+        const unsigned barcode = runBegin->getBarcode();
+        std::vector<alignment::Match>::const_iterator runEnd = runBegin + 1;
+        while (matchesEnd != runEnd && barcode == runEnd->getBarcode())
+        {
+            ++runEnd;
+        }
+        matchTally_(currentIteration_, tileIndex, barcode, runEnd - runBegin);
+        runBegin = runEnd;
     }
-    matchTally_(currentIteration_, index, seedId.getBarcode());
+}
+
+ThreadMatchWriter::ThreadMatchWriter(TileMatchWriter &tileMatchWriter) :
+    tileMatchWriter_(&tileMatchWriter),
+    tileOffsets_(tileMatchWriter.getMaxTileIndex() + 2)
+{
+    buffer_.reserve(MAX_BUFFERED_MATCHES);
+    partitioned_.resize(MAX_BUFFERED_MATCHES);
+}
+
+void ThreadMatchWriter::flush()
+{
+    if (buffer_.empty())
+    {
+        return;
+    }
+
+    // counting sort by tile. tileOffsets_[tile + 1] counts the tile matches first, then becomes the tile end.
+    std::fill(tileOffsets_.begin(), tileOffsets_.end(), 0);
+    BOOST_FOREACH(const alignment::Match &match, buffer_)
+    {
+        ++tileOffsets_.at(match.getTile() + 1);
+    }
+    std::partial_sum(tileOffsets_.begin(), tileOffsets_.end(), tileOffsets_.begin());
+
+    BOOST_FOREACH(const alignment::Match &match, buffer_)
+    {
+        partitioned_[tileOffsets_[match.getTile()]++] = match;
+    }
+
+    // after the scatter, tileOffsets_[tile] is the end of the tile and the beginning of the next one
+    unsigned tileBegin = 0;
+    for (unsigned tileIndex = 0; tileOffsets_.size() - 1 > tileIndex; ++tileIndex)
+    {
+        const unsigned tileEnd = tileOffsets_[tileIndex];
+        if (tileBegin != tileEnd)
+        {
+            tileMatchWriter_->write(tileIndex, partitioned_.begin() + tileBegin, partitioned_.begin() + tileEnd);
+        }
+        tileBegin = tileEnd;
+    }
+    buffer_.clear();
 }
 
 } //namespace io
@@ -0,0 +1,160 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+#include <zlib.h>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testFastqReader.hh"
+
+#include "bgzf/BgzfCompressor.hh"
+#include "io/FastqReader.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestFastqReader, registryName("FastqReader"));
+
+// enough records for the uncompressed data to span several chunks and many BGZF blocks
+static const unsigned RECORDS = 50000;
+static const unsigned READ_LENGTH = 100;
+
+void TestFastqReader::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testFastqReader-%%%%-%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+    flatPath_ = tempDirectory_ / "flat.fastq";
+    gzipPath_ = tempDirectory_ / "gzip.fastq.gz";
+    bgzfPath_ = tempDirectory_ / "bgzf.fastq.gz";
+
+    std::string fastq;
+    unsigned random = 1;
+    for (unsigned record = 0; RECORDS > record; ++record)
+    {
+        headers_.push_back("@read" + boost::lexical_cast<std::string>(record));
+        std::string sequence;
+        std::string qualities;
+        for (unsigned cycle = 0; READ_LENGTH > cycle; ++cycle)
+        {
+            random = random * 1103515245 + 12345;
+            sequence.push_back("ACGT"[(random >> 16) % 4]);
+            qualities.push_back('#' + (random >> 20) % 40);
+        }
+        sequences_.push_back(sequence);
+        fastq += headers_.back() + "\n" + sequence + "\n+\n" + qualities + "\n";
+    }
+
+    std::ofstream flat(flatPath_.c_str());
+    flat << fastq;
+    flat.close();
+
+    gzFile gzip = gzopen(gzipPath_.c_str(), "wb");
+    CPPUNIT_ASSERT(gzip);
+    CPPUNIT_ASSERT_EQUAL(int(fastq.size()), gzwrite(gzip, fastq.data(), fastq.size()));
+    CPPUNIT_ASSERT_EQUAL(Z_OK, gzclose(gzip));
+
+    std::ofstream bgzfFile(bgzfPath_.c_str(), std::ios_base::binary);
+    boost::iostreams::filtering_ostream bgzf;
+    bgzf.push(isaac::bgzf::BgzfCompressor());
+    bgzf.push(bgzfFile);
+    bgzf << fastq;
+    bgzf.strict_sync();
+}
+
+void TestFastqReader::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+    headers_.clear();
+    sequences_.clear();
+}
+
+void TestFastqReader::checkRecords(isaac::io::FastqReader &reader)
+{
+    const isaac::flowcell::ReadMetadata readMetadata(1, READ_LENGTH, 0, 0);
+    std::vector<char> bcl(READ_LENGTH);
+    for (unsigned record = 0; RECORDS > record; ++record)
+    {
+        CPPUNIT_ASSERT(reader.hasData());
+        const isaac::io::FastqReader::IteratorPair header = reader.getHeader();
+        CPPUNIT_ASSERT_EQUAL(headers_.at(record), std::string(header.first, header.second));
+        CPPUNIT_ASSERT_EQUAL(READ_LENGTH, reader.getReadLength());
+        CPPUNIT_ASSERT(bcl.end() == reader.extractBcl(readMetadata, bcl.begin()));
+        for (unsigned cycle = 0; READ_LENGTH > cycle; ++cycle)
+        {
+            CPPUNIT_ASSERT_EQUAL(sequences_.at(record)[cycle], "ACGT"[bcl[cycle] & 3]);
+        }
+        reader.next();
+    }
+    CPPUNIT_ASSERT(!reader.hasData());
+}
+
+void TestFastqReader::testIsBgzf()
+{
+    CPPUNIT_ASSERT(isaac::io::FastqReader::isBgzf(bgzfPath_.string()));
+    CPPUNIT_ASSERT(!isaac::io::FastqReader::isBgzf(gzipPath_.string()));
+    CPPUNIT_ASSERT(!isaac::io::FastqReader::isBgzf(flatPath_.string()));
+    // only .gz files are looked into
+    const boost::filesystem::path renamed = tempDirectory_ / "bgzf.fastq";
+    boost::filesystem::copy_file(bgzfPath_, renamed);
+    CPPUNIT_ASSERT(!isaac::io::FastqReader::isBgzf(renamed.string()));
+}
+
+void TestFastqReader::testFlat()
+{
+    isaac::io::FastqReader reader(false, 2);
+    reader.open(flatPath_);
+    checkRecords(reader);
+
+    // same reader is reused for the next file
+    reader.open(gzipPath_);
+    checkRecords(reader);
+}
+
+void TestFastqReader::testParallelBgzf()
+{
+    isaac::io::FastqReader reader(false, 3);
+    reader.open(bgzfPath_);
+    checkRecords(reader);
+
+    // same reader is reused for the next file
+    const boost::filesystem::path copy = tempDirectory_ / "copy.fastq.gz";
+    boost::filesystem::copy_file(bgzfPath_, copy);
+    reader.open(copy);
+    checkRecords(reader);
+}
+
+void TestFastqReader::testSequentialBgzf()
+{
+    // without the threads BGZF is just a sequence of gzip members
+    isaac::io::FastqReader reader(false);
+    reader.open(bgzfPath_);
+    checkRecords(reader);
+}
+
+void TestFastqReader::testPipelinedBgzf()
+{
+    isaac::io::FastqReader reader(false, 2);
+    reader.open(bgzfPath_);
+    reader.startProducing();
+    boost::thread producer(boost::bind(&isaac::io::FastqReader::produceChunks, &reader));
+    checkRecords(reader);
+    reader.stopProducing();
+    producer.join();
+}
@@ -0,0 +1,60 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_IO_TEST_FASTQ_READER_HH
+#define iSAAC_IO_TEST_FASTQ_READER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+namespace isaac
+{
+namespace io
+{
+class FastqReader;
+}
+}
+
+class TestFastqReader : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestFastqReader );
+    CPPUNIT_TEST( testIsBgzf );
+    CPPUNIT_TEST( testFlat );
+    CPPUNIT_TEST( testParallelBgzf );
+    CPPUNIT_TEST( testSequentialBgzf );
+    CPPUNIT_TEST( testPipelinedBgzf );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+    boost::filesystem::path flatPath_;
+    boost::filesystem::path gzipPath_;
+    boost::filesystem::path bgzfPath_;
+    std::vector<std::string> headers_;
+    std::vector<std::string> sequences_;
+
+    void checkRecords(isaac::io::FastqReader &reader);
+public:
+    void setUp();
+    void tearDown();
+    void testIsBgzf();
+    void testFlat();
+    void testParallelBgzf();
+    void testSequentialBgzf();
+    void testPipelinedBgzf();
+};
+
+#endif // #ifndef iSAAC_IO_TEST_FASTQ_READER_HH
@@ -0,0 +1,176 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testMatchWriter.hh"
+
+#include "alignment/MatchArena.hh"
+#include "io/MatchWriter.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestMatchWriter, registryName("MatchWriter"));
+
+using isaac::alignment::Match;
+using isaac::alignment::SeedId;
+using isaac::reference::ReferencePosition;
+
+static const unsigned TILES = 3;
+static const unsigned BARCODES = 3;
+static const unsigned ITERATIONS = 2;
+// enough for ThreadMatchWriter to flush on its own a couple of times
+static const unsigned MATCHES = isaac::io::ThreadMatchWriter::MAX_BUFFERED_MATCHES * 2 + 1234;
+
+TestMatchWriter::TestMatchWriter() : barcodeMetadataList_(BARCODES)
+{
+    for (unsigned tileIndex = 0; TILES > tileIndex; ++tileIndex)
+    {
+        tileMetadataList_.push_back(isaac::flowcell::TileMetadata("blah", 0, 1101 + tileIndex, 1, MATCHES, tileIndex));
+    }
+}
+
+void TestMatchWriter::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testMatchWriter-%%%%-%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+    matchTally_.reset(new isaac::alignment::MatchTally(ITERATIONS, tempDirectory_, barcodeMetadataList_));
+    BOOST_FOREACH(const isaac::flowcell::TileMetadata &tile, tileMetadataList_)
+    {
+        matchTally_->addTile(tile);
+    }
+    tileMatches_.clear();
+    tileMatches_.resize(TILES);
+}
+
+void TestMatchWriter::tearDown()
+{
+    matchTally_.reset();
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+/**
+ * \brief Writes MATCHES matches through a ThreadMatchWriter. Tiles and barcodes are interleaved
+ *        with different periods so that each flush sees all tiles and runs of various barcodes.
+ */
+void TestMatchWriter::writeMatches(isaac::io::TileMatchWriter &tileMatchWriter)
+{
+    isaac::io::ThreadMatchWriter threadMatchWriter(tileMatchWriter);
+    for (unsigned i = 0; MATCHES > i; ++i)
+    {
+        const unsigned tile = (i / 7) % TILES;
+        const unsigned barcode = (i / 5) % BARCODES;
+        const SeedId seedId(tile, barcode, i, 0, i % 2);
+        const ReferencePosition position(i % 4, i * 10UL);
+        threadMatchWriter.write(seedId, position);
+        tileMatches_.at(tile).push_back(Match(seedId, position));
+    }
+    threadMatchWriter.flush();
+}
+
+static void checkMatches(const std::vector<Match> &expected, const std::vector<Match> &actual)
+{
+    CPPUNIT_ASSERT_EQUAL(expected.size(), actual.size());
+    for (unsigned i = 0; expected.size() > i; ++i)
+    {
+        CPPUNIT_ASSERT_EQUAL(expected[i].seedId, actual[i].seedId);
+        CPPUNIT_ASSERT_EQUAL(expected[i].location, actual[i].location);
+    }
+}
+
+void TestMatchWriter::checkTally(const unsigned iteration)
+{
+    for (unsigned tileIndex = 0; TILES > tileIndex; ++tileIndex)
+    {
+        const isaac::alignment::MatchTally::FileTallyList &tallies =
+            matchTally_->getFileTallyList(tileMetadataList_.at(tileIndex));
+        std::vector<unsigned long> barcodeTally(BARCODES, 0);
+        BOOST_FOREACH(const Match &match, tileMatches_.at(tileIndex))
+        {
+            ++barcodeTally.at(match.getBarcode());
+        }
+        for (unsigned i = 0; ITERATIONS > i; ++i)
+        {
+            const isaac::alignment::MatchTally::FileTally &tally = tallies.at(i);
+            CPPUNIT_ASSERT_EQUAL(iteration == i ? tileMatches_.at(tileIndex).size() : 0UL, tally.matchCount_);
+            for (unsigned barcode = 0; BARCODES > barcode; ++barcode)
+            {
+                CPPUNIT_ASSERT_EQUAL(iteration == i ? barcodeTally.at(barcode) : 0UL, tally.getBarcodeMatchCount(barcode));
+            }
+        }
+    }
+}
+
+void TestMatchWriter::testTileFiles()
+{
+    {
+        isaac::io::TileMatchWriter tileMatchWriter(*matchTally_, TILES, TILES - 1);
+        tileMatchWriter.reopen(1, tileMetadataList_);
+        writeMatches(tileMatchWriter);
+    }
+
+    for (unsigned tileIndex = 0; TILES > tileIndex; ++tileIndex)
+    {
+        CPPUNIT_ASSERT(!boost::filesystem::exists(matchTally_->getTilePath(0, tileIndex)));
+        const boost::filesystem::path &path = matchTally_->getTilePath(1, tileIndex);
+        CPPUNIT_ASSERT_EQUAL(tileMatches_.at(tileIndex).size() * sizeof(Match),
+                             static_cast<std::size_t>(boost::filesystem::file_size(path)));
+
+        std::vector<Match> matches(tileMatches_.at(tileIndex).size());
+        std::ifstream is(path.c_str(), std::ios_base::binary);
+        CPPUNIT_ASSERT(is.read(reinterpret_cast<char *>(&matches.front()), matches.size() * sizeof(Match)));
+        // the order within the tile is the order of writing
+        checkMatches(tileMatches_.at(tileIndex), matches);
+    }
+    checkTally(1);
+}
+
+void TestMatchWriter::testArena()
+{
+    isaac::alignment::MatchArena matchArena;
+    {
+        isaac::io::TileMatchWriter tileMatchWriter(*matchTally_, TILES, TILES - 1, &matchArena);
+        tileMatchWriter.reopen(0, tileMetadataList_);
+        writeMatches(tileMatchWriter);
+    }
+
+    for (unsigned tileIndex = 0; TILES > tileIndex; ++tileIndex)
+    {
+        // nothing goes to the files when the arena is used
+        CPPUNIT_ASSERT(!boost::filesystem::exists(matchTally_->getTilePath(0, tileIndex)));
+        std::vector<Match> matches;
+        matchArena.extractTileMatches(tileIndex, matches);
+        checkMatches(tileMatches_.at(tileIndex), matches);
+    }
+    checkTally(0);
+}
+
+void TestMatchWriter::testEmptyFlush()
+{
+    {
+        isaac::io::TileMatchWriter tileMatchWriter(*matchTally_, TILES, TILES - 1);
+        tileMatchWriter.reopen(0, tileMetadataList_);
+        isaac::io::ThreadMatchWriter threadMatchWriter(tileMatchWriter);
+        threadMatchWriter.flush();
+    }
+    for (unsigned tileIndex = 0; TILES > tileIndex; ++tileIndex)
+    {
+        // reopen truncates the tile files, nothing gets written into them
+        CPPUNIT_ASSERT_EQUAL(0UL, static_cast<unsigned long>(boost::filesystem::file_size(matchTally_->getTilePath(0, tileIndex))));
+    }
+    checkTally(0);
+}
@@ -0,0 +1,63 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_IO_TEST_MATCH_WRITER_HH
+#define iSAAC_IO_TEST_MATCH_WRITER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include "alignment/Match.hh"
+#include "alignment/MatchTally.hh"
+#include "flowcell/BarcodeMetadata.hh"
+#include "flowcell/TileMetadata.hh"
+
+namespace isaac
+{
+namespace io
+{
+class TileMatchWriter;
+}
+}
+
+class TestMatchWriter : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestMatchWriter );
+    CPPUNIT_TEST( testTileFiles );
+    CPPUNIT_TEST( testArena );
+    CPPUNIT_TEST( testEmptyFlush );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    const isaac::flowcell::BarcodeMetadataList barcodeMetadataList_;
+    isaac::flowcell::TileMetadataList tileMetadataList_;
+    boost::filesystem::path tempDirectory_;
+    boost::scoped_ptr<isaac::alignment::MatchTally> matchTally_;
+    // [tile][match] in the order they were given to the writer
+    std::vector<std::vector<isaac::alignment::Match> > tileMatches_;
+
+    void writeMatches(isaac::io::TileMatchWriter &tileMatchWriter);
+    void checkTally(const unsigned iteration);
+public:
+    TestMatchWriter();
+    void setUp();
+    void tearDown();
+    void testTileFiles();
+    void testArena();
+    void testEmptyFlush();
+};
+
+#endif // #ifndef iSAAC_IO_TEST_MATCH_WRITER_HH
@@ -0,0 +1,31 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file PackedSequence.cpp
+ **
+ ** \brief See PackedSequence.hh.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include "oligo/PackedSequence.hh"
+
+namespace isaac
+{
+namespace oligo
+{
+
+const unsigned PackedSequence::BASES_PER_WORD;
+const unsigned long PackedSequence::LANE_LOW_BITS;
+
+} // namespace oligo
+} // namespace isaac
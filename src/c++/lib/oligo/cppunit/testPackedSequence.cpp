@@ -0,0 +1,107 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <string>
+
+#include "RegistryName.hh"
+#include "testPackedSequence.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestPackedSequence, registryName("PackedSequence"));
+
+using isaac::oligo::PackedSequence;
+
+void TestPackedSequence::setUp()
+{
+    // 100 bases, long enough to span several base words and two N mask words
+    sequence_ = "ACGTTGCANNACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTACGTNACGTACGTACGTACGTACGTACGTACGTACGT";
+    sequence_.resize(100, 'G');
+}
+
+void TestPackedSequence::tearDown()
+{
+}
+
+static unsigned long packBases(const std::string &bases)
+{
+    unsigned long ret = 0;
+    for (unsigned i = 0; bases.size() > i && PackedSequence::BASES_PER_WORD > i; ++i)
+    {
+        const unsigned value = isaac::oligo::getValue(bases[i]);
+        ret |= static_cast<unsigned long>(3 < value ? 0 : value) << (i * 2);
+    }
+    return ret;
+}
+
+void TestPackedSequence::testGetBases()
+{
+    PackedSequence packed;
+    packed.assign(sequence_.begin(), sequence_.end());
+    CPPUNIT_ASSERT_EQUAL(sequence_.size(), packed.size());
+    for (unsigned position = 0; sequence_.size() > position; ++position)
+    {
+        CPPUNIT_ASSERT_EQUAL(packBases(sequence_.substr(position)), packed.getBases(position));
+    }
+    CPPUNIT_ASSERT_EQUAL(0UL, packed.getBases(sequence_.size()));
+
+    PackedSequence pushed;
+    pushed.push_back(1);
+    pushed.push_back(isaac::oligo::invalidOligo);
+    pushed.push_back(3);
+    CPPUNIT_ASSERT_EQUAL(3UL, pushed.size());
+    CPPUNIT_ASSERT_EQUAL(0x31UL, pushed.getBases(0));
+    CPPUNIT_ASSERT_EQUAL(0x4UL, pushed.getNLanes(0));
+}
+
+void TestPackedSequence::testNLanes()
+{
+    PackedSequence packed;
+    packed.assign(sequence_.begin(), sequence_.end());
+    for (unsigned position = 0; sequence_.size() > position; ++position)
+    {
+        unsigned long expected = 0;
+        for (unsigned i = 0; PackedSequence::BASES_PER_WORD > i && sequence_.size() > position + i; ++i)
+        {
+            if ('N' == sequence_[position + i])
+            {
+                expected |= 1UL << (i * 2);
+            }
+        }
+        CPPUNIT_ASSERT_EQUAL(expected, packed.getNLanes(position));
+    }
+}
+
+void TestPackedSequence::testHasN()
+{
+    PackedSequence packed;
+    packed.assign(sequence_.begin(), sequence_.end());
+    CPPUNIT_ASSERT(!packed.hasN(0, 8));
+    CPPUNIT_ASSERT(packed.hasN(0, 9));
+    CPPUNIT_ASSERT(packed.hasN(9, 10));
+    CPPUNIT_ASSERT(!packed.hasN(10, 66));
+    CPPUNIT_ASSERT(packed.hasN(10, 67));
+    CPPUNIT_ASSERT(packed.hasN(66, 67));
+    CPPUNIT_ASSERT(!packed.hasN(67, 100));
+    CPPUNIT_ASSERT(packed.hasN(0, 100));
+}
+
+void TestPackedSequence::testMismatchLanes()
+{
+    const std::string left = "ACGTACGTACGTACGTACGTACGTACGTACGT";
+    const std::string right = "ACGAACGTTCGTACGTACGTACGTACGTACGC";
+    const unsigned long mismatches = PackedSequence::getMismatchLanes(packBases(left), packBases(right));
+    CPPUNIT_ASSERT_EQUAL((1UL << 6) | (1UL << 16) | (1UL << 62), mismatches);
+    CPPUNIT_ASSERT_EQUAL(3U, PackedSequence::countLanes(mismatches));
+    CPPUNIT_ASSERT_EQUAL(2U, PackedSequence::countLanes(mismatches & PackedSequence::getLanes(31)));
+    CPPUNIT_ASSERT_EQUAL(0UL, PackedSequence::getLanes(0));
+    CPPUNIT_ASSERT_EQUAL(PackedSequence::LANE_LOW_BITS, PackedSequence::getLanes(PackedSequence::BASES_PER_WORD));
+}
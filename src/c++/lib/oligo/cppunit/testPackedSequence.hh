@@ -0,0 +1,42 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_OLIGO_TEST_PACKED_SEQUENCE_HH
+#define iSAAC_OLIGO_TEST_PACKED_SEQUENCE_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+#include "oligo/PackedSequence.hh"
+
+class TestPackedSequence : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestPackedSequence );
+    CPPUNIT_TEST( testGetBases );
+    CPPUNIT_TEST( testNLanes );
+    CPPUNIT_TEST( testHasN );
+    CPPUNIT_TEST( testMismatchLanes );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    std::string sequence_;
+public:
+    void setUp();
+    void tearDown();
+    void testGetBases();
+    void testNLanes();
+    void testHasN();
+    void testMismatchLanes();
+};
+
+#endif // #ifndef iSAAC_OLIGO_TEST_PACKED_SEQUENCE_HH
@@ -0,0 +1,95 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file AlignDaemonOptions.cpp
+ **
+ ** \brief See AlignDaemonOptions.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string/join.hpp>
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "options/AlignDaemonOptions.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+namespace bpo = boost::program_options;
+namespace bfs = boost::filesystem;
+using common::InvalidOptionException;
+using boost::format;
+
+AlignDaemonOptions::AlignDaemonOptions()
+    : pollInterval_(5)
+    , maxJobs_(0)
+{
+    namedOptions_.add_options()
+        ("spool-directory,s"       , bpo::value<bfs::path>(&spoolDirectory_),
+                "Directory polled for job files. Each *.job file contains isaac-align command line arguments, "
+                "one per line. isaac-align-submit can be used to create them."
+            )
+        ("poll-interval"       , bpo::value<unsigned>(&pollInterval_)->default_value(pollInterval_),
+                "Number of seconds to wait before checking the spool directory again when it has no jobs."
+            )
+        ("max-jobs"       , bpo::value<unsigned>(&maxJobs_)->default_value(maxJobs_),
+                "Exit after processing this many jobs. 0 means run until a file named 'stop' appears in the "
+                "spool directory."
+            );
+}
+
+common::Options::Action AlignDaemonOptions::parse(int argc, char *argv[])
+{
+    const std::vector<std::string> allOptions(argv, argv + argc);
+    common::Options::Action ret = common::Options::parse(argc, argv);
+    if (RUN == ret)
+    {
+        ISAAC_THREAD_CERR << "argc: " << argc << " argv: " << boost::join(allOptions, " ") << std::endl;
+    }
+    return ret;
+}
+
+void AlignDaemonOptions::postProcess(bpo::variables_map &vm)
+{
+    if(vm.count("help") ||  vm.count("version"))
+    {
+        return;
+    }
+
+    if(!vm.count("spool-directory"))
+    {
+        BOOST_THROW_EXCEPTION(InvalidOptionException("\n   *** The 'spool-directory' option is required ***\n"));
+    }
+
+    spoolDirectory_ = bfs::absolute(spoolDirectory_);
+    if (!bfs::is_directory(spoolDirectory_))
+    {
+        BOOST_THROW_EXCEPTION(InvalidOptionException(
+            (format("\n   *** Spool directory does not exist: %s ***\n") % spoolDirectory_.string()).str()));
+    }
+
+    if (!pollInterval_)
+    {
+        BOOST_THROW_EXCEPTION(InvalidOptionException("\n   *** The 'poll-interval' must be at least 1 second ***\n"));
+    }
+}
+
+} //namespace options
+} // namespace isaac
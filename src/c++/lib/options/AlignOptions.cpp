@@ -100,6 +100,7 @@ AlignOptions::AlignOptions()
     , stopAt(workflow::AlignWorkflow::Finish)
     , verbosity(2)
     , clustersAtATimeMax(0)
+    , selectClustersAtATimeMax(0)
     , ignoreNeighbors(false)
     , ignoreRepeats(false)
     , mapqThreshold(0)
@@ -145,6 +146,8 @@ AlignOptions::AlignOptions()
     , realignGapsString("sample")
     , realignGaps(build::REALIGN_SAMPLE)
     , bamGzipLevel(boost::iostreams::gzip::best_speed)
+    , bamIndexFormatString("auto")
+    , bamIndexFormat(bam::BAM_INDEX_AUTO)
     , bamPuFormat("%F:%L:%B")
     , expectedBgzfCompressionRatio(1)
     , singleLibrarySamples(true)
@@ -155,6 +158,8 @@ AlignOptions::AlignOptions()
     , statsImageFormatString("gif")
     , statsImageFormat(reports::AlignmentReportGenerator::gif)
     , bufferBins(true)
+    , inMemoryMatches(false)
+    , preLoadReference(false)
 	, qScoreBin(false)
     , bamExcludeTags("ZX,ZY")
     , optionalFeatures(parseBamExcludeTags(bamExcludeTags))
@@ -228,6 +233,11 @@ AlignOptions::AlignOptions()
                 "\n  - all             : realign against gaps found in all samples")
         ("bam-gzip-level"           , bpo::value<int>(&bamGzipLevel)->default_value(bamGzipLevel),
                 "Gzip level to use for BAM")
+        ("bam-index-format"         , bpo::value<std::string>(&bamIndexFormatString)->default_value(bamIndexFormatString),
+                "Format of the index generated for each BAM file."
+                "\n  - auto            : bai unless the reference has contigs longer than 512Mbp, csi otherwise"
+                "\n  - bai             : bai. References with contigs longer than 512Mbp still get csi"
+                "\n  - csi             : csi")
         ("bam-header-tag"           , bpo::value<std::vector<std::string> >(&bamHeaderTags)->multitoken(),
                 "Additional bam entries that are copied into the header of each produced bam file. Use '\\t' to represent tab separators.")
         ("bam-pu-format"           , bpo::value<std::string>(&bamPuFormat)->default_value(bamPuFormat),
@@ -345,6 +355,12 @@ AlignOptions::AlignOptions()
         ("clusters-at-a-time"         , bpo::value<unsigned>(&clustersAtATimeMax)->default_value(clustersAtATimeMax),
                 "When not set, number of clusters to process together when input is bam or fastq is computed "
                 "automatically based on the amount of available RAM. Set to non-zero value to force deterministic behavior.")
+        ("select-clusters-at-a-time"  , bpo::value<unsigned>(&selectClustersAtATimeMax)->default_value(selectClustersAtATimeMax),
+                "Maximum number of clusters MatchSelector processes together. Consecutive tiles are selected in one "
+                "pass as long as their total cluster count stays within the limit, which keeps all cores busy when "
+                "tiles are small. Tile buffers are reserved for the number of the biggest tiles that fit into the limit. "
+                "When not set, as many clusters as the batch buffers can hold in half of --memory-limit, "
+                "but not more than 4000000. Tiles bigger than the limit are processed one at a time.")
         ("ignore-neighbors"         , bpo::value<bool>(&ignoreNeighbors)->default_value(ignoreNeighbors),
                 "When not set, MatchFinder will ignore perfect seed matches during single-seed pass, "
                 "if the reference k-mer is known to have neighbors.")
@@ -444,7 +460,8 @@ AlignOptions::AlignOptions()
         ("memory-control"           , bpo::value<std::string>(&memoryControlString)->default_value(memoryControlString),
                 "Define the behavior in case unexpected memory allocations are detected: "
                 "\n  - warning         : Log WARNING about the allocation."
-                "\n  - off             : Don't monitor dynamic memory usage."
+                "\n  - off             : Don't monitor dynamic memory usage. Alignment reports are generated "
+                "while the BAM files are being built."
                 "\n  - strict          : Fail memory allocation. Intended for development use."
         )
         ("memory-limit,m"           , bpo::value<unsigned long>(&memoryLimit)->default_value(memoryLimit),
@@ -465,6 +482,14 @@ AlignOptions::AlignOptions()
                 "If set, MatchSelector will buffer bin data before writing it out. If not set, MatchSelector will keep an open "
                 "file handle per bin and write data into corresponding bins as it appears. This option requires extra RAM, but "
                 "improves performance on some file systems.")
+        ("in-memory-matches"   , bpo::value<bool>(&inMemoryMatches)->default_value(inMemoryMatches),
+                "If set, MatchFinder keeps the matches in RAM and MatchSelector takes them from there instead of "
+                "storing them in --temp-directory. Requires enough RAM to hold all the matches of the run at once. "
+                "Not compatible with --start-from/--stop-at that separate MatchFinder from MatchSelector "
+                "and with --memory-control strict.")
+        ("pre-load-reference"   , bpo::value<bool>(&preLoadReference)->default_value(preLoadReference),
+                "If set, the reference contigs are loaded in the background while MatchFinder runs. Requires enough "
+                "RAM to hold the whole reference in addition to the MatchFinder data. Requires --memory-control off.")
         ("qscore-bin"   , bpo::value<bool>(&qScoreBin)->default_value(qScoreBin),
         	    "Toggle QScore binning, this will be applied to the data after it is loaded and before processing")
         ("qscore-bin-values"   , bpo::value<std::string>(&qScoreBinValueString),
@@ -611,6 +636,24 @@ build::GapRealignerMode AlignOptions::parseGapRealignment()
     return build::REALIGN_NONE;
 }
 
+bam::BamIndexFormat AlignOptions::parseBamIndexFormat()
+{
+    if(bamIndexFormatString == "auto")
+    {
+        return bam::BAM_INDEX_AUTO;
+    }
+    else if(bamIndexFormatString == "bai")
+    {
+        return bam::BAM_INDEX_BAI;
+    }
+    else if(bamIndexFormatString != "csi")
+    {
+        const format message = format("\n   *** The 'bam-index-format' value is invalid %s ***\n") % bamIndexFormatString;
+        BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+    }
+    return bam::BAM_INDEX_CSI;
+}
+
 void AlignOptions::parseExecutionTargets()
 {
     const static std::vector<std::string> allowedStageStrings =
@@ -684,6 +727,38 @@ void AlignOptions::parseMemoryControl()
     }
 }
 
+void AlignOptions::verifyPreLoadReference()
+{
+    // malloc block is process-wide. The background loading would trip it while MatchFinder runs
+    if (preLoadReference && common::ScoopedMallocBlock::Off != memoryControl)
+    {
+        const format message = format("\n   *** --pre-load-reference requires --memory-control off. Got %s ***\n") % memoryControlString;
+        BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+    }
+}
+
+void AlignOptions::verifyInMemoryMatches()
+{
+    if (!inMemoryMatches)
+    {
+        return;
+    }
+    // in-memory matches don't survive between the runs
+    if (workflow::AlignWorkflow::Start != startFrom ||
+        workflow::AlignWorkflow::MatchFinderDone == stopAt || workflow::AlignWorkflow::Last == stopAt)
+    {
+        const format message = format("\n   *** --in-memory-matches requires MatchFinder and MatchSelector to run in the same invocation."
+            " Got --start-from %s --stop-at %s ***\n") % startFromString % stopAtString;
+        BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+    }
+    // the arena grows while the match finder runs with blocked allocations
+    if (common::ScoopedMallocBlock::Strict == memoryControl)
+    {
+        const format message = format("\n   *** --in-memory-matches is not compatible with --memory-control strict ***\n");
+        BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+    }
+}
+
 void AlignOptions::parseGapScoring()
 {
     if ("bwa" == gapScoringString)
@@ -1299,11 +1374,14 @@ void AlignOptions::postProcess(bpo::variables_map &vm)
     }
 
     realignGaps = parseGapRealignment();
+    bamIndexFormat = parseBamIndexFormat();
     std::for_each(bamHeaderTags.begin(), bamHeaderTags.end(), unescapeSlashT);
     validateSampleSheets(realignGaps, barcodeMetadataList);
 
     parseExecutionTargets();
     parseMemoryControl();
+    verifyInMemoryMatches();
+    verifyPreLoadReference();
     parseGapScoring();
     parseDodgyAlignmentScore();
     parseTemplateLength();
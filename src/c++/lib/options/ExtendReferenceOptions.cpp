@@ -0,0 +1,116 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ExtendReferenceOptions.cpp
+ **
+ ** Command line options for 'extendReference'
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <string>
+#include <vector>
+
+#include <boost/assign.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include "options/ExtendReferenceOptions.hh"
+#include "common/Exceptions.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+namespace bpo = boost::program_options;
+namespace bfs = boost::filesystem;
+
+ExtendReferenceOptions::ExtendReferenceOptions()
+    : seedLength(32)
+    , outputDirectory("./")
+    , repeatThreshold(1000)
+    , annotate(true)
+    , parallelSort(true)
+    , jobs(boost::thread::hardware_concurrency())
+{
+    namedOptions_.add_options()
+        ("reference-genome,r",  bpo::value<bfs::path>(&referenceGenome),
+                                "The 'SortedReference.xml' file of the reference to extend")
+        ("added-reference,a",   bpo::value<bfs::path>(&addedReference),
+                                "The 'SortedReference.xml' file of the added contigs sorted with the same seed length and "
+                                "mask width and no repeat threshold")
+        ("annotate",            bpo::value<bool>(&annotate)->default_value(annotate),
+                                "Find neighbors of the added k-mers. Must be off if the reference is not annotated")
+        ("jobs,j",              bpo::value<unsigned>(&jobs)->default_value(jobs),
+                                "Maximum number of threads to use for scanning and merging the mask files.")
+        ("output-directory",    bpo::value<bfs::path>(&outputDirectory),
+                                "The location for the merged mask files. Must differ from the location of the "
+                                "reference mask files")
+        ("output-file,o",       bpo::value<bfs::path>(&outputFile),
+                                "The output 'SortedReference.xml' file")
+        ("parallel-sort",       bpo::value<bool>(&parallelSort)->default_value(parallelSort),
+                                "Disable parallel sort to halve the RAM requirements of the neighbor search")
+        ("repeat-threshold",    bpo::value<unsigned int>(&repeatThreshold)->default_value(repeatThreshold),
+                                "The repeat threshold the reference was sorted with")
+        ("seed-length,s",       bpo::value<unsigned int>(&seedLength)->default_value(seedLength),
+                                "Length of reference k-mer in bases. 16, 32 or 64 is supported.")
+        ;
+}
+
+void ExtendReferenceOptions::postProcess(bpo::variables_map &vm)
+{
+    if(vm.count("help"))
+    {
+        return;
+    }
+    using isaac::common::InvalidOptionException;
+    using boost::format;
+    const std::vector<std::string> requiredOptions =
+        boost::assign::list_of("reference-genome")("added-reference")("output-file");
+    BOOST_FOREACH(const std::string &required, requiredOptions)
+    {
+        if(!vm.count(required))
+        {
+            const format message = format("\n   *** The '%s' option is required ***\n") % required;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+    }
+    typedef std::pair<bfs::path *, std::string> PathOption;
+    const std::vector<PathOption> existingPaths = boost::assign::list_of
+        (PathOption(&referenceGenome, "reference-genome"))
+        (PathOption(&addedReference, "added-reference"))
+        (PathOption(&outputDirectory, "output-directory"))
+        ;
+    BOOST_FOREACH(const PathOption &pathOption, existingPaths)
+    {
+        if(!exists(*pathOption.first))
+        {
+            const format message = format("\n   *** The '%s' does not exist: %s ***\n") % pathOption.second % *pathOption.first;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+    }
+    if (!jobs)
+    {
+        BOOST_THROW_EXCEPTION(InvalidOptionException("\n   *** The jobs must be at least 1 ***\n"));
+    }
+
+    if (16 != seedLength && 32 != seedLength && 64 != seedLength)
+    {
+        const format message = format("\n   *** The seed-length must be either 16, 32 or 64. Got: %d ***\n") % seedLength;
+        BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+    }
+}
+
+} // namespace options
+} // namespace isaac
@@ -17,11 +17,14 @@
  ** \author Come Raczy
  **/
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <boost/assign.hpp>
 #include <boost/foreach.hpp>
+#include <boost/thread.hpp>
 
+#include "common/SystemCompatibility.hh"
 #include "options/SortReferenceOptions.hh"
 
 namespace isaac
@@ -34,21 +37,35 @@ namespace bpo = boost::program_options;
 SortReferenceOptions::SortReferenceOptions()
     : seedLength(32)
     , maskWidth(6)
-    , mask(0)
     , repeatThreshold(1000)
+      // half of the RAM leaves room for the page cache of the fasta and the spilled runs
+    , memoryLimit(std::max(1UL, common::getPhysicalMemory() / 2 / 1024 / 1024 / 1024))
+    , jobs(boost::thread::hardware_concurrency())
 {
      namedOptions_.add_options()
         ("genome-file,g",       bpo::value<std::string>(&genomeFile),
                                 "Path to the reference genome")
         ("genome-neighbors,n",  bpo::value<boost::filesystem::path>(&genomeNeighborsFile),
                                 "Path to the file containing neighbor flags (one bit per genome file position)")
-        ("mask,m",              bpo::value<unsigned long>(&mask),
-                                "mask used to filter the k-mers counted by this process (must be strictly less than 2^mask-width")
+        ("mask,m",              bpo::value<std::vector<unsigned long> >(&masks),
+                                "mask used to filter the k-mers counted by this process (must be strictly less than 2^mask-width). "
+                                "Can be specified multiple times, once for each --output-file. All masks are produced "
+                                "in a single pass over the genome.")
         ("mask-width,w",        bpo::value<unsigned int>(&maskWidth)->default_value(maskWidth),
                                 "Width in bits of the mask used to split the sorted files")
         ("repeat-threshold",    bpo::value<unsigned int>(&repeatThreshold)->default_value(repeatThreshold),
                                 "Maximum number of k-mer occurrences in genome for it to be counted as repeat")
-        ("output-file,o",       bpo::value<boost::filesystem::path>(&outFile), "Output file path.")
+        ("output-file,o",       bpo::value<std::vector<boost::filesystem::path> >(&outFiles),
+                                "Output file path. One for each --mask, in the same order.")
+        ("temp-directory,t",    bpo::value<boost::filesystem::path>(&tempDirectory),
+                                "Directory for the sorted runs spilled when --memory-limit is exceeded. Defaults to "
+                                "the directory of the first output file.")
+        ("memory-limit",        bpo::value<unsigned long>(&memoryLimit)->default_value(memoryLimit),
+                                "Gigabytes of RAM to use for holding k-mers in memory. When exceeded, sorted runs "
+                                "are spilled into --temp-directory and merged at the end. Defaults to half of the physical "
+                                "RAM. 0 means no limit.")
+        ("jobs,j",              bpo::value<unsigned>(&jobs)->default_value(jobs),
+                                "Maximum number of threads to use for k-mer generation and sorting.")
         ("seed-length,s",       bpo::value<unsigned int>(&seedLength)->default_value(seedLength),
                                 "Length of reference k-mer in bases. 64 or 32 is supported.")
         ;
@@ -72,11 +89,32 @@ void SortReferenceOptions::postProcess(bpo::variables_map &vm)
         }
     }
     const unsigned int maskCount = (1 << maskWidth);
-    if(maskCount <= mask)
+    BOOST_FOREACH(const unsigned long mask, masks)
     {
-        const format message = format("\n   *** The mask must be strictly less than %d: mask = %d ***\n") % maskCount % mask;
+        if(maskCount <= mask)
+        {
+            const format message = format("\n   *** The mask must be strictly less than %d: mask = %d ***\n") % maskCount % mask;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+        if (1 != std::count(masks.begin(), masks.end(), mask))
+        {
+            const format message = format("\n   *** The mask %d is specified more than once ***\n") % mask;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+    }
+    if (masks.size() != outFiles.size())
+    {
+        const format message = format("\n   *** Each of %d masks requires an output-file. Got: %d ***\n") % masks.size() % outFiles.size();
         BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
     }
+    if (tempDirectory.empty())
+    {
+        tempDirectory = boost::filesystem::absolute(outFiles.front()).parent_path();
+    }
+    if (!jobs)
+    {
+        BOOST_THROW_EXCEPTION(InvalidOptionException("\n   *** The jobs must be at least 1 ***\n"));
+    }
 
     if (16 != seedLength && 32 != seedLength && 64 != seedLength)
     {
@@ -0,0 +1,69 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file WriteGenomeImageOptions.cpp
+ **
+ ** Command line options for writeGenomeImage
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <string>
+#include <vector>
+#include <boost/assign.hpp>
+#include <boost/foreach.hpp>
+
+#include "options/WriteGenomeImageOptions.hh"
+#include "reference/GenomeImage.hh"
+
+namespace isaac
+{
+namespace options
+{
+
+namespace bpo = boost::program_options;
+
+WriteGenomeImageOptions::WriteGenomeImageOptions()
+{
+    namedOptions_.add_options()
+        ("reference-genome,r",  bpo::value<boost::filesystem::path>(&sortedReferenceMetadata_),
+                                "Full path to the reference genome XmlFile")
+        ("output-file,o",       bpo::value<boost::filesystem::path>(&outputFilePath_),
+                                "Path of the genome image to produce. Defaults to genome-image.dat next to the reference genome XmlFile")
+        ;
+}
+
+void WriteGenomeImageOptions::postProcess(bpo::variables_map &vm)
+{
+    if(vm.count("help"))
+    {
+        return;
+    }
+    using isaac::common::InvalidOptionException;
+    using boost::format;
+    const std::vector<std::string> requiredOptions = boost::assign::list_of("reference-genome");
+    BOOST_FOREACH(const std::string &required, requiredOptions)
+    {
+        if(!vm.count(required))
+        {
+            const format message = format("\n   *** The '%s' option is required ***\n") % required;
+            BOOST_THROW_EXCEPTION(InvalidOptionException(message.str()));
+        }
+    }
+    if (outputFilePath_.empty())
+    {
+        outputFilePath_ = reference::GenomeImage::getPath(sortedReferenceMetadata_);
+    }
+}
+
+} //namespace option
+} // namespace isaac
@@ -0,0 +1,165 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ContigCache.cpp
+ **
+ ** \brief See ContigCache.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+
+#include "reference/ContigCache.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+bool ContigCache::retain_ = false;
+boost::mutex ContigCache::mutex_;
+boost::shared_ptr<ContigLists> ContigCache::cached_;
+std::vector<SortedReferenceMetadata::Contigs> ContigCache::cachedContigs_;
+std::vector<std::time_t> ContigCache::cachedTimestamps_;
+boost::mutex ContigCache::prefetchMutex_;
+boost::scoped_ptr<boost::thread> ContigCache::prefetchThread_;
+boost::exception_ptr ContigCache::prefetchException_;
+
+void ContigCache::setRetain(const bool retain)
+{
+    waitForPrefetch();
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    retain_ = retain;
+    if (!retain_)
+    {
+        cached_.reset();
+        cachedContigs_.clear();
+        cachedTimestamps_.clear();
+    }
+}
+
+void ContigCache::release()
+{
+    waitForPrefetch();
+    boost::lock_guard<boost::mutex> lock(mutex_);
+    if (!retain_ && cached_)
+    {
+        ISAAC_THREAD_CERR << "Releasing cached contigs of " << cached_->size() << " references" << std::endl;
+        cached_.reset();
+        cachedContigs_.clear();
+        cachedTimestamps_.clear();
+    }
+}
+
+void ContigCache::prefetch(const SortedReferenceMetadataList &sortedReferenceMetadataList, const unsigned loadThreads)
+{
+    waitForPrefetch();
+    boost::lock_guard<boost::mutex> lock(prefetchMutex_);
+    ISAAC_THREAD_CERR << "Prefetching contigs of " << sortedReferenceMetadataList.size() << " references" << std::endl;
+    prefetchThread_.reset(new boost::thread(&ContigCache::prefetchContigs, sortedReferenceMetadataList, loadThreads));
+}
+
+void ContigCache::prefetchContigs(const SortedReferenceMetadataList sortedReferenceMetadataList, const unsigned loadThreads)
+{
+    try
+    {
+        common::ThreadVector threads(loadThreads);
+        boost::lock_guard<boost::mutex> lock(mutex_);
+        // packed bases are needed by the match selector which is the first consumer
+        update(sortedReferenceMetadataList, AllContigsFilter(), threads, true);
+        ISAAC_THREAD_CERR << "Prefetching contigs done" << std::endl;
+    }
+    catch (...)
+    {
+        // will be rethrown to the first consumer
+        prefetchException_ = boost::current_exception();
+    }
+}
+
+void ContigCache::waitForPrefetch()
+{
+    boost::lock_guard<boost::mutex> lock(prefetchMutex_);
+    if (prefetchThread_)
+    {
+        prefetchThread_->join();
+        prefetchThread_.reset();
+        if (prefetchException_)
+        {
+            const boost::exception_ptr e = prefetchException_;
+            prefetchException_ = boost::exception_ptr();
+            boost::rethrow_exception(e);
+        }
+    }
+}
+
+void ContigCache::merge(ContigLists &loaded)
+{
+    ISAAC_ASSERT_MSG(cached_.unique(), "Cached contigs must not change while other consumers hold them");
+    ISAAC_ASSERT_MSG(cached_->size() == loaded.size(), "Loaded contigs don't match the cached ones");
+    for (unsigned referenceIndex = 0; loaded.size() > referenceIndex; ++referenceIndex)
+    {
+        std::vector<Contig> &cachedContigs = cached_->at(referenceIndex);
+        std::vector<Contig> &loadedContigs = loaded.at(referenceIndex);
+        ISAAC_ASSERT_MSG(cachedContigs.size() == loadedContigs.size(), "Loaded contigs don't match the cached ones");
+        for (unsigned contigIndex = 0; loadedContigs.size() > contigIndex; ++contigIndex)
+        {
+            Contig &cached = cachedContigs[contigIndex];
+            Contig &contig = loadedContigs[contigIndex];
+            // nobody else holds cached_, the contigs that are already there just stay
+            if (cached.forward_.empty())
+            {
+                cached.forward_.swap(contig.forward_);
+            }
+            if (cached.packed_.empty())
+            {
+                cached.packed_.swap(contig.packed_);
+            }
+        }
+    }
+}
+
+bool ContigCache::isCached(const SortedReferenceMetadataList &sortedReferenceMetadataList)
+{
+    return cached_ &&
+        getContigs(sortedReferenceMetadataList) == cachedContigs_ &&
+        // the fasta files could have been rewritten in place
+        getTimestamps(sortedReferenceMetadataList) == cachedTimestamps_;
+}
+
+std::vector<SortedReferenceMetadata::Contigs> ContigCache::getContigs(
+    const SortedReferenceMetadataList &sortedReferenceMetadataList)
+{
+    std::vector<SortedReferenceMetadata::Contigs> ret;
+    BOOST_FOREACH(const SortedReferenceMetadata &sortedReferenceMetadata, sortedReferenceMetadataList)
+    {
+        ret.push_back(sortedReferenceMetadata.getContigs());
+    }
+    return ret;
+}
+
+std::vector<std::time_t> ContigCache::getTimestamps(const SortedReferenceMetadataList &sortedReferenceMetadataList)
+{
+    std::vector<std::time_t> ret;
+    BOOST_FOREACH(const SortedReferenceMetadata &sortedReferenceMetadata, sortedReferenceMetadataList)
+    {
+        BOOST_FOREACH(const SortedReferenceMetadata::Contig &contig, sortedReferenceMetadata.getContigs())
+        {
+            ret.push_back(boost::filesystem::last_write_time(contig.filePath_));
+        }
+    }
+    return ret;
+}
+
+} // namespace reference
+} // namespace isaac
@@ -64,6 +64,26 @@ void loadContig(
     }
 }
 
+boost::shared_ptr<const GenomeImage> openGenomeImage(const reference::SortedReferenceMetadata &sortedReferenceMetadata)
+{
+    boost::shared_ptr<const GenomeImage> ret;
+    if (!sortedReferenceMetadata.getGenomeImagePath().empty())
+    {
+        ret.reset(new GenomeImage(sortedReferenceMetadata.getGenomeImagePath()));
+        if (!ret->matches(sortedReferenceMetadata.getContigs()))
+        {
+            ISAAC_THREAD_CERR << "WARNING: ignoring genome image " << sortedReferenceMetadata.getGenomeImagePath() <<
+                " as it does not match the reference contigs" << std::endl;
+            ret.reset();
+        }
+        else
+        {
+            ISAAC_THREAD_CERR << "Loading contigs from genome image " << sortedReferenceMetadata.getGenomeImagePath() << std::endl;
+        }
+    }
+    return ret;
+}
+
 struct DummyFilter {bool operator() (const unsigned contigIdx) const {return true;}} dummyFilter;
 /**
  * \brief loads all the fasta file contigs into memory on multiple threads
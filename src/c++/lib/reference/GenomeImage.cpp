@@ -0,0 +1,302 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file GenomeImage.cpp
+ **
+ ** \brief See GenomeImage.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "oligo/Nucleotides.hh"
+#include "reference/GenomeImage.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+const char *const GenomeImage::FILE_NAME = "genome-image.dat";
+
+static const char GENOME_IMAGE_MAGIC[8] = {'i', 'S', 'A', 'A', 'C', 'G', 'I', 0};
+
+GenomeImage::GenomeImage(const boost::filesystem::path &imagePath) : imagePath_(imagePath)
+{
+    try
+    {
+        file_.open(imagePath_.string());
+    }
+    catch (std::exception &e)
+    {
+        const boost::format message = boost::format("Failed to map genome image %s: %s") % imagePath_ % e.what();
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+
+    if (sizeof(Header) > file_.size() ||
+        memcmp(header().magic_, GENOME_IMAGE_MAGIC, sizeof(GENOME_IMAGE_MAGIC)) ||
+        FORMAT_VERSION != header().version_ ||
+        sizeof(Header) + sizeof(ContigEntry) * header().contigCount_ > file_.size())
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(EINVAL, "Invalid genome image file " + imagePath_.string()));
+    }
+
+    for (unsigned contigIndex = 0; getContigCount() > contigIndex; ++contigIndex)
+    {
+        const ContigEntry &entry = contig(contigIndex);
+        if (entry.basesOffset_ + oligo::PackedSequence::getBaseWords(entry.totalBases_) * sizeof(unsigned long) > file_.size() ||
+            entry.nMaskOffset_ + oligo::PackedSequence::getMaskWords(entry.totalBases_) * sizeof(unsigned long) > file_.size() ||
+            entry.nRunsOffset_ + entry.nRunsCount_ * sizeof(NRun) > file_.size())
+        {
+            const boost::format message = boost::format("Genome image %s is truncated at contig %d") % imagePath_ % contigIndex;
+            BOOST_THROW_EXCEPTION(common::IoException(EINVAL, message.str()));
+        }
+    }
+}
+
+bool GenomeImage::matches(const SortedReferenceMetadata::Contigs &xmlContigs) const
+{
+    if (xmlContigs.size() != getContigCount())
+    {
+        return false;
+    }
+    BOOST_FOREACH(const SortedReferenceMetadata::Contig &xmlContig, xmlContigs)
+    {
+        if (xmlContig.index_ >= getContigCount())
+        {
+            return false;
+        }
+        const ContigEntry &entry = contig(xmlContig.index_);
+        if (xmlContig.totalBases_ != entry.totalBases_ || xmlContig.acgtBases_ != entry.acgtBases_ ||
+            xmlContig.offset_ != entry.fastaOffset_)
+        {
+            return false;
+        }
+
+        boost::system::error_code errorCode;
+        const boost::uintmax_t fastaFileSize = boost::filesystem::file_size(xmlContig.filePath_, errorCode);
+        if (errorCode || entry.fastaFileSize_ != fastaFileSize)
+        {
+            return false;
+        }
+        const std::time_t fastaMtime = boost::filesystem::last_write_time(xmlContig.filePath_, errorCode);
+        if (errorCode || entry.fastaMtime_ != fastaMtime)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+char GenomeImage::getBase(const unsigned contigIndex, const unsigned long position) const
+{
+    const ContigEntry &entry = contig(contigIndex);
+    ISAAC_ASSERT_MSG(entry.totalBases_ > position, "Position " << position << " is outside of contig " << contigIndex);
+
+    const NRun key = {position, 0};
+    const NRun *nRun = std::upper_bound(nRunsBegin(entry), nRunsEnd(entry), key);
+    if (nRunsBegin(entry) != nRun && position < (nRun - 1)->begin_ + (nRun - 1)->length_)
+    {
+        return 'N';
+    }
+    return oligo::getBase((bases(entry)[position / 4] >> ((position % 4) * 2)) & 3);
+}
+
+/// \return four bases for every possible byte value
+static std::vector<char> makeByteBases()
+{
+    std::vector<char> ret;
+    ret.reserve(256 * 4);
+    for (unsigned byte = 0; 256 > byte; ++byte)
+    {
+        for (unsigned shift = 0; 8 > shift; shift += 2)
+        {
+            ret.push_back(oligo::getBase((byte >> shift) & 3));
+        }
+    }
+    return ret;
+}
+
+void GenomeImage::unpack(
+    const unsigned contigIndex,
+    const unsigned long begin,
+    const unsigned long end,
+    std::vector<char> &forward) const
+{
+    const ContigEntry &entry = contig(contigIndex);
+    ISAAC_ASSERT_MSG(begin <= end && entry.totalBases_ >= end, "Range [" << begin << "," << end <<
+                     ") is outside of contig " << contigIndex);
+
+    static const std::vector<char> byteBases = makeByteBases();
+
+    const std::size_t firstBase = forward.size();
+    forward.reserve(firstBase + end - begin);
+    const unsigned char *packed = bases(entry);
+    unsigned long position = begin;
+    for (; end != position && position % 4; ++position)
+    {
+        forward.push_back(byteBases[packed[position / 4] * 4 + position % 4]);
+    }
+    for (; end >= position + 4; position += 4)
+    {
+        const std::vector<char>::const_iterator four = byteBases.begin() + packed[position / 4] * 4;
+        forward.insert(forward.end(), four, four + 4);
+    }
+    for (; end != position; ++position)
+    {
+        forward.push_back(byteBases[packed[position / 4] * 4 + position % 4]);
+    }
+
+    const NRun key = {begin, 0};
+    const NRun *nRun = std::upper_bound(nRunsBegin(entry), nRunsEnd(entry), key);
+    if (nRunsBegin(entry) != nRun)
+    {
+        --nRun;
+    }
+    for (; nRunsEnd(entry) != nRun && end > nRun->begin_; ++nRun)
+    {
+        const unsigned long nBegin = std::max(begin, nRun->begin_);
+        const unsigned long nEnd = std::min(end, nRun->begin_ + nRun->length_);
+        if (nBegin < nEnd)
+        {
+            std::fill(forward.begin() + firstBase + (nBegin - begin), forward.begin() + firstBase + (nEnd - begin), 'N');
+        }
+    }
+}
+
+void GenomeImage::wrap(
+    const unsigned contigIndex,
+    const boost::shared_ptr<const GenomeImage> &image,
+    oligo::PackedSequence &packed) const
+{
+    ISAAC_ASSERT_MSG(this == image.get(), "The image must own itself");
+    const ContigEntry &entry = contig(contigIndex);
+    packed.wrap(reinterpret_cast<const unsigned long *>(bases(entry)), nMask(entry), entry.totalBases_, image);
+}
+
+void GenomeImage::write(
+    const boost::filesystem::path &imagePath,
+    const SortedReferenceMetadata::Contigs &xmlContigs,
+    const std::vector<Contig> &contigs)
+{
+    Header header;
+    std::copy(GENOME_IMAGE_MAGIC, GENOME_IMAGE_MAGIC + sizeof(GENOME_IMAGE_MAGIC), header.magic_);
+    header.version_ = FORMAT_VERSION;
+    header.contigCount_ = contigs.size();
+
+    // contigs are stored in the order of their index_ regardless of the order in which they've been loaded
+    std::vector<const Contig *> indexOrdered(contigs.size());
+    BOOST_FOREACH(const Contig &contig, contigs)
+    {
+        ISAAC_ASSERT_MSG(contig.index_ < indexOrdered.size() && !indexOrdered[contig.index_], "Contig index is out of range or duplicate: " << contig.index_);
+        indexOrdered[contig.index_] = &contig;
+    }
+    std::vector<const SortedReferenceMetadata::Contig *> indexOrderedXml(contigs.size());
+    BOOST_FOREACH(const SortedReferenceMetadata::Contig &xmlContig, xmlContigs)
+    {
+        ISAAC_ASSERT_MSG(xmlContig.index_ < indexOrderedXml.size() && !indexOrderedXml[xmlContig.index_], "Xml contig index is out of range or duplicate: " << xmlContig.index_);
+        indexOrderedXml[xmlContig.index_] = &xmlContig;
+    }
+
+    std::vector<std::vector<NRun> > nRuns(contigs.size());
+    std::vector<ContigEntry> entries(contigs.size());
+    unsigned long offset = sizeof(Header) + sizeof(ContigEntry) * entries.size();
+    for (std::size_t index = 0; indexOrdered.size() > index; ++index)
+    {
+        const std::vector<char> &forward = indexOrdered[index]->forward_;
+        for (std::vector<char>::const_iterator it = forward.begin(); forward.end() != it; ++it)
+        {
+            if (oligo::invalidOligo == oligo::getValue(*it))
+            {
+                const unsigned long position = std::distance(forward.begin(), it);
+                if (!nRuns[index].empty() && nRuns[index].back().begin_ + nRuns[index].back().length_ == position)
+                {
+                    ++nRuns[index].back().length_;
+                }
+                else
+                {
+                    const NRun nRun = {position, 1};
+                    nRuns[index].push_back(nRun);
+                }
+            }
+        }
+
+        ISAAC_ASSERT_MSG(indexOrderedXml[index], "Missing xml contig " << index);
+        const SortedReferenceMetadata::Contig &xmlContig = *indexOrderedXml[index];
+        ContigEntry &entry = entries[index];
+        entry.totalBases_ = forward.size();
+        entry.acgtBases_ = xmlContig.acgtBases_;
+        entry.fastaOffset_ = xmlContig.offset_;
+        entry.fastaFileSize_ = boost::filesystem::file_size(xmlContig.filePath_);
+        entry.fastaMtime_ = boost::filesystem::last_write_time(xmlContig.filePath_);
+        // keep everything 8-byte aligned
+        entry.basesOffset_ = offset;
+        offset += oligo::PackedSequence::getBaseWords(forward.size()) * sizeof(unsigned long);
+        entry.nMaskOffset_ = offset;
+        offset += oligo::PackedSequence::getMaskWords(forward.size()) * sizeof(unsigned long);
+        entry.nRunsOffset_ = offset;
+        entry.nRunsCount_ = nRuns[index].size();
+        offset += sizeof(NRun) * nRuns[index].size();
+    }
+
+    std::ofstream os(imagePath.c_str());
+    if (!os.write(reinterpret_cast<const char *>(&header), sizeof(header)) ||
+        (!entries.empty() && !os.write(reinterpret_cast<const char *>(&entries.front()), sizeof(ContigEntry) * entries.size())))
+    {
+        const boost::format message = boost::format("Failed to write genome image header into %s: %s") % imagePath % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+
+    for (std::size_t index = 0; indexOrdered.size() > index; ++index)
+    {
+        const std::vector<char> &forward = indexOrdered[index]->forward_;
+        std::vector<unsigned long> packed(oligo::PackedSequence::getBaseWords(forward.size()), 0);
+        std::vector<unsigned long> nMask(oligo::PackedSequence::getMaskWords(forward.size()), 0);
+        for (std::size_t position = 0; forward.size() > position; ++position)
+        {
+            const unsigned long value = oligo::getValue(forward[position]);
+            if (oligo::invalidOligo == value)
+            {
+                nMask[position / 64] |= 1UL << (position % 64);
+            }
+            else
+            {
+                packed[position / 32] |= value << ((position % 32) * 2);
+            }
+        }
+        if ((!packed.empty() && !os.write(reinterpret_cast<const char *>(&packed.front()), packed.size() * sizeof(unsigned long))) ||
+            (!nMask.empty() && !os.write(reinterpret_cast<const char *>(&nMask.front()), nMask.size() * sizeof(unsigned long))) ||
+            (!nRuns[index].empty() && !os.write(reinterpret_cast<const char *>(&nRuns[index].front()), sizeof(NRun) * nRuns[index].size())))
+        {
+            const boost::format message = boost::format("Failed to write contig %d into genome image %s: %s") % index % imagePath % strerror(errno);
+            BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+        }
+    }
+
+    if (!os.flush())
+    {
+        const boost::format message = boost::format("Failed to flush genome image %s: %s") % imagePath % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+}
+
+} // namespace reference
+} // namespace isaac
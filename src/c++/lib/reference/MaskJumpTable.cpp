@@ -0,0 +1,130 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file MaskJumpTable.cpp
+ **
+ ** \brief Prefix-bucket offset table for a sorted mask file.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#include <boost/format.hpp>
+
+#include "common/Exceptions.hh"
+#include "reference/MaskJumpTable.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+template <typename KmerT>
+void MaskJumpTable<KmerT>::reset(const unsigned maskWidth)
+{
+    maskWidth_ = maskWidth;
+    const unsigned unmaskedBits = oligo::KmerTraits<KmerT>::KMER_BITS - maskWidth_;
+    bucketBits_ = MAX_BUCKET_BITS < unmaskedBits ? MAX_BUCKET_BITS : unmaskedBits;
+    kmers_ = 0;
+    filledBuckets_ = 0;
+    offsets_.resize((1UL << bucketBits_) + 1);
+}
+
+template <typename KmerT>
+void MaskJumpTable<KmerT>::save(const boost::filesystem::path &maskFilePath) const
+{
+    const boost::filesystem::path filePath = getPath(maskFilePath);
+    std::ofstream os(filePath.c_str());
+    if (!os)
+    {
+        const boost::format message = boost::format("Failed to open file %s for writing: %s") % filePath % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+
+    const unsigned long kmers = kmers_;
+    if (!os.write(reinterpret_cast<const char *>(&bucketBits_), sizeof(bucketBits_)) ||
+        !os.write(reinterpret_cast<const char *>(&maskWidth_), sizeof(maskWidth_)) ||
+        !os.write(reinterpret_cast<const char *>(&kmers), sizeof(kmers)) ||
+        !os.write(reinterpret_cast<const char *>(&offsets_.front()), sizeof(offsets_.front()) * filledBuckets_))
+    {
+        const boost::format message = boost::format("Failed to write jump table into %s: %s") % filePath % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+    // buckets past the last stored kmer point at the end of the mask file
+    for (std::size_t bucket = filledBuckets_; offsets_.size() > bucket; ++bucket)
+    {
+        if (!os.write(reinterpret_cast<const char *>(&kmers), sizeof(kmers)))
+        {
+            const boost::format message = boost::format("Failed to write jump table into %s: %s") % filePath % strerror(errno);
+            BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+        }
+    }
+}
+
+template <typename KmerT>
+bool MaskJumpTable<KmerT>::load(
+    const boost::filesystem::path &maskFilePath,
+    const std::size_t maskFileKmers,
+    const unsigned maskWidth)
+{
+    offsets_.clear();
+    const boost::filesystem::path filePath = getPath(maskFilePath);
+    std::ifstream is(filePath.c_str());
+    if (!is)
+    {
+        return false;
+    }
+
+    unsigned long kmers = 0;
+    if (!is.read(reinterpret_cast<char *>(&bucketBits_), sizeof(bucketBits_)) ||
+        !is.read(reinterpret_cast<char *>(&maskWidth_), sizeof(maskWidth_)) ||
+        !is.read(reinterpret_cast<char *>(&kmers), sizeof(kmers)))
+    {
+        const boost::format message = boost::format("Failed to read jump table header from %s: %s") % filePath % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+
+    if (maskWidth != maskWidth_)
+    {
+        const boost::format message = boost::format("Jump table %s is built for mask width %d while the reference "
+            "mask width is %d. Please re-sort the reference.") % filePath % maskWidth_ % maskWidth;
+        BOOST_THROW_EXCEPTION(common::InvalidParameterException(message.str()));
+    }
+
+    if (MAX_BUCKET_BITS < bucketBits_ || oligo::KmerTraits<KmerT>::KMER_BITS < maskWidth_ + bucketBits_ ||
+        maskFileKmers != kmers)
+    {
+        ISAAC_THREAD_CERR << "WARNING: ignoring jump table " << filePath << " as it does not match the mask file with " <<
+            maskFileKmers << " kmers" << std::endl;
+        return false;
+    }
+
+    kmers_ = kmers;
+    filledBuckets_ = (1UL << bucketBits_) + 1;
+    offsets_.resize(filledBuckets_);
+    if (!is.read(reinterpret_cast<char *>(&offsets_.front()), sizeof(offsets_.front()) * offsets_.size()))
+    {
+        const boost::format message = boost::format("Failed to read jump table from %s: %s") % filePath % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+    return true;
+}
+
+template class MaskJumpTable<oligo::ShortKmerType>;
+template class MaskJumpTable<oligo::KmerType>;
+template class MaskJumpTable<oligo::LongKmerType>;
+
+} // namespace reference
+} // namespace isaac
@@ -30,6 +30,7 @@
 
 #include "common/Debug.hh"
 #include "common/ParallelSort.hpp"
+#include "reference/MaskJumpTable.hh"
 #include "reference/NeighborsFinder.hh"
 #include "reference/SortedReferenceXml.hh"
 #include "reference/ReferenceKmer.hh"
@@ -72,20 +73,6 @@ void NeighborsFinder<KmerT>::run() const
     saveSortedReferenceXml(outputFile_, sortedReferenceMetadata);
 }
 
-template <typename KmerT>
-KmerT reverseComplement(KmerT kmer)
-{
-    KmerT reversed = 0;
-    kmer = ~kmer; // complement all the bases
-    for (unsigned i = 0; oligo::KmerTraits<KmerT>::KMER_BASES > i; ++i)
-    {
-        reversed <<= 2;
-        reversed |= (kmer & 3);
-        kmer >>= 2;
-    }
-    return reversed;
-}
-
 template <typename KmerT>
 void NeighborsFinder<KmerT>::updateSortedReference(SortedReferenceMetadata::MaskFiles &maskFileList) const
 {
@@ -100,9 +87,11 @@ void NeighborsFinder<KmerT>::updateSortedReference(SortedReferenceMetadata::Mask
     clock_t start;
     KmerT currentNeighbor = 0;
     neighbors.read(reinterpret_cast<char *>(&currentNeighbor), sizeof(currentNeighbor));
+    MaskJumpTable<KmerT> jumpTable;
     BOOST_FOREACH(SortedReferenceMetadata::MaskFile &maskFile, maskFileList)
     {
         start = clock();
+        jumpTable.reset(maskFile.maskWidth);
         const bfs::path oldMaskFile = maskFile.path; //bfs::path(maskFile.path).replace_extension(".orig");
         ISAAC_THREAD_CERR << "Annotating " << oldMaskFile << std::endl;
         if (!exists(oldMaskFile))
@@ -154,6 +143,7 @@ void NeighborsFinder<KmerT>::updateSortedReference(SortedReferenceMetadata::Mask
                     const format message = format("Failed to write reference k-mer into %s: %s") % maskFile.path % strerror(errno);
                     BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
                 }
+                jumpTable.add(referenceKmer.getKmer());
             }
         }
         if (!maskInput.eof() && !neighbors.eof())
@@ -161,6 +151,8 @@ void NeighborsFinder<KmerT>::updateSortedReference(SortedReferenceMetadata::Mask
             const format message = format("Failed to update %s with neighbors information: %s") % maskFile.path % strerror(errno);
             BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
         }
+        maskOutput.close();
+        jumpTable.save(maskFile.path);
         ISAAC_THREAD_CERR << "Adding neighbors information done in " << (clock() - start) / 1000 << " ms for " << maskFile.path << std::endl;
     }
 }
@@ -193,6 +185,13 @@ template <typename KmerT>
 void NeighborsFinder<KmerT>::generateNeighbors(const SortedReferenceMetadata &sortedReferenceMetadata) const
 {
     KmerList kmerList = getKmerList(sortedReferenceMetadata);
+    annotateNeighbors(kmerList, parallelSort_, jobs_);
+    storeNeighborKmers(kmerList);
+}
+
+template <typename KmerT>
+void NeighborsFinder<KmerT>::annotateNeighbors(KmerList &kmerList, const bool parallelSort, const unsigned jobs)
+{
     std::vector<oligo::Permutate> permutateList = oligo::getPermutateList<KmerT>(4);
     // iterate over all possible permutations
     clock_t start = clock();
@@ -209,7 +208,7 @@ void NeighborsFinder<KmerT>::generateNeighbors(const SortedReferenceMetadata &so
         ISAAC_THREAD_CERR << "Permuting all k-mers done (" << kmerList.size() << " k-mers) " << permutate.toString() << " in " << (clock() - start) / 1000 << " ms" << std::endl;
         start = clock();
         ISAAC_THREAD_CERR << "Sorting all k-mers (" << kmerList.size() << " k-mers)" << std::endl;
-        if (parallelSort_)
+        if (parallelSort)
         {
             common::parallelSort(kmerList, &compareAnnotatedKmerMask<KmerT>);
         }
@@ -221,7 +220,7 @@ void NeighborsFinder<KmerT>::generateNeighbors(const SortedReferenceMetadata &so
         start = clock();
         ISAAC_THREAD_CERR << "Finding neighbors" << std::endl;
         // find neighbors
-        findNeighbors(kmerList, jobs_);
+        findNeighbors(kmerList, jobs);
         unsigned count = 0;
         ISAAC_THREAD_CERR << "Counting neighbors" << std::endl;
         BOOST_FOREACH(AnnotatedKmer &kmer, kmerList)
@@ -246,8 +245,6 @@ void NeighborsFinder<KmerT>::generateNeighbors(const SortedReferenceMetadata &so
     ISAAC_THREAD_CERR << "Sorting all k-mers (" << kmerList.size() << " k-mers)" << std::endl;
     std::sort(kmerList.begin(), kmerList.end());
     ISAAC_THREAD_CERR << "Sorting all k-mers done in " << (clock() - start) / 1000 << " ms" << std::endl;
-
-    storeNeighborKmers(kmerList);
 }
 
 template <typename KmerT>
@@ -387,46 +384,71 @@ void NeighborsFinder<KmerT>::markNeighbors(
 template <typename KmerT>
 typename NeighborsFinder<KmerT>::AnnotatedKmer reverseComplementAnnotatedKmer(typename NeighborsFinder<KmerT>::AnnotatedKmer ak)
 {
-    ak.value = reverseComplement(ak.value);
+    ak.value = oligo::reverseComplement(ak.value);
     return ak;
 }
 
+/**
+ * \brief Reads the unique kmers of the mask file. If kmerList is 0, they are only counted.
+ *
+ * \return number of unique kmers in the file
+ */
+template <typename KmerT>
+std::size_t NeighborsFinder<KmerT>::loadUniqueKmers(const boost::filesystem::path &maskPath, KmerList *kmerList) const
+{
+    std::ifstream is(maskPath.string().c_str());
+    if (!is)
+    {
+        using boost::format;
+        using common::IoException;
+        const format message = format("Failed to open sorted reference file %s: %s") % maskPath % strerror(errno);
+        BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
+    }
+    std::size_t ret = 0;
+    KmerT lastKmer = 0;
+    ReferenceKmer<KmerT> referenceKmer;
+    while (is.read(reinterpret_cast<char*>(&referenceKmer), sizeof(referenceKmer)))
+    {
+        if (!ret || referenceKmer.getKmer() != lastKmer)
+        {
+            lastKmer = referenceKmer.getKmer();
+            ++ret;
+            if (kmerList)
+            {
+                kmerList->push_back(AnnotatedKmer(lastKmer, false));
+            }
+        }
+    }
+    if (!is.eof())
+    {
+        using boost::format;
+        using common::IoException;
+        const format message = format("Failed to read sorted reference file %s: %s") % maskPath % strerror(errno);
+        BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
+    }
+    return ret;
+}
+
 template <typename KmerT>
 typename NeighborsFinder<KmerT>::KmerList NeighborsFinder<KmerT>::getKmerList(const SortedReferenceMetadata &sortedReferenceMetadata) const
 {
     const std::vector<SortedReferenceMetadata::MaskFile> &maskFileList =
         sortedReferenceMetadata.getMaskFileList(oligo::KmerTraits<KmerT>::KMER_BASES);
+    // The total kmer count of the metadata includes all repeat occurrences. Count the unique ones first
+    // so that the list, which is the largest allocation of the neighbor search, is not oversized.
+    std::size_t uniqueKmers = 0;
+    BOOST_FOREACH(const SortedReferenceMetadata::MaskFile &maskFile, maskFileList)
+    {
+        uniqueKmers += loadUniqueKmers(maskFile.path, 0);
+    }
     KmerList kmerList;
-    ISAAC_THREAD_CERR << "reserving memory for " <<
-        sortedReferenceMetadata.getTotalKmers(oligo::KmerTraits<KmerT>::KMER_BASES) * 2 << " kmers" << std::endl;
-    kmerList.reserve(sortedReferenceMetadata.getTotalKmers(oligo::KmerTraits<KmerT>::KMER_BASES) * 2);
+    ISAAC_THREAD_CERR << "reserving memory for " << uniqueKmers * 2 << " kmers" << std::endl;
+    kmerList.reserve(uniqueKmers * 2);
     ISAAC_THREAD_CERR << "reserving memory done for " << kmerList.capacity() << " kmers" << std::endl;
     // load all the kmers found in all the ABCD files
     BOOST_FOREACH(const SortedReferenceMetadata::MaskFile &maskFile, maskFileList)
     {
-        std::ifstream is(maskFile.path.string().c_str());
-        if (!is)
-        {
-            using boost::format;
-            using common::IoException;
-            const format message = format("Failed to open sorted reference file %s: %s") % maskFile.path % strerror(errno);
-            BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
-        }
-        ReferenceKmer<KmerT> referenceKmer;
-        while (is.read(reinterpret_cast<char*>(&referenceKmer), sizeof(referenceKmer)))
-        {
-            if (kmerList.empty() || referenceKmer.getKmer() != kmerList.back().value)
-            {
-                kmerList.push_back(AnnotatedKmer(referenceKmer.getKmer(), false));
-            }
-        }
-        if (!is.eof())
-        {
-            using boost::format;
-            using common::IoException;
-            const format message = format("Failed to read sorted reference file %s: %s") % maskFile.path % strerror(errno);
-            BOOST_THROW_EXCEPTION(IoException(errno, message.str()));
-        }
+        loadUniqueKmers(maskFile.path, &kmerList);
     }
     ISAAC_THREAD_CERR << "loading done for " << kmerList.size() << " unique forward kmers" << std::endl;
     std::transform(kmerList.begin(), kmerList.end(), std::back_inserter(kmerList), &reverseComplementAnnotatedKmer<KmerT>);
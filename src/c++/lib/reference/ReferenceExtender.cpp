@@ -0,0 +1,534 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file ReferenceExtender.cpp
+ **
+ ** \brief See ReferenceExtender.hh.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "reference/MaskJumpTable.hh"
+#include "reference/NeighborsFinder.hh"
+#include "reference/ReferenceExtender.hh"
+
+namespace isaac
+{
+namespace reference
+{
+
+namespace bfs = boost::filesystem;
+
+template <typename KmerT>
+ReferenceExtender<KmerT>::ReferenceExtender(
+    const SortedReferenceMetadata &reference,
+    const SortedReferenceMetadata &delta,
+    const bfs::path &outputDirectory,
+    const unsigned repeatThreshold,
+    const bool annotate,
+    const bool parallelSort,
+    const unsigned jobs)
+    : reference_(reference)
+    , delta_(delta)
+    , outputDirectory_(outputDirectory)
+    , repeatThreshold_(repeatThreshold)
+    , annotate_(annotate)
+    , parallelSort_(parallelSort)
+    , jobs_(jobs)
+    , permutateList_(oligo::getPermutateList<KmerT>(4))
+    , threads_(jobs)
+    , threadCandidates_(jobs)
+{
+}
+
+template <typename KmerT>
+SortedReferenceMetadata ReferenceExtender<KmerT>::run()
+{
+    validate();
+    loadDelta();
+    if (annotate_)
+    {
+        buildPrefixFilters();
+    }
+
+    clock_t start = clock();
+    ISAAC_THREAD_CERR << "Counting existing occurrences of " << counts_.size() << " kmers" << std::endl;
+    threads_.execute(boost::bind(&ReferenceExtender::scanMasks, this, _1), jobs_);
+    ISAAC_THREAD_CERR << "Counting existing occurrences done in " << (clock() - start) / 1000 << " ms" << std::endl;
+
+    // not needed anymore
+    std::vector<Kmers>().swap(prefixes_);
+    std::vector<std::vector<bool> >().swap(prefixFilters_);
+
+    if (annotate_)
+    {
+        findNeighbors();
+    }
+
+    start = clock();
+    ISAAC_THREAD_CERR << "Merging mask files into " << outputDirectory_ << std::endl;
+    storedKmers_.resize(reference_.getMaskFileList(oligo::KmerTraits<KmerT>::KMER_BASES).size());
+    threads_.execute(boost::bind(&ReferenceExtender::mergeMasks, this, _1), jobs_);
+    ISAAC_THREAD_CERR << "Merging mask files done in " << (clock() - start) / 1000 << " ms" << std::endl;
+
+    return makeMetadata();
+}
+
+template <typename KmerT>
+void ReferenceExtender<KmerT>::validate() const
+{
+    using boost::format;
+    const unsigned seedLength = oligo::KmerTraits<KmerT>::KMER_BASES;
+    if (!reference_.supportsSeedLength(seedLength) || !delta_.supportsSeedLength(seedLength))
+    {
+        const format message = format("Both references must be sorted for %d-mers") % seedLength;
+        BOOST_THROW_EXCEPTION(common::InvalidParameterException(message.str()));
+    }
+
+    const SortedReferenceMetadata::MaskFiles &maskFiles = reference_.getMaskFileList(seedLength);
+    const SortedReferenceMetadata::MaskFiles &deltaMaskFiles = delta_.getMaskFileList(seedLength);
+    std::vector<std::pair<unsigned, unsigned> > masks;
+    std::vector<std::pair<unsigned, unsigned> > deltaMasks;
+    BOOST_FOREACH(const SortedReferenceMetadata::MaskFile &maskFile, maskFiles)
+    {
+        masks.push_back(std::make_pair(maskFile.maskWidth, maskFile.mask_));
+        if (bfs::exists(outputDirectory_) && bfs::equivalent(maskFile.path.parent_path(), outputDirectory_))
+        {
+            const format message = format("Mask file %s would be overwritten. Use a different output directory") % maskFile.path;
+            BOOST_THROW_EXCEPTION(common::InvalidParameterException(message.str()));
+        }
+    }
+    BOOST_FOREACH(const SortedReferenceMetadata::MaskFile &maskFile, deltaMaskFiles)
+    {
+        deltaMasks.push_back(std::make_pair(maskFile.maskWidth, maskFile.mask_));
+    }
+    std::sort(masks.begin(), masks.end());
+    std::sort(deltaMasks.begin(), deltaMasks.end());
+    if (masks.empty() || masks != deltaMasks ||
+        masks.end() != std::unique(masks.begin(), masks.end()) ||
+        masks.size() != (1UL << masks.front().first))
+    {
+        const format message = format("Both references must have the same complete set of %d-mer mask files") % seedLength;
+        BOOST_THROW_EXCEPTION(common::InvalidParameterException(message.str()));
+    }
+}
+
+/**
+ * \brief Loads all delta kmers and prepares counts_ for them and their reverse complements.
+ */
+template <typename KmerT>
+void ReferenceExtender<KmerT>::loadDelta()
+{
+    const clock_t start = clock();
+    const unsigned seedLength = oligo::KmerTraits<KmerT>::KMER_BASES;
+    const unsigned long contigIdOffset = reference_.getContigsCount();
+    deltaKmers_.reserve(delta_.getTotalKmers(seedLength));
+    BOOST_FOREACH(const SortedReferenceMetadata::MaskFile &maskFile, delta_.getMaskFileList(seedLength))
+    {
+        ISAAC_THREAD_CERR << "Loading " << maskFile.path << std::endl;
+        std::ifstream is(maskFile.path.string().c_str());
+        if (!is)
+        {
+            const boost::format message = boost::format("Failed to open sorted reference file %s: %s") % maskFile.path % strerror(errno);
+            BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+        }
+        ReferenceKmerType referenceKmer;
+        while (is.read(reinterpret_cast<char*>(&referenceKmer), sizeof(referenceKmer)))
+        {
+            const ReferencePosition position = referenceKmer.getReferencePosition();
+            if (position.isTooManyMatch())
+            {
+                const boost::format message = boost::format(
+                    "%s contains repeat-limited kmers. Sort the added contigs without repeat threshold") % maskFile.path;
+                BOOST_THROW_EXCEPTION(common::InvalidParameterException(message.str()));
+            }
+            deltaKmers_.push_back(ReferenceKmerType(
+                referenceKmer.getKmer(), ReferencePosition(position.getContigId() + contigIdOffset, position.getPosition())));
+        }
+        if (!is.eof())
+        {
+            const boost::format message = boost::format("Failed to read sorted reference file %s: %s") % maskFile.path % strerror(errno);
+            BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+        }
+    }
+    std::sort(deltaKmers_.begin(), deltaKmers_.end(), &compareKmerAndPosition<KmerT>);
+
+    AllKmerCounts counts;
+    counts.reserve(deltaKmers_.size() * 2);
+    BOOST_FOREACH(const ReferenceKmerType &referenceKmer, deltaKmers_)
+    {
+        if (counts.empty() || counts.back().kmer_ != referenceKmer.getKmer())
+        {
+            counts.push_back(KmerCounts(referenceKmer.getKmer()));
+            counts.push_back(KmerCounts(oligo::reverseComplement(referenceKmer.getKmer())));
+            std::swap(counts[counts.size() - 2], counts.back());
+        }
+        ++counts.back().added_;
+    }
+    std::sort(counts.begin(), counts.end());
+
+    counts_.reserve(counts.size());
+    BOOST_FOREACH(const KmerCounts &kmerCounts, counts)
+    {
+        if (counts_.empty() || counts_.back().kmer_ != kmerCounts.kmer_)
+        {
+            counts_.push_back(kmerCounts);
+        }
+        else
+        {
+            counts_.back().added_ += kmerCounts.added_;
+        }
+    }
+    ISAAC_THREAD_CERR << "Loaded " << deltaKmers_.size() << " added kmers (" << counts_.size() <<
+        " unique forward and reverse) in " << (clock() - start) / 1000 << " ms" << std::endl;
+}
+
+/**
+ * \brief For each permutation, collects the prefixes of the permuted counts_ kmers.
+ *
+ * By the pigeonhole principle, two kmers within the neighborhood distance have equal prefixes under
+ * at least one of the permutations.
+ */
+template <typename KmerT>
+void ReferenceExtender<KmerT>::buildPrefixFilters()
+{
+    const clock_t start = clock();
+    Kmers permuted;
+    permuted.reserve(counts_.size());
+    BOOST_FOREACH(const KmerCounts &kmerCounts, counts_)
+    {
+        permuted.push_back(kmerCounts.kmer_);
+    }
+
+    prefixes_.resize(permutateList_.size());
+    prefixFilters_.resize(permutateList_.size(), std::vector<bool>(1UL << PREFIX_FILTER_BITS));
+    for (std::size_t permutation = 0; permutateList_.size() > permutation; ++permutation)
+    {
+        Kmers &prefixes = prefixes_[permutation];
+        prefixes.reserve(permuted.size());
+        BOOST_FOREACH(KmerT &kmer, permuted)
+        {
+            kmer = permutateList_[permutation](kmer);
+            const KmerT prefix = kmer >> oligo::KmerTraits<KmerT>::KMER_BASES;
+            prefixes.push_back(prefix);
+            prefixFilters_[permutation][static_cast<std::size_t>(
+                prefix >> (oligo::KmerTraits<KmerT>::KMER_BASES - PREFIX_FILTER_BITS))] = true;
+        }
+        std::sort(prefixes.begin(), prefixes.end());
+        prefixes.erase(std::unique(prefixes.begin(), prefixes.end()), prefixes.end());
+    }
+    ISAAC_THREAD_CERR << "Building prefix filters for " << permutateList_.size() << " permutations done in " <<
+        (clock() - start) / 1000 << " ms" << std::endl;
+}
+
+template <typename KmerT>
+bool ReferenceExtender<KmerT>::isCandidate(KmerT kmer) const
+{
+    for (std::size_t permutation = 0; permutateList_.size() > permutation; ++permutation)
+    {
+        kmer = permutateList_[permutation](kmer);
+        const KmerT prefix = kmer >> oligo::KmerTraits<KmerT>::KMER_BASES;
+        if (prefixFilters_[permutation][static_cast<std::size_t>(
+                prefix >> (oligo::KmerTraits<KmerT>::KMER_BASES - PREFIX_FILTER_BITS))] &&
+            std::binary_search(prefixes_[permutation].begin(), prefixes_[permutation].end(), prefix))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename KmerT>
+void ReferenceExtender<KmerT>::scanMasks(const unsigned threadNumber)
+{
+    const SortedReferenceMetadata::MaskFiles &maskFiles =
+        reference_.getMaskFileList(oligo::KmerTraits<KmerT>::KMER_BASES);
+    for (std::size_t i = threadNumber; maskFiles.size() > i; i += jobs_)
+    {
+        scanMask(maskFiles[i], threadCandidates_[threadNumber]);
+    }
+}
+
+/**
+ * \brief Updates counts_ for the kmers of the mask. As each counts_ kmer belongs to exactly one mask, the
+ *        threads never update the same element.
+ */
+template <typename KmerT>
+void ReferenceExtender<KmerT>::scanMask(const SortedReferenceMetadata::MaskFile &maskFile, Kmers &candidates)
+{
+    ISAAC_THREAD_CERR << "Scanning " << maskFile.path << std::endl;
+    std::ifstream is(maskFile.path.string().c_str());
+    if (!is)
+    {
+        const boost::format message = boost::format("Failed to open sorted reference file %s: %s") % maskFile.path % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+
+    typename AllKmerCounts::iterator counts = counts_.begin();
+    ReferenceKmerType referenceKmer;
+    bool first = true;
+    KmerT last = 0;
+    while (is.read(reinterpret_cast<char*>(&referenceKmer), sizeof(referenceKmer)))
+    {
+        const KmerT kmer = referenceKmer.getKmer();
+        if (first || last != kmer)
+        {
+            counts = std::lower_bound(counts, counts_.end(), KmerCounts(kmer));
+            if ((counts_.end() == counts || counts->kmer_ != kmer) && annotate_ && isCandidate(kmer))
+            {
+                candidates.push_back(kmer);
+            }
+            first = false;
+            last = kmer;
+        }
+        if (counts_.end() != counts && counts->kmer_ == kmer)
+        {
+            const ReferencePosition position = referenceKmer.getReferencePosition();
+            if (position.isTooManyMatch())
+            {
+                counts->tooMany_ = true;
+            }
+            else
+            {
+                ++counts->existing_;
+            }
+            counts->neighbors_ |= position.hasNeighbors();
+        }
+    }
+    if (!is.eof())
+    {
+        const boost::format message = boost::format("Failed to read sorted reference file %s: %s") % maskFile.path % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+}
+
+/**
+ * \brief Runs the neighbors search on the new kmers, the existing candidates and their reverse complements.
+ */
+template <typename KmerT>
+void ReferenceExtender<KmerT>::findNeighbors()
+{
+    typedef typename NeighborsFinder<KmerT>::AnnotatedKmer AnnotatedKmer;
+    typename NeighborsFinder<KmerT>::KmerList kmerList;
+    std::size_t candidatesCount = 0;
+    BOOST_FOREACH(const Kmers &candidates, threadCandidates_)
+    {
+        candidatesCount += candidates.size();
+    }
+    ISAAC_THREAD_CERR << "Found " << candidatesCount << " existing neighbor candidates" << std::endl;
+
+    kmerList.reserve(counts_.size() + candidatesCount * 2);
+    BOOST_FOREACH(const KmerCounts &kmerCounts, counts_)
+    {
+        kmerList.push_back(AnnotatedKmer(kmerCounts.kmer_, false));
+    }
+    BOOST_FOREACH(Kmers &candidates, threadCandidates_)
+    {
+        BOOST_FOREACH(const KmerT candidate, candidates)
+        {
+            kmerList.push_back(AnnotatedKmer(candidate, false));
+            kmerList.push_back(AnnotatedKmer(oligo::reverseComplement(candidate), false));
+        }
+        Kmers().swap(candidates);
+    }
+    std::sort(kmerList.begin(), kmerList.end());
+    kmerList.erase(
+        std::unique(kmerList.begin(), kmerList.end(),
+                    boost::bind(&AnnotatedKmer::value, _1) == boost::bind(&AnnotatedKmer::value, _2)),
+        kmerList.end());
+
+    NeighborsFinder<KmerT>::annotateNeighbors(kmerList, parallelSort_, jobs_);
+
+    BOOST_FOREACH(const AnnotatedKmer &annotatedKmer, kmerList)
+    {
+        if (annotatedKmer.hasNeighbors)
+        {
+            neighborKmers_.push_back(annotatedKmer.value);
+        }
+    }
+    typename Kmers::iterator neighbor = neighborKmers_.begin();
+    BOOST_FOREACH(KmerCounts &kmerCounts, counts_)
+    {
+        neighbor = std::lower_bound(neighbor, neighborKmers_.end(), kmerCounts.kmer_);
+        kmerCounts.neighbors_ |= (neighborKmers_.end() != neighbor && *neighbor == kmerCounts.kmer_);
+    }
+    ISAAC_THREAD_CERR << neighborKmers_.size() << " of " << kmerList.size() << " kmers have neighbors" << std::endl;
+}
+
+template <typename KmerT>
+void ReferenceExtender<KmerT>::mergeMasks(const unsigned threadNumber)
+{
+    const SortedReferenceMetadata::MaskFiles &maskFiles =
+        reference_.getMaskFileList(oligo::KmerTraits<KmerT>::KMER_BASES);
+    for (std::size_t i = threadNumber; maskFiles.size() > i; i += jobs_)
+    {
+        storedKmers_[i] = mergeMask(maskFiles[i], outputDirectory_ / maskFiles[i].path.filename());
+    }
+}
+
+/**
+ * \brief Writes the existing records of the mask followed by the delta records, applying the repeat
+ *        threshold to the combined counts.
+ *
+ * \return number of records stored
+ */
+template <typename KmerT>
+std::size_t ReferenceExtender<KmerT>::mergeMask(
+    const SortedReferenceMetadata::MaskFile &maskFile,
+    const bfs::path &outputFile) const
+{
+    ISAAC_THREAD_CERR << "Merging " << maskFile.path << " into " << outputFile << std::endl;
+    const clock_t start = clock();
+    std::ifstream is(maskFile.path.string().c_str());
+    if (!is)
+    {
+        const boost::format message = boost::format("Failed to open sorted reference file %s: %s") % maskFile.path % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+    std::ofstream os(outputFile.string().c_str());
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to create file " + outputFile.string()));
+    }
+
+    MaskJumpTable<KmerT> jumpTable;
+    jumpTable.reset(maskFile.maskWidth);
+
+    typename ReferenceKmers::const_iterator delta = std::lower_bound(
+        deltaKmers_.begin(), deltaKmers_.end(),
+        ReferenceKmerType(KmerT(maskFile.mask_) << (KMER_BITS - maskFile.maskWidth)), &compareKmer<KmerT>);
+    typename AllKmerCounts::const_iterator counts = counts_.begin();
+    typename Kmers::const_iterator neighbor = neighborKmers_.begin();
+
+    ReferenceKmers sameKmer;
+    ReferenceKmerType next;
+    bool nextValid = is.read(reinterpret_cast<char*>(&next), sizeof(next));
+    std::size_t storedKmers = 0;
+    while (nextValid ||
+        (deltaKmers_.end() != delta && maskFile.mask_ == getMask(delta->getKmer(), maskFile.maskWidth)))
+    {
+        const bool deltaValid =
+            deltaKmers_.end() != delta && maskFile.mask_ == getMask(delta->getKmer(), maskFile.maskWidth);
+        const KmerT kmer = !nextValid ? delta->getKmer() :
+            !deltaValid ? next.getKmer() : std::min(next.getKmer(), delta->getKmer());
+
+        sameKmer.clear();
+        for (; nextValid && kmer == next.getKmer(); nextValid = is.read(reinterpret_cast<char*>(&next), sizeof(next)))
+        {
+            sameKmer.push_back(next);
+        }
+        const typename ReferenceKmers::const_iterator deltaBegin = delta;
+        for (; deltaKmers_.end() != delta && kmer == delta->getKmer(); ++delta)
+        {
+        }
+
+        neighbor = std::lower_bound(neighbor, neighborKmers_.end(), kmer);
+        bool hasNeighbors = neighborKmers_.end() != neighbor && *neighbor == kmer;
+
+        counts = std::lower_bound(counts, counts_.end(), KmerCounts(kmer));
+        if (counts_.end() != counts && counts->kmer_ == kmer)
+        {
+            const typename AllKmerCounts::const_iterator reverse =
+                std::lower_bound(counts_.begin(), counts_.end(), KmerCounts(oligo::reverseComplement(kmer)));
+            ISAAC_ASSERT_MSG(counts_.end() != reverse, "Reverse complement is expected to be counted");
+            hasNeighbors |= counts->neighbors_ || reverse->neighbors_;
+            const unsigned long matches = counts->existing_ + reverse->existing_ + counts->added_ + reverse->added_;
+            if (counts->tooMany_ || reverse->tooMany_ || repeatThreshold_ < matches)
+            {
+                sameKmer.assign(1, ReferenceKmerType(kmer, ReferencePosition(ReferencePosition::TooManyMatch)));
+            }
+            else
+            {
+                sameKmer.insert(sameKmer.end(), deltaBegin, delta);
+            }
+        }
+        else
+        {
+            ISAAC_ASSERT_MSG(deltaBegin == delta, "All added kmers are expected to be counted");
+        }
+
+        BOOST_FOREACH(ReferenceKmerType referenceKmer, sameKmer)
+        {
+            referenceKmer.setNeighbors(hasNeighbors || !referenceKmer.hasNoNeighbors());
+            if (!os.write(reinterpret_cast<const char*>(&referenceKmer), sizeof(referenceKmer)))
+            {
+                BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write reference kmer into " + outputFile.string()));
+            }
+            jumpTable.add(referenceKmer.getKmer());
+            ++storedKmers;
+        }
+    }
+    if (!is.eof())
+    {
+        const boost::format message = boost::format("Failed to read sorted reference file %s: %s") % maskFile.path % strerror(errno);
+        BOOST_THROW_EXCEPTION(common::IoException(errno, message.str()));
+    }
+    os.flush();
+    os.close();
+    jumpTable.save(outputFile);
+    ISAAC_THREAD_CERR << "Merging " << storedKmers << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers done in " <<
+        (clock() - start) / 1000 << "ms" << std::endl;
+    return storedKmers;
+}
+
+/**
+ * \brief Existing contigs followed by the delta contigs with indexes, karyotype indexes and genomic positions
+ *        past the existing ones.
+ */
+template <typename KmerT>
+SortedReferenceMetadata ReferenceExtender<KmerT>::makeMetadata() const
+{
+    const unsigned seedLength = oligo::KmerTraits<KmerT>::KMER_BASES;
+    SortedReferenceMetadata ret = reference_;
+    ret.clearMasks();
+    const SortedReferenceMetadata::MaskFiles &maskFiles = reference_.getMaskFileList(seedLength);
+    for (std::size_t i = 0; maskFiles.size() > i; ++i)
+    {
+        ret.addMaskFile(seedLength, maskFiles[i].maskWidth, maskFiles[i].mask_,
+                        outputDirectory_ / maskFiles[i].path.filename(), storedKmers_[i]);
+    }
+
+    unsigned karyotypeIndexOffset = 0;
+    unsigned long genomicPositionOffset = 0;
+    BOOST_FOREACH(const SortedReferenceMetadata::Contig &contig, reference_.getContigs())
+    {
+        karyotypeIndexOffset = std::max(karyotypeIndexOffset, contig.karyotypeIndex_ + 1);
+        genomicPositionOffset = std::max(genomicPositionOffset, contig.genomicPosition_ + contig.totalBases_);
+    }
+    BOOST_FOREACH(SortedReferenceMetadata::Contig contig, delta_.getContigs())
+    {
+        contig.index_ += reference_.getContigsCount();
+        contig.karyotypeIndex_ += karyotypeIndexOffset;
+        contig.genomicPosition_ += genomicPositionOffset;
+        ret.getContigs().push_back(contig);
+    }
+    return ret;
+}
+
+template class ReferenceExtender<oligo::ShortKmerType>;
+template class ReferenceExtender<oligo::KmerType>;
+template class ReferenceExtender<oligo::LongKmerType>;
+
+} // namespace reference
+} // namespace isaac
@@ -17,17 +17,23 @@
  ** \author Come Raczy
  **/
 
+#include <limits>
+
 #include <boost/assert.hpp>
 #include <boost/foreach.hpp>
+#include <boost/format.hpp>
 #include <boost/io/ios_state.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include "common/Exceptions.hh"
+#include "common/ParallelSort.hpp"
 #include "common/SystemCompatibility.hh"
 #include "io/BitsetLoader.hh"
 #include "io/BitsetSaver.hh"
 #include "io/FastaReader.hh"
 #include "oligo/Nucleotides.hh"
 #include "oligo/Mask.hh"
+#include "reference/MaskJumpTable.hh"
 #include "reference/ReferencePosition.hh"
 #include "reference/ReferenceSorter.hh"
 #include "reference/SortedReferenceXml.hh"
@@ -37,41 +43,182 @@ namespace isaac
 namespace reference
 {
 
+/**
+ * \brief Sequential reader of a sorted run stored in a file or in memory
+ */
+template <typename KmerT>
+class SortedRunReader: boost::noncopyable
+{
+public:
+    explicit SortedRunReader(const boost::filesystem::path &path) :
+        path_(path), is_(path.c_str()), buffer_(RUN_BUFFER_KMERS), current_(0), end_(0)
+    {
+        if (!is_)
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open sorted run " + path_.string()));
+        }
+        refill();
+    }
+
+    SortedRunReader(const ReferenceKmer<KmerT> *begin, const ReferenceKmer<KmerT> *end) :
+        current_(begin), end_(end)
+    {
+    }
+
+    bool empty() const {return current_ == end_;}
+    const ReferenceKmer<KmerT> &front() const {return *current_;}
+    void pop()
+    {
+        ++current_;
+        if (current_ == end_ && is_.is_open())
+        {
+            refill();
+        }
+    }
+
+private:
+    static const std::size_t RUN_BUFFER_KMERS = 1 << 16;
+    const boost::filesystem::path path_;
+    std::ifstream is_;
+    std::vector<ReferenceKmer<KmerT> > buffer_;
+    const ReferenceKmer<KmerT> *current_;
+    const ReferenceKmer<KmerT> *end_;
+
+    void refill()
+    {
+        is_.read(reinterpret_cast<char *>(&buffer_.front()), buffer_.size() * sizeof(ReferenceKmer<KmerT>));
+        const std::size_t kmers = is_.gcount() / sizeof(ReferenceKmer<KmerT>);
+        if (!kmers && !is_.eof())
+        {
+            BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to read sorted run " + path_.string()));
+        }
+        current_ = &buffer_.front();
+        end_ = current_ + kmers;
+    }
+};
+
+/**
+ * \brief k-way merge of the sorted runs
+ */
+template <typename KmerT>
+class SortedRunMerger: boost::noncopyable
+{
+    typedef SortedRunReader<KmerT> Reader;
+public:
+    SortedRunMerger(
+        const std::vector<boost::filesystem::path> &runs,
+        const std::vector<ReferenceKmer<KmerT> > &memoryRun)
+    {
+        BOOST_FOREACH(const boost::filesystem::path &run, runs)
+        {
+            readers_.push_back(boost::shared_ptr<Reader>(new Reader(run)));
+        }
+        if (!memoryRun.empty())
+        {
+            readers_.push_back(boost::shared_ptr<Reader>(new Reader(&memoryRun.front(), &memoryRun.front() + memoryRun.size())));
+        }
+        BOOST_FOREACH(const boost::shared_ptr<Reader> &reader, readers_)
+        {
+            if (!reader->empty())
+            {
+                heap_.push_back(reader.get());
+            }
+        }
+        std::make_heap(heap_.begin(), heap_.end(), &greater);
+    }
+
+    bool empty() const {return heap_.empty();}
+    const ReferenceKmer<KmerT> &front() const {return heap_.front()->front();}
+    void pop()
+    {
+        std::pop_heap(heap_.begin(), heap_.end(), &greater);
+        heap_.back()->pop();
+        if (heap_.back()->empty())
+        {
+            heap_.pop_back();
+        }
+        else
+        {
+            std::push_heap(heap_.begin(), heap_.end(), &greater);
+        }
+    }
+
+private:
+    std::vector<boost::shared_ptr<Reader> > readers_;
+    std::vector<Reader *> heap_;
+
+    static bool greater(const Reader *left, const Reader *right)
+    {
+        return compareKmerAndPosition(right->front(), left->front());
+    }
+};
+
 template <typename KmerT>
 ReferenceSorter<KmerT>::ReferenceSorter (
     const unsigned int maskWidth,
-    const unsigned mask,
+    const std::vector<unsigned long> &masks,
     const boost::filesystem::path &genomeFile,
     const boost::filesystem::path &genomeNeighborsFile,
-    const boost::filesystem::path &outputFile,
-    const unsigned repeatThreshold
+    const std::vector<boost::filesystem::path> &outputFiles,
+    const unsigned repeatThreshold,
+    const boost::filesystem::path &tempDirectory,
+    const unsigned long memoryLimit,
+    const unsigned threads
     )
     : repeatThreshold_(repeatThreshold)
     , maskWidth_(maskWidth)
-    , mask_(mask)
-    , msbMask_(~((~(KmerT(0)) >> maskWidth)))
-    , maskBits_(KmerT(mask_) << (oligo::KmerTraits<KmerT>::KMER_BASES * oligo::BITS_PER_BASE - maskWidth_))
-    , unpermutatedMsbMask_(msbMask_)
-    , unpermutatedMaskBits_(maskBits_)
+    , selectedMasks_(oligo::getMaskCount(maskWidth_), false)
     , genomeFile_(genomeFile)
     , genomeNeighborsFile_(genomeNeighborsFile)
-    , outputFile_(boost::filesystem::absolute(outputFile))
+    , tempDirectory_(tempDirectory)
+      // the per-thread buffers can hold up to two kmers per block base
+    , bufferKmersMax_(memoryLimit ?
+        std::max<std::size_t>(memoryLimit / sizeof(ReferenceKmerType), BLOCK_BASES * 4) - BLOCK_BASES * 2 :
+        std::numeric_limits<std::size_t>::max())
+    , threads_(threads)
+    , threadKmers_(threads)
 {
-    boost::io::ios_flags_saver svr(std::cerr);
-    std::cerr <<
+    ISAAC_ASSERT_MSG(masks.size() == outputFiles.size(), "Each mask needs an output file");
+    for (std::size_t i = 0; masks.size() > i; ++i)
+    {
+        BOOST_ASSERT(masks[i] < isaac::oligo::getMaskCount(maskWidth_) && "Mask value cannot exceed the allowed bit width");
+        outputs_.push_back(std::make_pair(masks[i], boost::filesystem::absolute(outputFiles[i])));
+        selectedMasks_.at(masks[i]) = true;
+    }
+    std::sort(outputs_.begin(), outputs_.end());
+
+    ISAAC_THREAD_CERR <<
             "Constructing ReferenceSorter: for " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers " <<
             " mask width: " << maskWidth_ <<
-            " msbMask_: " << oligo::TraceKmer<KmerT>(msbMask_) <<
-            " maskBits_: " << oligo::TraceKmer<KmerT>(maskBits_) <<
-            " unpermutatedMsbMask_:" << std::hex << oligo::TraceKmer<KmerT>(unpermutatedMsbMask_) <<
-            " unpermutatedMaskBits_:" << std::hex << oligo::TraceKmer<KmerT>(unpermutatedMaskBits_) <<
+            " masks: " << outputs_.size() <<
             " genomeFile_: " << genomeFile_ <<
-            " outputFile_: " << outputFile_ <<
+            " tempDirectory_: " << tempDirectory_ <<
+            " bufferKmersMax_: " << bufferKmersMax_ <<
+            " threads: " << threads <<
             std::endl;
+}
 
-    BOOST_ASSERT(mask_ < isaac::oligo::getMaskCount(maskWidth_) && "Mask value cannot exceed the allowed bit width");
+template <typename KmerT>
+ReferenceSorter<KmerT>::~ReferenceSorter()
+{
+    // the runs remain only if the sorting has failed
+    removeRuns();
 }
 
+template <typename KmerT>
+void ReferenceSorter<KmerT>::removeRuns()
+{
+    BOOST_FOREACH(const boost::filesystem::path &run, runs_)
+    {
+        boost::system::error_code error;
+        boost::filesystem::remove(run, error);
+        if (error)
+        {
+            ISAAC_THREAD_CERR << "WARNING: Failed to remove sorted run " << run << ": " << error.message() << std::endl;
+        }
+    }
+    runs_.clear();
+}
 
 template <typename KmerT>
 void ReferenceSorter<KmerT>::run()
@@ -93,11 +240,11 @@ void ReferenceSorter<KmerT>::run()
         const unsigned long neighborsCount = loader.load(genomeLength, neighbors);
         ISAAC_THREAD_CERR << "Scanning " << genomeNeighborsFile_ << " found " << neighborsCount << " neighbors among " << genomeLength << " bases" << std::endl;
     }
-    saveReference(contigOffsets, neighbors, genomeLength);
+    saveReference(contigOffsets, neighbors);
 }
 
 /**
- * \brief Load kmers matching the unpermutatedMaskBits_.
+ * \brief Load kmers matching the selected masks. Spill sorted runs when the buffer fills up.
  *
  * \return vector of contig base offsets in the order found in fasta file
  */
@@ -105,32 +252,97 @@ template <typename KmerT>
 unsigned long ReferenceSorter<KmerT>::loadReference(
     std::vector<unsigned long> &retContigOffsets)
 {
-    std::cerr << "Loading " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << std::endl;
+    ISAAC_THREAD_CERR << "Loading " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << std::endl;
     const clock_t start = clock();
 
+    if (std::numeric_limits<std::size_t>::max() != bufferKmersMax_)
+    {
+        reference_.reserve(bufferKmersMax_);
+    }
+
     retContigOffsets.clear();
     isaac::io::MultiFastaReader multiFastaReader(std::vector<boost::filesystem::path>(1, genomeFile_));
     char base;
-    KmerT forward = 0;
-    KmerT reverse = 0;
-    unsigned int badKmer = oligo::KmerTraits<KmerT>::KMER_BASES;
-    unsigned long position = 0;
     bool newContig = false;
     unsigned long lastContigOffset = 0UL;
+    int contigId = 0;
+    // bases of the current contig starting at blockPosition
+    std::vector<char> block;
+    block.reserve(BLOCK_BASES + oligo::KmerTraits<KmerT>::KMER_BASES - 1);
+    unsigned long blockPosition = 0;
     while (multiFastaReader.get(base, newContig))
     {
         if (newContig)
         {
-            std::cerr << "New contig: " << multiFastaReader.getContigId() << " found at position " << position << std::endl;
-            position = 0;
-            badKmer = oligo::KmerTraits<KmerT>::KMER_BASES;
+            addBlock(contigId, blockPosition, block);
+            block.clear();
+            blockPosition = 0;
+            contigId = multiFastaReader.getContigId();
+            ISAAC_THREAD_CERR << "New contig: " << contigId << " found at offset " << lastContigOffset << std::endl;
             retContigOffsets.push_back(lastContigOffset);
         }
+        block.push_back(base);
+        if (BLOCK_BASES + oligo::KmerTraits<KmerT>::KMER_BASES - 1 == block.size())
+        {
+            addBlock(contigId, blockPosition, block);
+            // keep the bases of the kmers that span the block boundary
+            block.erase(block.begin(), block.end() - (oligo::KmerTraits<KmerT>::KMER_BASES - 1));
+            blockPosition += BLOCK_BASES;
+        }
+        ++lastContigOffset;
+    }
+    addBlock(contigId, blockPosition, block);
+    std::vector<ReferenceKmers>(threadKmers_.size()).swap(threadKmers_);
+
+    ISAAC_THREAD_CERR << "Loading " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << " done in " << (clock() - start) / 1000 << "ms" << std::endl;
+    return lastContigOffset;
+}
+
+/**
+ * \brief Generates kmers of the block on all threads and moves them into reference_
+ */
+template <typename KmerT>
+void ReferenceSorter<KmerT>::addBlock(const int contigId, const unsigned long blockPosition, const std::vector<char> &block)
+{
+    if (block.size() < oligo::KmerTraits<KmerT>::KMER_BASES)
+    {
+        return;
+    }
+    threads_.execute(boost::bind(&ReferenceSorter::generateKmers, this, contigId, blockPosition, boost::cref(block), _1));
+
+    BOOST_FOREACH(const ReferenceKmers &kmers, threadKmers_)
+    {
+        if (reference_.size() + kmers.size() > bufferKmersMax_)
+        {
+            spillReference();
+        }
+        reference_.insert(reference_.end(), kmers.begin(), kmers.end());
+    }
+}
+
+template <typename KmerT>
+void ReferenceSorter<KmerT>::generateKmers(
+    const int contigId,
+    const unsigned long blockPosition,
+    const std::vector<char> &block,
+    const unsigned threadNumber)
+{
+    const std::size_t blockKmers = block.size() + 1 - oligo::KmerTraits<KmerT>::KMER_BASES;
+    const std::size_t firstKmer = blockKmers * threadNumber / threads_.size();
+    const std::size_t endKmer = blockKmers * (threadNumber + 1) / threads_.size();
+
+    ReferenceKmers &kmers = threadKmers_.at(threadNumber);
+    kmers.clear();
+    KmerT forward = 0;
+    KmerT reverse = 0;
+    unsigned int badKmer = oligo::KmerTraits<KmerT>::KMER_BASES;
+    for (std::size_t i = firstKmer; endKmer + oligo::KmerTraits<KmerT>::KMER_BASES - 1 > i; ++i)
+    {
         if (badKmer)
         {
             --badKmer;
         }
-        const KmerT baseValue = oligo::getValue(base);
+        const KmerT baseValue = oligo::getValue(block[i]);
         if (baseValue >> oligo::BITS_PER_BASE)
         {
             badKmer = oligo::KmerTraits<KmerT>::KMER_BASES;
@@ -138,99 +350,155 @@ unsigned long ReferenceSorter<KmerT>::loadReference(
         forward <<= oligo::BITS_PER_BASE;
         forward |= baseValue;
         reverse >>= oligo::BITS_PER_BASE;
-        reverse |= (((~baseValue) & oligo::BITS_PER_BASE_MASK) << (oligo::BITS_PER_BASE * oligo::KmerTraits<KmerT>::KMER_BASES - oligo::BITS_PER_BASE));
-        //std:: cerr << forward << '\t' << position << '\t' << reverse << '\t' << position << '\t' << bad16mer << '\t' << base << '\t' << baseValue << '\n';
-        const unsigned long kmerPosition = (position + 1) - oligo::KmerTraits<KmerT>::KMER_BASES;
+        reverse |= (((~baseValue) & oligo::BITS_PER_BASE_MASK) << (KMER_BITS - oligo::BITS_PER_BASE));
         if (0 == badKmer)
         {
-            ISAAC_ASSERT_MSG(position + 1 >= oligo::KmerTraits<KmerT>::KMER_BASES, "Kmers at the start of contig are always bad");
-            addToReference(forward, ReferencePosition(multiFastaReader.getContigId(), kmerPosition, false));
+            const unsigned long kmerPosition = blockPosition + i + 1 - oligo::KmerTraits<KmerT>::KMER_BASES;
+            if (selectedMasks_[getMask(forward)])
+            {
+                kmers.push_back(ReferenceKmerType(forward, ReferencePosition(contigId, kmerPosition, false)));
+            }
             // Reverse kmers are added only to be able to properly count repeats.
             // Mark them as having neighbors to be able to filter them out before storing the results.
-            addToReference(reverse, ReferencePosition(multiFastaReader.getContigId(), kmerPosition, true));
+            if (selectedMasks_[getMask(reverse)])
+            {
+                kmers.push_back(ReferenceKmerType(reverse, ReferencePosition(contigId, kmerPosition, true)));
+            }
         }
-        ++position;
-        ++lastContigOffset;
     }
-    std::cerr << "Loading " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << " done in " << (clock() - start) / 1000 << "ms" << std::endl;
-    return lastContigOffset;
 }
 
 template <typename KmerT>
-void ReferenceSorter<KmerT>::addToReference(const KmerT kmer, const ReferencePosition &referencePosition)
+void ReferenceSorter<KmerT>::sortReference()
 {
-    if (unpermutatedMaskBits_ == (kmer & unpermutatedMsbMask_))
+    ISAAC_THREAD_CERR << "Sorting " << reference_.size() << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << std::endl;
+    const clock_t start = clock();
+    common::parallelSort(reference_.begin(), reference_.end(), &compareKmerAndPosition<KmerT>, threads_, threads_.size());
+    ISAAC_THREAD_CERR << "Sorting " << reference_.size() << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << " done in " << (clock() - start) / 1000 << "ms" << std::endl;
+}
+
+template <typename KmerT>
+void ReferenceSorter<KmerT>::spillReference()
+{
+    sortReference();
+
+    const boost::filesystem::path runPath = tempDirectory_ /
+        (boost::format("%s.run%d") % outputs_.front().second.filename().string() % runs_.size()).str();
+    ISAAC_THREAD_CERR << "Spilling " << reference_.size() << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers into " << runPath << std::endl;
+    std::ofstream os(runPath.c_str());
+    if (!os)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to create file " + runPath.string()));
+    }
+    // registered before writing so that a partially written run gets removed as well
+    runs_.push_back(runPath);
+    if (!os.write(reinterpret_cast<const char*>(&reference_.front()), reference_.size() * sizeof(ReferenceKmerType)) || !os.flush())
     {
-//        std::cerr << std::hex << kmer << '\t' << referencePosition << '\n';
-        reference_.push_back(ReferenceKmer<KmerT>(kmer, referencePosition));
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to write sorted run into " + runPath.string()));
     }
+    reference_.clear();
 }
 
 template <typename KmerT>
-void ReferenceSorter<KmerT>::sortReference()
+void ReferenceSorter<KmerT>::saveReference(
+    const std::vector<unsigned long> &contigOffsets,
+    const std::vector<bool> &neighbors)
 {
-    std::cerr << "Sorting " << reference_.size() << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << std::endl;
-    const clock_t start = clock();
-    std::sort(reference_.begin(), reference_.end(), &compareKmer<KmerT>);
-    std::cerr << "Sorting " << reference_.size() << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << " done in " << (clock() - start) / 1000 << "ms" << std::endl;
+    ISAAC_THREAD_CERR << "Merging " << runs_.size() << " sorted runs and " << reference_.size() << " in-memory " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << std::endl;
+    SortedRunMerger<KmerT> merger(runs_, reference_);
+
+    SortedReferenceMetadata sortedReference;
+    ReferenceKmers sameKmer;
+    sameKmer.reserve(repeatThreshold_ + 1);
+    typedef std::pair<unsigned long, boost::filesystem::path> MaskOutput;
+    BOOST_FOREACH(const MaskOutput &output, outputs_)
+    {
+        const std::size_t storedKmers = saveMask(merger, output.first, output.second, contigOffsets, neighbors, sameKmer);
+        sortedReference.addMaskFile(oligo::KmerTraits<KmerT>::KMER_BASES, maskWidth_, output.first, output.second, storedKmers);
+    }
+    ISAAC_ASSERT_MSG(merger.empty(), "Kmers of unexpected mask remain after all masks are saved");
+
+    removeRuns();
+    saveSortedReferenceXml(std::cout, sortedReference);
 }
 
+/**
+ * \brief Stores the kmers of the mask from the front of the sorted source into outputFile
+ *
+ * \param sameKmer  buffer for the occurrences of a kmer, reserved for repeatThreshold_ + 1 elements
+ * \return number of kmers stored
+ */
 template <typename KmerT>
-void ReferenceSorter<KmerT>::saveReference(
+template <typename SourceT>
+std::size_t ReferenceSorter<KmerT>::saveMask(
+    SourceT &source,
+    const unsigned long mask,
+    const boost::filesystem::path &outputFile,
     const std::vector<unsigned long> &contigOffsets,
     const std::vector<bool> &neighbors,
-    const unsigned long genomeLength)
+    ReferenceKmers &sameKmer)
 {
-    std::cerr << "Saving " << reference_.size() << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers" << std::endl;
+    ISAAC_THREAD_CERR << "Saving " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers into " << outputFile << std::endl;
     const clock_t start = clock();
 
-    std::ofstream os(outputFile_.c_str());
+    std::ofstream os(outputFile.c_str());
     if (!os)
     {
-        BOOST_THROW_EXCEPTION(common::IoException(errno,"Failed to create file " + outputFile_.string()));
+        BOOST_THROW_EXCEPTION(common::IoException(errno,"Failed to create file " + outputFile.string()));
     }
 
-    typename std::vector<ReferenceKmer<KmerT> >::iterator current(reference_.begin());
-    std::size_t neighborKmers = 0;
+    MaskJumpTable<KmerT> jumpTable;
+    jumpTable.reset(maskWidth_);
+
     std::size_t storedKmers = 0;
-    while(reference_.end() != current)
+    while(!source.empty() && mask == getMask(source.front().getKmer()))
     {
-        std::pair<typename std::vector<ReferenceKmer<KmerT> >::iterator,
-                  typename std::vector<ReferenceKmer<KmerT> >::iterator> sameKmerRange =
-                std::equal_range(current, reference_.end(), *current, &compareKmer<KmerT>);
-        const std::size_t kmerMatches = std::distance(sameKmerRange.first, sameKmerRange.second);
-
-        // the kmers we want to store are those that don't have the neighbors flag set by loadReference.
-        const typename std::vector<ReferenceKmer<KmerT> >::const_iterator firstToStore =
-            std::find_if(sameKmerRange.first, sameKmerRange.second,
-                         boost::bind(&ReferenceKmer<KmerT>::hasNoNeighbors, _1));
+        const KmerT kmer = source.front().getKmer();
+        // occurrences past the repeat threshold are only counted
+        sameKmer.clear();
+        std::size_t kmerMatches = 0;
+        // the kmers we want to store are those that don't have the neighbors flag set by generateKmers.
+        // The forward ones can be anywhere in the range, including past the occurrences kept in sameKmer
+        bool anyToStore = false;
+        for (; !source.empty() && kmer == source.front().getKmer(); source.pop())
+        {
+            anyToStore = anyToStore || source.front().hasNoNeighbors();
+            if (repeatThreshold_ >= kmerMatches)
+            {
+                sameKmer.push_back(source.front());
+            }
+            ++kmerMatches;
+        }
 
-        if (firstToStore != sameKmerRange.second)
+        if (anyToStore)
         {
             if (repeatThreshold_ < kmerMatches)
             {
-                std::cerr << "Skipping kmer " << oligo::bases(current->getKmer()) << " as it generates " << kmerMatches << "matches\n";
+                std::cerr << "Skipping kmer " << oligo::bases(kmer) << " as it generates " << kmerMatches << "matches\n";
 
                 static const ReferencePosition tooManyMatchPosition(ReferencePosition::TooManyMatch);
-                const ReferenceKmer<KmerT> tooManyMatchKmer(sameKmerRange.first->getKmer(), tooManyMatchPosition);
-                //std::cerr << std::hex << referenceKmer.first << '\t' << referenceKmer.second << '\n';
+                const ReferenceKmerType tooManyMatchKmer(kmer, tooManyMatchPosition);
                 if (!os.write(reinterpret_cast<const char*>(&tooManyMatchKmer), sizeof(tooManyMatchKmer)))
                 {
-                    BOOST_THROW_EXCEPTION(common::IoException(errno,"Failed to write toomanymatch reference kmer into " + outputFile_.string()));
+                    BOOST_THROW_EXCEPTION(common::IoException(errno,"Failed to write toomanymatch reference kmer into " + outputFile.string()));
                 }
+                jumpTable.add(tooManyMatchKmer.getKmer());
                 ++storedKmers;
             }
             else
             {
+                // below the repeat threshold, sameKmer has all the occurrences
+                const typename ReferenceKmers::const_iterator firstToStore =
+                    std::find_if(sameKmer.begin(), sameKmer.end(), boost::bind(&ReferenceKmerType::hasNoNeighbors, _1));
                 const bool kmerHasNeighbors =
                     // neighborhood annotation is available
                     !neighbors.empty() &&
                     neighbors.at(contigOffsets.at(firstToStore->getReferencePosition().getContigId()) +
                                  firstToStore->getReferencePosition().getPosition());
 
-                BOOST_FOREACH(ReferenceKmer<KmerT> referenceKmer, sameKmerRange)
+                BOOST_FOREACH(ReferenceKmerType referenceKmer, sameKmer)
                 {
-                    // the kmers we want to store are those that don't have the neighbors flag set by loadReference.
+                    // the kmers we want to store are those that don't have the neighbors flag set by generateKmers.
                     if (referenceKmer.hasNoNeighbors())
                     {
                         if (kmerHasNeighbors)
@@ -239,25 +507,21 @@ void ReferenceSorter<KmerT>::saveReference(
                         }
                         if (!os.write(reinterpret_cast<const char*>(&referenceKmer), sizeof(referenceKmer)))
                         {
-                            BOOST_THROW_EXCEPTION(common::IoException(errno,"Failed to write reference kmer into " + outputFile_.string()));
+                            BOOST_THROW_EXCEPTION(common::IoException(errno,"Failed to write reference kmer into " + outputFile.string()));
                         }
+                        jumpTable.add(referenceKmer.getKmer());
                         ++storedKmers;
                     }
                 }
             }
-
         }
-
-        current = sameKmerRange.second;
     }
     os.flush();
     os.close();
-    std::cerr << "Saving " << storedKmers << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers with " <<
-        neighborKmers << " neighbors done in " << (clock() - start) / 1000 << "ms" << std::endl;
-
-    SortedReferenceMetadata sortedReference;
-    sortedReference.addMaskFile(oligo::KmerTraits<KmerT>::KMER_BASES, maskWidth_, mask_, outputFile_, storedKmers);
-    saveSortedReferenceXml(std::cout, sortedReference);
+    jumpTable.save(outputFile);
+    ISAAC_THREAD_CERR << "Saving " << storedKmers << " " << oligo::KmerTraits<KmerT>::KMER_BASES << "-mers done in " <<
+        (clock() - start) / 1000 << "ms" << std::endl;
+    return storedKmers;
 }
 
 template class ReferenceSorter<oligo::ShortKmerType>;
@@ -24,6 +24,7 @@
 #include "config.h"
 #include "common/Debug.hh"
 #include "common/Exceptions.hh"
+#include "reference/GenomeImage.hh"
 #include "reference/SortedReferenceXml.hh"
 #include "xml/XmlReader.hh"
 #include "xml/XmlWriter.hh"
@@ -203,14 +204,19 @@ SortedReferenceMetadata loadSortedReferenceXml(
 SortedReferenceMetadata loadSortedReferenceXml(
     const boost::filesystem::path &xmlPath)
 {
-    SortedReferenceMetadata ret;
     std::ifstream is(xmlPath.c_str());
     if (!is)
     {
         BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open sorted reference file " + xmlPath.string()));
     }
 
-    return loadSortedReferenceXml(is);
+    SortedReferenceMetadata ret = loadSortedReferenceXml(is);
+    const boost::filesystem::path genomeImagePath = GenomeImage::getPath(xmlPath);
+    if (boost::filesystem::exists(genomeImagePath))
+    {
+        ret.setGenomeImagePath(genomeImagePath);
+    }
+    return ret;
 }
 
 void serialize(xml::XmlWriter &writer, const SortedReferenceMetadata::MaskFile &mf, const unsigned int version)
@@ -0,0 +1,144 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testContigCache.hh"
+
+#include "reference/ContigCache.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestContigCache, registryName("ContigCache"));
+
+static const std::string CHR1 = "ACGTACGTAC";
+static const std::string CHR2 = "GGGGCCCCAA";
+
+/// isMapped is true for the contigs of the only reference that are flagged
+struct ContigFilter
+{
+    std::vector<bool> contigs_;
+    ContigFilter(const bool chr1, const bool chr2)
+    {
+        contigs_.push_back(chr1);
+        contigs_.push_back(chr2);
+    }
+    bool isMapped(const unsigned, const unsigned contigIndex) const {return contigs_.at(contigIndex);}
+};
+
+static std::string getForward(const isaac::reference::ContigListsPtr &contigLists, const unsigned contigIndex)
+{
+    const std::vector<char> &forward = contigLists->at(0).at(contigIndex).forward_;
+    return std::string(forward.begin(), forward.end());
+}
+
+static void writeFasta(const boost::filesystem::path &fastaPath, const std::string &chr1, const std::string &chr2)
+{
+    std::ofstream os(fastaPath.c_str());
+    os << ">chr1\n" << chr1 << "\n>chr2\n" << chr2 << "\n";
+}
+
+void TestContigCache::setUp()
+{
+    fastaPath_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testContigCache-%%%%-%%%%.fa");
+    writeFasta(fastaPath_, CHR1, CHR2);
+
+    sortedReferenceMetadataList_.clear();
+    sortedReferenceMetadataList_.resize(1);
+    const unsigned long chr1Offset = 6;
+    const unsigned long chr2Offset = chr1Offset + CHR1.size() + 1 + 6;
+    sortedReferenceMetadataList_.front().putContig(
+        0, "chr1", fastaPath_, chr1Offset, CHR1.size() + 1, CHR1.size(), CHR1.size(), 0, 0, "", "", "");
+    sortedReferenceMetadataList_.front().putContig(
+        CHR1.size(), "chr2", fastaPath_, chr2Offset, CHR2.size() + 1, CHR2.size(), CHR2.size(), 1, 1, "", "", "");
+}
+
+void TestContigCache::tearDown()
+{
+    isaac::reference::ContigCache::setRetain(false);
+    isaac::reference::ContigCache::release();
+    boost::filesystem::remove(fastaPath_);
+}
+
+void TestContigCache::testSharedWhileHeld()
+{
+    isaac::common::ThreadVector threads(2);
+    const isaac::reference::ContigListsPtr first =
+        isaac::reference::ContigCache::get(sortedReferenceMetadataList_, ContigFilter(true, false), threads);
+    CPPUNIT_ASSERT_EQUAL(CHR1, getForward(first, 0));
+    CPPUNIT_ASSERT_EQUAL(std::string(), getForward(first, 1));
+
+    // the first consumer still holds the contigs. They must not change under it
+    const isaac::reference::ContigListsPtr second =
+        isaac::reference::ContigCache::get(sortedReferenceMetadataList_, ContigFilter(true, true), threads);
+    CPPUNIT_ASSERT(first != second);
+    CPPUNIT_ASSERT_EQUAL(CHR1, getForward(first, 0));
+    CPPUNIT_ASSERT_EQUAL(std::string(), getForward(first, 1));
+    CPPUNIT_ASSERT_EQUAL(CHR1, getForward(second, 0));
+    CPPUNIT_ASSERT_EQUAL(CHR2, getForward(second, 1));
+
+    // nothing is missing, the held contigs are shared
+    const isaac::reference::ContigListsPtr third =
+        isaac::reference::ContigCache::get(sortedReferenceMetadataList_, ContigFilter(false, true), threads);
+    CPPUNIT_ASSERT(second == third);
+}
+
+void TestContigCache::testTrimWhenUnused()
+{
+    isaac::common::ThreadVector threads(2);
+    {
+        const isaac::reference::ContigListsPtr first =
+            isaac::reference::ContigCache::get(sortedReferenceMetadataList_, ContigFilter(true, true), threads);
+        CPPUNIT_ASSERT_EQUAL(CHR1, getForward(first, 0));
+        CPPUNIT_ASSERT_EQUAL(CHR2, getForward(first, 1));
+    }
+
+    const isaac::reference::ContigListsPtr second =
+        isaac::reference::ContigCache::get(sortedReferenceMetadataList_, ContigFilter(false, true), threads);
+    CPPUNIT_ASSERT_EQUAL(std::string(), getForward(second, 0));
+    CPPUNIT_ASSERT_EQUAL(CHR2, getForward(second, 1));
+    // no genome image, nothing gets packed
+    CPPUNIT_ASSERT(second->at(0).at(1).packed_.empty());
+}
+
+void TestContigCache::testRetain()
+{
+    isaac::reference::ContigCache::setRetain(true);
+    isaac::common::ThreadVector threads(2);
+    const isaac::reference::ContigListsPtr first =
+        isaac::reference::ContigCache::get(sortedReferenceMetadataList_, ContigFilter(true, false), threads);
+    // all contigs get loaded for the subsequent jobs
+    CPPUNIT_ASSERT_EQUAL(CHR1, getForward(first, 0));
+    CPPUNIT_ASSERT_EQUAL(CHR2, getForward(first, 1));
+
+    isaac::reference::ContigCache::release();
+    const isaac::reference::ContigListsPtr second =
+        isaac::reference::ContigCache::get(sortedReferenceMetadataList_, ContigFilter(false, true), threads);
+    CPPUNIT_ASSERT(first == second);
+
+    // same layout, different bases
+    const std::string chr1 = "TTTTAAAACC";
+    const std::string chr2 = "CATGCATGCA";
+    writeFasta(fastaPath_, chr1, chr2);
+    boost::filesystem::last_write_time(fastaPath_, boost::filesystem::last_write_time(fastaPath_) + 1);
+    const isaac::reference::ContigListsPtr third =
+        isaac::reference::ContigCache::get(sortedReferenceMetadataList_, ContigFilter(true, false), threads);
+    CPPUNIT_ASSERT(first != third);
+    CPPUNIT_ASSERT_EQUAL(chr1, getForward(third, 0));
+    CPPUNIT_ASSERT_EQUAL(chr2, getForward(third, 1));
+    // the consumers of the old contigs keep them
+    CPPUNIT_ASSERT_EQUAL(CHR1, getForward(first, 0));
+}
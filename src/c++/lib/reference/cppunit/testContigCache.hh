@@ -0,0 +1,42 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_CONTIG_CACHE_HH
+#define iSAAC_REFERENCE_TEST_CONTIG_CACHE_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "reference/SortedReferenceMetadata.hh"
+
+class TestContigCache : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestContigCache );
+    CPPUNIT_TEST( testSharedWhileHeld );
+    CPPUNIT_TEST( testTrimWhenUnused );
+    CPPUNIT_TEST( testRetain );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path fastaPath_;
+    isaac::reference::SortedReferenceMetadataList sortedReferenceMetadataList_;
+public:
+    void setUp();
+    void tearDown();
+    void testSharedWhileHeld();
+    void testTrimWhenUnused();
+    void testRetain();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_CONTIG_CACHE_HH
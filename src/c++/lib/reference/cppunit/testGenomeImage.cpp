@@ -0,0 +1,158 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testGenomeImage.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestGenomeImage, registryName("GenomeImage"));
+
+static void setForward(isaac::reference::Contig &contig, const std::string &bases)
+{
+    contig.forward_.assign(bases.begin(), bases.end());
+}
+
+void TestGenomeImage::setUp()
+{
+    imagePath_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testGenomeImage-%%%%-%%%%.dat");
+    fastaPath_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testGenomeImage-%%%%-%%%%.fa");
+    // only the size and modification time of the fasta matter to the image
+    std::ofstream(fastaPath_.c_str()) << ">chr1\nGATTACA\n";
+    contigs_.clear();
+    // loaded in karyotype order which is different from the index order
+    contigs_.push_back(isaac::reference::Contig(1, "chr2"));
+    setForward(contigs_.back(), "NNNNACGTTGCANNNNNNNNNNACGGTACCATGNNAC");
+    contigs_.push_back(isaac::reference::Contig(0, "chr1"));
+    setForward(contigs_.back(), "GATTACA");
+    contigs_.push_back(isaac::reference::Contig(2, "chr3"));
+    setForward(contigs_.back(), "");
+
+    xmlContigs_.clear();
+    xmlContigs_.resize(contigs_.size());
+    for (std::size_t index = 0; contigs_.size() > index; ++index)
+    {
+        isaac::reference::SortedReferenceMetadata::Contig &xmlContig = xmlContigs_[index];
+        xmlContig.index_ = contigs_[index].index_;
+        xmlContig.filePath_ = fastaPath_;
+        xmlContig.offset_ = index * 100;
+        xmlContig.totalBases_ = contigs_[index].forward_.size();
+        xmlContig.acgtBases_ = xmlContig.totalBases_ -
+            std::count(contigs_[index].forward_.begin(), contigs_[index].forward_.end(), 'N');
+    }
+    isaac::reference::GenomeImage::write(imagePath_, xmlContigs_, contigs_);
+}
+
+void TestGenomeImage::tearDown()
+{
+    boost::filesystem::remove(imagePath_);
+    boost::filesystem::remove(fastaPath_);
+}
+
+void TestGenomeImage::testRoundTrip()
+{
+    const isaac::reference::GenomeImage image(imagePath_);
+    CPPUNIT_ASSERT_EQUAL(3U, image.getContigCount());
+    BOOST_FOREACH(const isaac::reference::Contig &contig, contigs_)
+    {
+        CPPUNIT_ASSERT_EQUAL(contig.forward_.size(), std::size_t(image.getContigLength(contig.index_)));
+        std::vector<char> forward;
+        image.unpack(contig.index_, 0, contig.forward_.size(), forward);
+        CPPUNIT_ASSERT_EQUAL(std::string(contig.forward_.begin(), contig.forward_.end()),
+                             std::string(forward.begin(), forward.end()));
+        for (std::size_t position = 0; contig.forward_.size() > position; ++position)
+        {
+            CPPUNIT_ASSERT_EQUAL(contig.forward_[position], image.getBase(contig.index_, position));
+        }
+    }
+}
+
+void TestGenomeImage::testPartialUnpack()
+{
+    const isaac::reference::GenomeImage image(imagePath_);
+    const std::vector<char> &expected = contigs_.front().forward_;
+    for (std::size_t begin = 0; expected.size() >= begin; ++begin)
+    {
+        for (std::size_t end = begin; expected.size() >= end; ++end)
+        {
+            std::vector<char> forward(1, 'X');
+            image.unpack(1, begin, end, forward);
+            CPPUNIT_ASSERT_EQUAL("X" + std::string(expected.begin() + begin, expected.begin() + end),
+                                 std::string(forward.begin(), forward.end()));
+        }
+    }
+}
+
+void TestGenomeImage::testMatches()
+{
+    const isaac::reference::GenomeImage image(imagePath_);
+    isaac::reference::SortedReferenceMetadata::Contigs xmlContigs = xmlContigs_;
+    CPPUNIT_ASSERT(image.matches(xmlContigs));
+    xmlContigs[1].totalBases_ = 8;
+    CPPUNIT_ASSERT(!image.matches(xmlContigs));
+    xmlContigs = xmlContigs_;
+    xmlContigs[0].acgtBases_ = xmlContigs[0].totalBases_;
+    CPPUNIT_ASSERT(!image.matches(xmlContigs));
+    xmlContigs = xmlContigs_;
+    xmlContigs[2].offset_ = 1;
+    CPPUNIT_ASSERT(!image.matches(xmlContigs));
+    xmlContigs = xmlContigs_;
+    xmlContigs.pop_back();
+    CPPUNIT_ASSERT(!image.matches(xmlContigs));
+}
+
+void TestGenomeImage::testStaleFasta()
+{
+    const isaac::reference::GenomeImage image(imagePath_);
+    CPPUNIT_ASSERT(image.matches(xmlContigs_));
+    boost::filesystem::last_write_time(fastaPath_, boost::filesystem::last_write_time(fastaPath_) + 1);
+    CPPUNIT_ASSERT(!image.matches(xmlContigs_));
+    boost::filesystem::last_write_time(fastaPath_, boost::filesystem::last_write_time(fastaPath_) - 1);
+    CPPUNIT_ASSERT(image.matches(xmlContigs_));
+    std::ofstream(fastaPath_.c_str(), std::ios_base::app) << "A\n";
+    boost::filesystem::last_write_time(fastaPath_, boost::filesystem::last_write_time(fastaPath_) - 1);
+    CPPUNIT_ASSERT(!image.matches(xmlContigs_));
+    boost::filesystem::remove(fastaPath_);
+    CPPUNIT_ASSERT(!image.matches(xmlContigs_));
+}
+
+void TestGenomeImage::testWrap()
+{
+    isaac::oligo::PackedSequence packed;
+    {
+        const boost::shared_ptr<const isaac::reference::GenomeImage> image(new isaac::reference::GenomeImage(imagePath_));
+        image->wrap(1, image, packed);
+    }
+    // the view keeps the mapping alive
+    const std::vector<char> &forward = contigs_.front().forward_;
+    isaac::oligo::PackedSequence expected;
+    expected.assign(forward.begin(), forward.end());
+    CPPUNIT_ASSERT(packed.isView());
+    CPPUNIT_ASSERT_EQUAL(expected.size(), packed.size());
+    for (std::size_t position = 0; forward.size() > position; ++position)
+    {
+        CPPUNIT_ASSERT_EQUAL(expected.getBases(position), packed.getBases(position));
+        CPPUNIT_ASSERT_EQUAL(expected.getNLanes(position), packed.getNLanes(position));
+        for (std::size_t end = position; forward.size() >= end; ++end)
+        {
+            CPPUNIT_ASSERT_EQUAL(expected.hasN(position, end), packed.hasN(position, end));
+        }
+    }
+}
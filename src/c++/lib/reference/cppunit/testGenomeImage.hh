@@ -0,0 +1,47 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_GENOME_IMAGE_HH
+#define iSAAC_REFERENCE_TEST_GENOME_IMAGE_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+#include "reference/GenomeImage.hh"
+
+class TestGenomeImage : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestGenomeImage );
+    CPPUNIT_TEST( testRoundTrip );
+    CPPUNIT_TEST( testPartialUnpack );
+    CPPUNIT_TEST( testMatches );
+    CPPUNIT_TEST( testStaleFasta );
+    CPPUNIT_TEST( testWrap );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path imagePath_;
+    boost::filesystem::path fastaPath_;
+    std::vector<isaac::reference::Contig> contigs_;
+    isaac::reference::SortedReferenceMetadata::Contigs xmlContigs_;
+public:
+    void setUp();
+    void tearDown();
+    void testRoundTrip();
+    void testPartialUnpack();
+    void testMatches();
+    void testStaleFasta();
+    void testWrap();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_GENOME_IMAGE_HH
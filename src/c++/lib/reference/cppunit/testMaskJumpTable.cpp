@@ -0,0 +1,167 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testMaskJumpTable.hh"
+
+#include "common/Exceptions.hh"
+#include "reference/MaskJumpTable.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestMaskJumpTable, registryName("MaskJumpTable"));
+
+typedef isaac::oligo::KmerType KmerType;
+typedef isaac::reference::MaskJumpTable<KmerType> MaskJumpTable;
+static const unsigned MASK_WIDTH = 6;
+static const unsigned UNMASKED_BITS = isaac::oligo::KmerTraits<KmerType>::KMER_BITS - MASK_WIDTH;
+static const KmerType MASK = KmerType(0x2A) << UNMASKED_BITS;
+
+void TestMaskJumpTable::setUp()
+{
+    srand(0);
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testMaskJumpTable-%%%%-%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+    maskFilePath_ = tempDirectory_ / "mask.dat";
+}
+
+void TestMaskJumpTable::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+static KmerType randomKmer()
+{
+    const KmerType unmasked = (KmerType(rand()) << 40) ^ (KmerType(rand()) << 20) ^ KmerType(rand());
+    return MASK | (unmasked & ((KmerType(1) << UNMASKED_BITS) - 1));
+}
+
+static void checkRange(const MaskJumpTable &table, const KmerType kmer, const std::size_t first, const std::size_t second)
+{
+    const std::pair<std::size_t, std::size_t> range = table.getBucketRange(kmer);
+    CPPUNIT_ASSERT_EQUAL(first, range.first);
+    CPPUNIT_ASSERT_EQUAL(second, range.second);
+}
+
+static void buildTable(const boost::filesystem::path &maskFilePath, const std::vector<KmerType> &kmers)
+{
+    MaskJumpTable table;
+    table.reset(MASK_WIDTH);
+    for (std::vector<KmerType>::const_iterator it = kmers.begin(); kmers.end() != it; ++it)
+    {
+        table.add(*it);
+    }
+    table.save(maskFilePath);
+}
+
+/**
+ * \brief every kmer must be found in its bucket range and the range must not skip any kmer of the bucket
+ */
+static void checkRanges(const MaskJumpTable &table, const std::vector<KmerType> &kmers, const KmerType kmer)
+{
+    const std::pair<std::size_t, std::size_t> range = table.getBucketRange(kmer);
+    CPPUNIT_ASSERT(range.first <= range.second);
+    CPPUNIT_ASSERT(kmers.size() >= range.second);
+    const std::size_t lowerBound = std::lower_bound(kmers.begin(), kmers.end(), kmer) - kmers.begin();
+    CPPUNIT_ASSERT(range.first <= lowerBound);
+    CPPUNIT_ASSERT(range.second >= lowerBound);
+    const std::size_t upperBound = std::upper_bound(kmers.begin(), kmers.end(), kmer) - kmers.begin();
+    CPPUNIT_ASSERT(range.second >= upperBound);
+}
+
+void TestMaskJumpTable::testBuildLoad()
+{
+    std::vector<KmerType> kmers;
+    for (unsigned i = 0; 100000 > i; ++i)
+    {
+        kmers.push_back(randomKmer());
+    }
+    // repeats
+    kmers.insert(kmers.end(), kmers.begin(), kmers.begin() + 1000);
+    std::sort(kmers.begin(), kmers.end());
+    buildTable(maskFilePath_, kmers);
+
+    MaskJumpTable table;
+    CPPUNIT_ASSERT(table.empty());
+    CPPUNIT_ASSERT(table.load(maskFilePath_, kmers.size(), MASK_WIDTH));
+    CPPUNIT_ASSERT(!table.empty());
+
+    for (std::vector<KmerType>::const_iterator it = kmers.begin(); kmers.end() != it; ++it)
+    {
+        checkRanges(table, kmers, *it);
+        const std::pair<std::size_t, std::size_t> range = table.getBucketRange(*it);
+        CPPUNIT_ASSERT(std::size_t(it - kmers.begin()) >= range.first);
+        CPPUNIT_ASSERT(std::size_t(it - kmers.begin()) < range.second);
+    }
+    // kmers that are not in the mask file
+    for (unsigned i = 0; 10000 > i; ++i)
+    {
+        checkRanges(table, kmers, randomKmer());
+    }
+    checkRanges(table, kmers, MASK);
+}
+
+void TestMaskJumpTable::testLastKmer()
+{
+    const KmerType lastKmer = MASK | ((KmerType(1) << UNMASKED_BITS) - 1);
+    std::vector<KmerType> kmers;
+    kmers.push_back(MASK);
+    kmers.push_back(MASK | 1);
+    kmers.push_back(lastKmer);
+    kmers.push_back(lastKmer);
+    buildTable(maskFilePath_, kmers);
+
+    MaskJumpTable table;
+    CPPUNIT_ASSERT(table.load(maskFilePath_, kmers.size(), MASK_WIDTH));
+    // the last bucket ends at the end of the mask file
+    checkRange(table, lastKmer, 2, 4);
+    checkRange(table, MASK, 0, 2);
+    // buckets between the stored kmers are empty
+    const std::pair<std::size_t, std::size_t> middle = table.getBucketRange(MASK | (KmerType(1) << (UNMASKED_BITS - 1)));
+    CPPUNIT_ASSERT_EQUAL(middle.first, middle.second);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(2), middle.first);
+}
+
+void TestMaskJumpTable::testEmptyMask()
+{
+    buildTable(maskFilePath_, std::vector<KmerType>());
+
+    MaskJumpTable table;
+    CPPUNIT_ASSERT(table.load(maskFilePath_, 0, MASK_WIDTH));
+    CPPUNIT_ASSERT(!table.empty());
+    checkRange(table, MASK, 0, 0);
+    checkRange(table, ~KmerType(0), 0, 0);
+}
+
+void TestMaskJumpTable::testMismatch()
+{
+    std::vector<KmerType> kmers;
+    kmers.push_back(MASK | 5);
+    kmers.push_back(MASK | 7);
+    buildTable(maskFilePath_, kmers);
+
+    MaskJumpTable table;
+    // no table for the mask file
+    CPPUNIT_ASSERT(!table.load(tempDirectory_ / "other.dat", kmers.size(), MASK_WIDTH));
+    CPPUNIT_ASSERT(table.empty());
+    // mask file has changed since the table was built
+    CPPUNIT_ASSERT(!table.load(maskFilePath_, kmers.size() + 1, MASK_WIDTH));
+    CPPUNIT_ASSERT(table.empty());
+    CPPUNIT_ASSERT_THROW(table.load(maskFilePath_, kmers.size(), MASK_WIDTH + 2), isaac::common::InvalidParameterException);
+    CPPUNIT_ASSERT(table.empty());
+    CPPUNIT_ASSERT(table.load(maskFilePath_, kmers.size(), MASK_WIDTH));
+}
@@ -0,0 +1,41 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_MASK_JUMP_TABLE_HH
+#define iSAAC_REFERENCE_TEST_MASK_JUMP_TABLE_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <boost/filesystem.hpp>
+
+class TestMaskJumpTable : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestMaskJumpTable );
+    CPPUNIT_TEST( testBuildLoad );
+    CPPUNIT_TEST( testLastKmer );
+    CPPUNIT_TEST( testEmptyMask );
+    CPPUNIT_TEST( testMismatch );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path tempDirectory_;
+    boost::filesystem::path maskFilePath_;
+public:
+    void setUp();
+    void tearDown();
+    void testBuildLoad();
+    void testLastKmer();
+    void testEmptyMask();
+    void testMismatch();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_MASK_JUMP_TABLE_HH
@@ -0,0 +1,193 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testReferenceExtender.hh"
+
+#include "reference/ReferenceExtender.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestReferenceExtender, registryName("ReferenceExtender"));
+
+using isaac::reference::ReferencePosition;
+using isaac::reference::SortedReferenceMetadata;
+typedef isaac::oligo::ShortKmerType KmerType;
+
+static const unsigned SEED_LENGTH = isaac::oligo::KmerTraits<KmerType>::KMER_BASES;
+static const unsigned MASK_WIDTH = 1;
+// mask 0 kmers whose reverse complements don't collide with any of the others
+static const KmerType X = 0x0F0F1E1E;
+static const KmerType Y = 0x1234ABCD;
+static const KmerType Z = 0x3C3C5A5A;
+
+void TestReferenceExtender::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testReferenceExtender-%%%%-%%%%");
+    boost::filesystem::create_directories(tempDirectory_ / "output");
+}
+
+void TestReferenceExtender::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+SortedReferenceMetadata TestReferenceExtender::makeReference(
+    const std::string &name, const unsigned contigs, ReferenceKmers kmers) const
+{
+    std::sort(kmers.begin(), kmers.end(), &isaac::reference::compareKmerAndPosition<KmerType>);
+    SortedReferenceMetadata ret;
+    for (unsigned mask = 0; (1U << MASK_WIDTH) > mask; ++mask)
+    {
+        const boost::filesystem::path path = tempDirectory_ / (name + char('0' + mask) + ".dat");
+        std::ofstream os(path.c_str());
+        std::size_t count = 0;
+        BOOST_FOREACH(const ReferenceKmer &kmer, kmers)
+        {
+            if (mask == (kmer.getKmer() >> (SEED_LENGTH * 2 - MASK_WIDTH)))
+            {
+                os.write(reinterpret_cast<const char *>(&kmer), sizeof(kmer));
+                ++count;
+            }
+        }
+        ret.addMaskFile(SEED_LENGTH, MASK_WIDTH, mask, path, count);
+    }
+    for (unsigned contig = 0; contigs > contig; ++contig)
+    {
+        ret.putContig(contig * 100, name + char('0' + contig), tempDirectory_ / (name + ".fa"),
+                      0, 0, 100, 100, contig, contig, "", "", "");
+    }
+    return ret;
+}
+
+SortedReferenceMetadata TestReferenceExtender::extend(
+    const ReferenceKmers &existing, const ReferenceKmers &added,
+    const unsigned repeatThreshold, const bool annotate) const
+{
+    const SortedReferenceMetadata reference = makeReference("existing", 2, existing);
+    const SortedReferenceMetadata delta = makeReference("added", 1, added);
+    isaac::reference::ReferenceExtender<KmerType> extender(
+        reference, delta, tempDirectory_ / "output", repeatThreshold, annotate, false, 2);
+    return extender.run();
+}
+
+TestReferenceExtender::ReferenceKmers TestReferenceExtender::load(const SortedReferenceMetadata &reference) const
+{
+    ReferenceKmers ret;
+    BOOST_FOREACH(const SortedReferenceMetadata::MaskFile &maskFile, reference.getMaskFileList(SEED_LENGTH))
+    {
+        CPPUNIT_ASSERT(boost::filesystem::exists(maskFile.path.string() + ".jump"));
+        std::ifstream is(maskFile.path.c_str());
+        ReferenceKmer kmer;
+        std::size_t count = 0;
+        while (is.read(reinterpret_cast<char *>(&kmer), sizeof(kmer)))
+        {
+            ret.push_back(kmer);
+            ++count;
+        }
+        CPPUNIT_ASSERT_EQUAL(maskFile.kmers, count);
+    }
+    return ret;
+}
+
+void TestReferenceExtender::testRepeats()
+{
+    ReferenceKmers existing;
+    existing.push_back(ReferenceKmer(X, ReferencePosition(0, 1)));
+    existing.push_back(ReferenceKmer(Y, ReferencePosition(0, 2)));
+    existing.push_back(ReferenceKmer(Y, ReferencePosition(1, 3)));
+    existing.push_back(ReferenceKmer(Z, ReferencePosition(ReferencePosition::TooManyMatch)));
+    ReferenceKmers added;
+    added.push_back(ReferenceKmer(X, ReferencePosition(0, 7)));
+    added.push_back(ReferenceKmer(Y, ReferencePosition(0, 8)));
+    added.push_back(ReferenceKmer(Z, ReferencePosition(0, 9)));
+    added.push_back(ReferenceKmer(Z + 1, ReferencePosition(0, 4)));
+
+    const ReferenceKmers result = load(extend(existing, added, 2, false));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(5), result.size());
+    // added positions follow the existing ones and refer to the contigs past the existing ones
+    CPPUNIT_ASSERT_EQUAL(X, result[0].getKmer());
+    CPPUNIT_ASSERT_EQUAL(ReferencePosition(0, 1), result[0].getReferencePosition());
+    CPPUNIT_ASSERT_EQUAL(X, result[1].getKmer());
+    CPPUNIT_ASSERT_EQUAL(ReferencePosition(2, 7), result[1].getReferencePosition());
+    // three occurrences exceed the threshold of 2
+    CPPUNIT_ASSERT_EQUAL(Y, result[2].getKmer());
+    CPPUNIT_ASSERT(result[2].getReferencePosition().isTooManyMatch());
+    // stays TooManyMatch
+    CPPUNIT_ASSERT_EQUAL(Z, result[3].getKmer());
+    CPPUNIT_ASSERT(result[3].getReferencePosition().isTooManyMatch());
+    CPPUNIT_ASSERT_EQUAL(Z + 1, result[4].getKmer());
+    CPPUNIT_ASSERT_EQUAL(ReferencePosition(2, 4), result[4].getReferencePosition());
+}
+
+void TestReferenceExtender::testReverseComplementRepeats()
+{
+    const KmerType reverseX = isaac::oligo::reverseComplement(X);
+    ReferenceKmers existing;
+    existing.push_back(ReferenceKmer(X, ReferencePosition(0, 1)));
+    existing.push_back(ReferenceKmer(Y, ReferencePosition(0, 2)));
+    ReferenceKmers added;
+    // reverse complement occurrences count towards the repeats of X
+    added.push_back(ReferenceKmer(reverseX, ReferencePosition(0, 5)));
+    added.push_back(ReferenceKmer(reverseX, ReferencePosition(0, 6)));
+
+    const ReferenceKmers result = load(extend(existing, added, 2, false));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), result.size());
+    BOOST_FOREACH(const ReferenceKmer &kmer, result)
+    {
+        CPPUNIT_ASSERT_EQUAL(Y == kmer.getKmer(), !kmer.getReferencePosition().isTooManyMatch());
+    }
+}
+
+void TestReferenceExtender::testNeighbors()
+{
+    ReferenceKmers existing;
+    existing.push_back(ReferenceKmer(X, ReferencePosition(0, 1)));
+    existing.push_back(ReferenceKmer(Y, ReferencePosition(0, 2, true)));
+    ReferenceKmers added;
+    // one mismatch away from X
+    added.push_back(ReferenceKmer(X ^ 1, ReferencePosition(0, 3)));
+    added.push_back(ReferenceKmer(Z, ReferencePosition(0, 4)));
+
+    const ReferenceKmers result = load(extend(existing, added, 10, true));
+    CPPUNIT_ASSERT_EQUAL(std::size_t(4), result.size());
+    BOOST_FOREACH(const ReferenceKmer &kmer, result)
+    {
+        // existing flags are preserved, both ends of the new neighborhood are flagged
+        CPPUNIT_ASSERT_EQUAL(Z != kmer.getKmer(), kmer.getReferencePosition().hasNeighbors());
+    }
+}
+
+void TestReferenceExtender::testContigs()
+{
+    ReferenceKmers existing(1, ReferenceKmer(X, ReferencePosition(0, 1)));
+    ReferenceKmers added(1, ReferenceKmer(Y, ReferencePosition(0, 1)));
+    const SortedReferenceMetadata result = extend(existing, added, 10, false);
+    const SortedReferenceMetadata::Contigs &contigs = result.getContigs();
+    CPPUNIT_ASSERT_EQUAL(std::size_t(3), contigs.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("added0"), contigs[2].name_);
+    CPPUNIT_ASSERT_EQUAL(2U, contigs[2].index_);
+    CPPUNIT_ASSERT_EQUAL(2U, contigs[2].karyotypeIndex_);
+    CPPUNIT_ASSERT_EQUAL(200UL, contigs[2].genomicPosition_);
+    BOOST_FOREACH(const SortedReferenceMetadata::MaskFile &maskFile, result.getMaskFileList(SEED_LENGTH))
+    {
+        CPPUNIT_ASSERT(tempDirectory_ / "output" == maskFile.path.parent_path());
+    }
+}
@@ -0,0 +1,53 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_REFERENCE_EXTENDER_HH
+#define iSAAC_REFERENCE_TEST_REFERENCE_EXTENDER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "reference/ReferenceKmer.hh"
+#include "reference/SortedReferenceMetadata.hh"
+
+class TestReferenceExtender : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestReferenceExtender );
+    CPPUNIT_TEST( testRepeats );
+    CPPUNIT_TEST( testReverseComplementRepeats );
+    CPPUNIT_TEST( testNeighbors );
+    CPPUNIT_TEST( testContigs );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    typedef isaac::reference::ReferenceKmer<isaac::oligo::ShortKmerType> ReferenceKmer;
+    typedef std::vector<ReferenceKmer> ReferenceKmers;
+    boost::filesystem::path tempDirectory_;
+
+    isaac::reference::SortedReferenceMetadata makeReference(
+        const std::string &name, const unsigned contigs, ReferenceKmers kmers) const;
+    isaac::reference::SortedReferenceMetadata extend(
+        const ReferenceKmers &existing, const ReferenceKmers &added,
+        const unsigned repeatThreshold, const bool annotate) const;
+    ReferenceKmers load(const isaac::reference::SortedReferenceMetadata &reference) const;
+public:
+    void setUp();
+    void tearDown();
+    void testRepeats();
+    void testReverseComplementRepeats();
+    void testNeighbors();
+    void testContigs();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_REFERENCE_EXTENDER_HH
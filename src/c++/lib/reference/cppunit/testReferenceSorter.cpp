@@ -0,0 +1,124 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testReferenceSorter.hh"
+
+#include "oligo/Nucleotides.hh"
+#include "reference/ReferenceSorter.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestReferenceSorter, registryName("ReferenceSorter"));
+
+using isaac::reference::ReferencePosition;
+typedef isaac::oligo::ShortKmerType KmerType;
+
+static const unsigned MASK_WIDTH = 1;
+static const std::string KMER = "AACCGGTTACGTAGCA";
+static const std::string KMER_REVERSE_COMPLEMENT = "TGCTACGTAACCGGTT";
+
+void TestReferenceSorter::setUp()
+{
+    tempDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testReferenceSorter-%%%%-%%%%");
+    boost::filesystem::create_directories(tempDirectory_);
+}
+
+void TestReferenceSorter::tearDown()
+{
+    boost::filesystem::remove_all(tempDirectory_);
+}
+
+TestReferenceSorter::ReferenceKmers TestReferenceSorter::sort(
+    const std::string &contig, const unsigned repeatThreshold, const std::string &kmer) const
+{
+    const boost::filesystem::path genomeFile = tempDirectory_ / "genome.fa";
+    {
+        std::ofstream os(genomeFile.c_str());
+        os << ">chr1\n" << contig << "\n";
+    }
+    std::vector<unsigned long> masks;
+    std::vector<boost::filesystem::path> outputFiles;
+    for (unsigned mask = 0; (1U << MASK_WIDTH) > mask; ++mask)
+    {
+        masks.push_back(mask);
+        outputFiles.push_back(tempDirectory_ / (std::string("mask") + char('0' + mask) + ".dat"));
+    }
+
+    {
+        // the sorter prints the metadata xml into the standard output
+        std::ostringstream xml;
+        std::streambuf *const coutBuf = std::cout.rdbuf(xml.rdbuf());
+        try
+        {
+            isaac::reference::ReferenceSorter<KmerType> sorter(
+                MASK_WIDTH, masks, genomeFile, "", outputFiles, repeatThreshold, tempDirectory_, 0, 2);
+            sorter.run();
+        }
+        catch (...)
+        {
+            std::cout.rdbuf(coutBuf);
+            throw;
+        }
+        std::cout.rdbuf(coutBuf);
+    }
+
+    KmerType kmerValue = 0;
+    BOOST_FOREACH(const char base, kmer)
+    {
+        kmerValue = (kmerValue << isaac::oligo::BITS_PER_BASE) | isaac::oligo::getValue(base);
+    }
+
+    ReferenceKmers ret;
+    BOOST_FOREACH(const boost::filesystem::path &outputFile, outputFiles)
+    {
+        std::ifstream is(outputFile.c_str());
+        ReferenceKmer referenceKmer;
+        while (is.read(reinterpret_cast<char *>(&referenceKmer), sizeof(referenceKmer)))
+        {
+            if (kmerValue == referenceKmer.getKmer())
+            {
+                ret.push_back(referenceKmer);
+            }
+        }
+    }
+    return ret;
+}
+
+void TestReferenceSorter::testRepeatOnReverseStrandFirst()
+{
+    // three reverse strand occurrences precede the only forward one
+    const std::string contig =
+        KMER_REVERSE_COMPLEMENT + "N" + KMER_REVERSE_COMPLEMENT + "N" + KMER_REVERSE_COMPLEMENT + "N" + KMER;
+    const ReferenceKmers stored = sort(contig, 2, KMER);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), stored.size());
+    CPPUNIT_ASSERT(stored.front().getReferencePosition().isTooManyMatch());
+}
+
+void TestReferenceSorter::testBelowRepeatThreshold()
+{
+    const std::string contig = KMER_REVERSE_COMPLEMENT + "N" + KMER;
+    const ReferenceKmers stored = sort(contig, 2, KMER);
+    CPPUNIT_ASSERT_EQUAL(std::size_t(1), stored.size());
+    CPPUNIT_ASSERT(!stored.front().getReferencePosition().isTooManyMatch());
+    CPPUNIT_ASSERT_EQUAL(0UL, stored.front().getReferencePosition().getContigId());
+    CPPUNIT_ASSERT_EQUAL(static_cast<unsigned long>(KMER_REVERSE_COMPLEMENT.size() + 1), stored.front().getReferencePosition().getPosition());
+}
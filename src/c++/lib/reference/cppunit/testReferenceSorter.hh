@@ -0,0 +1,45 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_REFERENCE_TEST_REFERENCE_SORTER_HH
+#define iSAAC_REFERENCE_TEST_REFERENCE_SORTER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "reference/ReferenceKmer.hh"
+
+class TestReferenceSorter : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestReferenceSorter );
+    CPPUNIT_TEST( testRepeatOnReverseStrandFirst );
+    CPPUNIT_TEST( testBelowRepeatThreshold );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    typedef isaac::reference::ReferenceKmer<isaac::oligo::ShortKmerType> ReferenceKmer;
+    typedef std::vector<ReferenceKmer> ReferenceKmers;
+    boost::filesystem::path tempDirectory_;
+
+    /// sorts the single-contig genome and returns the stored occurrences of kmer
+    ReferenceKmers sort(const std::string &contig, const unsigned repeatThreshold, const std::string &kmer) const;
+public:
+    void setUp();
+    void tearDown();
+    void testRepeatOnReverseStrandFirst();
+    void testBelowRepeatThreshold();
+};
+
+#endif // #ifndef iSAAC_REFERENCE_TEST_REFERENCE_SORTER_HH
@@ -0,0 +1,204 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file BclTransposeKernel.cpp
+ **
+ ** \brief See BclTransposeKernel.hh. SSE2 is part of the baseline compiler flags, so it does not need
+ **        a separate translation unit.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "rta/BclTransposeKernel.hh"
+
+namespace isaac
+{
+namespace rta
+{
+
+const unsigned BclTransposeKernel::BLOCK_CLUSTERS;
+const unsigned BclTransposeKernel::SQUARE;
+
+BclTransposeKernel::BclTransposeKernel(const Implementation implementation)
+    : implementation_(selectImplementation(implementation))
+{
+}
+
+bool BclTransposeKernel::isSupported(const Implementation implementation)
+{
+    switch (implementation)
+    {
+    case Sse2:
+#ifdef __SSE2__
+        return true;
+#else
+        return false;
+#endif
+    case Auto:
+    case Scalar:
+        return true;
+    }
+    return false;
+}
+
+BclTransposeKernel::Implementation BclTransposeKernel::selectImplementation(const Implementation requested)
+{
+    if (Auto == requested)
+    {
+        return isSupported(Sse2) ? Sse2 : Scalar;
+    }
+    if (!isSupported(requested))
+    {
+        const std::string message = (boost::format("BclTransposeKernel: implementation %d is not supported by the build") % requested).str();
+        BOOST_THROW_EXCEPTION(isaac::common::InvalidParameterException(message));
+    }
+    return requested;
+}
+
+void BclTransposeKernel::transpose(
+    const char *firstCycle,
+    const unsigned long cycleStride,
+    const unsigned cycles,
+    const unsigned long clusters,
+    char *output,
+    const QScoreBinner *qScoreBinner) const
+{
+    ISAAC_ASSERT_MSG(1 == cycles || cycleStride >= clusters, "Cycles overlap. Stride: " << cycleStride << " clusters:" << clusters);
+    for (unsigned long blockBegin = 0; clusters > blockBegin; blockBegin += BLOCK_CLUSTERS)
+    {
+        const unsigned long blockEnd = std::min<unsigned long>(clusters, blockBegin + BLOCK_CLUSTERS);
+        if (Sse2 == implementation_)
+        {
+            transposeBlockSse2(firstCycle, cycleStride, cycles, blockBegin, blockEnd, output);
+        }
+        else
+        {
+            transposeScalar(firstCycle, cycleStride, cycles, 0, cycles, blockBegin, blockEnd, output);
+        }
+
+        if (qScoreBinner)
+        {
+            qScoreBinner->bin(output + blockBegin * cycles, output + blockEnd * cycles);
+        }
+    }
+}
+
+/**
+ * \brief Reference implementation. The vectorized one uses it for the bytes that don't fill a square.
+ */
+void BclTransposeKernel::transposeScalar(
+    const char *firstCycle, const unsigned long cycleStride, const unsigned cycles,
+    const unsigned cycleBegin, const unsigned cycleEnd,
+    const unsigned long clusterBegin, const unsigned long clusterEnd,
+    char *output)
+{
+    const char *cycleChunk = firstCycle + cycleBegin * cycleStride;
+    for (unsigned cycle = cycleBegin; cycleEnd > cycle; ++cycle, cycleChunk += cycleStride)
+    {
+        char *clusterCycle = output + clusterBegin * cycles + cycle;
+        for (unsigned long cluster = clusterBegin; clusterEnd > cluster; ++cluster, clusterCycle += cycles)
+        {
+            *clusterCycle = cycleChunk[cluster];
+        }
+    }
+}
+
+#ifdef __SSE2__
+
+/**
+ * \brief Turns 16 rows of 16 bytes into 16 columns. Each stage interleaves pairs of registers at twice the
+ *        width of the previous one.
+ */
+static void transposeSquare(__m128i rows[16])
+{
+    __m128i tmp[16];
+    for (unsigned i = 0; 8 > i; ++i)
+    {
+        tmp[i * 2] = _mm_unpacklo_epi8(rows[i * 2], rows[i * 2 + 1]);
+        tmp[i * 2 + 1] = _mm_unpackhi_epi8(rows[i * 2], rows[i * 2 + 1]);
+    }
+    for (unsigned i = 0; 4 > i; ++i)
+    {
+        rows[i * 4] = _mm_unpacklo_epi16(tmp[i * 4], tmp[i * 4 + 2]);
+        rows[i * 4 + 1] = _mm_unpackhi_epi16(tmp[i * 4], tmp[i * 4 + 2]);
+        rows[i * 4 + 2] = _mm_unpacklo_epi16(tmp[i * 4 + 1], tmp[i * 4 + 3]);
+        rows[i * 4 + 3] = _mm_unpackhi_epi16(tmp[i * 4 + 1], tmp[i * 4 + 3]);
+    }
+    // rows[i * 4 + j] now holds columns j * 4 to j * 4 + 3 of the rows i * 4 to i * 4 + 3
+    for (unsigned i = 0; 2 > i; ++i)
+    {
+        for (unsigned j = 0; 4 > j; ++j)
+        {
+            tmp[i * 8 + j * 2] = _mm_unpacklo_epi32(rows[i * 8 + j], rows[i * 8 + j + 4]);
+            tmp[i * 8 + j * 2 + 1] = _mm_unpackhi_epi32(rows[i * 8 + j], rows[i * 8 + j + 4]);
+        }
+    }
+    for (unsigned i = 0; 8 > i; ++i)
+    {
+        rows[i * 2] = _mm_unpacklo_epi64(tmp[i], tmp[i + 8]);
+        rows[i * 2 + 1] = _mm_unpackhi_epi64(tmp[i], tmp[i + 8]);
+    }
+}
+
+void BclTransposeKernel::transposeBlockSse2(
+    const char *firstCycle, const unsigned long cycleStride, const unsigned cycles,
+    const unsigned long blockBegin, const unsigned long blockEnd,
+    char *output)
+{
+    const unsigned squareCycles = cycles - cycles % SQUARE;
+    const unsigned long squareClustersEnd = blockEnd - (blockEnd - blockBegin) % SQUARE;
+    __m128i rows[SQUARE];
+    for (unsigned cycle = 0; squareCycles > cycle; cycle += SQUARE)
+    {
+        for (unsigned long cluster = blockBegin; squareClustersEnd > cluster; cluster += SQUARE)
+        {
+            const char *source = firstCycle + cycle * cycleStride + cluster;
+            for (unsigned row = 0; SQUARE > row; ++row, source += cycleStride)
+            {
+                rows[row] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source));
+            }
+            transposeSquare(rows);
+            char *destination = output + cluster * cycles + cycle;
+            for (unsigned row = 0; SQUARE > row; ++row, destination += cycles)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(destination), rows[row]);
+            }
+        }
+    }
+    transposeScalar(firstCycle, cycleStride, cycles, squareCycles, cycles, blockBegin, squareClustersEnd, output);
+    transposeScalar(firstCycle, cycleStride, cycles, 0, cycles, squareClustersEnd, blockEnd, output);
+}
+
+#else //__SSE2__
+
+void BclTransposeKernel::transposeBlockSse2(
+    const char *, const unsigned long, const unsigned,
+    const unsigned long, const unsigned long,
+    char *)
+{
+    ISAAC_ASSERT_MSG(false, "The binary is compiled without SSE2 support");
+}
+
+#endif //__SSE2__
+
+} // namespace rta
+} // namespace isaac
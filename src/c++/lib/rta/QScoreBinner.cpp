@@ -0,0 +1,112 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file QScoreBinner.cpp
+ **
+ ** \brief See QScoreBinner.hh. Dispatch and the scalar implementation.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <boost/format.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "rta/QScoreBinner.hh"
+
+namespace isaac
+{
+namespace rta
+{
+
+const unsigned QScoreBinner::QSCORES;
+
+QScoreBinner::QScoreBinner(const BclTable &fullBclQScoreTable, const Implementation implementation)
+    : table_(fullBclQScoreTable),
+      implementation_(selectImplementation(implementation, fullBclQScoreTable))
+{
+    for (unsigned qScore = 0; QSCORES > qScore; ++qScore)
+    {
+        qScoreTable_[qScore] = table_[qScore << 2] & ~3;
+    }
+}
+
+bool QScoreBinner::isQScoreOnly(const BclTable &table)
+{
+    for (unsigned bcl = 0; table.size() > bcl; ++bcl)
+    {
+        const unsigned char binned = table[bcl];
+        if ((binned & 3) != (bcl & 3) || (binned & ~3) != (static_cast<unsigned char>(table[bcl & ~3]) & ~3))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool QScoreBinner::isSupported(const Implementation implementation)
+{
+    switch (implementation)
+    {
+    case Ssse3:
+        return ssse3Supported();
+    case Auto:
+    case Scalar:
+        return true;
+    }
+    return false;
+}
+
+QScoreBinner::Implementation QScoreBinner::selectImplementation(const Implementation requested, const BclTable &table)
+{
+    if (Auto == requested)
+    {
+        return isSupported(Ssse3) && isQScoreOnly(table) ? Ssse3 : Scalar;
+    }
+    if (!isSupported(requested))
+    {
+        const std::string message = (boost::format("QScoreBinner: implementation %d is not supported by the CPU") % requested).str();
+        BOOST_THROW_EXCEPTION(isaac::common::InvalidParameterException(message));
+    }
+    if (Scalar != requested && !isQScoreOnly(table))
+    {
+        BOOST_THROW_EXCEPTION(isaac::common::InvalidParameterException(
+            "QScoreBinner: vectorized binning requires a table that does not change the base bits"));
+    }
+    return requested;
+}
+
+void QScoreBinner::bin(char *begin, char *end) const
+{
+    if (Ssse3 == implementation_)
+    {
+        binSsse3(begin, end);
+    }
+    else
+    {
+        binScalar(begin, end);
+    }
+}
+
+/**
+ * \brief Reference implementation. The vectorized one uses it for the bytes that don't fill a register.
+ */
+void QScoreBinner::binScalar(char *begin, char *end) const
+{
+    for (; end != begin; ++begin)
+    {
+        *begin = bin(*begin);
+    }
+}
+
+} // namespace rta
+} // namespace isaac
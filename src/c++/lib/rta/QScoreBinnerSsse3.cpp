@@ -0,0 +1,84 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file QScoreBinnerSsse3.cpp
+ **
+ ** \brief SSSE3 implementation of QScoreBinner. The only file compiled with -mssse3
+ **
+ ** \author Roman Petrovski
+ **/
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "common/Debug.hh"
+#include "rta/QScoreBinner.hh"
+
+namespace isaac
+{
+namespace rta
+{
+
+#ifdef __SSSE3__
+
+bool QScoreBinner::ssse3Supported()
+{
+    return __builtin_cpu_supports("ssse3");
+}
+
+void QScoreBinner::binSsse3(char *begin, char *end) const
+{
+    // each shuffle looks up 16 of the 64 quality scores
+    const __m128i table0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(qScoreTable_ + 0));
+    const __m128i table1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(qScoreTable_ + 16));
+    const __m128i table2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(qScoreTable_ + 32));
+    const __m128i table3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(qScoreTable_ + 48));
+    const __m128i qScoreBits = _mm_set1_epi8(0x3f);
+    const __m128i lowNibble = _mm_set1_epi8(0x0f);
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i two = _mm_set1_epi8(2);
+    const __m128i three = _mm_set1_epi8(3);
+    const __m128i &baseBits = three;
+
+    for (; end - begin >= 16; begin += 16)
+    {
+        const __m128i bcl = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        // there is no byte shift, the bits shifted in from the neighbor byte are masked out
+        const __m128i qScore = _mm_and_si128(_mm_srli_epi16(bcl, 2), qScoreBits);
+        const __m128i index = _mm_and_si128(qScore, lowNibble);
+        const __m128i quarter = _mm_and_si128(_mm_srli_epi16(qScore, 4), three);
+        __m128i binned = _mm_and_si128(_mm_cmpeq_epi8(quarter, _mm_setzero_si128()), _mm_shuffle_epi8(table0, index));
+        binned = _mm_or_si128(binned, _mm_and_si128(_mm_cmpeq_epi8(quarter, one), _mm_shuffle_epi8(table1, index)));
+        binned = _mm_or_si128(binned, _mm_and_si128(_mm_cmpeq_epi8(quarter, two), _mm_shuffle_epi8(table2, index)));
+        binned = _mm_or_si128(binned, _mm_and_si128(_mm_cmpeq_epi8(quarter, three), _mm_shuffle_epi8(table3, index)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(begin), _mm_or_si128(binned, _mm_and_si128(bcl, baseBits)));
+    }
+    binScalar(begin, end);
+}
+
+#else //__SSSE3__
+
+bool QScoreBinner::ssse3Supported()
+{
+    return false;
+}
+
+void QScoreBinner::binSsse3(char *, char *) const
+{
+    ISAAC_ASSERT_MSG(false, "The binary is compiled without SSSE3 support");
+}
+
+#endif //__SSSE3__
+
+} // namespace rta
+} // namespace isaac
@@ -0,0 +1,117 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testBclTransposeKernel.hh"
+
+#include "rta/BclTransposeKernel.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestBclTransposeKernel, registryName("BclTransposeKernel"));
+
+using isaac::rta::BclTransposeKernel;
+using isaac::rta::QScoreBinner;
+
+void TestBclTransposeKernel::setUp()
+{
+}
+
+void TestBclTransposeKernel::tearDown()
+{
+}
+
+/**
+ * \brief cycles bytes each stride apart, the gaps filled with garbage the transpose must not pick up
+ */
+static std::vector<char> makeTile(const unsigned cycles, const unsigned long stride)
+{
+    std::vector<char> tile(cycles * stride + 16);
+    for (unsigned i = 0; tile.size() > i; ++i)
+    {
+        tile[i] = rand();
+    }
+    return tile;
+}
+
+static std::vector<char> expectedClusters(
+    const std::vector<char> &tile, const unsigned cycles, const unsigned long clusters, const unsigned long stride)
+{
+    std::vector<char> ret;
+    for (unsigned long cluster = 0; clusters > cluster; ++cluster)
+    {
+        for (unsigned cycle = 0; cycles > cycle; ++cycle)
+        {
+            ret.push_back(tile[1 + cycle * stride + cluster]);
+        }
+    }
+    return ret;
+}
+
+void TestBclTransposeKernel::testGeometries()
+{
+    const unsigned cyclesList[] = {1, 15, 16, 17, 32, 101, 150};
+    const unsigned long clustersList[] = {1, 15, 16, 63, 64, 65, 1000, 2100};
+    const BclTransposeKernel::Implementation implementations[] = {BclTransposeKernel::Scalar, BclTransposeKernel::Sse2};
+    srand(0);
+    for (unsigned i = 0; sizeof(implementations) / sizeof(implementations[0]) > i; ++i)
+    {
+        if (!BclTransposeKernel::isSupported(implementations[i]))
+        {
+            continue;
+        }
+        const BclTransposeKernel kernel(implementations[i]);
+        CPPUNIT_ASSERT_EQUAL(implementations[i], kernel.getImplementation());
+        for (unsigned c = 0; sizeof(cyclesList) / sizeof(cyclesList[0]) > c; ++c)
+        {
+            for (unsigned k = 0; sizeof(clustersList) / sizeof(clustersList[0]) > k; ++k)
+            {
+                const unsigned cycles = cyclesList[c];
+                const unsigned long clusters = clustersList[k];
+                // odd stride and offset to make sure nothing relies on alignment
+                const unsigned long stride = clusters + 13;
+                const std::vector<char> tile = makeTile(cycles, stride);
+                std::vector<char> actual(cycles * clusters);
+                kernel.transpose(&tile.front() + 1, stride, cycles, clusters, &actual.front(), 0);
+                CPPUNIT_ASSERT(expectedClusters(tile, cycles, clusters, stride) == actual);
+            }
+        }
+    }
+}
+
+void TestBclTransposeKernel::testBinning()
+{
+    QScoreBinner::BclTable table;
+    for (unsigned bcl = 0; table.size() > bcl; ++bcl)
+    {
+        // everything above quality 30 becomes 30
+        table[bcl] = (bcl >> 2) > 30 ? ((30 << 2) | (bcl & 3)) : bcl;
+    }
+    const QScoreBinner binner(table);
+
+    const unsigned cycles = 150;
+    const unsigned long clusters = 1000;
+    const unsigned long stride = 4096;
+    srand(1);
+    const std::vector<char> tile = makeTile(cycles, stride);
+    std::vector<char> expected = expectedClusters(tile, cycles, clusters, stride);
+    binner.bin(&expected.front(), &expected.front() + expected.size());
+
+    std::vector<char> actual(cycles * clusters);
+    const BclTransposeKernel kernel;
+    kernel.transpose(&tile.front() + 1, stride, cycles, clusters, &actual.front(), &binner);
+    CPPUNIT_ASSERT(expected == actual);
+}
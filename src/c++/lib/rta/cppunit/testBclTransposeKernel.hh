@@ -0,0 +1,32 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_RTA_TEST_BCL_TRANSPOSE_KERNEL_HH
+#define iSAAC_RTA_TEST_BCL_TRANSPOSE_KERNEL_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TestBclTransposeKernel : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestBclTransposeKernel );
+    CPPUNIT_TEST( testGeometries );
+    CPPUNIT_TEST( testBinning );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp();
+    void tearDown();
+    void testGeometries();
+    void testBinning();
+};
+
+#endif // #ifndef iSAAC_RTA_TEST_BCL_TRANSPOSE_KERNEL_HH
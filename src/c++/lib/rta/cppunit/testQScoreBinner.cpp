@@ -0,0 +1,108 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testQScoreBinner.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestQScoreBinner, registryName("QScoreBinner"));
+
+using isaac::rta::QScoreBinner;
+
+void TestQScoreBinner::setUp()
+{
+    // same as the --qscore-bin defaults
+    for (unsigned qScore = 0; QScoreBinner::QSCORES > qScore; ++qScore)
+    {
+        const unsigned bin =
+            0 == qScore ? 0 : 1 == qScore ? 1 : 10 > qScore ? 6 : 20 > qScore ? 15 : 25 > qScore ? 22 :
+            30 > qScore ? 27 : 35 > qScore ? 33 : 40 > qScore ? 37 : 40;
+        for (unsigned base = 0; 4 > base; ++base)
+        {
+            binTable_[(qScore << 2) | base] = (bin << 2) | base;
+        }
+    }
+}
+
+void TestQScoreBinner::tearDown()
+{
+}
+
+void TestQScoreBinner::testAllBytes()
+{
+    std::vector<char> expected;
+    for (unsigned bcl = 0; 256 > bcl; ++bcl)
+    {
+        expected.push_back(binTable_[bcl]);
+    }
+
+    const QScoreBinner::Implementation implementations[] = {QScoreBinner::Scalar, QScoreBinner::Ssse3};
+    for (unsigned i = 0; sizeof(implementations) / sizeof(implementations[0]) > i; ++i)
+    {
+        if (!QScoreBinner::isSupported(implementations[i]))
+        {
+            continue;
+        }
+        const QScoreBinner binner(binTable_, implementations[i]);
+        std::vector<char> bcls;
+        for (unsigned bcl = 0; 256 > bcl; ++bcl)
+        {
+            bcls.push_back(bcl);
+        }
+        binner.bin(&bcls.front(), &bcls.front() + bcls.size());
+        CPPUNIT_ASSERT(expected == bcls);
+    }
+}
+
+void TestQScoreBinner::testUnalignedRanges()
+{
+    if (!QScoreBinner::isSupported(QScoreBinner::Ssse3))
+    {
+        return;
+    }
+    const QScoreBinner scalar(binTable_, QScoreBinner::Scalar);
+    const QScoreBinner ssse3(binTable_, QScoreBinner::Ssse3);
+    srand(0);
+    std::vector<char> data(1000);
+    for (unsigned i = 0; data.size() > i; ++i)
+    {
+        data[i] = rand();
+    }
+    for (unsigned begin = 0; 17 > begin; ++begin)
+    {
+        for (unsigned length = 0; 100 > length; ++length)
+        {
+            std::vector<char> expected = data;
+            std::vector<char> actual = data;
+            scalar.bin(&expected.front() + begin, &expected.front() + begin + length);
+            ssse3.bin(&actual.front() + begin, &actual.front() + begin + length);
+            CPPUNIT_ASSERT(expected == actual);
+        }
+    }
+}
+
+void TestQScoreBinner::testBaseChangingTable()
+{
+    QScoreBinner::BclTable table = binTable_;
+    // turns the base of the quality 30 call into A
+    table[(30 << 2) | 3] = 30 << 2;
+    const QScoreBinner binner(table);
+    CPPUNIT_ASSERT_EQUAL(QScoreBinner::Scalar, binner.getImplementation());
+    char bcl = (30 << 2) | 3;
+    binner.bin(&bcl, &bcl + 1);
+    CPPUNIT_ASSERT_EQUAL(char(30 << 2), bcl);
+}
@@ -0,0 +1,38 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_RTA_TEST_Q_SCORE_BINNER_HH
+#define iSAAC_RTA_TEST_Q_SCORE_BINNER_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "rta/QScoreBinner.hh"
+
+class TestQScoreBinner : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestQScoreBinner );
+    CPPUNIT_TEST( testAllBytes );
+    CPPUNIT_TEST( testUnalignedRanges );
+    CPPUNIT_TEST( testBaseChangingTable );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    isaac::rta::QScoreBinner::BclTable binTable_;
+public:
+    void setUp();
+    void tearDown();
+    void testAllBytes();
+    void testUnalignedRanges();
+    void testBaseChangingTable();
+};
+
+#endif // #ifndef iSAAC_RTA_TEST_Q_SCORE_BINNER_HH
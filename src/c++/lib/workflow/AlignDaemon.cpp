@@ -0,0 +1,199 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file AlignDaemon.cpp
+ **
+ ** \brief See AlignDaemon.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/exception/diagnostic_information.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <boost/thread.hpp>
+
+#include "common/Debug.hh"
+#include "common/Exceptions.hh"
+#include "options/AlignOptions.hh"
+#include "reference/ContigCache.hh"
+#include "workflow/AlignDaemon.hh"
+#include "workflow/AlignJob.hh"
+
+namespace isaac
+{
+namespace workflow
+{
+
+const std::string AlignDaemon::JOB_EXTENSION(".job");
+const std::string AlignDaemon::RUNNING_EXTENSION(".running");
+const std::string AlignDaemon::DONE_EXTENSION(".done");
+const std::string AlignDaemon::FAILED_EXTENSION(".failed");
+const std::string AlignDaemon::STOP_FILE_NAME("stop");
+
+AlignDaemon::AlignDaemon(
+    const bfs::path &spoolDirectory,
+    const unsigned pollInterval,
+    const unsigned maxJobs) :
+        spoolDirectory_(spoolDirectory),
+        pollInterval_(pollInterval),
+        maxJobs_(maxJobs)
+{
+}
+
+void AlignDaemon::run()
+{
+    reference::ContigCache::setRetain(true);
+    ISAAC_THREAD_CERR << "Waiting for jobs in " << spoolDirectory_ << std::endl;
+
+    unsigned jobs = 0;
+    while ((!maxJobs_ || maxJobs_ > jobs) && !isStopRequested())
+    {
+        bfs::path jobPath;
+        if (findNextJob(jobPath))
+        {
+            if (runJob(jobPath))
+            {
+                ++jobs;
+            }
+        }
+        else
+        {
+            boost::this_thread::sleep(boost::posix_time::seconds(pollInterval_));
+        }
+    }
+
+    reference::ContigCache::setRetain(false);
+    ISAAC_THREAD_CERR << "Exiting after " << jobs << " jobs" << std::endl;
+}
+
+bool AlignDaemon::isStopRequested() const
+{
+    return bfs::exists(spoolDirectory_ / STOP_FILE_NAME);
+}
+
+bool AlignDaemon::findNextJob(bfs::path &jobPath) const
+{
+    std::vector<bfs::path> jobs;
+    for (bfs::directory_iterator it(spoolDirectory_); bfs::directory_iterator() != it; ++it)
+    {
+        if (JOB_EXTENSION == it->path().extension().string() && bfs::is_regular_file(it->path()))
+        {
+            jobs.push_back(it->path());
+        }
+    }
+    if (jobs.empty())
+    {
+        return false;
+    }
+    jobPath = *std::min_element(jobs.begin(), jobs.end());
+    return true;
+}
+
+bool AlignDaemon::runJob(const bfs::path &jobPath) const
+{
+    bfs::path runningPath = jobPath;
+    runningPath.replace_extension(RUNNING_EXTENSION);
+
+    std::string error;
+    try
+    {
+        // rename is atomic. When daemons share the spool directory, only one of them gets the job.
+        // The submitter creates the file under a different name and renames it, so the contents are complete here
+        boost::system::error_code errorCode;
+        bfs::rename(jobPath, runningPath, errorCode);
+        if (errorCode)
+        {
+            ISAAC_THREAD_CERR << "Job " << jobPath << " taken by another daemon: " << errorCode.message() << std::endl;
+            return false;
+        }
+        ISAAC_THREAD_CERR << "Starting job " << runningPath << std::endl;
+        align(readArguments(runningPath));
+    }
+    catch (const common::ExceptionData &exception)
+    {
+        error = exception.getContext() + ": " + exception.getMessage();
+    }
+    catch (const boost::exception &e)
+    {
+        error = "boost::exception: " + boost::diagnostic_information(e);
+    }
+    catch (const std::exception &e)
+    {
+        error = e.what();
+    }
+
+    bfs::path resultPath = jobPath;
+    if (error.empty())
+    {
+        resultPath.replace_extension(DONE_EXTENSION);
+        bfs::rename(runningPath, resultPath);
+        ISAAC_THREAD_CERR << "Finished job " << resultPath << std::endl;
+    }
+    else
+    {
+        resultPath.replace_extension(FAILED_EXTENSION);
+        std::ofstream os(runningPath.c_str(), std::ios_base::app);
+        os << "Error: " << error << std::endl;
+        os.close();
+        bfs::rename(runningPath, resultPath);
+        ISAAC_THREAD_CERR << "Failed job " << resultPath << ": " << error << std::endl;
+    }
+    return true;
+}
+
+void AlignDaemon::align(const std::vector<std::string> &arguments) const
+{
+    std::vector<std::string> argvStrings(1, "isaac-align");
+    argvStrings.insert(argvStrings.end(), arguments.begin(), arguments.end());
+    std::vector<char *> argv;
+    BOOST_FOREACH(std::string &argument, argvStrings)
+    {
+        argv.push_back(&argument[0]);
+    }
+    argv.push_back(0);
+
+    options::AlignOptions options;
+    if (options::AlignOptions::RUN != options.parse(argvStrings.size(), &argv.front()))
+    {
+        BOOST_THROW_EXCEPTION(common::InvalidOptionException("Job arguments do not request an alignment run"));
+    }
+
+    // the limit is not enforced with ulimit here as it would apply to the daemon for the rest of its life
+    const unsigned long long availableMemory = options.memoryLimit * 1024 * 1024 * 1024;
+    runAlignJob(options, availableMemory);
+}
+
+std::vector<std::string> AlignDaemon::readArguments(const bfs::path &jobPath)
+{
+    std::ifstream is(jobPath.c_str());
+    if (!is)
+    {
+        BOOST_THROW_EXCEPTION(common::IoException(errno, "Failed to open job file " + jobPath.string()));
+    }
+    std::vector<std::string> ret;
+    std::string line;
+    while (std::getline(is, line))
+    {
+        if (!line.empty())
+        {
+            ret.push_back(line);
+        }
+    }
+    return ret;
+}
+
+} // namespace workflow
+} // namespace isaac
@@ -0,0 +1,141 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file AlignJob.cpp
+ **
+ ** \brief See AlignJob.hh
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include "common/Debug.hh"
+#include "workflow/AlignJob.hh"
+#include "workflow/AlignWorkflowSerialization.hh"
+#include "workflow/AlignWorkflow.hh"
+
+namespace isaac
+{
+namespace workflow
+{
+
+void runAlignJob(const options::AlignOptions &options, const unsigned long long availableMemory)
+{
+    AlignWorkflow workflow(
+        options.argv,
+        options.description,
+        options.flowcellLayoutList,
+        options.seedLength,
+        options.barcodeMetadataList,
+        options.allowVariableReadLength,
+        options.cleanupIntermediary,
+        options.ignoreMissingBcls,
+        options.ignoreMissingFilters,
+        options.firstPassSeeds,
+        0, //TODO: have a command-line argument to override the estimation-based value
+        options.referenceMetadataList,
+        options.tempDirectory,
+        options.outputDirectory,
+        options.jobs,
+        options.repeatThreshold,
+        options.mateDriftRange,
+        options.neighborhoodSizeThreshold,
+        availableMemory,
+        options.clustersAtATimeMax,
+        options.selectClustersAtATimeMax,
+        options.ignoreNeighbors,
+        options.ignoreRepeats,
+        options.mapqThreshold,
+        options.perTileTls,
+        options.pfOnly,
+        options.baseQualityCutoff,
+        options.keepUnaligned,
+        options.preSortBins,
+        options.putUnalignedInTheBack,
+        options.realignGapsVigorously,
+        options.realignDodgyFragments,
+        options.realignedGapsPerFragment,
+        options.clipSemialigned,
+        options.clipOverlapping,
+        options.scatterRepeats,
+        options.gappedMismatchesMax,
+        options.avoidSmithWaterman,
+        options.gapMatchScore,
+        options.gapMismatchScore,
+        options.gapOpenScore,
+        options.gapExtendScore,
+        options.minGapExtendScore,
+        options.semialignedGapLimit,
+        options.dodgyAlignmentScore,
+        options.inputLoadersMax,
+        options.tempSaversMax,
+        options.tempLoadersMax,
+        options.outputSaversMax,
+        options.realignGaps,
+        options.bamGzipLevel,
+        options.bamIndexFormat,
+        options.bamPuFormat,
+        options.bamHeaderTags,
+        options.expectedBgzfCompressionRatio,
+        options.singleLibrarySamples,
+        options.keepDuplicates,
+        options.markDuplicates,
+        options.binRegexString,
+        options.memoryControl,
+        options.clusterIdList,
+        options.userTemplateLengthStatistics,
+        options.statsImageFormat,
+        options.bufferBins,
+        options.inMemoryMatches,
+        options.preLoadReference,
+        options.qScoreBin,
+        options.fullBclQScoreTable,
+        options.optionalFeatures,
+        options.pessimisticMapQ);
+
+    const boost::filesystem::path stateFilePath = options.tempDirectory / "AlignerState.txt";
+
+    if (AlignWorkflow::Start != options.startFrom)
+    {
+        load(stateFilePath, workflow);
+    }
+
+    AlignWorkflow::State targetState =
+        (options.stopAt == AlignWorkflow::Last) ? workflow.getNextState() : options.stopAt;
+
+    ISAAC_ASSERT_MSG(options.startFrom < targetState, "Target state must follow the start state");
+
+    if (options.startFrom != workflow.rewind(options.startFrom))
+    {
+        // store new state as we're about to corrupt all the data required for the subsequent ones
+        save(stateFilePath, workflow);
+    }
+
+    while(targetState != workflow.step(targetState))
+    {
+        // save new state
+        save(stateFilePath, workflow);
+        if (options.cleanupIntermediary)
+        {
+            workflow.cleanupIntermediary();
+        }
+    }
+
+    // save final state
+    save(stateFilePath, workflow);
+    if (options.cleanupIntermediary)
+    {
+        workflow.cleanupIntermediary();
+    }
+}
+
+} // namespace workflow
+} // namespace isaac
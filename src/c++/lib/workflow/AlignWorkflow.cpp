@@ -23,6 +23,7 @@
 #include <cstring>
 #include <cerrno>
 
+#include <boost/bind.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <boost/lambda/bind.hpp>
 #include <boost/thread.hpp>
@@ -39,6 +40,7 @@
 #include "common/FileSystem.hh"
 #include "flowcell/Layout.hh"
 #include "flowcell/ReadMetadata.hh"
+#include "reference/ContigCache.hh"
 #include "reports/AlignmentReportGenerator.hh"
 
 namespace isaac
@@ -46,6 +48,9 @@ namespace isaac
 namespace workflow
 {
 
+/// clusters selected together when --select-clusters-at-a-time is not set
+static const unsigned SELECT_CLUSTERS_AT_A_TIME_DEFAULT = 4000000;
+
 AlignWorkflow::AlignWorkflow(
     const std::vector<std::string> &argv,
     const std::string &description,
@@ -67,6 +72,7 @@ AlignWorkflow::AlignWorkflow(
     const unsigned neighborhoodSizeThreshold,
     const unsigned long availableMemory,
     const unsigned clustersAtATimeMax,
+    const unsigned selectClustersAtATimeMax,
     const bool ignoreNeighbors,
     const bool ignoreRepeats,
     const unsigned mapqThreshold,
@@ -97,6 +103,7 @@ AlignWorkflow::AlignWorkflow(
     const unsigned outputSaversMax,
     const build::GapRealignerMode realignGaps,
     const int bamGzipLevel,
+    const bam::BamIndexFormat bamIndexFormat,
     const std::string &bamPuFormat,
     const std::vector<std::string> &bamHeaderTags,
     const double expectedBgzfCompressionRatio,
@@ -109,6 +116,8 @@ AlignWorkflow::AlignWorkflow(
     const alignment::TemplateLengthStatistics &userTemplateLengthStatistics,
     const reports::AlignmentReportGenerator::ImageFileFormat statsImageFormat,
     const bool bufferBins,
+    const bool inMemoryMatches,
+    const bool preLoadReference,
     const bool qScoreBin,
     const boost::array<char, 256> &fullBclQScoreTable,
     const OptionalFeatures optionalFeatures,
@@ -138,6 +147,7 @@ AlignWorkflow::AlignWorkflow(
     , matchesPerBin_(matchesPerBin)
     , availableMemory_(availableMemory)
     , clustersAtATimeMax_(clustersAtATimeMax)
+    , selectClustersAtATimeMax_(selectClustersAtATimeMax)
     , mapqThreshold_(mapqThreshold)
     , perTileTls_(perTileTls)
     , pfOnly_(pfOnly)
@@ -166,6 +176,7 @@ AlignWorkflow::AlignWorkflow(
     , outputSaversMax_(outputSaversMax)
     , realignGaps_(realignGaps)
     , bamGzipLevel_(bamGzipLevel)
+    , bamIndexFormat_(bamIndexFormat)
     , bamPuFormat_(bamPuFormat)
     , bamHeaderTags_(bamHeaderTags)
     , expectedBgzfCompressionRatio_(expectedBgzfCompressionRatio)
@@ -173,6 +184,8 @@ AlignWorkflow::AlignWorkflow(
     , keepDuplicates_(keepDuplicates)
     , markDuplicates_(markDuplicates)
     , bufferBins_(bufferBins)
+    , inMemoryMatches_(inMemoryMatches)
+    , preLoadReference_(preLoadReference)
     , qScoreBin_(qScoreBin)
     , fullBclQScoreTable_(fullBclQScoreTable)
     , optionalFeatures_(optionalFeatures)
@@ -240,7 +253,8 @@ void AlignWorkflow::findMatches(alignWorkflow::FoundMatchesMetadata &foundMatche
         tempSaversMax_,
         memoryControl_,
         clusterIdList_,
-        sortedReferenceMetadataList_);
+        sortedReferenceMetadataList_,
+        inMemoryMatches_);
 
     if (16 == seedLength_)
     {
@@ -277,12 +291,13 @@ void AlignWorkflow::cleanupMatches() const
 
 void AlignWorkflow::selectMatches(
     alignment::matchSelector::FragmentStorage &fragmentStorage,
+    const unsigned long batchClustersMax,
     std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const
 {
     ISAAC_TRACE_STAT("AlignWorkflow::selectMatches fragmentStorage ")
 
     workflow::alignWorkflow::SelectMatchesTransition transition(
-        (bufferBins_ ? 3 : 2),
+        getSelectIoOverlap(), batchClustersMax,
         fragmentStorage, foundMatchesMetadata_.matchDistribution_,
         sortedReferenceMetadataList_, tempDirectory_, coresMax_,
         foundMatchesMetadata_.tileMetadataList_, barcodeMetadataList_,
@@ -292,6 +307,7 @@ void AlignWorkflow::selectMatches(
         ignoreMissingBcls_, ignoreMissingFilters_,
         inputLoadersMax_, tempLoadersMax_, tempSaversMax_,
         foundMatchesMetadata_.matchTally_,
+        foundMatchesMetadata_.matchArena_.get(),
         userTemplateLengthStatistics_, mapqThreshold_, perTileTls_, pfOnly_, baseQualityCutoff_,
         keepUnaligned_, clipSemialigned_, clipOverlapping_,
         scatterRepeats_, gappedMismatchesMax_, avoidSmithWaterman_,
@@ -308,10 +324,43 @@ void AlignWorkflow::cleanupBins() const
     BOOST_FOREACH(const alignment::BinMetadata &bin, selectedMatchesMetadata_)
     {
         removed += boost::filesystem::remove(bin.getPath());
+        removed += boost::filesystem::remove(bin.getFragmentIndexPath());
     }
     ISAAC_THREAD_CERR << "Removing intermediary bin files done. " << removed << " files removed." << std::endl;
 }
 
+/**
+ * \brief Small tiles are selected together up to this many clusters. Never less than the biggest tile.
+ *        Unless --select-clusters-at-a-time is given, the batch buffers get at most half of the memory
+ *        limit, the rest is left for the reference, the matches and the Build.
+ */
+unsigned long AlignWorkflow::getSelectBatchClustersMax() const
+{
+    const unsigned long maxTileClusters = flowcell::getMaxTileClusters(foundMatchesMetadata_.tileMetadataList_);
+    const unsigned long batchTileBytes = alignWorkflow::SelectMatchesTransition::getBatchTileBytes(
+        getSelectIoOverlap(), foundMatchesMetadata_.tileMetadataList_, flowcellLayoutList_,
+        foundMatchesMetadata_.matchTally_, !!foundMatchesMetadata_.matchArena_, bufferBins_,
+        optionalFeatures_ & BamZX);
+
+    unsigned long ret = selectClustersAtATimeMax_;
+    if (!ret)
+    {
+        const unsigned long memoryTilesMax = availableMemory_ / 2 / std::max(1UL, batchTileBytes);
+        ret = std::min<unsigned long>(memoryTilesMax * maxTileClusters, SELECT_CLUSTERS_AT_A_TIME_DEFAULT);
+    }
+    ret = std::max(ret, maxTileClusters);
+
+    const unsigned long batchBytes = (ret / std::max(1UL, maxTileClusters)) * batchTileBytes;
+    ISAAC_THREAD_CERR << "Match selection batch buffers for " << ret << " clusters take " <<
+        batchBytes / 1024 / 1024 << " megabytes" << std::endl;
+    if (batchBytes > availableMemory_)
+    {
+        ISAAC_THREAD_CERR << "WARNING: match selection batch buffers exceed the memory limit of " <<
+            availableMemory_ / 1024 / 1024 << " megabytes" << std::endl;
+    }
+    return ret;
+}
+
 void AlignWorkflow::selectMatches(
     SelectedMatchesMetadata &binPaths,
     std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics) const
@@ -324,7 +373,13 @@ void AlignWorkflow::selectMatches(
     const unsigned long matchesPerBin = matchesPerBin_
         ? matchesPerBin_
         : build::Build::estimateOptimumFragmentsPerBin(flowcellLayoutList_, availableMemory_, expectedBgzfCompressionRatio_,
-                                                       coresMax_) * firstPassSeeds_;
+                                                       coresMax_,
+                                                       // Build keeps a stream per thread and bam file. Each barcode
+                                                       // gets at most one bam file
+                                                       (tempLoadersMax_ + coresMax_ + outputSaversMax_) *
+                                                           barcodeMetadataList_.size()) * firstPassSeeds_;
+
+    const unsigned long batchClustersMax = getSelectBatchClustersMax();
 
     ISAAC_TRACE_STAT("AlignWorkflow::selectMatches ")
 
@@ -338,7 +393,7 @@ void AlignWorkflow::selectMatches(
             foundMatchesMetadata_.tileMetadataList_.size());
 
         ISAAC_THREAD_CERR << "Selecting matches using " << matchesPerBin << " matches per bin limit" << std::endl;
-        selectMatches(fragmentStorage, barcodeTemplateLengthStatistics);
+        selectMatches(fragmentStorage, batchClustersMax, barcodeTemplateLengthStatistics);
         AlignWorkflow::SelectedMatchesMetadata ret;
         fragmentStorage.close(binPaths);
     }
@@ -349,11 +404,12 @@ void AlignWorkflow::selectMatches(
             foundMatchesMetadata_.matchDistribution_, matchesPerBin, tempDirectory_,
             flowcellLayoutList_, barcodeMetadataList_,
             flowcell::getMaxTileClusters(foundMatchesMetadata_.tileMetadataList_),
+            batchClustersMax,
             foundMatchesMetadata_.tileMetadataList_.size(),
             "skip-empty" == binRegexString_);
 
         ISAAC_THREAD_CERR << "Selecting matches using " << matchesPerBin << " matches per bin limit" << std::endl;
-        selectMatches(fragmentStorage, barcodeTemplateLengthStatistics);
+        selectMatches(fragmentStorage, batchClustersMax, barcodeTemplateLengthStatistics);
         AlignWorkflow::SelectedMatchesMetadata ret;
         fragmentStorage.close(binPaths);
     }
@@ -384,7 +440,7 @@ const build::BarcodeBamMapping AlignWorkflow::generateBam(
                        sortedReferenceMetadataList_,
                        projectsDirectory_,
                        tempLoadersMax_, coresMax_, outputSaversMax_, realignGaps_,
-                       bamGzipLevel_, bamPuFormat_, bamHeaderTags_, expectedBgzfCompressionRatio_, singleLibrarySamples_,
+                       bamGzipLevel_, bamIndexFormat_, bamPuFormat_, bamHeaderTags_, expectedBgzfCompressionRatio_, singleLibrarySamples_,
                        keepDuplicates_, markDuplicates_,
                        realignGapsVigorously_, realignDodgyFragments_, realignedGapsPerFragment_,
                        clipSemialigned_, binRegexString_,
@@ -406,6 +462,8 @@ const build::BarcodeBamMapping AlignWorkflow::generateBam(
         build.run(mallocBlock);
     }
     build.dumpStats(statsDirectory_ / "BuildStats.xml");
+    // nothing else needs the reference. The memory goes back once build is gone
+    reference::ContigCache::release();
     ISAAC_THREAD_CERR << "Generating the BAM files done" << std::endl;
     return build.getBarcodeBamMapping();
 }
@@ -469,6 +527,8 @@ AlignWorkflow::State AlignWorkflow::step()
     case MatchFinderDone:
     {
         selectMatches(selectedMatchesMetadata_, barcodeTemplateLengthStatistics_);
+        // all in-memory matches have been taken by the selection, don't hold the arena through Build
+        foundMatchesMetadata_.matchArena_.reset();
         state_ = getNextState();
         break;
     }
@@ -498,6 +558,38 @@ AlignWorkflow::State AlignWorkflow::step()
     return state_;
 }
 
+void AlignWorkflow::generateAlignmentReportsAndBam(const unsigned threadNumber)
+{
+    if (threadNumber)
+    {
+        generateAlignmentReports();
+    }
+    else
+    {
+        barcodeBamMapping_ = generateBam(selectedMatchesMetadata_, barcodeTemplateLengthStatistics_);
+    }
+}
+
+AlignWorkflow::State AlignWorkflow::step(const AlignWorkflow::State targetState)
+{
+    if (Start == state_ && MatchFinderDone < targetState && preLoadReference_)
+    {
+        // MatchSelector and Build pick the contigs up from the cache
+        reference::ContigCache::prefetch(sortedReferenceMetadataList_, tempLoadersMax_);
+    }
+
+    // malloc block is process-wide. Reports can't be allowed to allocate while Build is under it
+    if (MatchSelectorDone != state_ || BamDone > targetState || common::ScoopedMallocBlock::Off != memoryControl_)
+    {
+        return step();
+    }
+
+    common::ThreadVector threads(2);
+    threads.execute(boost::bind(&AlignWorkflow::generateAlignmentReportsAndBam, this, _1));
+    state_ = BamDone;
+    return state_;
+}
+
 void AlignWorkflow::cleanupIntermediary()
 {
     switch (state_)
@@ -510,6 +602,7 @@ void AlignWorkflow::cleanupIntermediary()
     case AlignmentReportsDone:
     case MatchSelectorDone:
     {
+        foundMatchesMetadata_.matchArena_.reset();
         cleanupMatches();
         //fall through
     }
@@ -548,6 +641,7 @@ AlignWorkflow::State AlignWorkflow::rewind(AlignWorkflow::State to)
     case MatchFinderDone:
     {
         if (Start == state_) {BOOST_THROW_EXCEPTION(common::PreConditionException("Aligner rewind from Start to MatchFinderDone is not possible"));}
+        if (inMemoryMatches_ && !foundMatchesMetadata_.matchArena_) {BOOST_THROW_EXCEPTION(common::PreConditionException("Aligner rewind to MatchFinderDone is not possible once the in-memory matches have been selected"));}
         state_ = MatchFinderDone;
         ISAAC_THREAD_CERR << "Workflow state rewind to MatchFinderDone successful" << std::endl;
         break;
@@ -205,6 +205,7 @@ BclBaseCallsSource::BclBaseCallsSource(
 
 void BclBaseCallsSource::loadClusters(
         const flowcell::TileMetadata &tileMetadata,
+        const rta::QScoreBinner *qScoreBinner,
         alignment::BclClusters &bclData)
 {
     ISAAC_THREAD_CERR << "Loading Bcl data for " << tileMetadata << std::endl;
@@ -241,12 +242,13 @@ void BclBaseCallsSource::loadClusters(
     // However, the amount of CPU required is relatively low, and occurs on a single thread.
     // Avoid locking all the cores for the duration of this...
     // Also, bclMapper_ and filtersMapper_ are shared between the threads at the moment.
-    bclToClusters(tileMetadata, bclData, boolUseLocsPositions);
+    bclToClusters(tileMetadata, qScoreBinner, bclData, boolUseLocsPositions);
 }
 
 
 void BclBaseCallsSource::bclToClusters(
     const flowcell::TileMetadata &tileMetadata,
+    const rta::QScoreBinner *qScoreBinner,
     alignment::BclClusters &bclData,
     const bool useLocsPositions) const
 {
@@ -256,9 +258,10 @@ void BclBaseCallsSource::bclToClusters(
     ISAAC_THREAD_CERR << "Resetting Bcl data done for " << bclData.getClusterCount() << " bcl clusters" << std::endl;
 
 
-    ISAAC_THREAD_CERR << "Transposing Bcl data for " << tileMetadata.getClusterCount() << " bcl clusters" << std::endl;
+    ISAAC_THREAD_CERR << "Transposing Bcl data for " << tileMetadata.getClusterCount() << " bcl clusters" <<
+        (qScoreBinner ? " with qscore binning" : "") << std::endl;
     const clock_t startTranspose = clock();
-    bclMapper_.transpose(bclData.cluster(0));
+    bclMapper_.transpose(bclData.cluster(0), qScoreBinner);
     ISAAC_THREAD_CERR << "Transposing Bcl data done for " << bclData.getClusterCount() << " bcl clusters in " << (clock() - startTranspose) / 1000 << "ms" << std::endl;
 
     ISAAC_THREAD_CERR << "Extracting Pf values for " << tileMetadata.getClusterCount() << " bcl clusters" << std::endl;
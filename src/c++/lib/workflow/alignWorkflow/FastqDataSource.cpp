@@ -26,6 +26,37 @@ namespace workflow
 namespace alignWorkflow
 {
 
+/**
+ * \brief The fastq readers get threads to inflate BGZF blocks in parallel only when there is BGZF data to read
+ */
+static bool hasBgzfFastq(const flowcell::Layout &flowcell)
+{
+    BOOST_FOREACH(const unsigned lane, flowcell.getLaneIds())
+    {
+        BOOST_FOREACH(const flowcell::ReadMetadata &readMetadata, flowcell.getReadMetadataList())
+        {
+            if (io::FastqReader::isBgzf(flowcell.getLaneReadAttribute<flowcell::Layout::Fastq, flowcell::FastqFilePathAttributeTag>(
+                lane, readMetadata.getNumber()).string()))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static bool hasBgzfFastq(const flowcell::FlowcellLayoutList &flowcellLayoutList)
+{
+    BOOST_FOREACH(const flowcell::Layout &flowcell, flowcellLayoutList)
+    {
+        if (flowcell::Layout::Fastq == flowcell.getFormat() && hasBgzfFastq(flowcell))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 template <typename KmerT>
 unsigned FastqSeedSource<KmerT>::determineMemoryCapacity(
     const unsigned long availableMemory,
@@ -93,7 +124,7 @@ FastqSeedSource<KmerT>::FastqSeedSource(
         currentLaneIterator_(lanes_.begin()),
         currentTile_(1),
         threads_(threads),
-        fastqLoader_(allowVariableLength, 0, threads_, coresMax_)
+        fastqLoader_(allowVariableLength, 0, threads_, coresMax_, hasBgzfFastq(fastqFlowcellLayout))
 
 {
 }
@@ -219,7 +250,8 @@ FastqBaseCallsSource::FastqBaseCallsSource(
     common::ThreadVector &threads,
     const unsigned inputLoadersMax):
     flowcellLayoutList_(flowcellLayoutList),
-    fastqLoader_(allowVariableFastqLength, getLongestFastqPath(flowcellLayoutList_).string().size(), threads, inputLoadersMax),
+    fastqLoader_(allowVariableFastqLength, getLongestFastqPath(flowcellLayoutList_).string().size(), threads, inputLoadersMax,
+                 hasBgzfFastq(flowcellLayoutList_)),
     fastqFilePaths_(2) //read 1 and read 2 paths
 {
     boost::filesystem::path longestFastqFilePath = getLongestFastqPath(flowcellLayoutList_);
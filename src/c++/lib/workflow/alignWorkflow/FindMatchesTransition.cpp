@@ -22,7 +22,8 @@
 #include "alignment/SeedMemoryManager.hh"
 #include "common/Debug.hh"
 #include "common/Exceptions.hh"
-#include "common/ParallelSort.hpp"
+#include "common/Numa.hh"
+#include "common/RadixSort.hpp"
 #include "demultiplexing/DemultiplexingStatsXml.hh"
 #include "flowcell/Layout.hh"
 #include "flowcell/ReadMetadata.hh"
@@ -60,7 +61,8 @@ FindMatchesTransition::FindMatchesTransition(
     const unsigned tempSaversMax,
     const common::ScoopedMallocBlock::Mode memoryControl,
     const std::vector<size_t> &clusterIdList,
-    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList
+    const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
+    const bool inMemoryMatches
     )
     : flowcellLayoutList_(flowcellLayoutList)
     , tempDirectory_(tempDirectory)
@@ -82,9 +84,11 @@ FindMatchesTransition::FindMatchesTransition(
     , memoryControl_(memoryControl)
     , clusterIdList_(clusterIdList)
     , sortedReferenceMetadataList_(sortedReferenceMetadataList)
+    , inMemoryMatches_(inMemoryMatches)
     // Have thread pool for the maximum number of threads we may potentially need.
     , threads_(std::max(inputLoadersMax_, std::max(coresMax_, tempSaversMax_)))
 {
+    threads_.execute(boost::bind(&common::bindToNumaNode, _1, false));
 }
 
 std::vector<std::vector<unsigned> > FindMatchesTransition::getSeedIndexListPerIteration(const flowcell::Layout &flowcell) const
@@ -203,14 +207,16 @@ flowcell::TileMetadataList FindMatchesTransition::findSingleSeedMatches(
                             ignoreNeighbors_, ignoreRepeats_,
                             repeatThreshold_, neighborhoodSizeThreshold_,
                             foundMatches.matchTally_, tileClusterInfo, threads_, coresMax_, tempSaversMax_,
-                            standardOpenFileHandlesCount + seedLoaderOpenFileHandlesCount);
+                            standardOpenFileHandlesCount + seedLoaderOpenFileHandlesCount,
+                            foundMatches.matchArena_.get());
 
     flowcell::TileMetadataList currentTiles; currentTiles.reserve(unprocessedTiles.size());
 
     seedSource.initBuffers(unprocessedTiles, seedMetadataList);
 
     alignment::SeedMemoryManager<KmerT> seedMemoryManager(
-        barcodeMetadataList_, flowcell.getReadMetadataList(), seedMetadataList, unprocessedTiles);
+        barcodeMetadataList_, flowcell.getReadMetadataList(), seedMetadataList, unprocessedTiles,
+        inMemoryMatches_);
 
     if (!seedMemoryManager.selectTiles(
         unprocessedTiles, tileClusterInfo, matchFinder.getMaxTileCount(), tempSaversMax_, currentTiles))
@@ -287,7 +293,8 @@ void FindMatchesTransition::maskCompleteReadSeeds(
         {
             common::ScoopedMallocBlockUnblock unblock(mallocBlock);
             // comparing the full kmer is required to push the N-seeds off to the very end.
-            common::parallelSort(referenceSeedsBegin, referenceSeedsEnd, &alignment::orderByKmerSeedIndex<KmerT>, threads_, coresMax_);
+            common::radixSort(referenceSeedsBegin, referenceSeedsEnd, alignment::SeedRadixDigits<KmerT>(), threads_, coresMax_,
+                              std::distance(referenceSeedsBegin, referenceSeedsEnd) / alignment::SeedRadixDigits<KmerT>::SCRATCH_DIVISOR);
         }
         ISAAC_THREAD_CERR << "Sorting " << std::distance(referenceSeedsBegin, referenceSeedsEnd) << " seeds done in " << (clock() - startSort) / 1000 << "ms" << std::endl;
         referenceSeedsBegin = referenceSeedsEnd;
@@ -332,14 +339,16 @@ void FindMatchesTransition::findMultiSeedMatches(
                             ignoreNeighbors_, ignoreRepeats_,
                             repeatThreshold_, neighborhoodSizeThreshold_,
                             foundMatches.matchTally_, tileClusterInfo, threads_, coresMax_, tempSaversMax_,
-                            standardOpenFileHandlesCount + seedLoaderOpenFileHandlesCount);
+                            standardOpenFileHandlesCount + seedLoaderOpenFileHandlesCount,
+                            foundMatches.matchArena_.get());
 
     flowcell::TileMetadataList currentTiles; currentTiles.reserve(unprocessedTiles.size());
 
     seedSource.initBuffers(unprocessedTiles, seedMetadataList);
 
     alignment::SeedMemoryManager<KmerT> seedMemoryManager(
-        barcodeMetadataList_, flowcell.getReadMetadataList(), seedMetadataList, unprocessedTiles);
+        barcodeMetadataList_, flowcell.getReadMetadataList(), seedMetadataList, unprocessedTiles,
+        inMemoryMatches_);
 
     while(!unprocessedTiles.empty())
     {
@@ -539,6 +548,10 @@ template <typename KmerT>
 void FindMatchesTransition::perform(FoundMatchesMetadata &foundMatches)
 {
     FoundMatchesMetadata ret(tempDirectory_, barcodeMetadataList_, maxIterations_, sortedReferenceMetadataList_);
+    if (inMemoryMatches_)
+    {
+        ret.matchArena_.reset(new alignment::MatchArena);
+    }
     demultiplexing::DemultiplexingStats demultiplexingStats(flowcellLayoutList_, barcodeMetadataList_);
 
     BOOST_FOREACH(const flowcell::Layout& flowcell, flowcellLayoutList_)
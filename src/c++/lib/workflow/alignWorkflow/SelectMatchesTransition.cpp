@@ -31,10 +31,10 @@
 #include "common/Debug.hh"
 #include "common/Exceptions.hh"
 #include "common/FastIo.hh"
-#include "common/ParallelSort.hpp"
 #include "reference/Contig.hh"
 #include "reference/ContigLoader.hh"
 
+#include "alignment/matchSelector/FragmentCollector.hh"
 #include "alignment/matchSelector/MatchSelectorStatsXml.hh"
 
 #include "workflow/alignWorkflow/SelectMatchesTransition.hh"
@@ -69,6 +69,7 @@ const flowcell::TileMetadataList sortByTotalReadLengthDesc(
 
 SelectMatchesTransition::SelectMatchesTransition(
         const unsigned ioOverlapParallelization,
+        const unsigned long batchClustersMax,
         alignment::matchSelector::FragmentStorage &fragmentStorage,
         const alignment::MatchDistribution &matchDistribution,
         const reference::SortedReferenceMetadataList &sortedReferenceMetadataList,
@@ -87,6 +88,7 @@ SelectMatchesTransition::SelectMatchesTransition(
         const unsigned tempLoadersMax,
         const unsigned tempSaversMax,
         const alignment::MatchTally &matchTally,
+        alignment::MatchArena *matchArena,
         const alignment::TemplateLengthStatistics &userTemplateLengthStatistics,
         const unsigned mapqThreshold,
         const bool perTileTls,
@@ -116,15 +118,24 @@ SelectMatchesTransition::SelectMatchesTransition(
       flowcellLayoutList_(flowcellLayoutList),
       ioOverlapThreads_(ioOverlapParallelization),
       nextUnprocessedTile_(processOrderTileMetadataList_.begin()),
+      batchClustersMax_(std::max<unsigned long>(batchClustersMax, flowcell::getMaxTileClusters(tileMetadataList_))),
+      batchTilesMax_(std::max<unsigned long>(1, batchClustersMax_ / std::max(1U, flowcell::getMaxTileClusters(tileMetadataList_)))),
       loadSlotAvailable_(true),
       flushSlotAvailable_(true),
       computeSlotAvailable_(true),
 
       matchTally_(matchTally),
-      threadMatches_(ioOverlapParallelization, std::vector<alignment::Match>(getMaxTileMatches(matchTally_))),
+      matchArena_(matchArena),
+      // arena hands over its own buffers, no need to preallocate
+      tileBuffers_(ioOverlapParallelization * batchTilesMax_,
+                   TileBuffer(matchArena_ ? 0 : getMaxTileMatches(tileMetadataList_, matchTally_),
+                              flowcell::getMaxTotalReadLength(flowcellLayoutList_) + flowcell::getMaxBarcodeLength(flowcellLayoutList_))),
+      threadBatchBuffers_(ioOverlapParallelization),
+      threadBatches_(ioOverlapParallelization),
+      groupThreads_(maxThreadCount),
+      matchGrouper_(groupThreads_, flowcell::getMaxTileClusters(tileMetadataList_), barcodeMetadataList.size()),
       fragmentStorage_(fragmentStorage),
       matchLoader_(matchLoadThreads_),
-      threadBclData_(ioOverlapParallelization, alignment::BclClusters(flowcell::getMaxTotalReadLength(flowcellLayoutList_) + flowcell::getMaxBarcodeLength(flowcellLayoutList_))),
       bclBaseCallsSource_(
           flowcellLayoutList_.end() == std::find_if(
               flowcellLayoutList_.begin(), flowcellLayoutList_.end(),
@@ -175,6 +186,7 @@ SelectMatchesTransition::SelectMatchesTransition(
           matchDistribution,
           sortedReferenceMetadataList,
         maxThreadCount,
+        batchTilesMax_,
         tileMetadataList,
         barcodeMetadataList,
         flowcellLayoutList,
@@ -198,8 +210,7 @@ SelectMatchesTransition::SelectMatchesTransition(
         minGapExtendScore,
         semialignedGapLimit,
         dodgyAlignmentScore),
-        qScoreBin_(qScoreBin),
-        fullBclQScoreTable_(fullBclQScoreTable),
+        qScoreBinner_(qScoreBin ? new rta::QScoreBinner(fullBclQScoreTable) : 0),
         forceTermination_(false)
 {
     ISAAC_TRACE_STAT("SelectMatchesTransition::SelectMatchesTransitions constructor begin ")
@@ -207,16 +218,48 @@ SelectMatchesTransition::SelectMatchesTransition(
     matchLoader_.reservePathBuffers(matchTally_.getMaxFilePathLength());
 
     ISAAC_TRACE_STAT("SelectMatchesTransition::SelectMatchesTransitions before bclMapper_.reserveClusters ")
-    BOOST_FOREACH(alignment::BclClusters &bclData, threadBclData_)
+    BOOST_FOREACH(TileBuffer &tileBuffer, tileBuffers_)
     {
-        bclData.reserveClusters(flowcell::getMaxTileClusters(tileMetadataList_), extractClusterXy);
+        tileBuffer.bclData_.reserveClusters(flowcell::getMaxTileClusters(tileMetadataList_), extractClusterXy);
+        freeTileBuffers_.push_back(&tileBuffer - &tileBuffers_.front());
     }
     ISAAC_TRACE_STAT("SelectMatchesTransition::SelectMatchesTransitions after bclData.reserveClusters ")
 
+    for (unsigned threadNumber = 0; ioOverlapParallelization > threadNumber; ++threadNumber)
+    {
+        threadBatchBuffers_[threadNumber].reserve(batchTilesMax_);
+        threadBatches_[threadNumber].reserve(batchTilesMax_);
+    }
+    ISAAC_THREAD_CERR << "Selecting up to " << batchTilesMax_ << " tiles or " << batchClustersMax_ <<
+        " clusters at a time" << std::endl;
+
     ISAAC_TRACE_STAT("SelectMatchesTransition::SelectMatchesTransitions constructor end ")
     ISAAC_THREAD_CERR << "Constructed the SelectMatchesTransition" << std::endl;
 }
 
+unsigned long SelectMatchesTransition::getBatchTileBytes(
+    const unsigned ioOverlapParallelization,
+    const TileMetadataList &tileMetadataList,
+    const flowcell::FlowcellLayoutList &flowcellLayoutList,
+    const alignment::MatchTally &matchTally,
+    const bool inMemoryMatches,
+    const bool bufferFragments,
+    const bool extractClusterXy)
+{
+    const unsigned long maxTileClusters = flowcell::getMaxTileClusters(tileMetadataList);
+    const unsigned long clusterBytes =
+        flowcell::getMaxTotalReadLength(flowcellLayoutList) + flowcell::getMaxBarcodeLength(flowcellLayoutList) +
+        (extractClusterXy ? sizeof(alignment::ClusterXy) : 0);
+    const unsigned long tileBufferBytes =
+        // arena hands over its own buffers
+        (inMemoryMatches ? 0 : getMaxTileMatches(tileMetadataList, matchTally) * sizeof(alignment::Match)) +
+        maxTileClusters * clusterBytes;
+    // the fragment collector and the flush buffer are both sized for the whole batch
+    const unsigned long fragmentBufferBytes = bufferFragments ?
+        2 * maxTileClusters * alignment::matchSelector::FragmentBuffer::getClusterBytes(flowcellLayoutList) : 0;
+    return ioOverlapParallelization * tileBufferBytes + fragmentBufferBytes;
+}
+
 void SelectMatchesTransition::selectMatches(
     const common::ScoopedMallocBlock::Mode memoryControl,
     const boost::filesystem::path &matchSelectorStatsXmlPath,
@@ -226,11 +269,14 @@ void SelectMatchesTransition::selectMatches(
         common::ScoopedMallocBlock  mallocBlock(memoryControl);
         nextUnprocessedTile_ = processOrderTileMetadataList_.begin();
         ioOverlapThreads_.execute(boost::bind(&SelectMatchesTransition::selectTileMatches, this, _1,
-                                              boost::ref(matchTally_), boost::ref(barcodeTemplateLengthStatistics), boost::ref(mallocBlock)));
+                                              boost::ref(matchTally_), boost::ref(barcodeTemplateLengthStatistics)));
 
         ISAAC_ASSERT_MSG(loadSlotAvailable_ && computeSlotAvailable_ && flushSlotAvailable_,
                          "All slots must be available after the processing threads are gone");
+        ISAAC_ASSERT_MSG(tileBuffers_.size() == freeTileBuffers_.size(),
+                         "All tile buffers must be returned after the processing threads are gone");
         matchSelector_.unreserve();
+        matchGrouper_.unreserve();
     }
 
     matchSelector_.dumpStats(matchSelectorStatsXmlPath);
@@ -239,65 +285,98 @@ void SelectMatchesTransition::selectMatches(
 }
 
 
-inline bool sortByTileBarcodeClusterLocation(const alignment::Match &lhs, const alignment::Match &rhs)
-{
-    return
-        lhs.seedId.getTileBarcodeCluster() < rhs.seedId.getTileBarcodeCluster() ||
-        (
-            (lhs.seedId.getTileBarcodeCluster() == rhs.seedId.getTileBarcodeCluster()) && (lhs.location < rhs.location ||
-                // same location for different seed numbers designates different locations for the fragment
-                // ensure consistency of results by ordering by the seed as well
-                (lhs.location == rhs.location && (lhs.seedId.getSeed() < rhs.seedId.getSeed())
-                )
-            )
-        );
-}
-
 void SelectMatchesTransition::loadClusters(
-    const unsigned threadNumber,
-    const flowcell::TileMetadata &tileMetadata)
+    const flowcell::TileMetadata &tileMetadata,
+    alignment::BclClusters &bclData)
 {
     const flowcell::Layout &flowcell = flowcellLayoutList_.at(tileMetadata.getFlowcellIndex());
+    // bcl sources bin while transposing. The others produce cluster-major data and are binned afterwards
+    bool binned = true;
     if (flowcell::Layout::Fastq == flowcell.getFormat())
     {
-        fastqBaseCallsSource_->loadClusters(tileMetadata, threadBclData_[threadNumber]);
+        fastqBaseCallsSource_->loadClusters(tileMetadata, bclData);
+        binned = false;
     }
     else if (flowcell::Layout::Bam == flowcell.getFormat())
     {
-        bamBaseCallsSource_->loadClusters(tileMetadata, threadBclData_[threadNumber]);
+        bamBaseCallsSource_->loadClusters(tileMetadata, bclData);
+        binned = false;
     }
     else if (flowcell::Layout::BclBgzf == flowcell.getFormat())
     {
-        bclBgzfBaseCallsSource_->loadClusters(processOrderTileMetadataList_, tileMetadata, threadBclData_[threadNumber]);
+        bclBgzfBaseCallsSource_->loadClusters(processOrderTileMetadataList_, tileMetadata, qScoreBinner_.get(), bclData);
     }
     else
     {
         ISAAC_ASSERT_MSG(flowcell::Layout::Bcl == flowcell.getFormat(), "Unsupported flowcell layout format " << flowcell.getFormat());
-        bclBaseCallsSource_->loadClusters(tileMetadata, threadBclData_[threadNumber]);
+        bclBaseCallsSource_->loadClusters(tileMetadata, qScoreBinner_.get(), bclData);
     }
 
-    // Bin QScore
-    if(qScoreBin_)
+    if (qScoreBinner_ && !binned && bclData.cluster(0) != bclData.end())
     {
         ISAAC_THREAD_CERR << "Binning qscores" << std::endl;
-        ISAAC_ASSERT_MSG(fullBclQScoreTable_.size() == 256, "QScore bin table incorrect size");
-        alignment::BclClusters &bclData = threadBclData_[threadNumber];
+        qScoreBinner_->bin(&*bclData.cluster(0), &*bclData.cluster(0) + (bclData.end() - bclData.cluster(0)));
+        ISAAC_THREAD_CERR << "Binning qscores done" << std::endl;
+    }
+}
 
-        for(std::vector<char>::iterator itr = bclData.cluster(0); itr != bclData.end(); ++itr)
+/**
+ * \brief Loads the consecutive unprocessed tiles as long as they fit into the batch limits. Tiles without
+ *        matches are skipped.
+ *
+ * \pre load slot is acquired
+ */
+void SelectMatchesTransition::loadBatch(
+    const unsigned threadNumber,
+    const alignment::MatchTally &matchTally)
+{
+    std::vector<unsigned> &batchBuffers = threadBatchBuffers_[threadNumber];
+    alignment::MatchSelector::Batch &batch = threadBatches_[threadNumber];
+    ISAAC_ASSERT_MSG(batchBuffers.empty() && batch.empty(), "Previous batch has not been released");
+
+    unsigned long batchClusters = 0;
+    while (processOrderTileMetadataList_.end() != nextUnprocessedTile_ && batchTilesMax_ > batch.size() &&
+        (batch.empty() || batchClustersMax_ >= batchClusters + nextUnprocessedTile_->getClusterCount()))
+    {
+        const flowcell::TileMetadata &tileMetadata = *nextUnprocessedTile_++;
+        const unsigned tileBufferIndex = acquireTileBuffer();
+        batchBuffers.push_back(tileBufferIndex);
+        TileBuffer &tileBuffer = tileBuffers_[tileBufferIndex];
+
+        if (matchArena_)
         {
-            const int xx = int((unsigned char)*itr);
-            *itr = fullBclQScoreTable_[xx];
+            matchArena_->extractTileMatches(tileMetadata.getIndex(), tileBuffer.matches_);
+            ISAAC_THREAD_CERR << "Taken " << tileBuffer.matches_.size() << " in-memory matches for " << tileMetadata << std::endl;
         }
-        ISAAC_THREAD_CERR << "Binning qscores done" << std::endl;
+        else
+        {
+            ISAAC_THREAD_CERR << "Loading matches for " << tileMetadata << std::endl;
+            matchLoader_.load(matchTally.getFileTallyList(tileMetadata), tileBuffer.matches_);
+            ISAAC_THREAD_CERR << "Loading matches done for " << tileMetadata << std::endl;
+        }
+
+        if(tileBuffer.matches_.empty())
+        {
+            // The processing code below does not handle empty data too well.
+            batchBuffers.pop_back();
+            boost::unique_lock<boost::mutex> lock(slotMutex_);
+            freeTileBuffers_.push_back(tileBufferIndex);
+            continue;
+        }
+
+        loadClusters(tileMetadata, tileBuffer.bclData_);
+        batch.push_back(alignment::MatchSelector::BatchTile(tileMetadata, tileBuffer.matches_, tileBuffer.bclData_));
+        batchClusters += tileMetadata.getClusterCount();
     }
 }
 
 void SelectMatchesTransition::selectTileMatches(
     const unsigned threadNumber,
     const alignment::MatchTally &matchTally,
-    std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics,
-    common::ScoopedMallocBlock &mallocBlock)
+    std::vector<alignment::TemplateLengthStatistics> &barcodeTemplateLengthStatistics)
 {
+    std::vector<unsigned> &batchBuffers = threadBatchBuffers_[threadNumber];
+    alignment::MatchSelector::Batch &batch = threadBatches_[threadNumber];
     while (true)
     {
         acquireLoadSlot();
@@ -307,41 +386,42 @@ void SelectMatchesTransition::selectTileMatches(
             return;
         }
 
-        const flowcell::TileMetadata &tileMetadata = *nextUnprocessedTile_++;
-
         ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&SelectMatchesTransition::releaseLoadSlot, this, _1))
         {
-
-            ISAAC_THREAD_CERR << "Loading matches for " << tileMetadata << std::endl;
-            matchLoader_.load(matchTally.getFileTallyList(tileMetadata), threadMatches_[threadNumber]);
-            ISAAC_THREAD_CERR << "Loading matches done for " << tileMetadata << std::endl;
-
-            if(threadMatches_[threadNumber].empty())
-            {
-                // The processing code below does not handle empty data too well.
-                continue;
-            }
-
-            loadClusters(threadNumber, tileMetadata);
+            loadBatch(threadNumber, matchTally);
         }
 
-            // sort the matches by SeedId and reference position.
-//            ISAAC_THREAD_CERR << "Sorting matches for " << tileMetadata << std::endl;
-//            std::sort(threadMatches_[threadNumber].begin(), threadMatches_[threadNumber].end(), sortByTileBarcodeClusterLocation);
-//            ISAAC_THREAD_CERR << "Sorting matches done for " << tileMetadata << std::endl;
+        if (batch.empty())
+        {
+            // all tiles of the batch were without matches
+            continue;
+        }
 
         acquireComputeSlot();
         ISAAC_BLOCK_WITH_CLENAUP(boost::bind(&SelectMatchesTransition::releaseComputeSlot, this, _1))
         {
-            // sort the matches by SeedId and reference position
-            ISAAC_THREAD_CERR << "Sorting matches by barcode for " << tileMetadata << std::endl;
+            for (unsigned batchTileIndex = 0; batch.size() > batchTileIndex; ++batchTileIndex)
             {
-                common::ScoopedMallocBlockUnblock unblock(mallocBlock);
-                common::parallelSort(threadMatches_[threadNumber], sortByTileBarcodeClusterLocation);
+                const flowcell::TileMetadata &tileMetadata = *batch[batchTileIndex].tileMetadata_;
+                // order the matches by barcode, cluster and reference position
+                ISAAC_THREAD_CERR << "Grouping matches by barcode for " << tileMetadata << std::endl;
+                matchGrouper_.group(tileMetadata.getClusterCount(), tileBuffers_[batchBuffers[batchTileIndex]].matches_);
+                ISAAC_THREAD_CERR << "Grouping matches by barcode done for " << tileMetadata << std::endl;
             }
-            ISAAC_THREAD_CERR << "Sorting matches by barcode done for " << tileMetadata << std::endl;
 
-            matchSelector_.parallelSelect(matchTally, barcodeTemplateLengthStatistics, tileMetadata, threadMatches_[threadNumber], threadBclData_[threadNumber]);
+            matchSelector_.parallelSelect(matchTally, barcodeTemplateLengthStatistics, batch);
+
+            // the fragments are in the fragment storage now, the tile buffers can be reused for loading
+            batch.clear();
+            if (matchArena_)
+            {
+                // in-memory matches are not coming back, don't keep them until the buffer gets reused
+                BOOST_FOREACH(const unsigned tileBufferIndex, batchBuffers)
+                {
+                    std::vector<alignment::Match>().swap(tileBuffers_[tileBufferIndex].matches_);
+                }
+            }
+            releaseTileBuffers(batchBuffers);
 
             // There are only two sets of thread fragment dispatcher buffers (the one being flushed and the one we've just filled)
             // Wait for exclusive flush buffers access and swap the buffers before giving up the compute slot
@@ -0,0 +1,91 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace std;
+
+#include "RegistryName.hh"
+#include "testAlignDaemon.hh"
+
+#include "workflow/AlignDaemon.hh"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION( TestAlignDaemon, registryName("AlignDaemon"));
+
+void TestAlignDaemon::setUp()
+{
+    spoolDirectory_ = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("testAlignDaemon-%%%%-%%%%");
+    boost::filesystem::create_directories(spoolDirectory_);
+}
+
+void TestAlignDaemon::tearDown()
+{
+    boost::filesystem::remove_all(spoolDirectory_);
+}
+
+void TestAlignDaemon::submit(const std::string &name, const std::string &arguments) const
+{
+    std::ofstream os((spoolDirectory_ / (name + ".job")).c_str());
+    os << arguments;
+}
+
+static std::string readFile(const boost::filesystem::path &path)
+{
+    std::ifstream is(path.c_str());
+    return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+void TestAlignDaemon::testFailedJob()
+{
+    // nothing runs without a reference
+    submit("job", "--no-such-option\n");
+    isaac::workflow::AlignDaemon(spoolDirectory_, 0, 1).run();
+
+    CPPUNIT_ASSERT(!boost::filesystem::exists(spoolDirectory_ / "job.job"));
+    CPPUNIT_ASSERT(!boost::filesystem::exists(spoolDirectory_ / "job.running"));
+    CPPUNIT_ASSERT(!boost::filesystem::exists(spoolDirectory_ / "job.done"));
+    const std::string failed = readFile(spoolDirectory_ / "job.failed");
+    // the error follows the arguments
+    CPPUNIT_ASSERT_EQUAL(std::string("--no-such-option\nError: "), failed.substr(0, 24));
+}
+
+void TestAlignDaemon::testJobOrder()
+{
+    submit("b", "--no-such-option\n");
+    submit("a", "--no-such-option\n");
+    // job still being written by the submitter
+    std::ofstream os((spoolDirectory_ / "c.job.tmp").c_str());
+    os << "--no-such-option\n";
+    os.close();
+
+    isaac::workflow::AlignDaemon(spoolDirectory_, 0, 1).run();
+    CPPUNIT_ASSERT(boost::filesystem::exists(spoolDirectory_ / "a.failed"));
+    CPPUNIT_ASSERT(boost::filesystem::exists(spoolDirectory_ / "b.job"));
+
+    isaac::workflow::AlignDaemon(spoolDirectory_, 0, 1).run();
+    CPPUNIT_ASSERT(boost::filesystem::exists(spoolDirectory_ / "b.failed"));
+    CPPUNIT_ASSERT(boost::filesystem::exists(spoolDirectory_ / "c.job.tmp"));
+}
+
+void TestAlignDaemon::testStop()
+{
+    submit("job", "--no-such-option\n");
+    std::ofstream stop((spoolDirectory_ / "stop").c_str());
+    stop.close();
+
+    // returns without waiting for the job to be taken
+    isaac::workflow::AlignDaemon(spoolDirectory_, 0, 0).run();
+    CPPUNIT_ASSERT(boost::filesystem::exists(spoolDirectory_ / "job.job"));
+}
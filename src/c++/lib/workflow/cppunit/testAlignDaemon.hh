@@ -0,0 +1,42 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **/
+
+#ifndef iSAAC_WORKFLOW_TEST_ALIGN_DAEMON_HH
+#define iSAAC_WORKFLOW_TEST_ALIGN_DAEMON_HH
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+class TestAlignDaemon : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( TestAlignDaemon );
+    CPPUNIT_TEST( testFailedJob );
+    CPPUNIT_TEST( testJobOrder );
+    CPPUNIT_TEST( testStop );
+    CPPUNIT_TEST_SUITE_END();
+private:
+    boost::filesystem::path spoolDirectory_;
+
+    void submit(const std::string &name, const std::string &arguments) const;
+public:
+    void setUp();
+    void tearDown();
+    void testFailedJob();
+    void testJobOrder();
+    void testStop();
+};
+
+#endif // #ifndef iSAAC_WORKFLOW_TEST_ALIGN_DAEMON_HH
@@ -0,0 +1,66 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file extendReference.cpp
+ **
+ ** \brief Adds separately sorted contigs to an existing sorted reference.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include "oligo/Kmer.hh"
+#include "options/ExtendReferenceOptions.hh"
+#include "reference/ReferenceExtender.hh"
+#include "reference/SortedReferenceXml.hh"
+
+template <typename KmerT>
+void extendReferenceT(const isaac::options::ExtendReferenceOptions &options)
+{
+    const isaac::reference::SortedReferenceMetadata reference =
+        isaac::reference::loadSortedReferenceXml(options.referenceGenome);
+    const isaac::reference::SortedReferenceMetadata added =
+        isaac::reference::loadSortedReferenceXml(options.addedReference);
+    isaac::reference::ReferenceExtender<KmerT> referenceExtender(
+        reference,
+        added,
+        options.outputDirectory,
+        options.repeatThreshold,
+        options.annotate,
+        options.parallelSort,
+        options.jobs);
+    isaac::reference::saveSortedReferenceXml(options.outputFile, referenceExtender.run());
+}
+
+void extendReference(const isaac::options::ExtendReferenceOptions &options)
+{
+    if (16 == options.seedLength)
+    {
+        extendReferenceT<isaac::oligo::ShortKmerType>(options);
+    }
+    else if (32 == options.seedLength)
+    {
+        extendReferenceT<isaac::oligo::KmerType>(options);
+    }
+    else if (64 == options.seedLength)
+    {
+        extendReferenceT<isaac::oligo::LongKmerType>(options);
+    }
+    else
+    {
+        ISAAC_ASSERT_MSG(false, "Unexpected seedLength " << options.seedLength)
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    isaac::common::run(extendReference, argc, argv);
+}
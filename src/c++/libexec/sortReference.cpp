@@ -26,11 +26,14 @@ void sortReferenceT(const isaac::options::SortReferenceOptions &options)
 {
     isaac::reference::ReferenceSorter<KmerT> referenceSorter(
         options.maskWidth,
-        options.mask,
+        options.masks,
         options.genomeFile,
         options.genomeNeighborsFile,
-        options.outFile,
-        options.repeatThreshold);
+        options.outFiles,
+        options.repeatThreshold,
+        options.tempDirectory,
+        options.memoryLimit * 1024 * 1024 * 1024,
+        options.jobs);
     referenceSorter.run();
 }
 
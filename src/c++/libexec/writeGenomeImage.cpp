@@ -0,0 +1,45 @@
+/**
+ ** Isaac Genome Alignment Software
+ ** Copyright (c) 2010-2014 Illumina, Inc.
+ ** All rights reserved.
+ **
+ ** This software is provided under the terms and conditions of the
+ ** BSD 2-Clause License
+ **
+ ** You should have received a copy of the BSD 2-Clause License
+ ** along with this program. If not, see
+ ** <https://github.com/sequencing/licenses/>.
+ **
+ ** \file writeGenomeImage.cpp
+ **
+ ** Packs the contigs of a sorted reference into a genome image that aligners can map
+ ** instead of parsing the fasta.
+ **
+ ** \author Roman Petrovski
+ **/
+
+#include <boost/thread.hpp>
+
+#include "common/Threads.hpp"
+#include "options/WriteGenomeImageOptions.hh"
+#include "reference/ContigLoader.hh"
+#include "reference/GenomeImage.hh"
+#include "reference/SortedReferenceXml.hh"
+
+void writeGenomeImage(const isaac::options::WriteGenomeImageOptions &options)
+{
+    const isaac::reference::SortedReferenceMetadata sortedReferenceMetadata =
+        isaac::reference::loadSortedReferenceXml(options.sortedReferenceMetadata_);
+
+    isaac::common::ThreadVector threads(boost::thread::hardware_concurrency());
+    const std::vector<isaac::reference::Contig> contigs =
+        isaac::reference::loadContigs(sortedReferenceMetadata.getContigs(), threads);
+
+    isaac::reference::GenomeImage::write(options.outputFilePath_, sortedReferenceMetadata.getContigs(), contigs);
+    ISAAC_THREAD_CERR << "Genome image written to " << options.outputFilePath_ << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    isaac::common::run(writeGenomeImage, argc, argv);
+}
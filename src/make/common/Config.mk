@@ -105,6 +105,10 @@ TEMP_DIR:=Temp
 #########################################################
 # tools
 
+# ... extendReference
+EXTEND_REFERENCE:=$(LIBEXEC_DIR)/extendReference
+# ...
+
 # ... extractNeighbors
 EXTRACT_NEIGHBORS:=$(LIBEXEC_DIR)/extractNeighbors
 # ...
@@ -129,6 +133,10 @@ REORDER_REFERENCE:=$(BIN_DIR)/isaac-reorder-reference
 SORT_REFERENCE:=$(LIBEXEC_DIR)/sortReference
 # ...
 
+# ... writeGenomeImage
+WRITE_GENOME_IMAGE:=$(LIBEXEC_DIR)/writeGenomeImage
+# ...
+
 # ... GetSupportedSeedLengths.xsl
 GET_SUPPORTED_SEED_LENGTHS_XSL:=$(DATA_DIR)/xsl/reference/GetSupportedSeedLengths.xsl
 # ...
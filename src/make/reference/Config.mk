@@ -28,5 +28,9 @@ MASK_FILE_SUFFIX=.dat
 MASK_TMP_FILE_SUFFIX=.orig
 
 REPEAT_THRESHOLD:=1000
+# threads and gigabytes of RAM for sortReference. Empty memory limit lets sortReference use half of the
+# physical RAM. 0 keeps all k-mers in RAM
+SORT_JOBS:=1
+SORT_MEMORY_LIMIT:=
 CURRENT_REFERENCE_FORMAT_VERSION:=3
 
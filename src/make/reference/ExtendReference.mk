@@ -0,0 +1,117 @@
+################################################################################
+##
+## Isaac Genome Alignment Software
+## Copyright (c) 2010-2014 Illumina, Inc.
+## All rights reserved.
+##
+## This software is provided under the terms and conditions of the
+## BSD 2-Clause License
+##
+## You should have received a copy of the BSD 2-Clause License
+## along with this program. If not, see
+## <https://github.com/sequencing/licenses/>.
+##
+################################################################################
+##
+## file ExtendReference.mk
+##
+## brief Adds the contigs of GENOME_FILE to the sorted reference REFERENCE_XML
+##       without re-sorting the existing contigs
+##
+## author Roman Petrovski
+##
+################################################################################
+
+# first target needs to be defined in the beginning. Ohterwise includes such as
+# Log.mk cause unexpected behavior
+firsttarget: all
+
+MAKEFILES_DIR:=@iSAAC_HOME@@iSAAC_FULL_DATADIR@/makefiles
+
+# Import the global configuration
+include $(MAKEFILES_DIR)/common/Config.mk
+
+include $(MAKEFILES_DIR)/common/Sentinel.mk
+
+# Import the logging functionalities
+include $(MAKEFILES_DIR)/common/Log.mk
+
+# Import the debug functionalities
+include $(MAKEFILES_DIR)/common/Debug.mk
+
+include $(MAKEFILES_DIR)/reference/Config.mk
+
+include config.mk
+
+ifeq (,$(MASK_WIDTH))
+$(error "MASK_WIDTH is not defined")
+endif
+
+ifeq (,$(GENOME_FILE))
+$(error "GENOME_FILE is not defined")
+endif
+
+ifeq (,$(REFERENCE_XML))
+$(error "REFERENCE_XML is not defined")
+endif
+
+MASK_COUNT:=$(shell $(AWK) 'BEGIN{print 2^$(MASK_WIDTH)}')
+MASK_LIST:=$(wordlist 1, $(MASK_COUNT), $(shell $(SEQ) --equal-width 0 $(MASK_COUNT)))
+
+GENOME_NAME:=$(if $(GENOME_NAME),$(GENOME_NAME),$(notdir $(GENOME_FILE)))
+
+MASK_FILE_PREFIX:=$(GENOME_NAME)-$(SEED_LENGTH)mer-$(MASK_WIDTH)bit-
+SORTED_REFERENCE_XML:=sorted-reference.xml
+ADDED_CONTIGS_XML:=added-contigs.xml
+ADDED_REFERENCE_XML:=added-reference.xml
+GENOME_IMAGE:=genome-image.dat
+GENOME_NEIGHBORS_DAT:=genome-neighbors.1bpb
+GENOME_NEIGHBORS_DAT_PATTERN:=genome-neighbors%1bpb
+HIGH_REPEATS_DAT:=repeats-$(REPEAT_THRESHOLD).1bpb
+HIGH_REPEATS_DAT_PATTERN:=repeats-$(REPEAT_THRESHOLD)%1bpb
+
+# the added contigs are sorted without repeat threshold as the repeats are counted against the whole genome
+# when they are merged into the existing mask files
+ADDED_MASK_XMLS:=$(TEMP_DIR)/$(MASK_FILE_PREFIX)all$(MASK_FILE_XML_SUFFIX)
+NO_REPEAT_THRESHOLD:=4294967295
+
+$(ADDED_MASK_XMLS): $(GENOME_FILE) $(TEMP_DIR)/.sentinel
+	$(CMDPREFIX) $(SORT_REFERENCE) -g $(GENOME_FILE) --mask-width $(MASK_WIDTH) \
+		$(foreach m, $(MASK_LIST), --mask $(m) --output-file $(TEMP_DIR)/$(MASK_FILE_PREFIX)$(m)$(MASK_FILE_SUFFIX)) \
+		--seed-length $(SEED_LENGTH) \
+		--jobs $(SORT_JOBS) $(if $(SORT_MEMORY_LIMIT),--memory-limit $(SORT_MEMORY_LIMIT)) --temp-directory $(TEMP_DIR) \
+		--repeat-threshold $(NO_REPEAT_THRESHOLD) >$(SAFEPIPETARGET)
+
+$(TEMP_DIR)/$(ADDED_CONTIGS_XML): $(GENOME_FILE) $(TEMP_DIR)/.sentinel
+	$(CMDPREFIX) $(PRINT_CONTIGS) -g $(GENOME_FILE) >$(SAFEPIPETARGET)
+
+$(TEMP_DIR)/$(ADDED_REFERENCE_XML): $(TEMP_DIR)/$(ADDED_CONTIGS_XML) $(ADDED_MASK_XMLS)
+	$(CMDPREFIX) $(MERGE_REFERENCES) $(foreach part, $^, -i '$(part)') -o $(SAFEPIPETARGET)
+
+$(SORTED_REFERENCE_XML): $(REFERENCE_XML) $(TEMP_DIR)/$(ADDED_REFERENCE_XML)
+	$(CMDPREFIX) $(EXTEND_REFERENCE) -r $(REFERENCE_XML) -a $(TEMP_DIR)/$(ADDED_REFERENCE_XML) \
+		--seed-length $(SEED_LENGTH) \
+		--repeat-threshold $(REPEAT_THRESHOLD) \
+		--annotate $(if $(filter false,$(DONT_ANNOTATE)),1,0) \
+		--parallel-sort $(PARALLEL_SORT) \
+		--jobs $(SORT_JOBS) \
+		--output-directory $(CURDIR) -o $(SAFEPIPETARGET)
+
+$(GENOME_IMAGE): $(SORTED_REFERENCE_XML)
+	$(CMDPREFIX) $(WRITE_GENOME_IMAGE) --reference-genome $< --output-file $(SAFEPIPETARGET)
+
+ifeq (false,$(DONT_ANNOTATE))
+$(GENOME_NEIGHBORS_DAT_PATTERN) $(HIGH_REPEATS_DAT_PATTERN): $(SORTED_REFERENCE_XML)
+	$(CMDPREFIX) $(EXTRACT_NEIGHBORS) --reference-genome $< \
+		--seed-length $(SEED_LENGTH) \
+		--output-file $(GENOME_NEIGHBORS_DAT).tmp --high-repeats-file $(HIGH_REPEATS_DAT).tmp && \
+	$(MV) $(GENOME_NEIGHBORS_DAT).tmp $(GENOME_NEIGHBORS_DAT) && \
+	$(MV) $(HIGH_REPEATS_DAT).tmp $(HIGH_REPEATS_DAT)
+
+all: $(SORTED_REFERENCE_XML) $(GENOME_NEIGHBORS_DAT) $(HIGH_REPEATS_DAT) $(GENOME_IMAGE)
+	$(CMDPREFIX) $(LOG_INFO) "All done!"
+else
+all: $(SORTED_REFERENCE_XML) $(GENOME_IMAGE)
+	$(CMDPREFIX) $(LOG_INFO) "All done!"
+endif
+
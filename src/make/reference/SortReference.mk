@@ -59,6 +59,8 @@ GENOME_NAME:=$(if $(GENOME_NAME),$(GENOME_NAME),$(notdir $(GENOME_FILE)))
 MASK_FILE_PREFIX:=$(GENOME_NAME)-$(SEED_LENGTH)mer-$(MASK_WIDTH)bit-
 SORTED_REFERENCE_XML:=sorted-reference.xml
 CONTIGS_XML:=contigs.xml
+# 2-bit packed contigs mapped by the aligner instead of parsing the fasta
+GENOME_IMAGE:=genome-image.dat
 # actual kmers that have neighbors in the genome 
 NEIGHBORS_DAT:=neighbors.dat
 GENOME_NEIGHBORS_DAT:=genome-neighbors.1bpb
@@ -66,17 +68,14 @@ GENOME_NEIGHBORS_DAT_PATTERN:=genome-neighbors%1bpb
 HIGH_REPEATS_DAT:=repeats-$(REPEAT_THRESHOLD).1bpb
 HIGH_REPEATS_DAT_PATTERN:=repeats-$(REPEAT_THRESHOLD)%1bpb
 
-mask=$(word 1,$(subst -, ,$(@:$(TEMP_DIR)/$(MASK_FILE_PREFIX)%$(MASK_FILE_XML_SUFFIX)=%)))
-mask_file=$(@:$(TEMP_DIR)/%$(MASK_FILE_XML_SUFFIX)=%$(MASK_FILE_SUFFIX))
-
-ALL_MASK_XMLS:=$(foreach m, $(MASK_LIST), $(TEMP_DIR)/$(MASK_FILE_PREFIX)$(m)$(MASK_FILE_XML_SUFFIX))
-ALL_MASKS:=$(foreach m, $(MASK_LIST), $(MASK_FILE_PREFIX)$(m)$(MASK_FILE_SUFFIX))
-ALL_MASKS_TMP:=$(foreach m, $(MASK_LIST), $(MASK_FILE_PREFIX)$(m)$(MASK_TMP_FILE_SUFFIX))
+# all masks are produced by a single sortReference pass over the genome
+ALL_MASK_XMLS:=$(TEMP_DIR)/$(MASK_FILE_PREFIX)all$(MASK_FILE_XML_SUFFIX)
 
 $(ALL_MASK_XMLS): $(GENOME_FILE) $(TEMP_DIR)/.sentinel
-	$(CMDPREFIX) $(SORT_REFERENCE) -g $(GENOME_FILE) --mask-width $(MASK_WIDTH) --mask $(mask) \
+	$(CMDPREFIX) $(SORT_REFERENCE) -g $(GENOME_FILE) --mask-width $(MASK_WIDTH) \
+		$(foreach m, $(MASK_LIST), --mask $(m) --output-file $(TEMP_DIR)/$(MASK_FILE_PREFIX)$(m)$(MASK_FILE_SUFFIX)) \
 		--seed-length $(SEED_LENGTH) \
-		--output-file $(TEMP_DIR)/$(mask_file) \
+		--jobs $(SORT_JOBS) $(if $(SORT_MEMORY_LIMIT),--memory-limit $(SORT_MEMORY_LIMIT)) --temp-directory $(TEMP_DIR) \
 		--repeat-threshold $(REPEAT_THRESHOLD) >$(SAFEPIPETARGET)
 
 $(TEMP_DIR)/$(CONTIGS_XML): $(GENOME_FILE) $(TEMP_DIR)/.sentinel
@@ -85,6 +84,9 @@ $(TEMP_DIR)/$(CONTIGS_XML): $(GENOME_FILE) $(TEMP_DIR)/.sentinel
 $(TEMP_DIR)/$(SORTED_REFERENCE_XML): $(TEMP_DIR)/$(CONTIGS_XML) $(ALL_MASK_XMLS)
 	$(CMDPREFIX) $(MERGE_REFERENCES) $(foreach part, $^, -i '$(part)') -o $(SAFEPIPETARGET)
 
+$(GENOME_IMAGE): $(SORTED_REFERENCE_XML)
+	$(CMDPREFIX) $(WRITE_GENOME_IMAGE) --reference-genome $< --output-file $(SAFEPIPETARGET)
+
 ifeq (false,$(DONT_ANNOTATE))
 $(SORTED_REFERENCE_XML):$(TEMP_DIR)/$(SORTED_REFERENCE_XML)
 	$(CMDPREFIX) $(FIND_NEIGHBORS) -i $< -t $(TEMP_DIR)/$(NEIGHBORS_DAT) \
@@ -99,13 +101,13 @@ $(GENOME_NEIGHBORS_DAT_PATTERN) $(HIGH_REPEATS_DAT_PATTERN): $(SORTED_REFERENCE_
 	$(MV) $(GENOME_NEIGHBORS_DAT).tmp $(GENOME_NEIGHBORS_DAT) && \
 	$(MV) $(HIGH_REPEATS_DAT).tmp $(HIGH_REPEATS_DAT)
 
-all: $(SORTED_REFERENCE_XML) $(GENOME_NEIGHBORS_DAT) $(HIGH_REPEATS_DAT)
+all: $(SORTED_REFERENCE_XML) $(GENOME_NEIGHBORS_DAT) $(HIGH_REPEATS_DAT) $(GENOME_IMAGE)
 	$(CMDPREFIX) $(LOG_INFO) "All done!"
 else
 $(SORTED_REFERENCE_XML):$(TEMP_DIR)/$(SORTED_REFERENCE_XML)
 	$(CMDPREFIX) $(CP) $< $(SAFEPIPETARGET)
 
-all: $(SORTED_REFERENCE_XML)
+all: $(SORTED_REFERENCE_XML) $(GENOME_IMAGE)
 	$(CMDPREFIX) $(LOG_INFO) "All done!"
 endif
 